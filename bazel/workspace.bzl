@@ -96,6 +96,33 @@ def pynini_repositories(name = ""):
         urls = ["https://github.com/abseil/abseil-py/archive/master.zip"],
     )
 
+    # -------------------------------------------------------------------------
+    # Google Benchmark - C++ microbenchmarking library, used by the benchmarks
+    # of core grammar operations:
+    # -------------------------------------------------------------------------
+    benchmark_version = "1.7.1"
+
+    http_archive(
+        name = "com_github_google_benchmark",
+        urls = ["https://github.com/google/benchmark/archive/refs/tags/v%s.tar.gz"
+                % benchmark_version],
+        sha256 = "6430e4092653380d9dc4ccb45a1e2dc9259d581f4866dc0759713126056bc1d7",
+        strip_prefix = "benchmark-%s" % benchmark_version,
+    )
+
+    # -------------------------------------------------------------------------
+    # GoogleTest - C++ testing framework, used by the tests of the extensions:
+    # -------------------------------------------------------------------------
+    googletest_version = "1.12.1"
+
+    http_archive(
+        name = "com_google_googletest",
+        urls = ["https://github.com/google/googletest/archive/refs/tags/release-%s.tar.gz"
+                % googletest_version],
+        sha256 = "81964fe578e9bd7c94dfdb09c8e4d6e6759e19967e397dbea48d1c10e45d0df2",
+        strip_prefix = "googletest-release-%s" % googletest_version,
+    )
+
     # -------------------------------------------------------------------------
     # OpenFst: See
     #    http://www.openfst.org/twiki/pub/FST/FstDownload/README
@@ -27,6 +27,8 @@ from cython.operator cimport address as addr       # &foo
 from cython.operator cimport dereference as deref  # *foo
 from cython.operator cimport preincrement as inc   # ++foo
 
+from cpython.buffer cimport PyBuffer_FillInfo
+
 from libcpp cimport bool
 from libcpp.memory cimport static_pointer_cast
 from libcpp.memory cimport unique_ptr
@@ -76,6 +78,8 @@ from _pywrapfst cimport _get_WeightClass_or_zero
 from _pywrapfst cimport _get_compose_filter
 from _pywrapfst cimport _get_queue_type
 from _pywrapfst cimport _get_replace_label_type
+from _pywrapfst cimport _init_SymbolTable
+from _pywrapfst cimport _init_XFst
 from _pywrapfst cimport equal
 from _pywrapfst cimport replace as _replace
 from _pywrapfst cimport tostring
@@ -83,12 +87,22 @@ from _pywrapfst cimport path_tostring
 
 # C++ code for Pynini not from fst_util.
 
+from cpynini cimport BatchOptimalRewrites
+from cpynini cimport BatchRewrites
+from cpynini cimport BatchTopRewrite
+from cpynini cimport BatchTopRewrites
 from cpynini cimport CDRewriteCompile
+from cpynini cimport CDRewriteCompileDelayed
+from cpynini cimport CDRewriteCompileLabelClass
+from cpynini cimport CDRewriteCompileMany
 from cpynini cimport CDRewriteDirection as _CDRewriteDirection
 from cpynini cimport CDRewriteMode as _CDRewriteMode
 from cpynini cimport ConcatRange
+from cpynini cimport ConcatRangeDelayed
 from cpynini cimport Cross
+from cpynini cimport CrossDelayed
 from cpynini cimport Escape
+from cpynini cimport FstFingerprint
 from cpynini cimport GeneratedSymbols
 from cpynini cimport GetCDRewriteDirection
 from cpynini cimport GetDefaultSymbols
@@ -96,13 +110,21 @@ from cpynini cimport GetDefaultTokenType
 from cpynini cimport GetCDRewriteMode
 from cpynini cimport GetPdtComposeFilter
 from cpynini cimport GetPdtParserType
+from cpynini cimport LenientComposerClass
 from cpynini cimport LenientlyCompose
+from cpynini cimport LevenshteinAutomatonClass
 from cpynini cimport MPdtCompose
 from cpynini cimport MPdtComposeOptions
 from cpynini cimport MPdtExpand
 from cpynini cimport MPdtExpandOptions
 from cpynini cimport MPdtReverse
+from cpynini cimport Matches
+from cpynini cimport MemoryStats as _MemoryStats
+from cpynini cimport MemoryUsage
 from cpynini cimport Optimize
+from cpynini cimport OptimizeLimits
+from cpynini cimport OptimizePhaseStats
+from cpynini cimport OptimizeStats as _OptimizeStats
 from cpynini cimport OptimizeDifferenceRhs
 from cpynini cimport PdtCompose
 from cpynini cimport PdtComposeFilter
@@ -116,6 +138,12 @@ from cpynini cimport PdtShortestPath
 from cpynini cimport PdtShortestPathOptions
 from cpynini cimport ReadLabelPairs
 from cpynini cimport ReadLabelTriples
+from cpynini cimport RewriteCache as _RewriteCache
+from cpynini cimport RewriteCacheKey
+from cpynini cimport RewriteStats as _RewriteStats
+from cpynini cimport RuleCascadeClass
+from cpynini cimport ScopedFstMemoryMap
+from cpynini cimport ShortestStringIteratorClass
 from cpynini cimport StringCompile
 from cpynini cimport PopDefaults
 from cpynini cimport PushDefaults
@@ -123,7 +151,12 @@ from cpynini cimport StringFileCompile
 from cpynini cimport StringMapCompile
 from cpynini cimport StringPathIteratorClass
 from cpynini cimport StringPrint
+from cpynini cimport StringViewRewriteLattice
+from cpynini cimport StringViewTopRewrite
+from cpynini cimport TaggerClass
 from cpynini cimport TokenType as _TokenType
+from cpynini cimport ViewConstFst
+from cpynini cimport WriteConstFstImage
 from cpynini cimport WriteLabelPairs
 from cpynini cimport WriteLabelTriples
 from cpynini cimport kBosIndex
@@ -143,6 +176,7 @@ import contextlib
 import functools
 import io
 import os
+import pickle
 
 from _pywrapfst import FstArgError
 from _pywrapfst import FstIOError
@@ -278,6 +312,35 @@ cdef PdtParserType _get_pdt_parser_type(const string &pdt_parser_type) except *:
   return _pdt_parser_type
 
 
+cdef void _get_token_type_and_symbols(
+    token_type,
+    _TokenType *_token_type,
+    const_SymbolTable_ptr *_symbols) except *:
+  """Resolves a token type argument to a TokenType and symbol table.
+
+  Args:
+    token_type: None (in which case the defaults are used), a SymbolTable, or
+        a string matching a known token type.
+    _token_type: Output TokenType.
+    _symbols: Output symbol table pointer, which is NULL unless the token type
+        is a SymbolTable.
+
+  Raises:
+    FstArgError: Unknown token type.
+
+  This function is not visible to Python users.
+  """
+  if token_type is None:
+    _token_type[0] = GetDefaultTokenType()
+    _symbols[0] = GetDefaultSymbols()
+  elif isinstance(token_type, _pywrapfst.SymbolTableView):
+    _token_type[0] = _TokenType.SYMBOL
+    _symbols[0] = (<_SymbolTableView> token_type)._raw_ptr_or_raise()
+  else:
+    _token_type[0] = _get_token_type(tostring(token_type))
+    _symbols[0] = NULL
+
+
 cdef void _maybe_arcsort(MutableFstClass *fst1, MutableFstClass *fst2):
   """Arc-sorts two FST arguments for composition, if necessary.
 
@@ -299,7 +362,9 @@ class default_token_type(contextlib.ContextDecorator):
   """Override the default token_type used by Pynini functions and classes.
 
   A context manager and context decorator to temporarily override the default
-  token_type used by Pynini functions and classes.
+  token_type used by Pynini functions and classes. The override only applies to
+  the calling thread; other threads, including ones started within the
+  context, continue to use their own defaults.
 
   Args:
     token_type: A string indicating how the string is to be constructed from
@@ -332,6 +397,194 @@ class default_token_type(contextlib.ContextDecorator):
     PopDefaults()
 
 
+def get_default_token_type():
+  """
+  get_default_token_type()
+
+  Returns the default token_type of the calling thread.
+
+  Since default_token_type overrides only apply to the calling thread, this can
+  be used to pass the current default on to worker threads, which can then
+  apply it with default_token_type.
+
+  Returns:
+    The string "byte" or "utf8", or a copy of the default symbol table.
+  """
+  cdef _TokenType _token_type = GetDefaultTokenType()
+  if _token_type == _TokenType.SYMBOL:
+    return _init_SymbolTable(WrapUnique(GetDefaultSymbols().Copy()))
+  return "utf8" if _token_type == _TokenType.UTF8 else "byte"
+
+
+cdef class OptimizeStats:
+
+  """
+  OptimizeStats()
+
+  A record of the operations performed by a call to Fst.optimize.
+
+  An instance passed as the `stats` argument to optimize is overwritten with a
+  description of the branch taken and of each phase of optimization, which can
+  be used to find out which phase, if any, was slow or grew the FST.
+  """
+
+  cdef _OptimizeStats _stats
+
+  def __repr__(self):
+    return f"<{self.__class__.__name__} at 0x{id(self):x}>"
+
+  @property
+  def acceptor(self):
+    """Whether the FST was optimized as an acceptor."""
+    return self._stats.acceptor
+
+  @property
+  def determinized(self):
+    """Whether the FST was determinized."""
+    return self._stats.determinized
+
+  @property
+  def encode_flags(self):
+    """
+    The flags (ENCODE_LABELS and/or ENCODE_WEIGHTS) with which the FST was
+    encoded before determinization, or 0 if it was not encoded.
+    """
+    return self._stats.encode_flags
+
+  @property
+  def limit_exceeded(self):
+    """
+    Whether determinization was abandoned because it exceeded the requested
+    limits, leaving the FST epsilon-free but otherwise unoptimized.
+    """
+    return self._stats.limit_exceeded
+
+  @property
+  def phases(self):
+    """
+    A list of (name, seconds, input_states, input_arcs, output_states,
+    output_arcs) tuples, one for each phase run, in order; the phase names are
+    "rmepsilon", "encode", "determinize", "minimize", "decode", and "arcsum".
+    """
+    cdef OptimizePhaseStats phase
+    return [(phase.name.decode("utf8"), phase.seconds, phase.input_states,
+             phase.input_arcs, phase.output_states, phase.output_arcs)
+            for phase in self._stats.phases]
+
+
+cdef class RewriteStats:
+
+  """
+  RewriteStats()
+
+  A record of the work done by a single top rewrite.
+
+  An instance passed as the `stats` argument to string_view_top_rewrite is
+  overwritten with the size of the composed lattice, the wall time spent in
+  each phase of the rewrite, and the number of output strings enumerated,
+  which can be used to find out why rewriting some input was slow.
+  """
+
+  cdef _RewriteStats _stats
+
+  def __repr__(self):
+    return f"<{self.__class__.__name__} at 0x{id(self):x}>"
+
+  @property
+  def lattice_states(self):
+    """The number of states in the composed lattice."""
+    return self._stats.lattice_states
+
+  @property
+  def lattice_arcs(self):
+    """The number of arcs in the composed lattice."""
+    return self._stats.lattice_arcs
+
+  @property
+  def paths(self):
+    """The number of output strings enumerated."""
+    return self._stats.paths
+
+  @property
+  def compose_seconds(self):
+    """
+    The time spent composing the input with the rule, including projection and
+    epsilon-removal of the lattice.
+    """
+    return self._stats.compose_seconds
+
+  @property
+  def dfa_seconds(self):
+    """The time spent determinizing the lattice, if it was."""
+    return self._stats.dfa_seconds
+
+  @property
+  def shortest_path_seconds(self):
+    """The time spent searching for the best output strings."""
+    return self._stats.shortest_path_seconds
+
+  @property
+  def print_seconds(self):
+    """The time spent printing the output strings."""
+    return self._stats.print_seconds
+
+
+cdef class MemoryStats:
+
+  """
+  MemoryStats()
+
+  The approximate memory used by an FST or cache, in bytes.
+
+  Instances are returned by the memory_usage methods of FSTs, rule cascade
+  engines, and rewrite caches, so that processes holding many grammars can
+  account for, and cap, the memory each uses. Unused container capacity is not
+  counted.
+  """
+
+  cdef _MemoryStats _stats
+
+  def __repr__(self):
+    return f"<{self.__class__.__name__} at 0x{id(self):x}>"
+
+  @property
+  def states(self):
+    """
+    The bytes used by the states of expanded FSTs, including their final
+    weights; delayed FSTs are not counted, since that would expand them.
+    """
+    return self._stats.states
+
+  @property
+  def arcs(self):
+    """The bytes used by the arcs of expanded FSTs."""
+    return self._stats.arcs
+
+  @property
+  def symbols(self):
+    """The bytes used by symbol tables."""
+    return self._stats.symbols
+
+  @property
+  def caches(self):
+    """
+    The bytes held by caches; where a cache does not report its size, as with
+    the state caches of delayed compositions, this is its limit.
+    """
+    return self._stats.caches
+
+  @property
+  def total(self):
+    """The total number of bytes."""
+    return self._stats.Total()
+
+
+cdef MemoryStats _init_MemoryStats(const _MemoryStats &stats):
+  cdef MemoryStats result = MemoryStats.__new__(MemoryStats)
+  result._stats = stats
+  return result
+
+
 # Class for FSTs created from within Pynini. It overrides instance methods of
 # the superclass which take an FST argument so that it can string-compile said
 # argument if it is not yet an FST. It also overloads binary == (equals),
@@ -349,6 +602,11 @@ cdef class Fst(_VectorFst):
     arc_type: An optional string indicating the arc type for the FST.
   """
 
+  # Allows weak references, e.g., from per-rule statistics.
+  cdef object __weakref__
+  # Whether the last call to optimize abandoned determinization.
+  cdef bool _optimize_limit_exceeded
+
   cdef void _from_MutableFstClass(self, MutableFstClass *tfst):
     """
     _from_MutableFstClass(tfst)
@@ -468,6 +726,35 @@ cdef class Fst(_VectorFst):
     """
     return _StringPathIterator(self, input_token_type, output_token_type)
 
+  cpdef _ShortestStringIterator shortest_strings(self, token_type=None):
+    """
+    shortest_strings(self, token_type=None)
+
+    Creates a lazy iterator over the unique output strings in order of weight.
+
+    This method returns an iterator which generates (string, weight) pairs for
+    the unique output strings of the FST, best first, where each weight is that
+    of the string's best path. Unlike `shortestpath` with `unique=True`, which
+    must construct all n shortest paths up front, each string is found only
+    when it is requested, so stopping after the first few strings is cheap.
+    This is only valid in a semiring with the path property. The FST may be
+    cyclic, in which case the iterator is infinite.
+
+    Args:
+      token_type: An optional string indicating how the output strings are to
+          be constructed from arc labels---one of: "byte" (interprets arc
+          labels as raw bytes), "utf8" (interprets arc labels as Unicode code
+          points), or a SymbolTable. If not set, or set to None, the value is
+          set to the default token_type, which begins as "byte", but can be
+          overridden for regions of code using the default_token_type context
+          manager.
+
+    Raises:
+      FstArgError: Unknown token type.
+      FstOpError: Operation failed.
+    """
+    return _ShortestStringIterator(self, token_type)
+
   cpdef string string(self, token_type=None) except *:
     """
     string(self, token_type=None)
@@ -501,20 +788,37 @@ cdef class Fst(_VectorFst):
       FstArgError: Unknown token type.
       FstOpError: Operation failed.
     """
-    cdef _TokenType _token_type
-    cdef const_SymbolTable_ptr _symbols = NULL
-    if token_type is None:
-      _token_type = GetDefaultTokenType()
-      _symbols = GetDefaultSymbols()
-    elif isinstance(token_type, _pywrapfst.SymbolTableView):
-      _token_type = _TokenType.SYMBOL
-      _symbols = (<_SymbolTableView> token_type)._raw_ptr_or_raise()
-    else:
-      _token_type = _get_token_type(tostring(token_type))
-    cdef string result
-    if not StringPrint(deref(self._fst), addr(result), _token_type, _symbols):
-      raise FstOpError("Operation failed")
-    return result
+    return _print_string(self, token_type)
+
+  cpdef FrozenFst freeze(self):
+    """
+    freeze(self)
+
+    Returns an immutable, input-arc-sorted ConstFst copy of the FST.
+
+    A ConstFst stores all states and arcs contiguously, so it is more compact
+    than the mutable FST and has better locality when composed against; it is
+    meant for grammars which, once built, are only applied. Composition and the
+    rewrite functions use frozen FSTs as is; other operations accept them too,
+    but copy them into mutable FSTs first. Frozen FSTs also support the string
+    and paths methods, but not the other methods of Fst. A FAR opened for
+    writing with memory_map=True stores FSTs in the same form. Frozen FSTs can
+    be shared between processes without copying; see FrozenFst. Use
+    Fst.from_pywrapfst to convert a frozen FST back into a mutable one.
+
+    Returns:
+      A FrozenFst.
+    """
+    return _init_FrozenFst(_get_mappable_Fst(self))
+
+  cpdef MemoryStats memory_usage(self):
+    """
+    memory_usage(self)
+
+    Returns the approximate memory used by the FST's states, arcs, and symbol
+    tables; see memory_usage.
+    """
+    return memory_usage(self)
 
   # The following all override their definition in MutableFst.
 
@@ -572,7 +876,8 @@ cdef class Fst(_VectorFst):
     Returns:
       self.
     """
-    ConcatRange(self._mfst.get(), lower, upper)
+    with nogil:
+      ConcatRange(self._mfst.get(), lower, upper)
     self._check_mutating_imethod()
     return self
 
@@ -602,7 +907,8 @@ cdef class Fst(_VectorFst):
       An FST copy.
     """
     cdef Fst result = self.copy()
-    ConcatRange(result._mfst.get(), 0, 1)
+    with nogil:
+      ConcatRange(result._mfst.get(), 0, 1)
     result._check_mutating_imethod()
     return result
 
@@ -641,13 +947,29 @@ cdef class Fst(_VectorFst):
     cdef Fst _fst2 = _compile_or_copy_Fst(fst2, self.arc_type())
     return super().concat(_fst2)
 
-  cdef void _optimize(self, bool compute_props=False) except *:
-    Optimize(self._mfst.get(), compute_props)
+  cdef void _optimize(self,
+                      bool compute_props=False,
+                      OptimizeStats stats=None,
+                      int64 max_determinized_states=-1,
+                      int64 max_determinized_bytes=-1) except *:
+    cdef _OptimizeStats *_stats = NULL if stats is None else &stats._stats
+    cdef OptimizeLimits _limits
+    _limits.max_determinized_states = max_determinized_states
+    _limits.max_determinized_bytes = max_determinized_bytes
+    cdef bool _completed
+    with nogil:
+      _completed = Optimize(self._mfst.get(), compute_props, _stats, _limits)
     self._check_mutating_imethod()
+    self._optimize_limit_exceeded = not _completed
 
-  def optimize(self, bool compute_props=False):
+  def optimize(self,
+               bool compute_props=False,
+               OptimizeStats stats=None,
+               int64 max_determinized_states=-1,
+               int64 max_determinized_bytes=-1):
     """
-    optimize(self, compute_props=False)
+    optimize(self, compute_props=False, stats=None,
+             max_determinized_states=-1, max_determinized_bytes=-1)
 
     Performs a generic optimization of the FST.
 
@@ -679,13 +1001,34 @@ cdef class Fst(_VectorFst):
     Args:
       compute_props: Should unknown FST properties be computed to help choose
           appropriate optimizations?
+      stats: An optional OptimizeStats, which is overwritten with the branch
+          taken and the wall time and the number of states and arcs before and
+          after each phase.
+      max_determinized_states: If non-negative, the maximum number of states
+          of the determinized FST. If determinization would exceed it, it is
+          abandoned, leaving the FST epsilon-free but otherwise unoptimized,
+          and optimize_limit_exceeded (and stats.limit_exceeded) is set.
+      max_determinized_bytes: If non-negative, a similar limit on the
+          (estimated) size in bytes of the determinized FST.
 
     Returns:
       self.
     """
-    self._optimize(compute_props)
+    self._optimize(compute_props,
+                   stats,
+                   max_determinized_states,
+                   max_determinized_bytes)
     return self
 
+  @property
+  def optimize_limit_exceeded(self):
+    """
+    Whether the last call to optimize abandoned determinization because it
+    exceeded the requested limits, leaving the FST epsilon-free but otherwise
+    unoptimized.
+    """
+    return self._optimize_limit_exceeded
+
   def union(self, *fsts2):
     return super().union(*(_compile_or_copy_Fst(fst2, self.arc_type())
                            for fst2 in fsts2))
@@ -763,10 +1106,42 @@ cdef class Fst(_VectorFst):
 
 
 cdef Fst _compile_or_copy_Fst(arg, arc_type="standard"):
-  if not isinstance(arg, Fst):
-    return accep(arg, arc_type=arc_type)
-  else:
+  if isinstance(arg, Fst):
     return arg.copy()
+  # Immutable FSTs, such as frozen ones, are converted.
+  elif isinstance(arg, _Fst):
+    return _from_pywrapfst(arg)
+  else:
+    return accep(arg, arc_type=arc_type)
+
+
+# Frozen FSTs (see Fst.freeze), and other immutable input-arc-sorted FSTs, are
+# used as is by composition and rewriting, since these do not mutate them.
+
+
+cdef bool _is_frozen(arg):
+  return (isinstance(arg, _Fst) and not isinstance(arg, _MutableFst) and
+          (<_Fst> arg)._fst.get().Properties(kILabelSorted, False) ==
+          kILabelSorted)
+
+
+# Like _compile_or_copy_two_Fsts, but uses frozen arguments as is; the other
+# argument, if it is compiled or copied, is input-arc-sorted if necessary for
+# composition with the first.
+
+
+cdef object _compile_or_view_two_Fsts(fst1, fst2):
+  cdef _Fst _fst1
+  cdef Fst _fst2
+  if _is_frozen(fst2):
+    if _is_frozen(fst1):
+      return (fst1, fst2)
+    return (_compile_or_copy_Fst(fst1, (<_Fst> fst2).arc_type()), fst2)
+  _fst1 = fst1
+  _fst2 = _compile_or_copy_Fst(fst2, _fst1.arc_type())
+  if _fst2._mfst.get().Properties(kILabelSorted, True) != kILabelSorted:
+    ArcSort(_fst2._mfst.get(), ArcSortType.ILABEL_SORT)
+  return (_fst1, _fst2)
 
 
 # Makes copies or compiles, using the arc type of the first if specified,
@@ -776,11 +1151,11 @@ cdef Fst _compile_or_copy_Fst(arg, arc_type="standard"):
 cdef object _compile_or_copy_two_Fsts(fst1, fst2):
   cdef Fst _fst1
   cdef Fst _fst2
-  if isinstance(fst1, Fst):
-    _fst1 = fst1.copy()
+  if isinstance(fst1, _Fst):
+    _fst1 = _compile_or_copy_Fst(fst1)
     _fst2 = _compile_or_copy_Fst(fst2, _fst1.arc_type())
-  elif isinstance(fst2, Fst):
-    _fst2 = fst2.copy()
+  elif isinstance(fst2, _Fst):
+    _fst2 = _compile_or_copy_Fst(fst2)
     _fst1 = accep(fst1, arc_type=_fst2.arc_type())
   else:
     _fst1 = accep(fst1)
@@ -816,6 +1191,181 @@ cpdef Fst _read_from_string(state):
   return _from_pywrapfst(_pywrapfst.Fst.read_from_string(state))
 
 
+# Class for read-only buffers holding serialized FSTs.
+
+
+cdef class _FstImage:
+
+  """
+  A read-only buffer holding an aligned ConstFst image.
+
+  This class is not visible to Python users; instances support the buffer
+  protocol.
+  """
+
+  cdef string _image
+
+  def __getbuffer__(self, Py_buffer *buffer, int flags):
+    PyBuffer_FillInfo(buffer, self, <void *> <char *> self._image.c_str(),
+                      self._image.size(), 1, flags)
+
+  def __releasebuffer__(self, Py_buffer *buffer):
+    pass
+
+
+# Class for immutable FSTs stored contiguously.
+
+
+cdef class FrozenFst(_Fst):
+
+  """
+  An immutable FST, stored contiguously as a ConstFst.
+
+  Frozen FSTs are returned by Fst.freeze, or constructed over any buffer
+  holding a ConstFst image, such as the buffer of a shared memory segment, with
+  FrozenFst.from_buffer, which does not copy the image. They are pickled as
+  such an image; with pickle protocol 5, it is passed as a PickleBuffer, so
+  that it can be sent out-of-band, and an unpickled FST is constructed over the
+  buffer received rather than over a copy.
+
+  This class cannot be constructed directly.
+  """
+
+  # Keeps the memory underlying the FST, if borrowed, alive and exported.
+  cdef object _buffer
+  # Allows weak references, e.g., from per-rule fingerprints and statistics.
+  cdef object __weakref__
+
+  def __repr__(self):
+    return f"<{self.fst_type()} FrozenFst at 0x{id(self):x}>"
+
+  @classmethod
+  def from_buffer(cls, buffer):
+    """
+    FrozenFst.from_buffer(buffer)
+
+    Constructs a frozen FST over a ConstFst image, without copying it.
+
+    The buffer is kept, and kept exported (so that, e.g., an mmap object
+    cannot be closed), for as long as the FST or any FST sharing it exists.
+    The image should be aligned, as it is when produced by to_buffer, and begin
+    at an aligned address, as shared memory and memory maps do; otherwise, its
+    arrays are copied.
+
+    Args:
+      buffer: An object supporting the buffer protocol.
+
+    Returns:
+      A FrozenFst.
+
+    Raises:
+      FstIOError: Read failed.
+    """
+    return _frozen_from_buffer(buffer)
+
+  cpdef _FstImage to_buffer(self):
+    """
+    to_buffer(self)
+
+    Returns a read-only buffer holding an aligned ConstFst image of the FST.
+
+    The image may be copied, e.g., into a shared memory segment, and then read
+    in place with FrozenFst.from_buffer.
+
+    Returns:
+      An object supporting the buffer protocol.
+
+    Raises:
+      FstIOError: Write failed.
+    """
+    cdef _FstImage _image = _FstImage.__new__(_FstImage)
+    cdef bool _success
+    with nogil:
+      _success = WriteConstFstImage(deref(self._fst), addr(_image._image))
+    if not _success:
+      raise FstIOError("Write failed")
+    return _image
+
+  cpdef MemoryStats memory_usage(self):
+    """
+    memory_usage(self)
+
+    Returns the approximate memory used by the FST's states, arcs, and symbol
+    tables, even if they are stored in a borrowed buffer; see memory_usage.
+    """
+    return memory_usage(self)
+
+  # The following mirror their definition in Fst.
+
+  cpdef _StringPathIterator paths(self, input_token_type=None,
+                                  output_token_type=None):
+    """
+    paths(self, input_token_type=None, output_token_type=None)
+
+    Creates iterator over all string paths in an acyclic FST; see Fst.paths.
+
+    Raises:
+      FstArgError: Unknown token type.
+      FstOpError: Operation failed.
+    """
+    return _StringPathIterator(self, input_token_type, output_token_type)
+
+  cpdef string string(self, token_type=None) except *:
+    """
+    string(self, token_type=None)
+
+    Creates a string from a string FST; see Fst.string.
+
+    Raises:
+      FstArgError: Unknown token type.
+      FstOpError: Operation failed.
+    """
+    return _print_string(self, token_type)
+
+  def __reduce_ex__(self, protocol):
+    cdef _FstImage _image = self.to_buffer()
+    if protocol >= 5:
+      return (_frozen_from_buffer, (pickle.PickleBuffer(_image),))
+    return (_frozen_from_buffer, (bytes(memoryview(_image)),))
+
+
+cdef string _print_string(_Fst fst, token_type) except *:
+  cdef _TokenType _token_type
+  cdef const_SymbolTable_ptr _symbols = NULL
+  _get_token_type_and_symbols(token_type, addr(_token_type), addr(_symbols))
+  cdef string result
+  if not StringPrint(deref(fst._fst), addr(result), _token_type, _symbols):
+    raise FstOpError("Operation failed")
+  return result
+
+
+cdef bool _is_borrowed(arg):
+  return isinstance(arg, FrozenFst) and (<FrozenFst> arg)._buffer is not None
+
+
+cdef FrozenFst _init_FrozenFst(_Fst fst, buffer=None):
+  cdef FrozenFst result = FrozenFst.__new__(FrozenFst)
+  result._fst = fst._fst
+  result._buffer = buffer
+  return result
+
+
+cpdef FrozenFst _frozen_from_buffer(buffer):
+  cdef object _buffer = memoryview(buffer)
+  cdef const unsigned char[::1] _view = _buffer.cast("B")
+  if _view.shape[0] == 0:
+    raise FstIOError("Read failed")
+  cdef FstClass *_tfst
+  with nogil:
+    _tfst = ViewConstFst(<const char *> &_view[0], _view.shape[0])
+  if _tfst == NULL:
+    raise FstIOError("Read failed")
+  cdef FrozenFst result = FrozenFst.__new__(FrozenFst)
+  result._fst.reset(_tfst)
+  result._buffer = _buffer
+  return result
+
+
 # Utility functions.
 
 
@@ -927,21 +1477,58 @@ cpdef Fst cross(fst1, fst2):
   cdef Fst _fst2
   (_fst1, _fst2) = _compile_or_copy_two_Fsts(fst1, fst2)
   cdef Fst result = Fst(_fst1.arc_type())
-  Cross(deref(_fst1._fst), deref(_fst2._fst), result._mfst.get())
+  with nogil:
+    Cross(deref(_fst1._fst), deref(_fst2._fst), result._mfst.get())
   result._check_mutating_imethod()
   return result
 
 
-cpdef Fst cdrewrite(tau, l, r, sigma_star, direction="ltr", mode="obl"):
+def lazy_cross(fst1, fst2):
   """
-  cdrewrite(tau, l, r, sigma_star, direction="ltr", mode="obl")
-
-  Compiles a transducer expressing a context-dependent rewrite rule.
+  lazy_cross(fst1, fst2)
 
-  This operation compiles a transducer representing a context-dependent
-  rewrite rule of the form
+  Creates a delayed cross-product transducer.
 
-      tau / L __ R
+  This function is like `cross`, but the result is an immutable FST which is
+  only expanded as it is visited, which avoids materializing the cross-product
+  of large acceptors (e.g., of two lexicons). If both arguments are strings,
+  the result is instead written out directly, as it is no larger than the
+  arguments. Unlike the result of `cross`, the result is not trimmed.
+
+  Args:
+    fst1: The input string, or an acceptor FST representing the upper
+        language.
+    fst2: The output string, or an acceptor FST representing the lower
+        language.
+
+  Returns:
+    An immutable FST.
+
+  Raises:
+    FstOpError: Operation failed.
+  """
+  cdef Fst _fst1
+  cdef Fst _fst2
+  (_fst1, _fst2) = _compile_or_copy_two_Fsts(fst1, fst2)
+  cdef unique_ptr[FstClass] _result
+  with nogil:
+    _result = CrossDelayed(deref(_fst1._fst), deref(_fst2._fst))
+  if (_result.get() == NULL or
+      _result.get().Properties(kError, True) == kError):
+    raise FstOpError("Operation failed")
+  return _init_XFst(_result.release())
+
+
+cpdef Fst cdrewrite(tau, l, r, sigma_star, direction="ltr", mode="obl"):
+  """
+  cdrewrite(tau, l, r, sigma_star, direction="ltr", mode="obl")
+
+  Compiles a transducer expressing a context-dependent rewrite rule.
+
+  This operation compiles a transducer representing a context-dependent
+  rewrite rule of the form
+
+      tau / L __ R
 
   over a finite vocabulary.
 
@@ -979,19 +1566,244 @@ cpdef Fst cdrewrite(tau, l, r, sigma_star, direction="ltr", mode="obl"):
   cdef _CDRewriteDirection _direction = _get_cdrewrite_direction(tostring(
       direction))
   cdef _CDRewriteMode _mode = _get_cdrewrite_mode(tostring(mode))
-  CDRewriteCompile(deref(_tau._fst),
-                   deref(_l._fst),
-                   deref(_r._fst),
-                   deref(_sigma_star._fst),
-                   result._mfst.get(),
-                   _direction,
-                   _mode,
-                   kBosIndex,
-                   kEosIndex)
+  with nogil:
+    CDRewriteCompile(deref(_tau._fst),
+                     deref(_l._fst),
+                     deref(_r._fst),
+                     deref(_sigma_star._fst),
+                     result._mfst.get(),
+                     _direction,
+                     _mode,
+                     kBosIndex,
+                     kEosIndex)
   result._check_mutating_imethod()
   return result
 
 
+def cdrewrite_many(rules,
+                   sigma_star,
+                   direction="ltr",
+                   mode="obl",
+                   int num_threads=0):
+  """
+  cdrewrite_many(rules, sigma_star, direction="ltr", mode="obl",
+                 num_threads=0)
+
+  Compiles many context-dependent rewrite rules over the same alphabet.
+
+  This is equivalent to calling cdrewrite on each of the rules in turn, but the
+  alphabet is preprocessed only once, and the rules are compiled concurrently,
+  without holding the global interpreter lock.
+
+  Args:
+    rules: An iterable of (tau, l, r) triples, where tau is a transducer
+        representing the desired transduction, and l and r are unweighted
+        acceptors representing the left and right contexts, respectively.
+    sigma_star: A cyclic, unweighted acceptor representing the closure over the
+        alphabet.
+    direction: A string specifying the direction of rule application; one of:
+        "ltr" (left-to-right application), "rtl" (right-to-left application),
+        or "sim" (simultaneous application).
+    mode: A string specifying the mode of rule application; one of: "obl"
+        (obligatory application), "opt" (optional application).
+    num_threads: The maximum number of threads to use; if not positive, the
+        hardware concurrency is used.
+
+  Returns:
+    A list of FSTs, one for each rule.
+
+  Raises:
+    FstArgError: Unknown cdrewrite direction type.
+    FstArgError: Unknown cdrewrite mode type.
+    FstOpError: Operation failed.
+  """
+  cdef Fst _sigma_star = _compile_or_copy_Fst(sigma_star)
+  cdef string arc_type = _sigma_star.arc_type()
+  cdef _CDRewriteDirection _direction = _get_cdrewrite_direction(tostring(
+      direction))
+  cdef _CDRewriteMode _mode = _get_cdrewrite_mode(tostring(mode))
+  # Keeps the compiled arguments alive until compilation is done.
+  cdef list _args = []
+  cdef list results = []
+  cdef vector[const FstClass *] _taus
+  cdef vector[const FstClass *] _lambdas
+  cdef vector[const FstClass *] _rhos
+  cdef vector[MutableFstClass *] _fsts
+  cdef Fst _tau
+  cdef Fst _l
+  cdef Fst _r
+  cdef Fst result
+  for (tau, l, r) in rules:
+    _tau = _compile_or_copy_Fst(tau, arc_type)
+    _l = _compile_or_copy_Fst(l, arc_type)
+    _r = _compile_or_copy_Fst(r, arc_type)
+    _args.append((_tau, _l, _r))
+    _taus.push_back(_tau._fst.get())
+    _lambdas.push_back(_l._fst.get())
+    _rhos.push_back(_r._fst.get())
+    result = Fst(arc_type)
+    results.append(result)
+    _fsts.push_back(result._mfst.get())
+  with nogil:
+    CDRewriteCompileMany(_taus,
+                         _lambdas,
+                         _rhos,
+                         deref(_sigma_star._fst),
+                         _fsts,
+                         _direction,
+                         _mode,
+                         kBosIndex,
+                         kEosIndex,
+                         num_threads)
+  for result in results:
+    result._check_mutating_imethod()
+  return results
+
+
+def lazy_cdrewrite(tau,
+                   l,
+                   r,
+                   sigma_star,
+                   direction="ltr",
+                   mode="obl",
+                   size_t cache_gc_limit=1 << 20):
+  """
+  lazy_cdrewrite(tau, l, r, sigma_star, direction="ltr", mode="obl",
+                 cache_gc_limit=1 << 20)
+
+  Compiles a delayed transducer expressing a context-dependent rewrite rule.
+
+  This is like cdrewrite, except that rather than constructing and optimizing
+  the full rule transducer, it returns a delayed composition of the stages of
+  the rule, which are expanded only as they are visited, e.g., when the rule is
+  composed with an input string. This may greatly reduce compilation time and
+  memory usage when the alphabet is large but only a small part of the rule is
+  ever used. The state cache of each composition is bounded by cache_gc_limit
+  (in bytes), and memory_usage reports the sum of these bounds.
+
+  The result is an immutable FST. It is best applied using a RuleCascadeEngine
+  with lazy=True, which does not expand it; operations which copy the FST into
+  a mutable container expand it entirely.
+
+  Args:
+    tau: A transducer representing the desired transduction tau.
+    l: An unweighted acceptor representing the left context L.
+    r: An unweighted acceptor representing the right context R.
+    sigma_star: A cyclic, unweighted acceptor representing the closure over the
+        alphabet.
+    direction: A string specifying the direction of rule application; one of:
+        "ltr" (left-to-right application), "rtl" (right-to-left application),
+        or "sim" (simultaneous application).
+    mode: A string specifying the mode of rule application; one of: "obl"
+        (obligatory application), "opt" (optional application).
+    cache_gc_limit: The maximum size, in bytes, of the state cache of each
+        delayed composition.
+
+  Returns:
+    An immutable FST.
+
+  Raises:
+    FstArgError: Unknown cdrewrite direction type.
+    FstArgError: Unknown cdrewrite mode type.
+    FstOpError: Operation failed.
+  """
+  cdef Fst _sigma_star = _compile_or_copy_Fst(sigma_star)
+  cdef string arc_type = _sigma_star.arc_type()
+  cdef Fst _tau = _compile_or_copy_Fst(tau, arc_type)
+  cdef Fst _l = _compile_or_copy_Fst(l, arc_type)
+  cdef Fst _r = _compile_or_copy_Fst(r, arc_type)
+  cdef _CDRewriteDirection _direction = _get_cdrewrite_direction(tostring(
+      direction))
+  cdef _CDRewriteMode _mode = _get_cdrewrite_mode(tostring(mode))
+  cdef unique_ptr[FstClass] _result
+  with nogil:
+    _result = CDRewriteCompileDelayed(deref(_tau._fst),
+                                      deref(_l._fst),
+                                      deref(_r._fst),
+                                      deref(_sigma_star._fst),
+                                      _direction,
+                                      _mode,
+                                      kBosIndex,
+                                      kEosIndex,
+                                      cache_gc_limit)
+  if _result.get() == NULL:
+    raise FstOpError("Operation failed")
+  return _init_XFst(_result.release())
+
+
+def label_class_cdrewrite(tau,
+                          l,
+                          r,
+                          sigma_star,
+                          direction="ltr",
+                          mode="obl"):
+  """
+  label_class_cdrewrite(tau, l, r, sigma_star, direction="ltr", mode="obl")
+
+  Compiles a context-dependent rewrite rule over a collapsed alphabet.
+
+  This is like cdrewrite, except that the symbols of sigma_star which are not
+  mentioned by tau, l, or r are collapsed into a single symbol class before the
+  rule is compiled, so that the size of the rule and the time taken to compile
+  it do not grow with the size of the alphabet. This pays off when the
+  alphabet is large (e.g., all of Unicode) but the rule mentions only a few
+  symbols. The arcs over the class are matched against the symbols they stand
+  for when the rule is composed with an input, e.g., by the rewrite functions.
+  Since these arcs match any symbol not otherwise matched, inputs containing
+  symbols outside of sigma_star are rewritten rather than rejected. If the
+  symbols cannot be collapsed (e.g., because sigma_star is not the closure of
+  single symbols, or because the contexts mention all of them), the rule is
+  compiled in the ordinary way.
+
+  The result is an immutable FST, which must be the right-hand side of any
+  composition; operations which copy it into a mutable container, or compose
+  it on the left, treat the symbol class as an ordinary label. A
+  RuleCascadeEngine expands it into an ordinary rule where it would be on the
+  left (i.e., when it is the first of several rules, or lookahead is used).
+
+  Args:
+    tau: A transducer representing the desired transduction tau.
+    l: An unweighted acceptor representing the left context L.
+    r: An unweighted acceptor representing the right context R.
+    sigma_star: A cyclic, unweighted acceptor representing the closure over the
+        alphabet.
+    direction: A string specifying the direction of rule application; one of:
+        "ltr" (left-to-right application), "rtl" (right-to-left application),
+        or "sim" (simultaneous application).
+    mode: A string specifying the mode of rule application; one of: "obl"
+        (obligatory application), "opt" (optional application).
+
+  Returns:
+    An immutable FST.
+
+  Raises:
+    FstArgError: Unknown cdrewrite direction type.
+    FstArgError: Unknown cdrewrite mode type.
+    FstOpError: Operation failed.
+  """
+  cdef Fst _sigma_star = _compile_or_copy_Fst(sigma_star)
+  cdef string arc_type = _sigma_star.arc_type()
+  cdef Fst _tau = _compile_or_copy_Fst(tau, arc_type)
+  cdef Fst _l = _compile_or_copy_Fst(l, arc_type)
+  cdef Fst _r = _compile_or_copy_Fst(r, arc_type)
+  cdef _CDRewriteDirection _direction = _get_cdrewrite_direction(tostring(
+      direction))
+  cdef _CDRewriteMode _mode = _get_cdrewrite_mode(tostring(mode))
+  cdef unique_ptr[FstClass] _result
+  with nogil:
+    _result = CDRewriteCompileLabelClass(deref(_tau._fst),
+                                         deref(_l._fst),
+                                         deref(_r._fst),
+                                         deref(_sigma_star._fst),
+                                         _direction,
+                                         _mode,
+                                         kBosIndex,
+                                         kEosIndex)
+  if _result.get() == NULL:
+    raise FstOpError("Operation failed")
+  return _init_XFst(_result.release())
+
+
 cpdef Fst leniently_compose(mu, nu, sigma_star, compose_filter="auto",
                             bool connect=True):
   """
@@ -1030,11 +1842,12 @@ cpdef Fst leniently_compose(mu, nu, sigma_star, compose_filter="auto",
       new ComposeOptions(connect,
                          _get_compose_filter(tostring(compose_filter))))
   cdef Fst result = Fst(_mu.arc_type())
-  LenientlyCompose(deref(_mu._fst),
-                   deref(_nu._fst),
-                   deref(_sigma_star._fst),
-                   result._mfst.get(),
-                   deref(_opts))
+  with nogil:
+    LenientlyCompose(deref(_mu._fst),
+                     deref(_nu._fst),
+                     deref(_sigma_star._fst),
+                     result._mfst.get(),
+                     deref(_opts))
   result._check_mutating_imethod()
   return result
 
@@ -1042,188 +1855,1569 @@ cpdef Fst leniently_compose(mu, nu, sigma_star, compose_filter="auto",
 cpdef Fst string_file(filename,
                       arc_type="standard",
                       input_token_type=None,
-                      output_token_type=None):
+                      output_token_type=None,
+                      bool minimize=False,
+                      int num_threads=1):
   """
   string_file(filename, arc_type="standard",
-              input_token_type=None, output_token_type=None)
+              input_token_type=None, output_token_type=None, minimize=False,
+              num_threads=1)
+
+  Creates a transducer that maps between elements of mappings read from
+  a tab-delimited file.
+
+  The first column is interpreted as the input string to a transduction.
+
+  The second column, separated from the first by a single tab character, is
+  interpreted as the output string for the transduction; an acceptor can be
+  modeled by using identical first and second columns.
+
+  An optional third column, separated from the second by a single tab character,
+  is interpreted as a weight for the transduction; if not specified the weight
+  defaults to semiring One. Note that weights are never permitted in the second
+  column.
+
+  The comment character is #, and has scope until the end of the line. Any
+  preceding whitespace before a comment is ignored. To use the '#' literal
+  (i.e., to ensure it is not interpreted as the start of a comment) escape it
+  with \; the escaping \ in the string "\#" also ignored.
+
+  Args:
+    filename: The path to a TSV file formatted as described above.
+    arc_type: A string indicating the arc type.
+    input_token_type: An optional string indicating how the input strings are
+        to be encoded as arc labels---one of: "utf8" (encodes strings as a UTF-8
+        encoded Unicode strings), "byte" (encodes strings as raw bytes)---or a
+        SymbolTable. If not set, or set to None, the value is set to the
+        default token_type, which begins as "byte", but can be overridden for
+        regions of code using the default_token_type context manager.
+    output_token_type: An optional string indicating how the output strings are
+        to be encoded as arc labels---one of: "utf8" (encodes strings as a UTF-8
+        encoded Unicode strings), "byte" (encodes strings as raw bytes)---or a
+        SymbolTable. If not set, or set to None, the value is set to the
+        default token_type, which begins as "byte", but can be overridden for
+        regions of code using the default_token_type context manager.
+    minimize: If true, and the lines are sorted by input string and then by
+        output string, an automaton in which equivalent suffixes of the
+        prefix tree are merged is built directly, rather than the tree, which
+        saves memory. This is the minimal DFA for an unweighted acceptor, but
+        transducers keep the epsilon arcs between their input and output
+        labels, and weights are not pushed, so optimization may still shrink
+        it. Unsorted lines fall back to the prefix tree.
+    num_threads: The number of threads used to tokenize the lines; if not
+        positive, the hardware concurrency is used. The result does not depend
+        on the number of threads.
+
+  Returns:
+    An FST.
+
+  Raises:
+    FstIOError: Read failed.
+  """
+  cdef _TokenType _input_token_type
+  cdef const_SymbolTable_ptr _isymbols = NULL
+  if input_token_type is None:
+    _input_token_type = GetDefaultTokenType()
+    _isymbols = GetDefaultSymbols()
+  elif isinstance(input_token_type, _pywrapfst.SymbolTableView):
+    _input_token_type = _TokenType.SYMBOL
+    _isymbols = (<_SymbolTableView> input_token_type)._raw_ptr_or_raise()
+  else:
+    _input_token_type = _get_token_type(tostring(input_token_type))
+  cdef _TokenType _output_token_type
+  cdef const_SymbolTable_ptr _osymbols = NULL
+  if output_token_type is None:
+    _output_token_type = GetDefaultTokenType()
+    _osymbols = GetDefaultSymbols()
+  elif isinstance(output_token_type, _pywrapfst.SymbolTableView):
+    _output_token_type = _TokenType.SYMBOL
+    _osymbols = (<_SymbolTableView> output_token_type)._raw_ptr_or_raise()
+  else:
+    _output_token_type = _get_token_type(tostring(output_token_type))
+  cdef Fst result = Fst(arc_type=arc_type)
+  cdef string _filename = path_tostring(filename)
+  cdef bool _success
+  with nogil:
+    _success = StringFileCompile(_filename,
+                                 result._mfst.get(),
+                                 _input_token_type,
+                                 _output_token_type,
+                                 _isymbols,
+                                 _osymbols,
+                                 minimize,
+                                 num_threads)
+  if not _success:
+    raise FstIOError("Read failed")
+  return result
+
+
+cpdef Fst string_map(lines,
+                     arc_type="standard",
+                     input_token_type=None,
+                     output_token_type=None,
+                     bool minimize=False,
+                     int num_threads=1):
+  """
+  string_map(lines, arc_type="standard",
+             input_token_type=None, output_token_type=None, minimize=False,
+             num_threads=1)
+
+  Creates an acceptor or cross-product transducer that maps between
+  elements of mappings read from an iterable.
+
+  Args:
+    lines: An iterable of iterables of size one, two, or three, or an iterable
+        of strings. The first element in each indexable (or each string, if the
+        input is an iterable of strings) is interpreted as the input string,
+        the second (optional) as the output string, defaulting to the input
+        string, and the third (optional) as a string to be parsed as a weight,
+        defaulting to semiring One.
+    arc_type: A string indicating the arc type.
+    input_token_type: An optional string indicating how the input strings are to
+        be encoded as arc labels---one of: "utf8" (encodes strings as a UTF-8
+        encoded Unicode strings), "byte" (encodes strings as raw bytes)---or a
+        SymbolTable. If not set, or set to None, the value is set to the
+        default token_type, which begins as "byte", but can be overridden for
+        regions of code using the default_token_type context manager.
+    output_token_type: An optional string indicating how the output strings are
+        to be encoded as arc labels---one of: "utf8" (encodes strings as a UTF-8
+        encoded Unicode strings), "byte" (encodes strings as raw bytes)---or a
+        SymbolTable. If not set, or set to None, the value is set to the
+        default token_type, which begins as "byte", but can be overridden for
+        regions of code using the default_token_type context manager.
+    minimize: If true, and the lines are sorted by input string and then by
+        output string, an automaton in which equivalent suffixes of the
+        prefix tree are merged is built directly, rather than the tree, which
+        saves memory. This is the minimal DFA for an unweighted acceptor, but
+        transducers keep the epsilon arcs between their input and output
+        labels, and weights are not pushed, so optimization may still shrink
+        it. Unsorted lines fall back to the prefix tree.
+    num_threads: The number of threads used to tokenize the lines; if not
+        positive, the hardware concurrency is used. The result does not depend
+        on the number of threads.
+
+  Returns:
+    An FST.
+
+  Raises:
+    FstArgError: String map compilation failed.
+  """
+  cdef _TokenType _input_token_type
+  cdef const_SymbolTable_ptr _isymbols = NULL
+  if input_token_type is None:
+    _input_token_type = GetDefaultTokenType()
+    _isymbols = GetDefaultSymbols()
+  elif isinstance(input_token_type, _pywrapfst.SymbolTableView):
+    _input_token_type = _TokenType.SYMBOL
+    _isymbols = (<_SymbolTableView> input_token_type)._raw_ptr_or_raise()
+  else:
+    _input_token_type = _get_token_type(tostring(input_token_type))
+  cdef _TokenType _output_token_type
+  cdef const_SymbolTable_ptr _osymbols = NULL
+  if output_token_type is None:
+    _output_token_type = GetDefaultTokenType()
+    _osymbols = GetDefaultSymbols()
+  elif isinstance(output_token_type, _pywrapfst.SymbolTableView):
+    _output_token_type = _TokenType.SYMBOL
+    _osymbols = (<_SymbolTableView> output_token_type)._raw_ptr_or_raise()
+  else:
+    _output_token_type = _get_token_type(tostring(output_token_type))
+  cdef vector[vector[string]] _lines
+  for line in lines:
+    if isinstance(line, str):
+      _lines.push_back([tostring(line)])
+    else:
+      _lines.push_back([tostring(elem) for elem in line])
+  cdef Fst result = Fst(arc_type)
+  cdef bool _success
+  with nogil:
+    _success = StringMapCompile(_lines,
+                                result._mfst.get(),
+                                _input_token_type,
+                                _output_token_type,
+                                _isymbols,
+                                _osymbols,
+                                minimize,
+                                num_threads)
+  if not _success:
+    raise FstArgError("String map compilation failed")
+  return result
+
+
+cpdef _SymbolTable generated_symbols():
+  """Returns a copy of the symbol table containing generated symbols.
+
+  The copy is taken while no symbol is being generated, so it is consistent
+  even if strings are being compiled concurrently, but it does not include
+  symbols generated afterwards.
+  """
+  return _init_SymbolTable(WrapUnique(GeneratedSymbols().Copy()))
+
+
+# Rewriting.
+
+
+cdef _Fst _compile_or_copy_rule(rule):
+  """Makes a copy of a rule or compiles it, then input-arc-sorts it.
+
+  Frozen rules, and mutable rules already known to be input-arc-sorted, are
+  used as is, since rewriting does not mutate them; the properties of the
+  latter are not recomputed, which would modify them.
+
+  This function is not visible to Python users.
+  """
+  if _is_frozen(rule):
+    return rule
+  if (isinstance(rule, Fst) and
+      (<Fst> rule)._mfst.get().Properties(kILabelSorted, False) ==
+      kILabelSorted):
+    return rule
+  cdef Fst _rule = _compile_or_copy_Fst(rule)
+  if _rule._mfst.get().Properties(kILabelSorted, True) != kILabelSorted:
+    ArcSort(_rule._mfst.get(), ArcSortType.ILABEL_SORT)
+  return _rule
+
+
+cpdef Fst string_view_rewrite_lattice(astring, rule, token_type=None):
+  """
+  string_view_rewrite_lattice(astring, rule, token_type=None)
+
+  Constructs a weighted lattice of output strings without compiling the input.
+
+  This function composes the rule directly against a view of the input
+  string's bytes, rather than first compiling the string into an FST, and then
+  removes epsilons from the output projection of the result. Since the input
+  is not compiled, bracketed spans are not interpreted as generated symbols;
+  use compose instead if these are required.
+
+  Args:
+    astring: The input string.
+    rule: The rule FST.
+    token_type: An optional string indicating how the input string is to be
+        viewed as arc labels---one of: "utf8" (views the string as UTF-8
+        encoded Unicode code points), "byte" (views the string as raw bytes).
+        If not set, or set to None, the value is set to the default
+        token_type, which begins as "byte", but can be overridden for regions
+        of code using the default_token_type context manager.
+
+  Returns:
+    An epsilon-free FST.
+
+  Raises:
+    FstArgError: Unknown token type.
+    FstArgError: Symbol table token types are not supported.
+    FstOpError: Operation failed.
+  """
+  cdef _TokenType _token_type
+  cdef const_SymbolTable_ptr _symbols = NULL
+  _get_token_type_and_symbols(token_type, addr(_token_type), addr(_symbols))
+  if _token_type == _TokenType.SYMBOL:
+    raise FstArgError("Symbol table token types are not supported")
+  cdef _Fst _rule = _compile_or_copy_rule(rule)
+  cdef string _astring = tostring(astring)
+  cdef Fst result = Fst(_rule.arc_type())
+  cdef bool _success
+  with nogil:
+    _success = StringViewRewriteLattice(_astring,
+                                        deref(_rule._fst),
+                                        result._mfst.get(),
+                                        _token_type)
+  result._check_mutating_imethod()
+  if not _success:
+    raise FstOpError("Operation failed")
+  return result
+
+
+cpdef string string_view_top_rewrite(astring,
+                                     rule,
+                                     input_token_type=None,
+                                     output_token_type=None,
+                                     RewriteStats stats=None) except *:
+  """
+  string_view_top_rewrite(astring, rule, input_token_type=None,
+                          output_token_type=None, stats=None)
+
+  Computes a top rewrite without compiling the input.
+
+  This function is like string_view_rewrite_lattice, but also extracts a
+  single top string from the lattice; in case of ties, which string is
+  returned is implementation-defined.
+
+  Args:
+    astring: The input string.
+    rule: The rule FST.
+    input_token_type: An optional string indicating how the input string is to
+        be viewed as arc labels, as in string_view_rewrite_lattice.
+    output_token_type: An optional string indicating how the output string is
+        to be decoded from arc labels---one of: "utf8", "byte"---or a
+        SymbolTable. If not set, or set to None, the value is set to the
+        default token_type.
+    stats: An optional RewriteStats, which is overwritten with the size of the
+        lattice and the wall time spent in each phase.
+
+  Returns:
+    The top output string.
+
+  Raises:
+    FstArgError: Unknown token type.
+    FstArgError: Symbol table token types are not supported.
+    FstOpError: Operation failed.
+  """
+  cdef _TokenType _input_token_type
+  cdef const_SymbolTable_ptr _isymbols = NULL
+  _get_token_type_and_symbols(input_token_type, addr(_input_token_type),
+                              addr(_isymbols))
+  if _input_token_type == _TokenType.SYMBOL:
+    raise FstArgError("Symbol table token types are not supported")
+  cdef _TokenType _output_token_type
+  cdef const_SymbolTable_ptr _osymbols = NULL
+  _get_token_type_and_symbols(output_token_type, addr(_output_token_type),
+                              addr(_osymbols))
+  cdef _Fst _rule = _compile_or_copy_rule(rule)
+  cdef string _astring = tostring(astring)
+  cdef _RewriteStats *_stats = NULL if stats is None else &stats._stats
+  if _stats != NULL:
+    _stats.Clear()
+  cdef string _output
+  cdef bool _success
+  with nogil:
+    _success = StringViewTopRewrite(_astring,
+                                    deref(_rule._fst),
+                                    addr(_output),
+                                    _input_token_type,
+                                    _output_token_type,
+                                    _osymbols,
+                                    _stats)
+  if not _success:
+    raise FstOpError("Operation failed")
+  return _output
+
+
+cpdef bool matches(istring,
+                   ostring,
+                   rule,
+                   input_token_type=None,
+                   output_token_type=None) except *:
+  """
+  matches(istring, ostring, rule, input_token_type=None,
+          output_token_type=None)
+
+  Determines whether a rule allows an input/output pair.
+
+  Rather than constructing the lattice of output strings and intersecting it
+  with the output, this searches the delayed composition of the input, the
+  rule, and the output depth-first, and returns as soon as it finds a
+  successful path, so only the part of the composition it visits is built.
+  If there is none, the delayed composition of the input and the rule is
+  searched in the same way, to tell whether the rule rejects the input
+  altogether.
+
+  Args:
+    istring: The input string or acceptor.
+    ostring: The output string or acceptor.
+    rule: The rule FST.
+    input_token_type: An optional string indicating how the input string is to
+        be compiled---one of: "utf8", "byte"---or a SymbolTable. If not set, or
+        set to None, the value is set to the default token_type.
+    output_token_type: An optional string indicating how the output string is
+        to be compiled, as above.
+
+  Returns:
+    Whether the input-output pair is generated by the rule.
+
+  Raises:
+    FstArgError: Arc types do not match.
+    FstOpError: Composition failure.
+  """
+  cdef _Fst _rule = _compile_or_copy_rule(rule)
+  cdef _Fst _istring = (istring if isinstance(istring, _Fst) else
+                        accep(istring, arc_type=_rule.arc_type(),
+                              token_type=input_token_type))
+  cdef _Fst _ostring = (ostring if isinstance(ostring, _Fst) else
+                        accep(ostring, arc_type=_rule.arc_type(),
+                              token_type=output_token_type))
+  if (_istring.arc_type() != _rule.arc_type() or
+      _ostring.arc_type() != _rule.arc_type()):
+    raise FstArgError("Arc types do not match")
+  cdef bool _match = False
+  cdef bool _success
+  with nogil:
+    _success = Matches(deref(_istring._fst),
+                       deref(_ostring._fst),
+                       deref(_rule._fst),
+                       addr(_match))
+  if not _success:
+    raise FstOpError("Composition failure")
+  return _match
+
+
+def batch_top_rewrite(strings,
+                      rule,
+                      input_token_type=None,
+                      output_token_type=None,
+                      int num_threads=0):
+  """
+  batch_top_rewrite(strings, rule, input_token_type=None,
+                    output_token_type=None, num_threads=0)
+
+  Computes the top rewrite for each of a batch of strings.
+
+  The rule is input-arc-sorted once, and then the strings are rewritten
+  concurrently by a pool of worker threads.
+
+  Args:
+    strings: An iterable of input strings.
+    rule: The rule FST.
+    input_token_type: An optional string indicating how the input strings are
+        to be encoded as arc labels---one of: "utf8" (encodes strings as a UTF-8
+        encoded Unicode strings), "byte" (encodes strings as raw bytes)---or a
+        SymbolTable. If not set, or set to None, the value is set to the
+        default token_type, which begins as "byte", but can be overridden for
+        regions of code using the default_token_type context manager.
+    output_token_type: An optional string indicating how the output strings are
+        to be decoded from arc labels, with the same options as
+        input_token_type.
+    num_threads: The number of worker threads; if not positive, the hardware
+        concurrency is used.
+
+  Returns:
+    A list of output strings, one per input string.
+
+  Raises:
+    FstArgError: Unknown token type.
+    FstOpError: Operation failed.
+  """
+  cdef _TokenType _input_token_type
+  cdef const_SymbolTable_ptr _isymbols = NULL
+  _get_token_type_and_symbols(input_token_type, addr(_input_token_type),
+                              addr(_isymbols))
+  cdef _TokenType _output_token_type
+  cdef const_SymbolTable_ptr _osymbols = NULL
+  _get_token_type_and_symbols(output_token_type, addr(_output_token_type),
+                              addr(_osymbols))
+  cdef _Fst _rule = _compile_or_copy_rule(rule)
+  cdef vector[string] _strings = [tostring(astring) for astring in strings]
+  cdef vector[string] _outputs
+  cdef bool _success
+  with nogil:
+    _success = BatchTopRewrite(_strings,
+                               deref(_rule._fst),
+                               addr(_outputs),
+                               _input_token_type,
+                               _isymbols,
+                               _output_token_type,
+                               _osymbols,
+                               num_threads)
+  if not _success:
+    raise FstOpError("Operation failed")
+  return _outputs
+
+
+def batch_rewrites(strings,
+                   rule,
+                   input_token_type=None,
+                   output_token_type=None,
+                   int num_threads=0,
+                   int32 state_multiplier=4):
+  """
+  batch_rewrites(strings, rule, input_token_type=None, output_token_type=None,
+                 num_threads=0, state_multiplier=4)
+
+  Computes all rewrites for each of a batch of strings.
+
+  Args:
+    strings: An iterable of input strings.
+    rule: The rule FST.
+    input_token_type: An optional string indicating how the input strings are
+        to be encoded as arc labels, as in batch_top_rewrite.
+    output_token_type: An optional string indicating how the output strings are
+        to be decoded from arc labels, as in batch_top_rewrite.
+    num_threads: The number of worker threads; if not positive, the hardware
+        concurrency is used.
+    state_multiplier: Max ratio for the number of states in the DFAs
+        determinized from the lattices.
+
+  Returns:
+    A list of lists of output strings, one per input string.
+
+  Raises:
+    FstArgError: Unknown token type.
+    FstOpError: Operation failed.
+  """
+  cdef _TokenType _input_token_type
+  cdef const_SymbolTable_ptr _isymbols = NULL
+  _get_token_type_and_symbols(input_token_type, addr(_input_token_type),
+                              addr(_isymbols))
+  cdef _TokenType _output_token_type
+  cdef const_SymbolTable_ptr _osymbols = NULL
+  _get_token_type_and_symbols(output_token_type, addr(_output_token_type),
+                              addr(_osymbols))
+  cdef _Fst _rule = _compile_or_copy_rule(rule)
+  cdef vector[string] _strings = [tostring(astring) for astring in strings]
+  cdef vector[vector[string]] _outputs
+  cdef bool _success
+  with nogil:
+    _success = BatchRewrites(_strings,
+                             deref(_rule._fst),
+                             addr(_outputs),
+                             _input_token_type,
+                             _isymbols,
+                             _output_token_type,
+                             _osymbols,
+                             num_threads,
+                             state_multiplier)
+  if not _success:
+    raise FstOpError("Operation failed")
+  return _outputs
+
+
+def batch_optimal_rewrites(strings,
+                           rule,
+                           input_token_type=None,
+                           output_token_type=None,
+                           int num_threads=0,
+                           int32 state_multiplier=4):
+  """
+  batch_optimal_rewrites(strings, rule, input_token_type=None,
+                         output_token_type=None, num_threads=0,
+                         state_multiplier=4)
+
+  Computes all optimal rewrites for each of a batch of strings.
+
+  Args:
+    strings: An iterable of input strings.
+    rule: The rule FST.
+    input_token_type: An optional string indicating how the input strings are
+        to be encoded as arc labels, as in batch_top_rewrite.
+    output_token_type: An optional string indicating how the output strings are
+        to be decoded from arc labels, as in batch_top_rewrite.
+    num_threads: The number of worker threads; if not positive, the hardware
+        concurrency is used.
+    state_multiplier: Max ratio for the number of states in the DFAs
+        determinized from the lattices.
+
+  Returns:
+    A list of lists of output strings, one per input string.
+
+  Raises:
+    FstArgError: Unknown token type.
+    FstOpError: Operation failed.
+  """
+  cdef _TokenType _input_token_type
+  cdef const_SymbolTable_ptr _isymbols = NULL
+  _get_token_type_and_symbols(input_token_type, addr(_input_token_type),
+                              addr(_isymbols))
+  cdef _TokenType _output_token_type
+  cdef const_SymbolTable_ptr _osymbols = NULL
+  _get_token_type_and_symbols(output_token_type, addr(_output_token_type),
+                              addr(_osymbols))
+  cdef _Fst _rule = _compile_or_copy_rule(rule)
+  cdef vector[string] _strings = [tostring(astring) for astring in strings]
+  cdef vector[vector[string]] _outputs
+  cdef bool _success
+  with nogil:
+    _success = BatchOptimalRewrites(_strings,
+                                    deref(_rule._fst),
+                                    addr(_outputs),
+                                    _input_token_type,
+                                    _isymbols,
+                                    _output_token_type,
+                                    _osymbols,
+                                    num_threads,
+                                    state_multiplier)
+  if not _success:
+    raise FstOpError("Operation failed")
+  return _outputs
+
+
+def batch_top_rewrites(strings,
+                       rule,
+                       int32 nshortest,
+                       input_token_type=None,
+                       output_token_type=None,
+                       int num_threads=0):
+  """
+  batch_top_rewrites(strings, rule, nshortest, input_token_type=None,
+                     output_token_type=None, num_threads=0)
+
+  Computes the top n rewrites for each of a batch of strings.
+
+  Args:
+    strings: An iterable of input strings.
+    rule: The rule FST.
+    nshortest: The maximum number of rewrites to return per string.
+    input_token_type: An optional string indicating how the input strings are
+        to be encoded as arc labels, as in batch_top_rewrite.
+    output_token_type: An optional string indicating how the output strings are
+        to be decoded from arc labels, as in batch_top_rewrite.
+    num_threads: The number of worker threads; if not positive, the hardware
+        concurrency is used.
+
+  Returns:
+    A list of lists of output strings, one per input string.
+
+  Raises:
+    FstArgError: Unknown token type.
+    FstOpError: Operation failed.
+  """
+  cdef _TokenType _input_token_type
+  cdef const_SymbolTable_ptr _isymbols = NULL
+  _get_token_type_and_symbols(input_token_type, addr(_input_token_type),
+                              addr(_isymbols))
+  cdef _TokenType _output_token_type
+  cdef const_SymbolTable_ptr _osymbols = NULL
+  _get_token_type_and_symbols(output_token_type, addr(_output_token_type),
+                              addr(_osymbols))
+  cdef _Fst _rule = _compile_or_copy_rule(rule)
+  cdef vector[string] _strings = [tostring(astring) for astring in strings]
+  cdef vector[vector[string]] _outputs
+  cdef bool _success
+  with nogil:
+    _success = BatchTopRewrites(_strings,
+                                deref(_rule._fst),
+                                nshortest,
+                                addr(_outputs),
+                                _input_token_type,
+                                _isymbols,
+                                _output_token_type,
+                                _osymbols,
+                                num_threads)
+  if not _success:
+    raise FstOpError("Operation failed")
+  return _outputs
+
+
+# Class for applying a cascade of rules natively.
+
+
+cdef class RuleCascadeEngine:
+
+  """
+  RuleCascadeEngine(rules, lazy=False, lookahead=False,
+                    cache_gc_limit=1 << 20)
+
+  Native engine for applying a series of rewrite rules, in order, to inputs.
+
+  Rather than materializing an intermediate lattice after each rule is
+  applied, the rules are composed with each other when the engine is
+  constructed. If lazy is false, the rules are precomposed into a single rule;
+  otherwise, they are combined into a chain of delayed compositions whose
+  state cache persists across calls. Concurrent calls, e.g., from batch
+  rewriting, each use their own copy of the chain, so that they do not wait
+  for one another; memory_usage counts the caches of all copies. The rules are
+  input-arc-sorted if necessary.
+
+  If lookahead is true, the rules are converted, once, to a form supporting
+  lookahead composition, which avoids exploring paths through epsilon arcs
+  that cannot lead to a match; this pays off for long cascades of
+  context-dependent rewrite rules. Conversion expands delayed rules.
+
+  Args:
+    rules: An iterable of rule FSTs, all with the same arc type; these may
+        include delayed FSTs such as those returned by lazy_cdrewrite.
+    lazy: Should the cascade be composed lazily?
+    lookahead: Should the cascade use lookahead composition?
+    cache_gc_limit: The maximum size, in bytes, of the state cache of each
+        delayed composition.
+
+  Raises:
+    FstOpError: Rule cascade construction failed.
+  """
+
+  cdef unique_ptr[RuleCascadeClass] _cascade
+  # Keeps the rules alive, since the cascade may share memory they borrow
+  # (e.g., the buffer of a frozen FST constructed with FrozenFst.from_buffer).
+  cdef list _compiled
+
+  def __repr__(self):
+    return f"<{self.__class__.__name__} at 0x{id(self):x}>"
+
+  def __init__(self,
+               rules,
+               bool lazy=False,
+               bool lookahead=False,
+               size_t cache_gc_limit=1 << 20):
+    # Delayed rules (e.g., from lazy_cdrewrite) are used as is, since copying
+    # them into a mutable FST would expand them.
+    self._compiled = [rule if isinstance(rule, _Fst) and
+                      not isinstance(rule, _MutableFst) else
+                      _compile_or_copy_Fst(rule) for rule in rules]
+    cdef vector[const FstClass *] _rules
+    cdef _Fst _rule
+    for _rule in self._compiled:
+      _rules.push_back(_rule._fst.get())
+    with nogil:
+      self._cascade.reset(new RuleCascadeClass(_rules, lazy, lookahead,
+                                               cache_gc_limit))
+    if self._cascade.get().Error():
+      raise FstOpError("Rule cascade construction failed")
+
+  cpdef string arc_type(self):
+    """
+    arc_type(self)
+
+    Returns a string indicating the arc type.
+    """
+    return self._cascade.get().ArcType()
+
+  cpdef bool lazy(self):
+    """
+    lazy(self)
+
+    Indicates whether the cascade is composed lazily.
+    """
+    return self._cascade.get().Lazy()
+
+  cpdef bool lookahead(self):
+    """
+    lookahead(self)
+
+    Indicates whether the cascade uses lookahead composition.
+    """
+    return self._cascade.get().LookAhead()
+
+  cpdef MemoryStats memory_usage(self):
+    """
+    memory_usage(self)
+
+    Returns the approximate memory used by the cascade.
+
+    This counts the expanded rules the cascade holds, which may be shared with
+    the FSTs it was constructed from, and, if it is lazy, the limit on the state
+    cache of each delayed composition, including those of delayed rules such as
+    those returned by lazy_cdrewrite.
+    """
+    return _init_MemoryStats(self._cascade.get().MemoryUsage())
+
+  cdef Fst _compile_input(self, astring, token_type):
+    if isinstance(astring, Fst):
+      return astring
+    return accep(astring, arc_type=self.arc_type(), token_type=token_type)
+
+  cpdef Fst rewrite_lattice(self, astring, token_type=None):
+    """
+    rewrite_lattice(self, astring, token_type=None)
+
+    Constructs a weighted, epsilon-free lattice of output strings.
+
+    Args:
+      astring: Input string or FST.
+      token_type: Optional input token type, or symbol table.
+
+    Returns:
+      An epsilon-free FST.
+
+    Raises:
+      FstOpError: Operation failed.
+    """
+    cdef Fst _input = self._compile_input(astring, token_type)
+    cdef Fst result = Fst(self.arc_type())
+    cdef bool _success
+    with nogil:
+      _success = self._cascade.get().RewriteLattice(deref(_input._fst),
+                                                    result._mfst.get())
+    if not _success:
+      raise FstOpError("Operation failed")
+    return result
+
+  cpdef bool matches(self,
+                     istring,
+                     ostring,
+                     input_token_type=None,
+                     output_token_type=None) except *:
+    """
+    matches(self, istring, ostring, input_token_type=None,
+            output_token_type=None)
+
+    Returns whether the cascade allows an input/output pair.
+
+    Args:
+      istring: Input string or FST.
+      ostring: Output string or FST.
+      input_token_type: Optional input token type, or symbol table.
+      output_token_type: Optional output token type, or symbol table.
+
+    Returns:
+      Whether the input-output pair is generated by the cascade.
+
+    Raises:
+      FstOpError: Operation failed.
+    """
+    cdef Fst _input = self._compile_input(istring, input_token_type)
+    cdef Fst _output = self._compile_input(ostring, output_token_type)
+    cdef bool _match = False
+    cdef bool _success
+    with nogil:
+      _success = self._cascade.get().Matches(deref(_input._fst),
+                                             deref(_output._fst),
+                                             addr(_match))
+    if not _success:
+      raise FstOpError("Operation failed")
+    return _match
+
+  def rewrites(self,
+               astring,
+               input_token_type=None,
+               output_token_type=None,
+               int32 state_multiplier=4):
+    """
+    rewrites(self, astring, input_token_type=None, output_token_type=None,
+             state_multiplier=4)
+
+    Returns all rewrites.
+
+    Args:
+      astring: Input string or FST.
+      input_token_type: Optional input token type, or symbol table.
+      output_token_type: Optional output token type, or symbol table.
+      state_multiplier: Max ratio for the number of states in the DFA lattice
+          to the NFA lattice; if exceeded, a warning is logged.
+
+    Returns:
+      A list of output strings.
+
+    Raises:
+      FstOpError: Operation failed.
+    """
+    cdef Fst _input = self._compile_input(astring, input_token_type)
+    cdef _TokenType _output_token_type
+    cdef const_SymbolTable_ptr _osymbols = NULL
+    _get_token_type_and_symbols(output_token_type, addr(_output_token_type),
+                                addr(_osymbols))
+    cdef vector[string] _outputs
+    cdef bool _success
+    with nogil:
+      _success = self._cascade.get().Rewrites(deref(_input._fst),
+                                              addr(_outputs),
+                                              _output_token_type,
+                                              _osymbols,
+                                              state_multiplier)
+    if not _success:
+      raise FstOpError("Operation failed")
+    return _outputs
+
+  def top_rewrites(self,
+                   astring,
+                   int32 nshortest,
+                   input_token_type=None,
+                   output_token_type=None):
+    """
+    top_rewrites(self, astring, nshortest, input_token_type=None,
+                 output_token_type=None)
+
+    Returns the top n rewrites.
+
+    Args:
+      astring: Input string or FST.
+      nshortest: The maximum number of rewrites to return.
+      input_token_type: Optional input token type, or symbol table.
+      output_token_type: Optional output token type, or symbol table.
+
+    Returns:
+      A list of output strings.
+
+    Raises:
+      FstOpError: Operation failed.
+    """
+    cdef Fst _input = self._compile_input(astring, input_token_type)
+    cdef _TokenType _output_token_type
+    cdef const_SymbolTable_ptr _osymbols = NULL
+    _get_token_type_and_symbols(output_token_type, addr(_output_token_type),
+                                addr(_osymbols))
+    cdef vector[string] _outputs
+    cdef bool _success
+    with nogil:
+      _success = self._cascade.get().TopRewrites(deref(_input._fst),
+                                                 nshortest,
+                                                 addr(_outputs),
+                                                 _output_token_type,
+                                                 _osymbols)
+    if not _success:
+      raise FstOpError("Operation failed")
+    return _outputs
+
+  cpdef string top_rewrite(self,
+                           astring,
+                           input_token_type=None,
+                           output_token_type=None) except *:
+    """
+    top_rewrite(self, astring, input_token_type=None, output_token_type=None)
+
+    Returns one top rewrite.
+
+    Args:
+      astring: Input string or FST.
+      input_token_type: Optional input token type, or symbol table.
+      output_token_type: Optional output token type, or symbol table.
+
+    Returns:
+      The top string.
+
+    Raises:
+      FstOpError: Operation failed.
+    """
+    cdef Fst _input = self._compile_input(astring, input_token_type)
+    cdef _TokenType _output_token_type
+    cdef const_SymbolTable_ptr _osymbols = NULL
+    _get_token_type_and_symbols(output_token_type, addr(_output_token_type),
+                                addr(_osymbols))
+    cdef string _output
+    cdef bool _success
+    with nogil:
+      _success = self._cascade.get().TopRewrite(deref(_input._fst),
+                                                addr(_output),
+                                                _output_token_type,
+                                                _osymbols)
+    if not _success:
+      raise FstOpError("Operation failed")
+    return _output
+
+  def optimal_rewrites(self,
+                       astring,
+                       input_token_type=None,
+                       output_token_type=None,
+                       int32 state_multiplier=4):
+    """
+    optimal_rewrites(self, astring, input_token_type=None,
+                     output_token_type=None, state_multiplier=4)
+
+    Returns all optimal rewrites.
+
+    Args:
+      astring: Input string or FST.
+      input_token_type: Optional input token type, or symbol table.
+      output_token_type: Optional output token type, or symbol table.
+      state_multiplier: Max ratio for the number of states in the DFA lattice
+          to the NFA lattice; if exceeded, a warning is logged.
+
+    Returns:
+      A list of output strings.
+
+    Raises:
+      FstOpError: Operation failed.
+    """
+    cdef Fst _input = self._compile_input(astring, input_token_type)
+    cdef _TokenType _output_token_type
+    cdef const_SymbolTable_ptr _osymbols = NULL
+    _get_token_type_and_symbols(output_token_type, addr(_output_token_type),
+                                addr(_osymbols))
+    cdef vector[string] _outputs
+    cdef bool _success
+    with nogil:
+      _success = self._cascade.get().OptimalRewrites(deref(_input._fst),
+                                                     addr(_outputs),
+                                                     _output_token_type,
+                                                     _osymbols,
+                                                     state_multiplier)
+    if not _success:
+      raise FstOpError("Operation failed")
+    return _outputs
+
+
+# Class for leniently composing many FSTs with the same constraint.
+
+
+cdef class LenientComposer:
+
+  """
+  LenientComposer(nu, sigma_star, compose_filter="auto", connect=True)
+
+  Reusable lenient composition with a fixed lower-priority argument.
+
+  This class computes the same lenient composition as `leniently_compose`, but
+  the right-hand side argument (e.g., a constraint, in an Optimality Theory
+  grammar) and the closure over the alphabet are checked and arc-sorted once,
+  when the composer is constructed, rather than each time the composition is
+  applied.
+
+  Args:
+    nu: The second input FST, taking lower priority.
+    sigma_star: A cyclic, unweighted acceptor representing the closure over the
+        alphabet.
+    compose_filter: A string matching a known composition filter; one of:
+        "alt_sequence", "auto", "match", "no_match", "null", "sequence",
+        "trivial".
+    connect: Should output be trimmed?
+
+  Raises:
+    FstOpError: Lenient composer construction failed.
+  """
+
+  cdef unique_ptr[LenientComposerClass] _composer
+
+  def __repr__(self):
+    return f"<{self.__class__.__name__} at 0x{id(self):x}>"
+
+  def __init__(self, nu, sigma_star, compose_filter="auto",
+               bool connect=True):
+    cdef Fst _nu = _compile_or_copy_Fst(nu)
+    cdef Fst _sigma_star = _compile_or_copy_Fst(sigma_star, _nu.arc_type())
+    cdef unique_ptr[ComposeOptions] _opts
+    _opts.reset(
+        new ComposeOptions(connect,
+                           _get_compose_filter(tostring(compose_filter))))
+    with nogil:
+      self._composer.reset(
+          new LenientComposerClass(deref(_nu._fst),
+                                   deref(_sigma_star._fst),
+                                   deref(_opts)))
+    if self._composer.get().Error():
+      raise FstOpError("Lenient composer construction failed")
+
+  cpdef string arc_type(self):
+    """
+    arc_type(self)
+
+    Returns a string indicating the arc type.
+    """
+    return self._composer.get().ArcType()
+
+  def __call__(self, mu, bool lazy=False):
+    """
+    __call__(self, mu, lazy=False)
+
+    Leniently composes an FST with the constraint.
+
+    Args:
+      mu: The first input FST, taking higher priority; this may be a delayed
+          FST, such as one returned by a lazy call to a LenientComposer.
+      lazy: Should the result be a delayed FST? If true, the result is an
+          immutable FST which is expanded only as it is visited, so that it can
+          be passed on to a further lenient composition without being
+          materialized; it is not trimmed, and the composition filter is
+          ignored.
+
+    Returns:
+      An FST.
+
+    Raises:
+      FstOpError: Operation failed.
+    """
+    # Delayed inputs are used as is, since copying them into a mutable FST
+    # would expand them. A delayed result keeps a copy of its input, though,
+    # which does not keep a borrowed buffer alive, so frozen FSTs constructed
+    # over one are copied.
+    cdef _Fst _mu
+    if (isinstance(mu, _Fst) and not isinstance(mu, _MutableFst) and
+        not (lazy and _is_borrowed(mu))):
+      _mu = mu
+    else:
+      _mu = _compile_or_copy_Fst(mu, self.arc_type())
+    cdef unique_ptr[FstClass] _delayed
+    cdef Fst result
+    cdef bool _success
+    if lazy:
+      with nogil:
+        _delayed = self._composer.get().ComposeDelayed(deref(_mu._fst))
+      if (_delayed.get() == NULL or
+          _delayed.get().Properties(kError, True) == kError):
+        raise FstOpError("Operation failed")
+      return _init_XFst(_delayed.release())
+    result = Fst(self.arc_type())
+    with nogil:
+      _success = self._composer.get().Compose(deref(_mu._fst),
+                                              result._mfst.get())
+    if not _success:
+      raise FstOpError("Operation failed")
+    return result
+
+
+# Class for finding the closest matches to strings in a lexicon.
+
+
+cdef class LevenshteinAutomatonEngine:
+
+  """
+  LevenshteinAutomatonEngine(lexicon, sigma, insert_cost=1, delete_cost=1,
+                             substitute_cost=1, bound=0)
+
+  Native engine for approximately matching strings against a lexicon.
+
+  Rather than composing each query with an edit transducer and the lexicon,
+  this engine simulates the Levenshtein automaton of the query (i.e., the edit
+  distance dynamic program) directly over a deterministic copy of the lexicon,
+  searching it best-first, so that only lexicon prefixes which may be part of a
+  closest match are ever visited.
+
+  Args:
+    lexicon: An acceptor of the lexicon strings; weights are ignored.
+    sigma: An acceptor of the single-label alphabet over which edits are
+        permitted; labels outside of this alphabet can be neither matched nor
+        edited.
+    insert_cost: The positive cost for inserting a lexicon label.
+    delete_cost: The positive cost for deleting a query label.
+    substitute_cost: The positive cost for substituting a lexicon label for a
+        query label.
+    bound: The number of permissible edits, or `0` (the default) if there is no
+        upper bound.
+
+  Raises:
+    FstOpError: Levenshtein automaton construction failed.
+  """
+
+  cdef unique_ptr[LevenshteinAutomatonClass] _automaton
+
+  def __repr__(self):
+    return f"<{self.__class__.__name__} at 0x{id(self):x}>"
+
+  def __init__(self,
+               lexicon,
+               sigma,
+               double insert_cost=1,
+               double delete_cost=1,
+               double substitute_cost=1,
+               int32 bound=0):
+    cdef Fst _lexicon
+    cdef Fst _sigma
+    (_lexicon, _sigma) = _compile_or_copy_two_Fsts(lexicon, sigma)
+    with nogil:
+      self._automaton.reset(
+          new LevenshteinAutomatonClass(deref(_lexicon._fst),
+                                        deref(_sigma._fst),
+                                        insert_cost,
+                                        delete_cost,
+                                        substitute_cost,
+                                        bound))
+    if self._automaton.get().Error():
+      raise FstOpError("Levenshtein automaton construction failed")
+
+  cpdef string arc_type(self):
+    """
+    arc_type(self)
+
+    Returns a string indicating the arc type.
+    """
+    return self._automaton.get().ArcType()
+
+  cpdef list closest_matches(self,
+                             query,
+                             int32 nshortest=0,
+                             bool optimal_only=False,
+                             input_token_type=None,
+                             output_token_type=None):
+    """
+    closest_matches(self, query, nshortest=0, optimal_only=False,
+                    input_token_type=None, output_token_type=None)
+
+    Finds the lexicon strings closest to a query, best first.
+
+    Args:
+      query: Input string or string FST.
+      nshortest: The maximum number of matches to return, or `0` for no limit.
+      optimal_only: Should only the matches tied with the closest be returned?
+      input_token_type: Optional input token type, or symbol table.
+      output_token_type: Optional output token type, or symbol table.
+
+    Returns:
+      A list of (string, distance) pairs; this is empty if nothing in the
+      lexicon can be reached from the query by permissible edits.
+
+    Raises:
+      FstOpError: Operation failed.
+    """
+    cdef Fst _query = (query if isinstance(query, Fst) else
+                       accep(query,
+                             arc_type=self.arc_type(),
+                             token_type=input_token_type))
+    cdef _TokenType _output_token_type
+    cdef const_SymbolTable_ptr _osymbols = NULL
+    _get_token_type_and_symbols(output_token_type, addr(_output_token_type),
+                                addr(_osymbols))
+    cdef vector[string] _matches
+    cdef vector[double] _costs
+    cdef bool _success
+    with nogil:
+      _success = self._automaton.get().ClosestMatches(deref(_query._fst),
+                                                      nshortest,
+                                                      optimal_only,
+                                                      addr(_matches),
+                                                      addr(_costs),
+                                                      _output_token_type,
+                                                      _osymbols)
+    if not _success:
+      raise FstOpError("Operation failed")
+    return list(zip(_matches, _costs))
+
+
+# Class for streaming tagging of the substrings matched by an acceptor.
+
+
+cdef class TaggerEngine:
+
+  """
+  TaggerEngine(matcher, sigma_star, ltag, rtag, token_type=None)
+
+  Native engine for inserting tags around the substrings of a text which are
+  accepted by a matcher.
+
+  Rather than compiling the text into an FST and composing it with a
+  context-dependent rewrite rule, this engine scans the text directly, running
+  a deterministic copy of the matcher, built once, from each position. Matches
+  are chosen from left to right and do not overlap: at each position, the
+  match with the best weight (and among those, the longest) is tagged. Texts
+  may also be streamed through the tagger chunk by chunk using `tag_stream`.
+
+  Args:
+    matcher: An acceptor of the substrings to be tagged.
+    sigma_star: A cyclic, unweighted acceptor representing the closure over the
+        alphabet.
+    ltag: The string inserted to the left of each match.
+    rtag: The string inserted to the right of each match.
+    token_type: An optional token type, either "byte" or "utf8"; if not
+        specified, the default token type is used.
+
+  Raises:
+    FstArgError: Symbol table token types are not supported.
+    FstOpError: Tagger construction failed.
+  """
+
+  cdef unique_ptr[TaggerClass] _tagger
+
+  def __repr__(self):
+    return f"<{self.__class__.__name__} at 0x{id(self):x}>"
+
+  def __init__(self, matcher, sigma_star, ltag, rtag, token_type=None):
+    cdef _TokenType _token_type
+    cdef const_SymbolTable_ptr _symbols = NULL
+    _get_token_type_and_symbols(token_type, addr(_token_type), addr(_symbols))
+    if _token_type == _TokenType.SYMBOL:
+      raise FstArgError("Symbol table token types are not supported")
+    cdef Fst _matcher
+    cdef Fst _sigma_star
+    (_matcher, _sigma_star) = _compile_or_copy_two_Fsts(matcher, sigma_star)
+    cdef string _ltag = tostring(ltag)
+    cdef string _rtag = tostring(rtag)
+    with nogil:
+      self._tagger.reset(
+          new TaggerClass(deref(_matcher._fst),
+                          deref(_sigma_star._fst),
+                          _ltag,
+                          _rtag,
+                          _token_type))
+    if self._tagger.get().Error():
+      raise FstOpError("Tagger construction failed")
+
+  cpdef string arc_type(self):
+    """
+    arc_type(self)
+
+    Returns a string indicating the arc type.
+    """
+    return self._tagger.get().ArcType()
+
+  cpdef string tag(self, text) except *:
+    """
+    tag(self, text)
+
+    Tags a complete text.
+
+    Args:
+      text: The input string.
+
+    Returns:
+      The tagged string.
+
+    Raises:
+      FstOpError: Operation failed.
+    """
+    cdef string _text = tostring(text)
+    cdef string _output
+    cdef bool _success
+    with nogil:
+      _success = self._tagger.get().Tag(_text, addr(_output))
+    if not _success:
+      raise FstOpError("Operation failed")
+    return _output
+
+  def tag_stream(self, chunks):
+    """
+    tag_stream(self, chunks)
+
+    Tags a text given as an iterable of chunks.
+
+    Each part of the tagged string is yielded as soon as it is known, so that
+    only the part of the text after the earliest position at which a match might
+    still begin is buffered.
+
+    Args:
+      chunks: An iterable of strings which together make up the input string.
+
+    Yields:
+      Successive non-empty parts of the tagged string.
 
-  Creates a transducer that maps between elements of mappings read from
-  a tab-delimited file.
+    Raises:
+      FstOpError: Operation failed.
+    """
+    cdef string _pending
+    cdef string _chunk
+    cdef string _output
+    cdef bool _final = False
+    cdef bool _success
+    chunk_iterator = iter(chunks)
+    while not _final:
+      try:
+        _chunk = tostring(next(chunk_iterator))
+      except StopIteration:
+        _chunk.clear()
+        _final = True
+      _output.clear()
+      with nogil:
+        _success = self._tagger.get().TagIncremental(_chunk,
+                                                     _final,
+                                                     addr(_pending),
+                                                     addr(_output))
+      if not _success:
+        raise FstOpError("Operation failed")
+      if not _output.empty():
+        yield _output
 
-  The first column is interpreted as the input string to a transduction.
 
-  The second column, separated from the first by a single tab character, is
-  interpreted as the output string for the transduction; an acceptor can be
-  modeled by using identical first and second columns.
+# Class for caching the results of rewrites.
 
-  An optional third column, separated from the second by a single tab character,
-  is interpreted as a weight for the transduction; if not specified the weight
-  defaults to semiring One. Note that weights are never permitted in the second
-  column.
 
-  The comment character is #, and has scope until the end of the line. Any
-  preceding whitespace before a comment is ignored. To use the '#' literal
-  (i.e., to ensure it is not interpreted as the start of a comment) escape it
-  with \; the escaping \ in the string "\#" also ignored.
+cdef str _token_type_key(token_type):
+  """Returns a string identifying a resolved token type, for use in cache keys.
 
   Args:
-    filename: The path to a TSV file formatted as described above.
-    arc_type: A string indicating the arc type.
-    input_token_type: An optional string indicating how the input strings are
-        to be encoded as arc labels---one of: "utf8" (encodes strings as a UTF-8
-        encoded Unicode strings), "byte" (encodes strings as raw bytes)---or a
-        SymbolTable. If not set, or set to None, the value is set to the
-        default token_type, which begins as "byte", but can be overridden for
-        regions of code using the default_token_type context manager.
-    output_token_type: An optional string indicating how the output strings are
-        to be encoded as arc labels---one of: "utf8" (encodes strings as a UTF-8
-        encoded Unicode strings), "byte" (encodes strings as raw bytes)---or a
-        SymbolTable. If not set, or set to None, the value is set to the
-        default token_type, which begins as "byte", but can be overridden for
-        regions of code using the default_token_type context manager.
+    token_type: None (in which case the default is used), a SymbolTable, or a
+        string matching a known token type.
 
   Returns:
-    An FST.
+    A string identifying the token type.
 
-  Raises:
-    FstIOError: Read failed.
+  This function is not visible to Python users.
   """
-  cdef _TokenType _input_token_type
-  cdef const_SymbolTable_ptr _isymbols = NULL
-  if input_token_type is None:
-    _input_token_type = GetDefaultTokenType()
-    _isymbols = GetDefaultSymbols()
-  elif isinstance(input_token_type, _pywrapfst.SymbolTableView):
-    _input_token_type = _TokenType.SYMBOL
-    _isymbols = (<_SymbolTableView> input_token_type)._raw_ptr_or_raise()
-  else:
-    _input_token_type = _get_token_type(tostring(input_token_type))
-  cdef _TokenType _output_token_type
-  cdef const_SymbolTable_ptr _osymbols = NULL
-  if output_token_type is None:
-    _output_token_type = GetDefaultTokenType()
-    _osymbols = GetDefaultSymbols()
-  elif isinstance(output_token_type, _pywrapfst.SymbolTableView):
-    _output_token_type = _TokenType.SYMBOL
-    _osymbols = (<_SymbolTableView> output_token_type)._raw_ptr_or_raise()
-  else:
-    _output_token_type = _get_token_type(tostring(output_token_type))
-  cdef Fst result = Fst(arc_type=arc_type)
-  if not StringFileCompile(path_tostring(filename),
-                           result._mfst.get(),
-                           _input_token_type,
-                           _output_token_type,
-                           _isymbols,
-                           _osymbols):
-    raise FstIOError("Read failed")
-  return result
+  cdef _TokenType _token_type
+  cdef const_SymbolTable_ptr _symbols = NULL
+  _get_token_type_and_symbols(token_type, addr(_token_type), addr(_symbols))
+  if _token_type == _TokenType.SYMBOL and _symbols != NULL:
+    return f"symbol:{_symbols.LabeledCheckSum()}"
+  return str(<int> _token_type)
 
 
-cpdef Fst string_map(lines,
-                     arc_type="standard",
-                     input_token_type=None,
-                     output_token_type=None):
+cpdef uint64 fingerprint(fst) except *:
   """
-  string_map(lines, arc_type="standard",
-             input_token_type=None, output_token_type=None)
+  fingerprint(fst)
 
-  Creates an acceptor or cross-product transducer that maps between
-  elements of mappings read from an iterable.
+  Computes a fingerprint of an FST, for use as a RewriteCache key.
+
+  Equal FSTs have equal fingerprints. Computing the fingerprint visits every
+  state and arc (expanding delayed FSTs), so callers should compute it once per
+  rule rather than once per query, and must not mutate the rule while its
+  rewrites are cached.
 
   Args:
-    lines: An iterable of iterables of size one, two, or three, or an iterable
-        of strings. The first element in each indexable (or each string, if the
-        input is an iterable of strings) is interpreted as the input string,
-        the second (optional) as the output string, defaulting to the input
-        string, and the third (optional) as a string to be parsed as a weight,
-        defaulting to semiring One.
-    arc_type: A string indicating the arc type.
-    input_token_type: An optional string indicating how the input strings are to
-        be encoded as arc labels---one of: "utf8" (encodes strings as a UTF-8
-        encoded Unicode strings), "byte" (encodes strings as raw bytes)---or a
-        SymbolTable. If not set, or set to None, the value is set to the
-        default token_type, which begins as "byte", but can be overridden for
-        regions of code using the default_token_type context manager.
-    output_token_type: An optional string indicating how the output strings are
-        to be encoded as arc labels---one of: "utf8" (encodes strings as a UTF-8
-        encoded Unicode strings), "byte" (encodes strings as raw bytes)---or a
-        SymbolTable. If not set, or set to None, the value is set to the
-        default token_type, which begins as "byte", but can be overridden for
-        regions of code using the default_token_type context manager.
+    fst: The input FST.
 
   Returns:
-    An FST.
+    An unsigned 64-bit integer.
+  """
+  cdef _Fst _fst = fst if isinstance(fst, _Fst) else _compile_or_copy_Fst(fst)
+  cdef uint64 _fingerprint
+  with nogil:
+    _fingerprint = FstFingerprint(deref(_fst._fst))
+  return _fingerprint
 
-  Raises:
-    FstArgError: String map compilation failed.
+
+cpdef MemoryStats memory_usage(fst):
   """
-  cdef _TokenType _input_token_type
-  cdef const_SymbolTable_ptr _isymbols = NULL
-  if input_token_type is None:
-    _input_token_type = GetDefaultTokenType()
-    _isymbols = GetDefaultSymbols()
-  elif isinstance(input_token_type, _pywrapfst.SymbolTableView):
-    _input_token_type = _TokenType.SYMBOL
-    _isymbols = (<_SymbolTableView> input_token_type)._raw_ptr_or_raise()
-  else:
-    _input_token_type = _get_token_type(tostring(input_token_type))
-  cdef _TokenType _output_token_type
-  cdef const_SymbolTable_ptr _osymbols = NULL
-  if output_token_type is None:
-    _output_token_type = GetDefaultTokenType()
-    _osymbols = GetDefaultSymbols()
-  elif isinstance(output_token_type, _pywrapfst.SymbolTableView):
-    _output_token_type = _TokenType.SYMBOL
-    _osymbols = (<_SymbolTableView> output_token_type)._raw_ptr_or_raise()
-  else:
-    _output_token_type = _get_token_type(tostring(output_token_type))
-  cdef vector[vector[string]] _lines
-  for line in lines:
-    if isinstance(line, str):
-      _lines.push_back([tostring(line)])
-    else:
-      _lines.push_back([tostring(elem) for elem in line])
-  cdef Fst result = Fst(arc_type)
-  if not StringMapCompile(_lines,
-                          result._mfst.get(),
-                          _input_token_type,
-                          _output_token_type,
-                          _isymbols,
-                          _osymbols):
-    raise FstArgError("String map compilation failed")
-  return result
+  memory_usage(fst)
 
+  Computes the approximate memory used by an FST.
 
+  The states and arcs of expanded FSTs (such as mutable and frozen FSTs) are
+  counted, as are their symbol tables, with a table shared by both sides
+  counted once. The states of a delayed FST are not counted, since counting
+  them would expand it; for one returned by lazy_cdrewrite, the limits on the
+  state caches of its delayed compositions are counted instead. Unused
+  container capacity is not counted.
 
-cdef class _PointerSymbolTableView(_SymbolTableView):
+  Args:
+    fst: The input FST.
 
+  Returns:
+    A MemoryStats object.
   """
-  (No constructor.)
+  cdef _Fst _fst = fst if isinstance(fst, _Fst) else _compile_or_copy_Fst(fst)
+  cdef _MemoryStats _stats
+  with nogil:
+    _stats = MemoryUsage(deref(_fst._fst))
+  return _init_MemoryStats(_stats)
 
-  Immutable SymbolTable class for unowned tables.
 
-  This class wraps a library const SymbolTable pointer, and is used to wrap
-  the generated symbols table singleton.
+cdef class RewriteCache:
+
   """
+  RewriteCache(max_bytes=67108864, num_shards=16)
+
+  A thread-safe, size-bounded cache of the results of rewrite queries.
+
+  Each entry holds the output strings of a query, keyed on a fingerprint of the
+  rule (see `fingerprint`), the name of the query (which should include any
+  options, other than token types, that affect the result), the number of
+  shortest paths requested, the input string, and the resolved input and
+  output token types. When the cache is full, the least recently used entries
+  are evicted first. The cache is split into independently locked shards, each
+  holding an equal share of the bytes, so that concurrent callers rarely
+  contend.
+
+  Args:
+    max_bytes: The approximate maximum size of the cache, in bytes.
+    num_shards: The number of shards.
 
-  cdef const_SymbolTable_ptr _symbols
+  Raises:
+    FstArgError: The number of shards must be positive.
+  """
 
-  # NB: Do not expose any non-const methods of the wrapped SymbolTable here.
-  # Doing so will allow undefined behavior.
+  cdef unique_ptr[_RewriteCache] _cache
 
   def __repr__(self):
-    return f"<const pointer SymbolTableView {self.name()!r} at 0x{id(self):x}>"
+    return f"<{self.__class__.__name__} at 0x{id(self):x}>"
+
+  def __init__(self, size_t max_bytes=67108864, size_t num_shards=16):
+    if num_shards < 1:
+      raise FstArgError("The number of shards must be positive")
+    self._cache.reset(new _RewriteCache(max_bytes, num_shards))
+
+  def __len__(self):
+    return self._cache.get().Size()
+
+  cdef void _set_key(self,
+                     RewriteCacheKey *_key,
+                     uint64 rule,
+                     query,
+                     astring,
+                     int32 nshortest,
+                     input_token_type,
+                     output_token_type) except *:
+    _key.rule = rule
+    _key.query = tostring(f"{query}\0{_token_type_key(input_token_type)}\0"
+                          f"{_token_type_key(output_token_type)}")
+    _key.nshortest = nshortest
+    _key.input = tostring(astring)
+
+  def lookup(self,
+             uint64 rule,
+             query,
+             astring,
+             int32 nshortest=0,
+             input_token_type=None,
+             output_token_type=None):
+    """
+    lookup(self, rule, query, astring, nshortest=0, input_token_type=None,
+           output_token_type=None)
+
+    Looks up the outputs of a query.
+
+    Args:
+      rule: The fingerprint of the rule.
+      query: The name of the query, including any other options.
+      astring: The input string.
+      nshortest: The number of shortest paths requested, if applicable.
+      input_token_type: Optional input token type, or symbol table.
+      output_token_type: Optional output token type, or symbol table.
+
+    Returns:
+      A list of output strings, or None if the query is not cached.
+    """
+    cdef RewriteCacheKey _key
+    self._set_key(addr(_key), rule, query, astring, nshortest,
+                  input_token_type, output_token_type)
+    cdef vector[string] _outputs
+    cdef bool _found
+    with nogil:
+      _found = self._cache.get().Lookup(_key, addr(_outputs))
+    return _outputs if _found else None
+
+  cpdef void insert(self,
+                    uint64 rule,
+                    query,
+                    astring,
+                    outputs,
+                    int32 nshortest=0,
+                    input_token_type=None,
+                    output_token_type=None) except *:
+    """
+    insert(self, rule, query, astring, outputs, nshortest=0,
+           input_token_type=None, output_token_type=None)
+
+    Caches the outputs of a query.
+
+    Args:
+      rule: The fingerprint of the rule.
+      query: The name of the query, including any other options.
+      astring: The input string.
+      outputs: An iterable of output strings.
+      nshortest: The number of shortest paths requested, if applicable.
+      input_token_type: Optional input token type, or symbol table.
+      output_token_type: Optional output token type, or symbol table.
+    """
+    cdef RewriteCacheKey _key
+    self._set_key(addr(_key), rule, query, astring, nshortest,
+                  input_token_type, output_token_type)
+    cdef vector[string] _outputs = [tostring(output) for output in outputs]
+    with nogil:
+      self._cache.get().Insert(_key, _outputs)
+
+  cpdef void clear(self):
+    """
+    clear(self)
+
+    Removes all entries; the counters are not reset.
+    """
+    self._cache.get().Clear()
+
+  cpdef size_t max_bytes(self):
+    """
+    max_bytes(self)
+
+    Returns the approximate maximum size of the cache, in bytes.
+    """
+    return self._cache.get().MaxBytes()
+
+  cpdef size_t num_bytes(self):
+    """
+    num_bytes(self)
+
+    Returns the approximate size of the cached entries, in bytes.
+    """
+    return self._cache.get().NumBytes()
+
+  cpdef MemoryStats memory_usage(self):
+    """
+    memory_usage(self)
 
-  cdef const_SymbolTable_ptr _raw(self):
-    return self._symbols
+    Returns the approximate memory used by the cached entries, as caches.
 
+    The cache never holds more than max_bytes bytes.
+    """
+    cdef _MemoryStats _stats
+    _stats.caches = self._cache.get().NumBytes()
+    return _init_MemoryStats(_stats)
+
+  cpdef uint64 hits(self):
+    """
+    hits(self)
+
+    Returns the number of lookups which found their query.
+    """
+    return self._cache.get().Hits()
+
+  cpdef uint64 misses(self):
+    """
+    misses(self)
+
+    Returns the number of lookups which did not find their query.
+    """
+    return self._cache.get().Misses()
+
+  cpdef uint64 evictions(self):
+    """
+    evictions(self)
 
-cpdef _PointerSymbolTableView generated_symbols():
-  """Returns a view of a symbol table containing generated symbols."""
-  cdef _PointerSymbolTableView _symbols = (
-      _PointerSymbolTableView.__new__(_PointerSymbolTableView))
-  _symbols._symbols = addr(GeneratedSymbols())
-  return _symbols
+    Returns the number of entries evicted to make room for others.
+    """
+    return self._cache.get().Evictions()
 
 
 # Decorator for one-argument constructive FST operations.
@@ -1271,6 +3465,9 @@ def _compose_patch(fnc):
   def patch(fst1, fst2, *args, **kwargs):
     cdef Fst _fst1
     cdef Fst _fst2
+    if _is_frozen(fst1) or _is_frozen(fst2):
+      return _init_Fst_from_MutableFst(
+          fnc(*_compile_or_view_two_Fsts(fst1, fst2), *args, **kwargs))
     (_fst1, _fst2) = _compile_or_copy_two_Fsts(fst1, fst2)
     _maybe_arcsort(_fst1._mfst.get(), _fst2._mfst.get())
     return _init_Fst_from_MutableFst(fnc(_fst1, _fst2, *args, **kwargs))
@@ -1555,12 +3752,13 @@ def pdt_compose(fst1,
       tostring(compose_filter))
   cdef unique_ptr[PdtComposeOptions] _opts
   _opts.reset(new PdtComposeOptions(True, _compose_filter))
-  PdtCompose(deref(_fst1._fst),
-             deref(_fst2._fst),
-             parens._parens,
-             result._mfst.get(),
-             deref(_opts),
-             left_pdt)
+  with nogil:
+    PdtCompose(deref(_fst1._fst),
+               deref(_fst2._fst),
+               parens._parens,
+               result._mfst.get(),
+               deref(_opts),
+               left_pdt)
   return result
 
 
@@ -1602,7 +3800,11 @@ def pdt_expand(fst,
                                                       weight)
   cdef unique_ptr[PdtExpandOptions] _opts
   _opts.reset(new PdtExpandOptions(connect, keep_parentheses, _weight))
-  PdtExpand(deref(_fst._fst), parens._parens, result._mfst.get(), deref(_opts))
+  with nogil:
+    PdtExpand(deref(_fst._fst),
+              parens._parens,
+              result._mfst.get(),
+              deref(_opts))
   result._check_mutating_imethod()
   return result
 
@@ -1622,14 +3824,19 @@ cdef object _pdt_replace(pairs,
     _pairs.push_back(LabelFstClassPair(_label, _fst._fst.get()))
   cdef Fst result_fst = Fst(_pairs[0].second.ArcType())
   cdef PdtParentheses result_parens = PdtParentheses()
-  PdtReplace(_pairs,
-             result_fst._mfst.get(),
-             addr(result_parens._parens),
-             _pairs[0].first,
-             _get_pdt_parser_type(tostring(pdt_parser_type)),
-             start_paren_labels,
-             tostring(left_paren_prefix),
-             tostring(right_paren_prefix))
+  cdef PdtParserType _pdt_parser_type = _get_pdt_parser_type(
+      tostring(pdt_parser_type))
+  cdef string _left_paren_prefix = tostring(left_paren_prefix)
+  cdef string _right_paren_prefix = tostring(right_paren_prefix)
+  with nogil:
+    PdtReplace(_pairs,
+               result_fst._mfst.get(),
+               addr(result_parens._parens),
+               _pairs[0].first,
+               _pdt_parser_type,
+               start_paren_labels,
+               _left_paren_prefix,
+               _right_paren_prefix)
   result_fst._check_mutating_imethod()
   return (result_fst, result_parens)
 
@@ -1705,7 +3912,8 @@ cpdef Fst pdt_reverse(fst, PdtParentheses parens):
   """
   cdef Fst _fst = _compile_or_copy_Fst(fst)
   cdef Fst result = Fst(_fst.arc_type())
-  PdtReverse(deref(_fst._fst), parens._parens, result._mfst.get())
+  with nogil:
+    PdtReverse(deref(_fst._fst), parens._parens, result._mfst.get())
   result._check_mutating_imethod()
   return result
 
@@ -1746,10 +3954,11 @@ cpdef pdt_shortestpath(fst,
       new PdtShortestPathOptions(_get_queue_type(tostring(queue_type)),
                                  keep_parentheses,
                                  path_gc))
-  PdtShortestPath(deref(_fst._fst),
-                  parens._parens,
-                  result._mfst.get(),
-                  deref(_opts))
+  with nogil:
+    PdtShortestPath(deref(_fst._fst),
+                    parens._parens,
+                    result._mfst.get(),
+                    deref(_opts))
   result._check_mutating_imethod()
   return result
 
@@ -1904,13 +4113,14 @@ cpdef Fst mpdt_compose(fst1, fst2, MPdtParentheses parens,
   _opts.reset(
       new MPdtComposeOptions(True,
                              _get_pdt_compose_filter(tostring(compose_filter))))
-  MPdtCompose(deref(_fst1._fst),
-              deref(_fst2._fst),
-              parens._parens,
-              parens._assign,
-              result._mfst.get(),
-              deref(_opts),
-              left_mpdt)
+  with nogil:
+    MPdtCompose(deref(_fst1._fst),
+                deref(_fst2._fst),
+                parens._parens,
+                parens._assign,
+                result._mfst.get(),
+                deref(_opts),
+                left_mpdt)
   return result
 
 
@@ -1947,11 +4157,12 @@ cpdef Fst mpdt_expand(fst,
   cdef Fst result = Fst(_fst.arc_type())
   cdef unique_ptr[MPdtExpandOptions] _opts
   _opts.reset(new MPdtExpandOptions(connect, keep_parentheses))
-  MPdtExpand(deref(_fst._fst),
-             parens._parens,
-             parens._assign,
-             result._mfst.get(),
-             deref(_opts))
+  with nogil:
+    MPdtExpand(deref(_fst._fst),
+               parens._parens,
+               parens._assign,
+               result._mfst.get(),
+               deref(_opts))
   result._check_mutating_imethod()
   return result
 
@@ -1978,10 +4189,11 @@ def mpdt_reverse(fst, MPdtParentheses parens):
   cdef Fst _fst = _compile_or_copy_Fst(fst)
   cdef Fst result_fst = Fst(_fst.arc_type())
   cdef MPdtParentheses result_parens = parens.copy()
-  MPdtReverse(deref(_fst._fst),
-              result_parens._parens,
-              addr(result_parens._assign),
-              result_fst._mfst.get())
+  with nogil:
+    MPdtReverse(deref(_fst._fst),
+                result_parens._parens,
+                addr(result_parens._assign),
+                result_fst._mfst.get())
   result_fst._check_mutating_imethod()
   return (result_fst, result_parens)
 
@@ -2082,6 +4294,46 @@ cdef class _StringPathIterator:
     """
     return self._paths.get().Error()
 
+  def extract_all(self, int64 limit=-1):
+    """
+    extract_all(self, limit=-1)
+
+    Returns all remaining (istring, ostring, weight) triples in the FST.
+
+    This method is equivalent to taking up to `limit` triples from `items`, but
+    enumerates the paths in a single call without holding the interpreter
+    lock, so it is much faster for large FSTs. The iterator is advanced past
+    the extracted paths; the caller is responsible for resetting the iterator
+    if desired.
+
+    Args:
+      limit: The maximum number of paths to extract; if negative, all
+          remaining paths are extracted.
+
+    Returns:
+      A list of (istring, ostring, weight) triples.
+
+    Raises:
+      FstOpError: Operation failed.
+    """
+    cdef vector[string] _istrings
+    cdef vector[string] _ostrings
+    cdef vector[WeightClass] _weights
+    cdef bool success
+    with nogil:
+      success = self._paths.get().Extract(limit, addr(_istrings),
+                                          addr(_ostrings), addr(_weights))
+    if not success:
+      raise FstOpError("Operation failed")
+    cdef list result = []
+    cdef size_t _i = 0
+    cdef _Weight _weight
+    for _i in range(_weights.size()):
+      _weight = _Weight.__new__(_Weight)
+      _weight._weight.reset(new WeightClass(_weights[_i]))
+      result.append((_istrings[_i], _ostrings[_i], _weight))
+    return result
+
   def ilabels(self):
     """
     ilabels(self)
@@ -2221,13 +4473,96 @@ cdef class _StringPathIterator:
       self._paths.get().Next()
 
 
+# Class for lazily extracting the best strings from an FST.
+
+
+cdef class _ShortestStringIterator:
+
+  """
+  _ShortestStringIterator(fst, token_type=None)
+
+  Lazy iterator over the unique output strings of an FST in order of weight.
+
+  This class generates (string, weight) pairs for the unique output strings of
+  an FST, best first; searching for each string is deferred until it is
+  requested. This class is normally created by invoking the `shortest_strings`
+  method of `Fst`.
+
+  Args:
+    fst: input FST.
+    token_type: An optional string indicating how the output strings are to be
+        constructed from arc labels---one of: "byte" (interprets arc labels as
+        raw bytes), "utf8" (interprets arc labels as Unicode code points), or a
+        SymbolTable. If not set, or set to None, the value is set to the
+        default token_type, which begins as "byte", but can be overridden for
+        regions of code using the default_token_type context manager.
+
+  Raises:
+    FstArgError: Unknown token type.
+    FstOpError: Operation failed.
+  """
+
+  cdef unique_ptr[ShortestStringIteratorClass] _strings
+
+  def __repr__(self):
+    return f"<{self.__class__.__name__} at 0x{id(self):x}>"
+
+  def __init__(self, fst, token_type=None):
+    cdef _TokenType _token_type
+    cdef const_SymbolTable_ptr _symbols = NULL
+    if token_type is None:
+      _token_type = GetDefaultTokenType()
+      _symbols = GetDefaultSymbols()
+    elif isinstance(token_type, _pywrapfst.SymbolTableView):
+      _token_type = _TokenType.SYMBOL
+      _symbols = (<_SymbolTableView> token_type)._raw_ptr_or_raise()
+    else:
+      _token_type = _get_token_type(tostring(token_type))
+    cdef Fst _fst = _compile_or_copy_Fst(fst)
+    with nogil:
+      self._strings.reset(
+          new ShortestStringIteratorClass(deref(_fst._fst),
+                                          _token_type,
+                                          _symbols))
+    if self._strings.get().Error():
+      raise FstOpError("Operation failed")
+
+  def __iter__(self):
+    return self
+
+  def __next__(self):
+    if self._strings.get().Done():
+      raise StopIteration
+    cdef string _result
+    if not self._strings.get().String(addr(_result)):
+      raise FstOpError("Operation failed")
+    cdef _Weight _weight = _Weight.__new__(_Weight)
+    _weight._weight.reset(new WeightClass(self._strings.get().Weight()))
+    with nogil:
+      self._strings.get().Next()
+    return (_result, _weight)
+
+
+# Converts an FST to an input-arc-sorted ConstFst which can be memory-mapped
+# once written, copying it only if necessary.
+
+
+cdef _Fst _get_mappable_Fst(_Fst fst):
+  if fst._fst.get().Properties(kILabelSorted, True) != kILabelSorted:
+    fst = _from_pywrapfst(fst).arcsort(sort_type="ilabel")
+  if fst.fst_type() == "const":
+    return fst
+  return _pywrapfst.convert(fst, "const")
+
+
 # Class for FAR reading and/or writing.
 
 
 cdef class Far:
 
   """
-  Far(filename, mode="r", arc_type="standard", far_type="default")
+  Far(filename, mode="r", arc_type="standard", far_type="default",
+      memory_map=False)
 
   Pynini FAR ("Fst ARchive") object.
 
@@ -2235,15 +4570,27 @@ cdef class Far:
   opening a FAR for writing, the user may also specify the desired arc type
   and FAR type.
 
+  If memory_map is true, a FAR opened for reading memory-maps its ConstFst
+  members rather than reading them into memory, and returns them as is, as
+  immutable FSTs; these share their pages with any other process mapping the
+  same FAR. A FAR opened for writing instead converts each member to an
+  input-arc-sorted ConstFst, aligned so that it can be so mapped. OpenFst only
+  takes these settings from process-wide flags, which are changed while such a
+  FAR reads or writes a member, so this is not thread-safe: no other thread may
+  read or write FSTs or FARs meanwhile.
+
   Args:
     filename: A string indicating the filename.
     mode: FAR IO mode; one of: "r" (open for reading), "w" (open for writing).
     arc_type: Desired arc type; ignored if the FAR is opened for reading.
     far_type: Desired FAR type; ignored if the FAR is opened for reading.
+    memory_map: Should members be memory-mapped (when reading), or written so
+        that they can be (when writing)?
   """
 
   cdef char _mode
   cdef string _name
+  cdef bool _memory_map
   cdef FarReader _reader
   cdef FarWriter _writer
 
@@ -2253,9 +4600,15 @@ cdef class Far:
                filename,
                mode="r",
                arc_type="standard",
-               far_type="default"):
+               far_type="default",
+               bool memory_map=False):
     self._name = path_tostring(filename)
     self._mode = tostring(mode)[0]
+    self._memory_map = memory_map
+    # Some FAR types read the first member on opening.
+    cdef unique_ptr[ScopedFstMemoryMap] _scope
+    if self._memory_map:
+      _scope.reset(new ScopedFstMemoryMap())
     if self._mode == b"r":
       self._reader = FarReader.open(self._name)
     elif self._mode == b"w":
@@ -2386,14 +4739,18 @@ cdef class Far:
       io.UnsupportedOperation: Cannot invoke method in current mode.
     """
     self._check_mode(b"r")
+    cdef unique_ptr[ScopedFstMemoryMap] _scope
+    if self._memory_map:
+      _scope.reset(new ScopedFstMemoryMap())
     return self._reader.find(key)
 
-  cpdef Fst get_fst(self):
+  cpdef _Fst get_fst(self):
     """
     get_fst(self)
 
     Returns the FST at the current position. If the FST is not mutable,
-    it is converted to a VectorFst.
+    it is converted to a VectorFst, unless the FAR is memory-mapped, in which
+    case it is returned as is.
 
     Returns:
       A copy of the FST at the current position.
@@ -2403,7 +4760,15 @@ cdef class Far:
       io.UnsupportedOperation: Cannot invoke method in current mode.
     """
     self._check_mode(b"r")
-    return Fst.from_pywrapfst(self._reader.get_fst())
+    cdef unique_ptr[ScopedFstMemoryMap] _scope
+    if self._memory_map:
+      _scope.reset(new ScopedFstMemoryMap())
+    return self._maybe_from_pywrapfst(self._reader.get_fst())
+
+  cdef _Fst _maybe_from_pywrapfst(self, _Fst fst):
+    if self._memory_map and not isinstance(fst, _MutableFst):
+      return fst
+    return Fst.from_pywrapfst(fst)
 
   cpdef string get_key(self) except *:
     """
@@ -2432,6 +4797,9 @@ cdef class Far:
       io.UnsupportedOperation: Cannot invoke method in current mode.
     """
     self._check_mode(b"r")
+    cdef unique_ptr[ScopedFstMemoryMap] _scope
+    if self._memory_map:
+      _scope.reset(new ScopedFstMemoryMap())
     self._reader.next()
 
   cpdef void reset(self) except *:
@@ -2445,18 +4813,24 @@ cdef class Far:
       io.UnsupportedOperation: Cannot invoke method in current mode.
     """
     self._check_mode(b"r")
+    cdef unique_ptr[ScopedFstMemoryMap] _scope
+    if self._memory_map:
+      _scope.reset(new ScopedFstMemoryMap())
     self._reader.reset()
 
   def __getitem__(self, key):
-    if self.get_key() == tostring(key) or self._reader.find(key):
+    if self.get_key() == tostring(key) or self.find(key):
       return self.get_fst()
     else:
       raise KeyError(key)
 
   def __next__(self):
     self._check_mode(b"r")
+    cdef unique_ptr[ScopedFstMemoryMap] _scope
+    if self._memory_map:
+      _scope.reset(new ScopedFstMemoryMap())
     key, fst = self._reader.__next__()
-    return (key, Fst.from_pywrapfst(fst))
+    return (key, self._maybe_from_pywrapfst(fst))
 
   # This just registers this class as a possible iterator.
   def __iter__(self):
@@ -2464,14 +4838,15 @@ cdef class Far:
 
   # FarWriter API.
 
-  cpdef void add(self, key, Fst fst):
+  cpdef void add(self, key, _Fst fst):
     """
     add(self, key, fst)
 
     Adds an FST to the FAR (when open for writing).
 
     This methods adds an FST to the FAR which can be retrieved with the
-    specified string key.
+    specified string key. If the FAR is memory-mapped, the FST is first
+    converted to an input-arc-sorted ConstFst, copying it if necessary.
 
     Args:
       key: The string used to key the input FST.
@@ -2483,11 +4858,14 @@ cdef class Far:
       FstOpError: Incompatible or invalid arc type.
     """
     self._check_mode(b"w")
+    cdef unique_ptr[ScopedFstMemoryMap] _scope
+    if self._memory_map:
+      fst = _get_mappable_Fst(fst)
+      _scope.reset(new ScopedFstMemoryMap())
     self._writer.add(key, fst)
 
-  def __setitem__(self, key, Fst fst):
-    self._check_mode(b"w")
-    self._writer[key] = fst
+  def __setitem__(self, key, _Fst fst):
+    self.add(key, fst)
 
   cpdef void close(self):
     """
@@ -2637,7 +5015,6 @@ def _copy_patch(fnc):
 
 
 arcsort = _copy_patch(Fst.arcsort)
-closure = _copy_patch(Fst.closure)
 connect = _copy_patch(Fst.connect)
 decode = _copy_patch(Fst.decode)
 encode = _copy_patch(Fst.encode)
@@ -2652,6 +5029,45 @@ rmepsilon = _copy_patch(Fst.rmepsilon)
 topsort = _copy_patch(Fst.topsort)
 
 
+def closure(fst, int32 lower=0, int32 upper=0, bool lazy=False):
+  """
+  closure(fst, lower=0, upper=0, lazy=False)
+
+  Constructively computes concatenative closure.
+
+  This operation computes the concatenative closure of an FST as described in
+  `Fst.closure`, without modifying the input.
+
+  Normally, a bounded closure concatenates up to `upper` copies of the input,
+  so its size and construction time grow with the upper bound. If lazy is
+  true, the result is instead an immutable, delayed FST which "calls" a single
+  shared copy of the input and is only expanded as it is visited. This makes
+  bounded closure over large FSTs cheap; the result is best used as the input
+  to a further operation (e.g., a composition) which visits only part of it.
+
+  Args:
+    fst: The input FST.
+    lower: lower bound.
+    upper: upper bound.
+    lazy: Should the closure be computed lazily?
+
+  Returns:
+    An FST.
+
+  Raises:
+    FstOpError: Operation failed.
+  """
+  cdef Fst _fst = _compile_or_copy_Fst(fst)
+  cdef unique_ptr[FstClass] _result
+  if lazy:
+    with nogil:
+      _result = ConcatRangeDelayed(deref(_fst._fst), lower, upper)
+    if _result.get().Properties(kError, True) == kError:
+      raise FstOpError("Operation failed")
+    return _init_XFst(_result.release())
+  return _fst.closure(lower, upper)
+
+
 # Symbol table functions.
 
 
@@ -2006,7 +2006,11 @@ cdef class Fst:
     Raises:
       FstIOError: Write failed.
     """
-    if not self._fst.get().Write(path_tostring(source)):
+    cdef string _source = path_tostring(source)
+    cdef bool _success
+    with nogil:
+      _success = self._fst.get().Write(_source)
+    if not _success:
       raise FstIOError(f"Write failed: {source!r}")
 
   cpdef bytes write_to_string(self):
@@ -2187,7 +2191,8 @@ cdef class MutableFst(Fst):
     return self
 
   cdef void _decode(self, EncodeMapper mapper) except *:
-    fst.Decode(self._mfst.get(), deref(mapper._mapper))
+    with nogil:
+      fst.Decode(self._mfst.get(), deref(mapper._mapper))
     self._check_mutating_imethod()
 
   def decode(self, EncodeMapper mapper):
@@ -2263,7 +2268,8 @@ cdef class MutableFst(Fst):
     return self
 
   cdef void _encode(self, EncodeMapper mapper) except *:
-    fst.Encode(self._mfst.get(), mapper._mapper.get())
+    with nogil:
+      fst.Encode(self._mfst.get(), mapper._mapper.get())
     self._check_mutating_imethod()
 
   def encode(self, EncodeMapper mapper):
@@ -2310,7 +2316,8 @@ cdef class MutableFst(Fst):
                       float delta=fst.kShortestDelta,
                       bool allow_nondet=False) except *:
     # This runs in-place when the second argument is null.
-    fst.Minimize(self._mfst.get(), NULL, delta, allow_nondet)
+    with nogil:
+      fst.Minimize(self._mfst.get(), NULL, delta, allow_nondet)
     self._check_mutating_imethod()
 
   def minimize(self, float delta=fst.kShortestDelta, bool allow_nondet=False):
@@ -2414,7 +2421,8 @@ cdef class MutableFst(Fst):
     # Threshold is set to semiring Zero (no pruning) if no weight is specified.
     cdef fst.WeightClass _weight = _get_WeightClass_or_zero(self.weight_type(),
                                                             weight)
-    fst.Prune(self._mfst.get(), _weight, nstate, delta)
+    with nogil:
+      fst.Prune(self._mfst.get(), _weight, nstate, delta)
     self._check_mutating_imethod()
 
   def prune(self,
@@ -2447,10 +2455,11 @@ cdef class MutableFst(Fst):
                   float delta=fst.kShortestDelta,
                   bool remove_total_weight=False,
                   bool to_final=False):
-    fst.Push(self._mfst.get(),
-             fst.GetReweightType(to_final),
-             delta,
-             remove_total_weight)
+    with nogil:
+      fst.Push(self._mfst.get(),
+               fst.GetReweightType(to_final),
+               delta,
+               remove_total_weight)
 
   def push(self,
            float delta=fst.kShortestDelta,
@@ -2695,7 +2704,8 @@ cdef class MutableFst(Fst):
                                  _weight,
                                  nstate,
                                  delta))
-    fst.RmEpsilon(self._mfst.get(), deref(_opts))
+    with nogil:
+      fst.RmEpsilon(self._mfst.get(), deref(_opts))
     self._check_mutating_imethod()
 
   def rmepsilon(self,
@@ -2955,8 +2965,10 @@ cdef Fst _init_XFst(FstClass_ptr tfst):
 
 
 cpdef Fst _read_Fst(source):
+  cdef string _source = path_tostring(source)
   cdef unique_ptr[fst.FstClass] _tfst
-  _tfst.reset(fst.FstClass.Read(path_tostring(source)))
+  with nogil:
+    _tfst.reset(fst.FstClass.Read(_source))
   if _tfst.get() == NULL:
     raise FstIOError(f"Read failed: {source!r}")
   return _init_XFst(_tfst.release())
@@ -3544,7 +3556,11 @@ cpdef MutableFst compose(Fst ifst1,
   _opts.reset(
       new fst.ComposeOptions(connect,
                              _get_compose_filter(tostring(compose_filter))))
-  fst.Compose(deref(ifst1._fst), deref(ifst2._fst), _tfst.get(), deref(_opts))
+  with nogil:
+    fst.Compose(deref(ifst1._fst),
+                deref(ifst2._fst),
+                _tfst.get(),
+                deref(_opts))
   return _init_MutableFst(_tfst.release())
 
 
@@ -3629,7 +3645,8 @@ cpdef MutableFst determinize(Fst ifst,
                                  subsequential_label,
                                  _det_type,
                                  increment_subsequential_label))
-  fst.Determinize(deref(ifst._fst), _tfst.get(), deref(_opts))
+  with nogil:
+    fst.Determinize(deref(ifst._fst), _tfst.get(), deref(_opts))
   return _init_MutableFst(_tfst.release())
 
 
@@ -3666,10 +3683,11 @@ cpdef MutableFst difference(Fst ifst1,
   _opts.reset(
       new fst.ComposeOptions(connect,
                             _get_compose_filter(tostring(compose_filter))))
-  fst.Difference(deref(ifst1._fst),
-                 deref(ifst2._fst),
-                 _tfst.get(),
-                 deref(_opts))
+  with nogil:
+    fst.Difference(deref(ifst1._fst),
+                   deref(ifst2._fst),
+                   _tfst.get(),
+                   deref(_opts))
   return _init_MutableFst(_tfst.release())
 
 
@@ -3712,7 +3730,8 @@ cpdef MutableFst disambiguate(Fst ifst,
                                   _weight,
                                   nstate,
                                   subsequential_label))
-  fst.Disambiguate(deref(ifst._fst), _tfst.get(), deref(_opts))
+  with nogil:
+    fst.Disambiguate(deref(ifst._fst), _tfst.get(), deref(_opts))
   return _init_MutableFst(_tfst.release())
 
 
@@ -3738,10 +3757,11 @@ cpdef MutableFst epsnormalize(Fst ifst, bool eps_norm_output=False):
   """
   cdef unique_ptr[fst.VectorFstClass] _tfst
   _tfst.reset(new fst.VectorFstClass(ifst.arc_type()))
-  fst.EpsNormalize(
-      deref(ifst._fst),
-      _tfst.get(),
-      fst.EPS_NORM_OUTPUT if eps_norm_output else fst.EPS_NORM_INPUT)
+  with nogil:
+    fst.EpsNormalize(
+        deref(ifst._fst),
+        _tfst.get(),
+        fst.EPS_NORM_OUTPUT if eps_norm_output else fst.EPS_NORM_INPUT)
   return _init_MutableFst(_tfst.release())
 
 
@@ -3818,7 +3838,11 @@ cpdef MutableFst intersect(Fst ifst1,
   _opts.reset(
       new fst.ComposeOptions(connect,
                             _get_compose_filter(tostring(compose_filter))))
-  fst.Intersect(deref(ifst1._fst), deref(ifst2._fst), _tfst.get(), deref(_opts))
+  with nogil:
+    fst.Intersect(deref(ifst1._fst),
+                  deref(ifst2._fst),
+                  _tfst.get(),
+                  deref(_opts))
   return _init_MutableFst(_tfst.release())
 
 
@@ -3874,7 +3898,8 @@ cpdef MutableFst prune(Fst ifst,
   _tfst.reset(new fst.VectorFstClass(ifst.arc_type()))
   cdef fst.WeightClass _weight = _get_WeightClass_or_zero(ifst.weight_type(),
                                                           weight)
-  fst.Prune(deref(ifst._fst), _tfst.get(), _weight, nstate, delta)
+  with nogil:
+    fst.Prune(deref(ifst._fst), _tfst.get(), _weight, nstate, delta)
   return _init_MutableFst(_tfst.release())
 
 
@@ -3926,11 +3951,12 @@ cpdef MutableFst push(Fst ifst,
                                       push_labels,
                                       remove_common_affix,
                                       remove_total_weight)
-  fst.Push(deref(ifst._fst),
-           _tfst.get(),
-           flags,
-           fst.GetReweightType(to_final),
-           delta)
+  with nogil:
+    fst.Push(deref(ifst._fst),
+             _tfst.get(),
+             flags,
+             fst.GetReweightType(to_final),
+             delta)
   return _init_MutableFst(_tfst.release())
 
 
@@ -4034,7 +4060,8 @@ cpdef MutableFst randgen(Fst ifst,
   _tfst.reset(new fst.VectorFstClass(ifst.arc_type()))
   if seed == 0:
     seed = time(NULL)
-  fst.RandGen(deref(ifst._fst), _tfst.get(), deref(_opts), seed)
+  with nogil:
+    fst.RandGen(deref(ifst._fst), _tfst.get(), deref(_opts), seed)
   return _init_MutableFst(_tfst.release())
 
 
@@ -4094,7 +4121,8 @@ cpdef MutableFst replace(pairs,
       epsilon_on_replace)
   cdef unique_ptr[fst.ReplaceOptions] _opts
   _opts.reset(new fst.ReplaceOptions(_pairs[0].first, _cal, _ral, return_label))
-  fst.Replace(_pairs, _tfst.get(), deref(_opts))
+  with nogil:
+    fst.Replace(_pairs, _tfst.get(), deref(_opts))
   return _init_MutableFst(_tfst.release())
 
 
@@ -4119,7 +4147,8 @@ cpdef MutableFst reverse(Fst ifst, bool require_superinitial=True):
   """
   cdef unique_ptr[fst.VectorFstClass] _tfst
   _tfst.reset(new fst.VectorFstClass(ifst.arc_type()))
-  fst.Reverse(deref(ifst._fst), _tfst.get(), require_superinitial)
+  with nogil:
+    fst.Reverse(deref(ifst._fst), _tfst.get(), require_superinitial)
   return _init_MutableFst(_tfst.release())
 
 
@@ -4136,14 +4165,16 @@ cdef void _shortestdistance(Fst ifst,
   if reverse:
     # Only the simpler signature supports shortest distance to final states;
     # `nstate` and `queue_type` arguments are ignored.
-    fst.ShortestDistance(deref(ifst._fst), distance, True, delta)
+    with nogil:
+      fst.ShortestDistance(deref(ifst._fst), distance, True, delta)
   else:
     _opts.reset(
         new fst.ShortestDistanceOptions(_get_queue_type(tostring(queue_type)),
                                         fst.ArcFilterType.ANY_ARC_FILTER,
                                         nstate,
                                         delta))
-    fst.ShortestDistance(deref(ifst._fst), distance, deref(_opts))
+    with nogil:
+      fst.ShortestDistance(deref(ifst._fst), distance, deref(_opts))
 
 
 def shortestdistance(Fst ifst,
@@ -4233,7 +4264,8 @@ cpdef MutableFst shortestpath(Fst ifst,
                                   delta,
                                   _weight,
                                   nstate))
-  fst.ShortestPath(deref(ifst._fst), _tfst.get(), deref(_opts))
+  with nogil:
+    fst.ShortestPath(deref(ifst._fst), _tfst.get(), deref(_opts))
   return _init_MutableFst(_tfst.release())
 
 
@@ -4284,7 +4316,8 @@ cpdef MutableFst synchronize(Fst ifst):
   """
   cdef unique_ptr[fst.VectorFstClass] _tfst
   _tfst.reset(new fst.VectorFstClass(ifst.arc_type()))
-  fst.Synchronize(deref(ifst._fst), _tfst.get())
+  with nogil:
+    fst.Synchronize(deref(ifst._fst), _tfst.get())
   return _init_MutableFst(_tfst.release())
 
 
@@ -4471,7 +4504,8 @@ cdef class FarReader:
     """
     cdef vector[string] _sources = [path_tostring(source) for source in sources]
     cdef unique_ptr[fst.FarReaderClass] _tfar
-    _tfar = fst.FarReaderClass.Open(_sources)
+    with nogil:
+      _tfar = fst.FarReaderClass.Open(_sources)
     if _tfar.get() == NULL:
       raise FstIOError(f"Read failed: {sources!r}")
     cdef FarReader reader = FarReader.__new__(FarReader)
@@ -4524,7 +4558,11 @@ cdef class FarReader:
     Returns:
       True if the key was found, False otherwise.
     """
-    return self._reader.get().Find(tostring(key))
+    cdef string _key = tostring(key)
+    cdef bool _found
+    with nogil:
+      _found = self._reader.get().Find(_key)
+    return _found
 
   cpdef Fst get_fst(self):
     """
@@ -4554,7 +4592,8 @@ cdef class FarReader:
 
     Advances the iterator.
     """
-    self._reader.get().Next()
+    with nogil:
+      self._reader.get().Next()
 
   cpdef void reset(self):
     """
@@ -4565,7 +4604,7 @@ cdef class FarReader:
     self._reader.get().Reset()
 
   def __getitem__(self, key):
-    if self._reader.get().Find(tostring(key)):
+    if self.find(key):
       return self.get_fst()
     else:
       raise KeyError(key)
@@ -4654,7 +4693,9 @@ cdef class FarWriter:
     Adds an FST to the FAR.
 
     This method adds an FST to the FAR which can be retrieved with the
-    specified string key.
+    specified string key. The GIL is released while the FST is written, so
+    several writers can write at once, but a writer must not be used by more
+    than one thread at a time.
 
     Args:
       key: The string used to key the input FST.
@@ -4663,9 +4704,13 @@ cdef class FarWriter:
     Raises:
       FstOpError: Incompatible or invalid arc type.
     """
+    cdef string _key = tostring(key)
+    cdef bool _success
+    with nogil:
+      _success = self._writer.get().Add(_key, deref(ifst._fst))
     # Failure here results from passing an FST with a different arc type than
     # used by the FAR was initialized to use.
-    if not self._writer.get().Add(tostring(key), deref(ifst._fst)):
+    if not _success:
       raise FstOpError("Incompatible or invalid arc type")
 
   cpdef string arc_type(self):
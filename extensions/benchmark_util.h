@@ -0,0 +1,165 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_BENCHMARK_UTIL_H_
+#define PYNINI_BENCHMARK_UTIL_H_
+
+// Synthetic and realistic fixtures shared by the benchmarks of core grammar
+// operations. All fixtures are deterministic, so that timings are comparable
+// across runs and builds.
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <fst/arcsort.h>
+#include <fst/vector-fst.h>
+#include "cdrewrite.h"
+#include "stringcompile.h"
+#include "stringmap.h"
+
+namespace fst {
+namespace benchmark_util {
+
+// Returns a cyclic, unweighted acceptor over the single-label alphabet with
+// labels in [lower, upper], as used for sigma-star in rewrite rules.
+template <class Arc>
+VectorFst<Arc> SigmaStar(typename Arc::Label lower,
+                         typename Arc::Label upper) {
+  VectorFst<Arc> fst;
+  const auto state = fst.AddState();
+  fst.SetStart(state);
+  fst.SetFinal(state);
+  fst.ReserveArcs(state, upper - lower + 1);
+  for (auto label = lower; label <= upper; ++label) {
+    fst.AddArc(state, Arc(label, label, state));
+  }
+  return fst;
+}
+
+// Sigma-star over printable ASCII, for byte-mode rules.
+template <class Arc>
+VectorFst<Arc> ByteSigmaStar() {
+  return SigmaStar<Arc>(0x20, 0x7e);
+}
+
+// Sigma-star over printable ASCII, Latin-1, Latin Extended-A, Greek, and
+// Cyrillic code points, for UTF-8-mode rules.
+template <class Arc>
+VectorFst<Arc> Utf8SigmaStar() {
+  VectorFst<Arc> fst = SigmaStar<Arc>(0x20, 0x7e);
+  for (typename Arc::Label label = 0xa0; label <= 0x4ff; ++label) {
+    fst.AddArc(0, Arc(label, label, 0));
+  }
+  return fst;
+}
+
+// Returns num_words distinct random lowercase words with between min_length
+// and max_length letters.
+inline std::vector<std::string> RandomWords(int num_words, int min_length = 3,
+                                            int max_length = 12,
+                                            uint32_t seed = 1) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> length(min_length, max_length);
+  std::uniform_int_distribution<int> letter('a', 'z');
+  std::vector<std::string> words;
+  words.reserve(num_words);
+  std::unordered_set<std::string> seen;
+  while (words.size() < static_cast<size_t>(num_words)) {
+    std::string word(length(rng), ' ');
+    for (auto &c : word) c = letter(rng);
+    if (seen.insert(word).second) words.push_back(std::move(word));
+  }
+  return words;
+}
+
+// Returns a text of num_words random words separated by spaces, with a
+// number between 0 and 9999 after every fifth word.
+inline std::string RandomText(int num_words, uint32_t seed = 1) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> number(0, 9999);
+  const auto words = RandomWords(num_words, 3, 12, seed);
+  std::string text;
+  for (int i = 0; i < num_words; ++i) {
+    if (i) text += ' ';
+    text += words[i];
+    if (i % 5 == 4) {
+      text += ' ';
+      text += std::to_string(number(rng));
+    }
+  }
+  return text;
+}
+
+// Returns the English name of a number between 0 and 999999.
+inline std::string NumberName(int number) {
+  static const char *const kOnes[] = {
+      "zero",    "one",     "two",       "three",    "four",
+      "five",    "six",     "seven",     "eight",    "nine",
+      "ten",     "eleven",  "twelve",    "thirteen", "fourteen",
+      "fifteen", "sixteen", "seventeen", "eighteen", "nineteen"};
+  static const char *const kTens[] = {"",      "",      "twenty", "thirty",
+                                      "forty", "fifty", "sixty",  "seventy",
+                                      "eighty", "ninety"};
+  if (number < 20) return kOnes[number];
+  if (number < 100) {
+    std::string name = kTens[number / 10];
+    if (number % 10) name += std::string(" ") + kOnes[number % 10];
+    return name;
+  }
+  if (number < 1000) {
+    std::string name = NumberName(number / 100) + " hundred";
+    if (number % 100) name += " " + NumberName(number % 100);
+    return name;
+  }
+  std::string name = NumberName(number / 1000) + " thousand";
+  if (number % 1000) name += " " + NumberName(number % 1000);
+  return name;
+}
+
+// Returns string map lines from the numbers 0 through max_number, written in
+// digits, to their English names.
+inline std::vector<std::vector<std::string>> NumberNameLines(int max_number) {
+  std::vector<std::vector<std::string>> lines;
+  lines.reserve(max_number + 1);
+  for (int number = 0; number <= max_number; ++number) {
+    lines.push_back({std::to_string(number), NumberName(number)});
+  }
+  return lines;
+}
+
+// Returns a realistic number verbalization grammar: an obligatory rule
+// rewriting every number from 0 through max_number, delimited by spaces, as
+// its English name. The rule is input-arc-sorted, ready for composition.
+template <class Arc>
+VectorFst<Arc> NumberGrammar(int max_number = 9999) {
+  VectorFst<Arc> tau;
+  StringMapCompile(NumberNameLines(max_number), &tau);
+  VectorFst<Arc> space;
+  StringCompile(" ", &space);
+  VectorFst<Arc> rule;
+  CDRewriteCompile(tau, space, space, ByteSigmaStar<Arc>(), &rule);
+  ArcSort(&rule, ILabelCompare<Arc>());
+  return rule;
+}
+
+}  // namespace benchmark_util
+}  // namespace fst
+
+#endif  // PYNINI_BENCHMARK_UTIL_H_
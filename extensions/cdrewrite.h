@@ -24,7 +24,12 @@
 // Mohri, M., and Sproat, R. 1996. An efficient compiler for weighted rewrite
 // rules. In Proc. ACL, pages 231-238.
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -33,6 +38,7 @@
 #include <fst/compat.h>
 #include <fst/arc-map.h>
 #include <fst/arcsort.h>
+#include <fst/cache.h>
 #include <fst/closure.h>
 #include <fst/compose.h>
 #include <fst/concat.h>
@@ -46,7 +52,10 @@
 #include <fst/vector-fst.h>
 #include "checkprops.h"
 #include "cross.h"
+#include "labelclassrule.h"
+#include "memoryusage.h"
 #include "optimize.h"
+#include "parallel.h"
 
 namespace fst {
 
@@ -56,6 +65,21 @@ enum CDRewriteMode { OBLIGATORY, OPTIONAL };
 
 namespace internal {
 
+// The alphabet of a rule, augmented with the boundary markers the rule refers
+// to, together with the derived FSTs which depend only on it.
+template <class Arc>
+struct CDRewriteSigmaVariant {
+  VectorFst<Arc> sigma;         // Sigma, plus any boundary markers.
+  VectorFst<Arc> sigma_rbrace;  // The same, plus the > marker.
+  VectorFst<Arc> inserter;      // Boundary inserter, if needed.
+  VectorFst<Arc> deleter;       // Boundary deleter, if needed.
+  typename Arc::Label rbrace = kNoLabel;
+  bool boundary_markers = false;
+};
+
+template <class Arc>
+class CDRewriteSigma;
+
 // This class is used to represent context-dependent rewrite rules. A given rule
 // can be compile into a weighted transducer using different parameters
 // (direction, mode, alphabet) by calling Compile. See comments before
@@ -101,6 +125,43 @@ class CDRewriteRule {
                CDRewriteDirection dir = LEFT_TO_RIGHT,
                CDRewriteMode mode = OBLIGATORY);
 
+  // Same, but returns a delayed composition of the stages of the rule, which
+  // expands states only as they are visited; opts bounds the state cache of
+  // each composition. This avoids constructing the full rule when the alphabet
+  // is large but only a small part of the rule is ever needed.
+  //
+  // The error bit on the output FST is set if any argument does not satisfy
+  // the preconditions.
+  std::unique_ptr<Fst<Arc>> CompileDelayed(
+      const Fst<Arc> &sigma, CDRewriteDirection dir = LEFT_TO_RIGHT,
+      CDRewriteMode mode = OBLIGATORY,
+      const CacheOptions &opts = CacheOptions());
+
+  // Same as Compile, but using an alphabet which has been preprocessed for,
+  // and may be shared with, other rules with the same boundary markers. It is
+  // safe to compile distinct rules against the same sigma concurrently.
+  void Compile(CDRewriteSigma<Arc> *sigma, MutableFst<Arc> *fst,
+               CDRewriteDirection dir = LEFT_TO_RIGHT,
+               CDRewriteMode mode = OBLIGATORY);
+
+  // Whether the rule refers to the initial boundary marker.
+  bool HasInitialBoundaryMarker() const {
+    return HasArcWithLabel(*lambda_, initial_boundary_marker_) ||
+           HasArcWithLabel(*phi_, initial_boundary_marker_);
+  }
+
+  // Whether the rule refers to the final boundary marker.
+  bool HasFinalBoundaryMarker() const {
+    return HasArcWithLabel(*rho_, final_boundary_marker_) ||
+           HasArcWithLabel(*phi_, final_boundary_marker_);
+  }
+
+  // Augments sigma with the requested boundary markers and builds the FSTs
+  // derived from it.
+  void PrepareSigma(const Fst<Arc> &sigma, bool add_initial_boundary_marker,
+                    bool add_final_boundary_marker,
+                    CDRewriteSigmaVariant<Arc> *variant);
+
  private:
   enum MarkerType { MARK = 1, CHECK = 2, CHECK_COMPLEMENT = 3};
 
@@ -127,6 +188,22 @@ class CDRewriteRule {
 
   void MakeReplace(MutableFst<Arc> *fst, const Fst<Arc> &sigma);
 
+  // Builds the stages of the rule, in the order in which they are composed.
+  bool MakeStages(const Fst<Arc> &sigma, CDRewriteDirection dir,
+                  CDRewriteMode mode, std::vector<VectorFst<Arc>> *stages);
+
+  // Same, but using a prepared alphabet.
+  bool MakeStages(const CDRewriteSigmaVariant<Arc> &variant,
+                  CDRewriteDirection dir, CDRewriteMode mode,
+                  std::vector<VectorFst<Arc>> *stages);
+
+  // Composes the stages of the rule eagerly and optimizes the result.
+  static void ComposeStages(const std::vector<VectorFst<Arc>> &stages,
+                            MutableFst<Arc> *fst);
+
+  // Checks the preconditions on phi, psi, lambda and rho.
+  bool CheckArguments() const;
+
   static Label MaxLabel(const Fst<Arc> &fst);
 
   // Constructs transducer that either inserts or deletes boundary markers.
@@ -174,6 +251,44 @@ class CDRewriteRule {
   CDRewriteRule &operator=(const CDRewriteRule &) = delete;
 };
 
+// An alphabet shared by rules which are compiled against the same sigma. Since
+// the marker-augmented sigma and the boundary inserter and deleter depend only
+// on sigma and on which boundary markers a rule refers to, each variant is
+// built at most once, on first use. Variants may be requested concurrently,
+// provided the rules all use the same boundary markers.
+template <class Arc>
+class CDRewriteSigma {
+ public:
+  explicit CDRewriteSigma(const Fst<Arc> &sigma)
+      : sigma_(sigma),
+        error_(!CheckUnweightedAcceptor(sigma_, "CDRewriteRule::Compile",
+                                        "sigma")) {}
+
+  // Whether sigma fails to satisfy the preconditions.
+  bool Error() const { return error_; }
+
+  // Returns the variant of the alphabet needed by the rule.
+  const CDRewriteSigmaVariant<Arc> &Variant(CDRewriteRule<Arc> *rule) {
+    const bool add_initial_boundary_marker = rule->HasInitialBoundaryMarker();
+    const bool add_final_boundary_marker = rule->HasFinalBoundaryMarker();
+    const int i = add_initial_boundary_marker + 2 * add_final_boundary_marker;
+    std::call_once(once_[i], [&] {
+      rule->PrepareSigma(sigma_, add_initial_boundary_marker,
+                         add_final_boundary_marker, &variants_[i]);
+    });
+    return variants_[i];
+  }
+
+ private:
+  const VectorFst<Arc> sigma_;
+  const bool error_;
+  std::once_flag once_[4];
+  CDRewriteSigmaVariant<Arc> variants_[4];
+
+  CDRewriteSigma(const CDRewriteSigma &) = delete;
+  CDRewriteSigma &operator=(const CDRewriteSigma &) = delete;
+};
+
 // Turns an FST into a marker transducer of specified type using the specified
 // markers (markers) for the regular expression represented by the FST.
 template <class Arc>
@@ -478,79 +593,111 @@ typename Arc::Label CDRewriteRule<Arc>::MaxLabel(const Fst<Arc> &fst) {
   return max;
 }
 
-// Builds the transducer representing the context-dependent rewrite rule. sigma
-// is an FST specifying (the closure of) the alphabet for the resulting
-// transducer. dir can be LEFT_TO_RIGHT, RIGHT_TO_LEFT or SIMULTANEOUS. mode can
-// be OBLIGATORY or OPTIONAL. sigma must be an unweighted acceptor representing
-// a bifix code.
-//
-// The error bit on the output FST is set if any argument does not satisfy the
-// preconditions.
 template <class Arc>
-void CDRewriteRule<Arc>::Compile(const Fst<Arc> &sigma, MutableFst<Arc> *fst,
-                                 CDRewriteDirection dir, CDRewriteMode mode) {
-  dir_ = dir;
-  mode_ = mode;
+bool CDRewriteRule<Arc>::CheckArguments() const {
   if (!CheckUnweightedAcceptor(*phi_, "CDRewriteRule::Compile", "phi")) {
-    fst->SetProperties(kError, kError);
-    return;
+    return false;
   }
   if (!CheckUnweightedAcceptor(*lambda_, "CDRewriteRule::Compile", "lambda")) {
-    fst->SetProperties(kError, kError);
-    return;
+    return false;
   }
   if (!CheckUnweightedAcceptor(*rho_, "CDRewriteRule::Compile", "rho")) {
-    fst->SetProperties(kError, kError);
-    return;
+    return false;
   }
   if (!phiXpsi_ && (psi_->Properties(kAcceptor, true) != kAcceptor)) {
     FSTERROR() << "CDRewriteRuleRule::Compile: psi must be an acceptor or "
                << "phiXpsi must be set to true";
-    fst->SetProperties(kError, kError);
-    return;
+    return false;
   }
+  return true;
+}
+
+template <class Arc>
+void CDRewriteRule<Arc>::PrepareSigma(const Fst<Arc> &sigma,
+                                      bool add_initial_boundary_marker,
+                                      bool add_final_boundary_marker,
+                                      CDRewriteSigmaVariant<Arc> *variant) {
+  variant->sigma = sigma;
+  if (add_initial_boundary_marker) {
+    AddMarkersToSigma(&variant->sigma, {{initial_boundary_marker_,
+                                         initial_boundary_marker_}});
+  }
+  if (add_final_boundary_marker) {
+    AddMarkersToSigma(&variant->sigma, {{final_boundary_marker_,
+                                         final_boundary_marker_}});
+  }
+  variant->rbrace = MaxLabel(variant->sigma) + 1;
+  variant->sigma_rbrace = variant->sigma;
+  AddMarkersToSigma(&variant->sigma_rbrace,
+                    {{variant->rbrace, variant->rbrace}});
+  variant->boundary_markers =
+      add_initial_boundary_marker || add_final_boundary_marker;
+  if (variant->boundary_markers) {
+    BoundaryInserter(sigma, &variant->inserter, add_initial_boundary_marker,
+                     add_final_boundary_marker);
+    BoundaryDeleter(sigma, &variant->deleter, add_initial_boundary_marker,
+                    add_final_boundary_marker);
+  }
+}
+
+// Builds the stages of the transducer representing the context-dependent
+// rewrite rule, in the order in which they are to be composed, and returns
+// them in stages. Each stage after the first is sorted on input labels. sigma
+// is an FST specifying (the closure of) the alphabet for the resulting
+// transducer. dir can be LEFT_TO_RIGHT, RIGHT_TO_LEFT or SIMULTANEOUS. mode can
+// be OBLIGATORY or OPTIONAL. sigma must be an unweighted acceptor representing
+// a bifix code.
+//
+// Returns false if any argument does not satisfy the preconditions.
+template <class Arc>
+bool CDRewriteRule<Arc>::MakeStages(const Fst<Arc> &sigma,
+                                    CDRewriteDirection dir,
+                                    CDRewriteMode mode,
+                                    std::vector<VectorFst<Arc>> *stages) {
+  stages->clear();
   if (!CheckUnweightedAcceptor(sigma, "CDRewriteRule::Compile", "sigma")) {
-    fst->SetProperties(kError, kError);
-    return;
+    return false;
   }
-  static const ILabelCompare<Arc> icomp;
-  static const IdentityArcMapper<Arc> imapper;
-  VectorFst<Arc> mutable_sigma(sigma);
   // Determines whether we have initial and final boundaries and whether we need
   // to add them to sigma. The markers can be referenced in phi or in,
   // respectively, lambda or rho.
-  const bool add_initial_boundary_marker =
-      HasArcWithLabel(*lambda_, initial_boundary_marker_) ||
-      HasArcWithLabel(*phi_, initial_boundary_marker_);
-  const bool add_final_boundary_marker =
-      HasArcWithLabel(*rho_, final_boundary_marker_) ||
-      HasArcWithLabel(*phi_, final_boundary_marker_);
-  if (add_initial_boundary_marker) {
-    AddMarkersToSigma(&mutable_sigma, {{initial_boundary_marker_,
-                                        initial_boundary_marker_}});
-  }
-  if (add_final_boundary_marker) {
-    AddMarkersToSigma(&mutable_sigma, {{final_boundary_marker_,
-                                        final_boundary_marker_}});
-  }
-  rbrace_ = MaxLabel(mutable_sigma) + 1;
+  CDRewriteSigmaVariant<Arc> variant;
+  PrepareSigma(sigma, HasInitialBoundaryMarker(), HasFinalBoundaryMarker(),
+               &variant);
+  return MakeStages(variant, dir, mode, stages);
+}
+
+template <class Arc>
+bool CDRewriteRule<Arc>::MakeStages(const CDRewriteSigmaVariant<Arc> &variant,
+                                    CDRewriteDirection dir,
+                                    CDRewriteMode mode,
+                                    std::vector<VectorFst<Arc>> *stages) {
+  dir_ = dir;
+  mode_ = mode;
+  stages->clear();
+  if (!CheckArguments()) return false;
+  static const ILabelCompare<Arc> icomp;
+  static const IdentityArcMapper<Arc> imapper;
+  const auto &marked_sigma = variant.sigma;
+  const auto &sigma_rbrace = variant.sigma_rbrace;
+  rbrace_ = variant.rbrace;
   lbrace1_ = rbrace_ + 1;
   lbrace2_ = rbrace_ + 2;
-  VectorFst<Arc> sigma_rbrace(mutable_sigma);
-  AddMarkersToSigma(&sigma_rbrace, {{rbrace_, rbrace_}});
-  fst->DeleteStates();
+  // If we need to handle boundary markers, the cascade is preceded by the
+  // boundary inserter and followed by the boundary deleter.
+  if (variant.boundary_markers) stages->push_back(variant.inserter);
   VectorFst<Arc> replace;
   if (phiXpsi_) {
     ArcMap(*psi_, &replace, imapper);
   } else {
     Cross(*phi_, *psi_, &replace);
   }
-  MakeReplace(&replace, mutable_sigma);
+  MakeReplace(&replace, marked_sigma);
   switch (dir_) {
     case LEFT_TO_RIGHT: {
       // Builds r filter.
       VectorFst<Arc> r;
-      MakeFilter(*rho_, mutable_sigma, &r, MARK, {{0, rbrace_}}, true);
+      MakeFilter(*rho_, marked_sigma, &r, MARK, {{0, rbrace_}}, true);
       switch (mode_) {
         case OBLIGATORY: {
           VectorFst<Arc> phi_rbrace;  // Appends > after phi_, matches all >.
@@ -563,31 +710,25 @@ void CDRewriteRule<Arc>::Compile(const Fst<Arc> &sigma, MutableFst<Arc> *fst,
                      {{0, lbrace1_}, {0, lbrace2_}}, true);
           // Builds l1 filter.
           VectorFst<Arc> l1;
-          MakeFilter(*lambda_, mutable_sigma, &l1, CHECK, {{lbrace1_, 0}},
+          MakeFilter(*lambda_, marked_sigma, &l1, CHECK, {{lbrace1_, 0}},
                      false);
           IgnoreMarkers(&l1, {{lbrace2_, lbrace2_}});
           ArcSort(&l1, ILabelCompare<Arc>());
           // Builds l2 filter.
           VectorFst<Arc> l2;
-          MakeFilter(*lambda_, mutable_sigma, &l2, CHECK_COMPLEMENT,
+          MakeFilter(*lambda_, marked_sigma, &l2, CHECK_COMPLEMENT,
                      {{lbrace2_, 0}}, false);
-          // Builds (((r o f) o replace) o l1) o l2.
-          VectorFst<Arc> c;
-          Compose(r, f, &c);
-          Compose(c, replace, fst);
-          Compose(*fst, l1, &c);
-          Compose(c, l2, fst);
+          // Stages for (((r o f) o replace) o l1) o l2.
+          stages->insert(stages->end(), {r, f, replace, l1, l2});
           break;
         }
         case OPTIONAL: {
           // Builds l filter.
           VectorFst<Arc> l;
-          MakeFilter(*lambda_, mutable_sigma, &l, CHECK, {{lbrace1_, 0}},
+          MakeFilter(*lambda_, marked_sigma, &l, CHECK, {{lbrace1_, 0}},
                      false);
-          // Builds (r o replace) o l.
-          VectorFst<Arc> c;
-          Compose(r, replace, &c);
-          Compose(c, l, fst);
+          // Stages for (r o replace) o l.
+          stages->insert(stages->end(), {r, replace, l});
           break;
         }
       }
@@ -596,7 +737,7 @@ void CDRewriteRule<Arc>::Compile(const Fst<Arc> &sigma, MutableFst<Arc> *fst,
     case RIGHT_TO_LEFT: {
       // Builds l filter.
       VectorFst<Arc> l;
-      MakeFilter(*lambda_, mutable_sigma, &l, MARK, {{0, rbrace_}}, false);
+      MakeFilter(*lambda_, marked_sigma, &l, MARK, {{0, rbrace_}}, false);
       switch (mode_) {
         case OBLIGATORY: {
           VectorFst<Arc> rbrace_phi;  // Prepends > before phi, matches all >
@@ -609,30 +750,24 @@ void CDRewriteRule<Arc>::Compile(const Fst<Arc> &sigma, MutableFst<Arc> *fst,
                      {{0, lbrace1_}, {0, lbrace2_}}, false);
           // Builds r1 filter.
           VectorFst<Arc> r1;
-          MakeFilter(*rho_, mutable_sigma, &r1, CHECK, {{lbrace1_, 0}}, true);
+          MakeFilter(*rho_, marked_sigma, &r1, CHECK, {{lbrace1_, 0}}, true);
           IgnoreMarkers(&r1, {{lbrace2_, lbrace2_}});
           ArcSort(&r1, icomp);
           // Builds r2 filter.
           VectorFst<Arc> r2;
-          MakeFilter(*rho_, mutable_sigma, &r2, CHECK_COMPLEMENT,
+          MakeFilter(*rho_, marked_sigma, &r2, CHECK_COMPLEMENT,
                      {{lbrace2_, 0}},
                      true);
-          // Builds (((l o f) o replace) o r1) o r2.
-          VectorFst<Arc> c;
-          Compose(l, f, &c);
-          Compose(c, replace, fst);
-          Compose(*fst, r1, &c);
-          Compose(c, r2, fst);
+          // Stages for (((l o f) o replace) o r1) o r2.
+          stages->insert(stages->end(), {l, f, replace, r1, r2});
           break;
         }
         case OPTIONAL: {
           // Builds r filter.
           VectorFst<Arc> r;
-          MakeFilter(*rho_, mutable_sigma, &r, CHECK, {{lbrace1_, 0}}, true);
-          // Builds (l o replace) o r.
-          VectorFst<Arc> c;
-          Compose(l, replace, &c);
-          Compose(c, r, fst);
+          MakeFilter(*rho_, marked_sigma, &r, CHECK, {{lbrace1_, 0}}, true);
+          // Stages for (l o replace) o r.
+          stages->insert(stages->end(), {l, replace, r});
           break;
         }
       }
@@ -641,7 +776,7 @@ void CDRewriteRule<Arc>::Compile(const Fst<Arc> &sigma, MutableFst<Arc> *fst,
     case SIMULTANEOUS: {
       // Builds r filter.
       VectorFst<Arc> r;
-      MakeFilter(*rho_, mutable_sigma, &r, MARK, {{0, rbrace_}}, true);
+      MakeFilter(*rho_, marked_sigma, &r, MARK, {{0, rbrace_}}, true);
       switch (mode_) {
         case OBLIGATORY: {
           VectorFst<Arc> phi_rbrace;  // Appends > after phi, matches all >.
@@ -654,62 +789,109 @@ void CDRewriteRule<Arc>::Compile(const Fst<Arc> &sigma, MutableFst<Arc> *fst,
                      {{0, lbrace1_}, {0, lbrace2_}}, true);
           // Builds l1 filter.
           VectorFst<Arc> l1;
-          MakeFilter(*lambda_, mutable_sigma, &l1, CHECK,
+          MakeFilter(*lambda_, marked_sigma, &l1, CHECK,
                      {{lbrace1_, lbrace1_}}, false);
           IgnoreMarkers(&l1, {{lbrace2_, lbrace2_}, {rbrace_, rbrace_}});
           ArcSort(&l1, icomp);
           // Builds l2 filter.
           VectorFst<Arc> l2;
-          MakeFilter(*lambda_, mutable_sigma, &l2, CHECK_COMPLEMENT,
+          MakeFilter(*lambda_, marked_sigma, &l2, CHECK_COMPLEMENT,
                      {{lbrace2_, lbrace2_}}, false);
           IgnoreMarkers(&l2, {{lbrace1_, lbrace1_}, {rbrace_, rbrace_}});
           ArcSort(&l2, icomp);
-          // Builds (((r o f) o l1) o l2) o replace.
-          VectorFst<Arc> c;
-          Compose(r, f, &c);
-          Compose(c, l1, fst);
-          Compose(*fst, l2, &c);
-          Compose(c, replace, fst);
+          // Stages for (((r o f) o l1) o l2) o replace.
+          stages->insert(stages->end(), {r, f, l1, l2, replace});
           break;
         }
         case OPTIONAL: {
           // Builds l filter.
           VectorFst<Arc> l;
-          MakeFilter(*lambda_, mutable_sigma, &l, CHECK, {{0, lbrace1_}},
+          MakeFilter(*lambda_, marked_sigma, &l, CHECK, {{0, lbrace1_}},
                      false);
           IgnoreMarkers(&l, {{rbrace_, rbrace_}});
-          static const ILabelCompare<Arc> icomp;
           ArcSort(&l, icomp);
-          // Builds (r o l) o replace.
-          VectorFst<Arc> c;
-          Compose(r, l, &c);
-          Compose(c, replace, fst);
+          // Stages for (r o l) o replace.
+          stages->insert(stages->end(), {r, l, replace});
           break;
         }
       }
       break;
     }
   }
-  // If we need to handle boundary markers we do an extra composition of the
-  // boundary inserter and boundary deleter.
-  if (add_initial_boundary_marker || add_final_boundary_marker) {
-    VectorFst<Arc> inserter;
-    BoundaryInserter(sigma, &inserter,
-                     add_initial_boundary_marker, add_final_boundary_marker);
-    VectorFst<Arc> deleter;
-    BoundaryDeleter(sigma, &deleter,
-                    add_initial_boundary_marker, add_final_boundary_marker);
+  if (variant.boundary_markers) stages->push_back(variant.deleter);
+  return true;
+}
+
+// Builds the transducer representing the context-dependent rewrite rule. sigma
+// is an FST specifying (the closure of) the alphabet for the resulting
+// transducer. dir can be LEFT_TO_RIGHT, RIGHT_TO_LEFT or SIMULTANEOUS. mode can
+// be OBLIGATORY or OPTIONAL. sigma must be an unweighted acceptor representing
+// a bifix code.
+//
+// The error bit on the output FST is set if any argument does not satisfy the
+// preconditions.
+template <class Arc>
+void CDRewriteRule<Arc>::Compile(const Fst<Arc> &sigma, MutableFst<Arc> *fst,
+                                 CDRewriteDirection dir, CDRewriteMode mode) {
+  std::vector<VectorFst<Arc>> stages;
+  fst->DeleteStates();
+  if (!MakeStages(sigma, dir, mode, &stages)) {
+    fst->SetProperties(kError, kError);
+    return;
+  }
+  ComposeStages(stages, fst);
+}
+
+template <class Arc>
+void CDRewriteRule<Arc>::Compile(CDRewriteSigma<Arc> *sigma,
+                                 MutableFst<Arc> *fst, CDRewriteDirection dir,
+                                 CDRewriteMode mode) {
+  std::vector<VectorFst<Arc>> stages;
+  fst->DeleteStates();
+  if (sigma->Error() || !MakeStages(sigma->Variant(this), dir, mode, &stages)) {
+    fst->SetProperties(kError, kError);
+    return;
+  }
+  ComposeStages(stages, fst);
+}
+
+template <class Arc>
+void CDRewriteRule<Arc>::ComposeStages(
+    const std::vector<VectorFst<Arc>> &stages, MutableFst<Arc> *fst) {
+  static const ILabelCompare<Arc> icomp;
+  VectorFst<Arc> c(stages.front());
+  for (auto it = stages.begin() + 1; it + 1 != stages.end(); ++it) {
     VectorFst<Arc> tmp;
-    ArcSort(fst, icomp);
-    Compose(inserter, *fst, &tmp);
-    static const OLabelCompare<Arc> ocomp;
-    ArcSort(&tmp, ocomp);
-    Compose(tmp, deleter, fst);
+    Compose(c, *it, &tmp);
+    c = tmp;
   }
+  Compose(c, stages.back(), fst);
   Optimize(fst);
   ArcSort(fst, icomp);
 }
 
+// Same as Compile, but rather than composing the stages and optimizing the
+// result, returns their delayed composition, which is expanded only as it is
+// visited. Each delayed composition in the chain caches its states subject to
+// the cache options, bounding the memory used; the bound is reported by
+// MemoryUsage. The resulting FST is neither optimized nor known to be sorted.
+template <class Arc>
+std::unique_ptr<Fst<Arc>> CDRewriteRule<Arc>::CompileDelayed(
+    const Fst<Arc> &sigma, CDRewriteDirection dir, CDRewriteMode mode,
+    const CacheOptions &opts) {
+  std::vector<VectorFst<Arc>> stages;
+  if (!MakeStages(sigma, dir, mode, &stages)) {
+    auto error = std::make_unique<VectorFst<Arc>>();
+    error->SetProperties(kError, kError);
+    return error;
+  }
+  std::unique_ptr<Fst<Arc>> fst(stages.front().Copy());
+  for (auto it = stages.begin() + 1; it != stages.end(); ++it) {
+    fst = std::make_unique<BoundedComposeFst<Arc>>(*fst, *it, opts);
+  }
+  return fst;
+}
+
 template <class Arc>
 void CDRewriteRule<Arc>::HandleBoundaryMarkers(const Fst<Arc> &sigma,
                                                VectorFst<Arc> *final_fst,
@@ -921,6 +1103,291 @@ void CDRewriteCompile(const Fst<Arc> &tau, const Fst<Arc> &lambda,
                    initial_boundary_marker, final_boundary_marker);
 }
 
+// Builds transducers representing many context-dependent rewrite rules:
+//
+//   phi_i -> psi_i / lambda_i __ rho_i .
+//
+// where taus[i] represents the cross-product of phi_i X psi_i, and the result
+// is written to fsts[i]. All rules share the same alphabet sigma, direction,
+// mode and boundary markers; the preprocessed alphabet is built only once and
+// shared across rules, which are compiled concurrently using up to
+// num_threads threads (or the hardware concurrency, if not positive).
+//
+// The error bit on an output FST is set if its arguments do not satisfy the
+// preconditions; it is set on all of them if the argument vectors differ in
+// size or if sigma does not satisfy the preconditions.
+template <class Arc>
+void CDRewriteCompileMany(
+    const std::vector<const Fst<Arc> *> &taus,
+    const std::vector<const Fst<Arc> *> &lambdas,
+    const std::vector<const Fst<Arc> *> &rhos, const Fst<Arc> &sigma,
+    const std::vector<MutableFst<Arc> *> &fsts,
+    CDRewriteDirection dir = LEFT_TO_RIGHT, CDRewriteMode mode = OBLIGATORY,
+    typename Arc::Label initial_boundary_marker = kNoLabel,
+    typename Arc::Label final_boundary_marker = kNoLabel,
+    int num_threads = 0) {
+  if (taus.size() != lambdas.size() || taus.size() != rhos.size() ||
+      taus.size() != fsts.size()) {
+    FSTERROR() << "CDRewriteCompileMany: Expected the same number of taus, "
+               << "lambdas, rhos, and output FSTs";
+    for (auto *fst : fsts) fst->SetProperties(kError, kError);
+    return;
+  }
+  internal::CDRewriteSigma<Arc> shared_sigma(sigma);
+  if (shared_sigma.Error()) {
+    for (auto *fst : fsts) fst->SetProperties(kError, kError);
+    return;
+  }
+  internal::ParallelFor(taus.size(), num_threads, [&](size_t, size_t i) {
+    VectorFst<Arc> phi(*taus[i]);
+    Project(&phi, ProjectType::INPUT);
+    ArcMap(&phi, RmWeightMapper<Arc>());
+    Optimize(&phi);
+    internal::CDRewriteRule<Arc> cdrule(phi, *taus[i], *lambdas[i], *rhos[i],
+                                        true, initial_boundary_marker,
+                                        final_boundary_marker);
+    cdrule.Compile(&shared_sigma, fsts[i], dir, mode);
+  });
+}
+
+// Same as the above, but returns a delayed composition of the stages of the
+// rule, which expands states only as they are visited. Each composition in the
+// chain caches its states subject to opts; this bounds the memory used when
+// the alphabet is large but any given input only reaches a small part of the
+// rule. The result is not optimized.
+//
+// The error bit on the output FST is set if any argument does not satisfy the
+// preconditions.
+template <class Arc>
+std::unique_ptr<Fst<Arc>> CDRewriteCompileDelayed(
+    const Fst<Arc> &phi, const Fst<Arc> &psi, const Fst<Arc> &lambda,
+    const Fst<Arc> &rho, const Fst<Arc> &sigma,
+    CDRewriteDirection dir = LEFT_TO_RIGHT, CDRewriteMode mode = OBLIGATORY,
+    bool phiXpsi = true, typename Arc::Label initial_boundary_marker = kNoLabel,
+    typename Arc::Label final_boundary_marker = kNoLabel,
+    const CacheOptions &opts = CacheOptions()) {
+  internal::CDRewriteRule<Arc> cdrule(phi, psi, lambda, rho, phiXpsi,
+                                      initial_boundary_marker,
+                                      final_boundary_marker);
+  return cdrule.CompileDelayed(sigma, dir, mode, opts);
+}
+
+// Same, but where tau represents the cross-product of phi X psi.
+template <class Arc>
+std::unique_ptr<Fst<Arc>> CDRewriteCompileDelayed(
+    const Fst<Arc> &tau, const Fst<Arc> &lambda, const Fst<Arc> &rho,
+    const Fst<Arc> &sigma, CDRewriteDirection dir = LEFT_TO_RIGHT,
+    CDRewriteMode mode = OBLIGATORY,
+    typename Arc::Label initial_boundary_marker = kNoLabel,
+    typename Arc::Label final_boundary_marker = kNoLabel,
+    const CacheOptions &opts = CacheOptions()) {
+  VectorFst<Arc> phi(tau);
+  Project(&phi, ProjectType::INPUT);
+  ArcMap(&phi, RmWeightMapper<Arc>());
+  Optimize(&phi);
+  return CDRewriteCompileDelayed(phi, tau, lambda, rho, sigma, dir, mode, true,
+                                 initial_boundary_marker,
+                                 final_boundary_marker, opts);
+}
+
+namespace internal {
+
+// Adds the non-epsilon labels, on either side, of an FST to the set.
+template <class Arc>
+void CollectLabels(const Fst<Arc> &fst,
+                   std::unordered_set<typename Arc::Label> *labels) {
+  for (StateIterator<Fst<Arc>> siter(fst); !siter.Done(); siter.Next()) {
+    for (ArcIterator<Fst<Arc>> aiter(fst, siter.Value()); !aiter.Done();
+         aiter.Next()) {
+      const auto &arc = aiter.Value();
+      if (arc.ilabel != 0) labels->insert(arc.ilabel);
+      if (arc.olabel != 0) labels->insert(arc.olabel);
+    }
+  }
+}
+
+// The least label used for the class of collapsed labels. Since a class arc
+// is matched against any label not otherwise matched, the class label must not
+// be carried by any input, so this lies far above the code points and
+// generated symbols which strings are compiled into, while leaving room above
+// it for the markers used during compilation.
+inline constexpr int64_t kLabelClassIndex = 0x3FFFFFF0;
+
+// Collapses the labels of sigma which are not mentioned into a single class
+// label, which it returns: kLabelClassIndex, or if any label of sigma or
+// mentioned is as great, the label after the greatest of them. The mentioned
+// labels of sigma are written to kept, and the collapsed labels to others.
+// This is only possible if each state either has no arcs with the collapsed
+// labels or one unweighted acceptor arc for each of them, all to the same
+// state; kNoLabel is returned if this is not the case, or if there are fewer
+// than two labels to collapse.
+template <class Arc>
+typename Arc::Label CollapseLabelClass(
+    const Fst<Arc> &sigma,
+    const std::unordered_set<typename Arc::Label> &mentioned,
+    VectorFst<Arc> *collapsed, std::vector<typename Arc::Label> *kept,
+    std::vector<typename Arc::Label> *others) {
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+  // Repeated labels at a state would throw off the count below.
+  if (sigma.Properties(kIDeterministic, true) != kIDeterministic) {
+    return kNoLabel;
+  }
+  std::unordered_set<Label> sigma_labels;
+  CollectLabels(sigma, &sigma_labels);
+  std::unordered_set<Label> collapsible;
+  Label max_label = 0;
+  for (const auto label : mentioned) max_label = std::max(max_label, label);
+  for (const auto label : sigma_labels) {
+    max_label = std::max(max_label, label);
+    if (mentioned.count(label)) {
+      kept->push_back(label);
+    } else {
+      collapsible.insert(label);
+    }
+  }
+  if (collapsible.size() < 2) return kNoLabel;
+  const Label class_label = max_label < kLabelClassIndex ? kLabelClassIndex
+                                                         : max_label + 1;
+  *collapsed = sigma;
+  std::vector<Arc> arcs;
+  for (StateId s = 0; s < collapsed->NumStates(); ++s) {
+    arcs.clear();
+    size_t num_others = 0;
+    StateId nextstate = kNoStateId;
+    for (ArcIterator<VectorFst<Arc>> aiter(*collapsed, s); !aiter.Done();
+         aiter.Next()) {
+      const auto &arc = aiter.Value();
+      if (!collapsible.count(arc.ilabel)) {
+        arcs.push_back(arc);
+        continue;
+      }
+      // Only arcs which the class arc replaces exactly can be collapsed.
+      if (arc.olabel != arc.ilabel || arc.weight != Weight::One()) {
+        return kNoLabel;
+      }
+      if (num_others++ == 0) {
+        nextstate = arc.nextstate;
+      } else if (arc.nextstate != nextstate) {
+        return kNoLabel;
+      }
+    }
+    if (num_others == 0) continue;
+    if (num_others != collapsible.size()) return kNoLabel;
+    arcs.emplace_back(class_label, class_label, Weight::One(), nextstate);
+    collapsed->DeleteArcs(s);
+    for (const auto &arc : arcs) collapsed->AddArc(s, arc);
+  }
+  others->assign(collapsible.begin(), collapsible.end());
+  std::sort(others->begin(), others->end());
+  return class_label;
+}
+
+// Prepares a rule compiled over a collapsed alphabet for rho matching. The
+// rho matcher matches a class arc against any label which does not label
+// another arc leaving its state, so at each state with a class arc, the kept
+// labels which do not are given arcs to a non-final sink state. Returns false
+// if an arc maps the class label to anything but itself or epsilon, which
+// rho matching cannot express.
+template <class Arc>
+bool BlockKeptLabels(const std::vector<typename Arc::Label> &kept,
+                     typename Arc::Label class_label, MutableFst<Arc> *rule) {
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+  const auto num_states = rule->NumStates();
+  StateId sink = kNoStateId;
+  std::unordered_set<Label> present;
+  for (StateId s = 0; s < num_states; ++s) {
+    present.clear();
+    bool has_class_arc = false;
+    for (ArcIterator<MutableFst<Arc>> aiter(*rule, s); !aiter.Done();
+         aiter.Next()) {
+      const auto &arc = aiter.Value();
+      if (arc.ilabel == class_label) {
+        if (arc.olabel != class_label && arc.olabel != 0) return false;
+        has_class_arc = true;
+      } else if (arc.olabel == class_label) {
+        return false;
+      }
+      present.insert(arc.ilabel);
+    }
+    if (!has_class_arc) continue;
+    for (const auto label : kept) {
+      if (present.count(label)) continue;
+      if (sink == kNoStateId) sink = rule->AddState();
+      rule->AddArc(s, Arc(label, label, Weight::One(), sink));
+    }
+  }
+  return true;
+}
+
+}  // namespace internal
+
+// Same as CDRewriteCompile, where tau represents the cross-product of phi X
+// psi, but for rules whose arguments mention only a few of the labels of a
+// large alphabet. The labels of sigma which tau, lambda, and rho do not
+// mention are collapsed into a single class label before compilation, so that
+// the size of the rule, and the time taken to compile it, do not depend on
+// how many there are. The result is a LabelClassRuleFst, which matches its
+// class arcs against any of these labels when the rule is composed on the
+// right. Since a class arc matches any label not otherwise matched, inputs
+// with labels outside of sigma are rewritten rather than rejected. If the
+// labels cannot be collapsed (e.g., because sigma is not the closure of
+// single labels, or because the contexts mention all of them), the rule is
+// compiled in the ordinary way, and no label is given special treatment.
+//
+// The error bit on the output FST is set if any argument does not satisfy the
+// preconditions.
+template <class Arc>
+std::unique_ptr<LabelClassRuleFst<Arc>> CDRewriteCompileLabelClass(
+    const Fst<Arc> &tau, const Fst<Arc> &lambda, const Fst<Arc> &rho,
+    const Fst<Arc> &sigma, CDRewriteDirection dir = LEFT_TO_RIGHT,
+    CDRewriteMode mode = OBLIGATORY,
+    typename Arc::Label initial_boundary_marker = kNoLabel,
+    typename Arc::Label final_boundary_marker = kNoLabel) {
+  using Label = typename Arc::Label;
+  if (!CheckUnweightedAcceptor(sigma, "CDRewriteCompileLabelClass", "sigma")) {
+    VectorFst<Arc> error;
+    error.SetProperties(kError, kError);
+    return std::make_unique<LabelClassRuleFst<Arc>>(std::move(error),
+                                                    kNoLabel);
+  }
+  std::unordered_set<Label> mentioned;
+  internal::CollectLabels(tau, &mentioned);
+  internal::CollectLabels(lambda, &mentioned);
+  internal::CollectLabels(rho, &mentioned);
+  if (initial_boundary_marker != kNoLabel) {
+    mentioned.insert(initial_boundary_marker);
+  }
+  if (final_boundary_marker != kNoLabel) {
+    mentioned.insert(final_boundary_marker);
+  }
+  VectorFst<Arc> collapsed;
+  std::vector<Label> kept;
+  std::vector<Label> others;
+  const auto class_label = internal::CollapseLabelClass(
+      sigma, mentioned, &collapsed, &kept, &others);
+  VectorFst<Arc> rule;
+  if (class_label != kNoLabel) {
+    CDRewriteCompile(tau, lambda, rho, collapsed, &rule, dir, mode,
+                     initial_boundary_marker, final_boundary_marker);
+    if (rule.Properties(kError, false)) {
+      return std::make_unique<LabelClassRuleFst<Arc>>(std::move(rule),
+                                                      kNoLabel);
+    }
+    if (internal::BlockKeptLabels(kept, class_label, &rule)) {
+      ArcSort(&rule, ILabelCompare<Arc>());
+      return std::make_unique<LabelClassRuleFst<Arc>>(
+          std::move(rule), class_label, std::move(others));
+    }
+  }
+  CDRewriteCompile(tau, lambda, rho, sigma, &rule, dir, mode,
+                   initial_boundary_marker, final_boundary_marker);
+  return std::make_unique<LabelClassRuleFst<Arc>>(std::move(rule), kNoLabel);
+}
+
 }  // namespace fst
 
 #endif  // PYNINI_CDREWRITE_H_
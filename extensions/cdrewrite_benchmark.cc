@@ -0,0 +1,109 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks of context-dependent rewrite rule compilation.
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <fst/arc.h>
+#include <fst/vector-fst.h>
+#include "benchmark_util.h"
+#include "cdrewrite.h"
+#include "stringcompile.h"
+#include "stringmap.h"
+
+namespace fst {
+namespace {
+
+using ::fst::benchmark_util::ByteSigmaStar;
+using ::fst::benchmark_util::NumberNameLines;
+using ::fst::benchmark_util::RandomWords;
+using ::fst::benchmark_util::Utf8SigmaStar;
+
+// Compiles a rule deleting any of a number of words, given by the argument,
+// between two spaces, over printable ASCII.
+void BM_CDRewriteCompileByte(benchmark::State &state) {
+  std::vector<std::vector<std::string>> lines;
+  for (const auto &word : RandomWords(state.range(0))) {
+    lines.push_back({word, ""});
+  }
+  VectorFst<StdArc> tau;
+  StringMapCompile(lines, &tau);
+  VectorFst<StdArc> space;
+  StringCompile(" ", &space);
+  const auto sigma_star = ByteSigmaStar<StdArc>();
+  for (auto _ : state) {
+    VectorFst<StdArc> rule;
+    CDRewriteCompile(tau, space, space, sigma_star, &rule);
+    benchmark::DoNotOptimize(rule.NumStates());
+  }
+}
+BENCHMARK(BM_CDRewriteCompileByte)->Arg(1)->Arg(100)->Arg(1000);
+
+// Compiles a rule rewriting one Cyrillic letter as another, in the context of
+// Latin letters, over a large UTF-8 alphabet.
+void BM_CDRewriteCompileUtf8(benchmark::State &state) {
+  VectorFst<StdArc> tau;
+  StringMapCompile(std::vector<std::vector<std::string>>{{"ж", "zh"}}, &tau,
+                   TokenType::UTF8, TokenType::UTF8);
+  VectorFst<StdArc> lambda;
+  VectorFst<StdArc> rho;
+  StringCompile("a", &lambda, TokenType::UTF8);
+  StringCompile("é", &rho, TokenType::UTF8);
+  const auto sigma_star = Utf8SigmaStar<StdArc>();
+  for (auto _ : state) {
+    VectorFst<StdArc> rule;
+    CDRewriteCompile(tau, lambda, rho, sigma_star, &rule);
+    benchmark::DoNotOptimize(rule.NumStates());
+  }
+}
+BENCHMARK(BM_CDRewriteCompileUtf8);
+
+// Same, but collapsing the letters the rule does not mention into a class.
+void BM_CDRewriteCompileLabelClassUtf8(benchmark::State &state) {
+  VectorFst<StdArc> tau;
+  StringMapCompile(std::vector<std::vector<std::string>>{{"ж", "zh"}}, &tau,
+                   TokenType::UTF8, TokenType::UTF8);
+  VectorFst<StdArc> lambda;
+  VectorFst<StdArc> rho;
+  StringCompile("a", &lambda, TokenType::UTF8);
+  StringCompile("é", &rho, TokenType::UTF8);
+  const auto sigma_star = Utf8SigmaStar<StdArc>();
+  for (auto _ : state) {
+    const auto rule = CDRewriteCompileLabelClass(tau, lambda, rho, sigma_star);
+    benchmark::DoNotOptimize(rule->NumStates());
+  }
+}
+BENCHMARK(BM_CDRewriteCompileLabelClassUtf8);
+
+// Compiles the number verbalization rule, whose tau has many states.
+void BM_CDRewriteCompileNumbers(benchmark::State &state) {
+  VectorFst<StdArc> tau;
+  StringMapCompile(NumberNameLines(state.range(0)), &tau);
+  VectorFst<StdArc> space;
+  StringCompile(" ", &space);
+  const auto sigma_star = ByteSigmaStar<StdArc>();
+  for (auto _ : state) {
+    VectorFst<StdArc> rule;
+    CDRewriteCompile(tau, space, space, sigma_star, &rule);
+    benchmark::DoNotOptimize(rule.NumStates());
+  }
+}
+BENCHMARK(BM_CDRewriteCompileNumbers)->Arg(99)->Arg(9999);
+
+}  // namespace
+}  // namespace fst
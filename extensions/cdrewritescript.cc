@@ -17,6 +17,9 @@
 #include "cdrewritescript.h"
 
 #include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
 
 #include <fst/script/script-impl.h>
 
@@ -61,8 +64,87 @@ void CDRewriteCompile(const FstClass &tau, const FstClass &lambda,
                                           &args);
 }
 
+void CDRewriteCompileMany(const std::vector<const FstClass *> &taus,
+                          const std::vector<const FstClass *> &lambdas,
+                          const std::vector<const FstClass *> &rhos,
+                          const FstClass &sigma,
+                          const std::vector<MutableFstClass *> &fsts,
+                          CDRewriteDirection dir, CDRewriteMode mode,
+                          int64_t initial_boundary_marker,
+                          int64_t final_boundary_marker, int num_threads) {
+  bool match = true;
+  for (const auto *tau : taus) {
+    match = match && internal::ArcTypesMatch(*tau, sigma,
+                                             "CDRewriteCompileMany");
+  }
+  for (const auto *lambda : lambdas) {
+    match = match && internal::ArcTypesMatch(*lambda, sigma,
+                                             "CDRewriteCompileMany");
+  }
+  for (const auto *rho : rhos) {
+    match = match && internal::ArcTypesMatch(*rho, sigma,
+                                             "CDRewriteCompileMany");
+  }
+  for (const auto *fst : fsts) {
+    match = match && internal::ArcTypesMatch(*fst, sigma,
+                                             "CDRewriteCompileMany");
+  }
+  if (!match) {
+    for (auto *fst : fsts) fst->SetProperties(kError, kError);
+    return;
+  }
+  CDRewriteCompileManyArgs args(taus, lambdas, rhos, sigma, fsts, dir, mode,
+                                initial_boundary_marker, final_boundary_marker,
+                                num_threads);
+  Apply<Operation<CDRewriteCompileManyArgs>>("CDRewriteCompileMany",
+                                             sigma.ArcType(), &args);
+}
+
+std::unique_ptr<FstClass> CDRewriteCompileDelayed(
+    const FstClass &tau, const FstClass &lambda, const FstClass &rho,
+    const FstClass &sigma, CDRewriteDirection dir, CDRewriteMode mode,
+    int64_t initial_boundary_marker, int64_t final_boundary_marker,
+    size_t cache_gc_limit) {
+  if (!internal::ArcTypesMatch(tau, lambda, "CDRewriteCompileDelayed") ||
+      !internal::ArcTypesMatch(lambda, rho, "CDRewriteCompileDelayed") ||
+      !internal::ArcTypesMatch(rho, sigma, "CDRewriteCompileDelayed")) {
+    return nullptr;
+  }
+  CDRewriteCompileDelayedInnerArgs iargs(tau, lambda, rho, sigma, dir, mode,
+                                         initial_boundary_marker,
+                                         final_boundary_marker,
+                                         cache_gc_limit);
+  CDRewriteCompileDelayedArgs args(iargs);
+  Apply<Operation<CDRewriteCompileDelayedArgs>>("CDRewriteCompileDelayed",
+                                                tau.ArcType(), &args);
+  return std::move(args.retval);
+}
+
+std::unique_ptr<FstClass> CDRewriteCompileLabelClass(
+    const FstClass &tau, const FstClass &lambda, const FstClass &rho,
+    const FstClass &sigma, CDRewriteDirection dir, CDRewriteMode mode,
+    int64_t initial_boundary_marker, int64_t final_boundary_marker) {
+  if (!internal::ArcTypesMatch(tau, lambda, "CDRewriteCompileLabelClass") ||
+      !internal::ArcTypesMatch(lambda, rho, "CDRewriteCompileLabelClass") ||
+      !internal::ArcTypesMatch(rho, sigma, "CDRewriteCompileLabelClass")) {
+    return nullptr;
+  }
+  CDRewriteCompileLabelClassInnerArgs iargs(tau, lambda, rho, sigma, dir,
+                                            mode, initial_boundary_marker,
+                                            final_boundary_marker);
+  CDRewriteCompileLabelClassArgs args(iargs);
+  Apply<Operation<CDRewriteCompileLabelClassArgs>>(
+      "CDRewriteCompileLabelClass", tau.ArcType(), &args);
+  return std::move(args.retval);
+}
+
 REGISTER_FST_OPERATION_3ARCS(CDRewriteCompile, CDRewriteCompileArgs1);
 REGISTER_FST_OPERATION_3ARCS(CDRewriteCompile, CDRewriteCompileArgs2);
+REGISTER_FST_OPERATION_3ARCS(CDRewriteCompileMany, CDRewriteCompileManyArgs);
+REGISTER_FST_OPERATION_3ARCS(CDRewriteCompileDelayed,
+                             CDRewriteCompileDelayedArgs);
+REGISTER_FST_OPERATION_3ARCS(CDRewriteCompileLabelClass,
+                             CDRewriteCompileLabelClassArgs);
 
 }  // namespace script
 }  // namespace fst
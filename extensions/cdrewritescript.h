@@ -18,9 +18,13 @@
 #define PYNINI_CDREWRITESCRIPT_H_
 
 #include <cstdint>
+#include <memory>
 #include <utility>
+#include <vector>
 
 #include <fst/types.h>
+#include <fst/cache.h>
+#include <fst/script/arg-packs.h>
 #include <fst/script/fst-class.h>
 #include "cdrewrite.h"
 
@@ -82,6 +86,118 @@ void CDRewriteCompile(const FstClass &tau, const FstClass &lambda,
                       int64_t initial_boundary_marker = kNoLabel,
                       int64_t final_boundary_marker = kNoLabel);
 
+using CDRewriteCompileManyArgs =
+    std::tuple<const std::vector<const FstClass *> &,
+               const std::vector<const FstClass *> &,
+               const std::vector<const FstClass *> &, const FstClass &,
+               const std::vector<MutableFstClass *> &, CDRewriteDirection,
+               CDRewriteMode, int64_t, int64_t, int>;
+
+template <class Arc>
+void CDRewriteCompileMany(CDRewriteCompileManyArgs *args) {
+  const auto &itaus = std::get<0>(*args);
+  const auto &ilambdas = std::get<1>(*args);
+  const auto &irhos = std::get<2>(*args);
+  const auto &ifsts = std::get<4>(*args);
+  std::vector<const Fst<Arc> *> taus;
+  taus.reserve(itaus.size());
+  for (const auto *tau : itaus) taus.push_back(tau->GetFst<Arc>());
+  std::vector<const Fst<Arc> *> lambdas;
+  lambdas.reserve(ilambdas.size());
+  for (const auto *lambda : ilambdas) lambdas.push_back(lambda->GetFst<Arc>());
+  std::vector<const Fst<Arc> *> rhos;
+  rhos.reserve(irhos.size());
+  for (const auto *rho : irhos) rhos.push_back(rho->GetFst<Arc>());
+  const Fst<Arc> &sigma = *(std::get<3>(*args).GetFst<Arc>());
+  std::vector<MutableFst<Arc> *> fsts;
+  fsts.reserve(ifsts.size());
+  for (auto *fst : ifsts) fsts.push_back(fst->GetMutableFst<Arc>());
+  const CDRewriteDirection dir = std::get<5>(*args);
+  const CDRewriteMode mode = std::get<6>(*args);
+  const typename Arc::Label initial_boundary_marker = std::get<7>(*args);
+  const typename Arc::Label final_boundary_marker = std::get<8>(*args);
+  CDRewriteCompileMany(taus, lambdas, rhos, sigma, fsts, dir, mode,
+                       initial_boundary_marker, final_boundary_marker,
+                       std::get<9>(*args));
+}
+
+// All of the FSTs must have the same arc type as sigma.
+void CDRewriteCompileMany(const std::vector<const FstClass *> &taus,
+                          const std::vector<const FstClass *> &lambdas,
+                          const std::vector<const FstClass *> &rhos,
+                          const FstClass &sigma,
+                          const std::vector<MutableFstClass *> &fsts,
+                          CDRewriteDirection dir, CDRewriteMode mode,
+                          int64_t initial_boundary_marker = kNoLabel,
+                          int64_t final_boundary_marker = kNoLabel,
+                          int num_threads = 0);
+
+using CDRewriteCompileDelayedInnerArgs =
+    std::tuple<const FstClass &, const FstClass &, const FstClass &,
+               const FstClass &, CDRewriteDirection, CDRewriteMode, int64_t,
+               int64_t, size_t>;
+
+using CDRewriteCompileDelayedArgs =
+    WithReturnValue<std::unique_ptr<FstClass>,
+                    CDRewriteCompileDelayedInnerArgs>;
+
+template <class Arc>
+void CDRewriteCompileDelayed(CDRewriteCompileDelayedArgs *args) {
+  const Fst<Arc> &tau = *(std::get<0>(args->args).GetFst<Arc>());
+  const Fst<Arc> &lambda = *(std::get<1>(args->args).GetFst<Arc>());
+  const Fst<Arc> &rho = *(std::get<2>(args->args).GetFst<Arc>());
+  const Fst<Arc> &sigma = *(std::get<3>(args->args).GetFst<Arc>());
+  const CDRewriteDirection dir = std::get<4>(args->args);
+  const CDRewriteMode mode = std::get<5>(args->args);
+  const typename Arc::Label initial_boundary_marker = std::get<6>(args->args);
+  const typename Arc::Label final_boundary_marker = std::get<7>(args->args);
+  const CacheOptions opts(true, std::get<8>(args->args));
+  const auto fst = CDRewriteCompileDelayed(tau, lambda, rho, sigma, dir, mode,
+                                           initial_boundary_marker,
+                                           final_boundary_marker, opts);
+  args->retval = std::make_unique<FstClass>(*fst);
+}
+
+// Returns nullptr if the arc types of the arguments do not match.
+std::unique_ptr<FstClass> CDRewriteCompileDelayed(
+    const FstClass &tau, const FstClass &lambda, const FstClass &rho,
+    const FstClass &sigma, CDRewriteDirection dir, CDRewriteMode mode,
+    int64_t initial_boundary_marker, int64_t final_boundary_marker,
+    size_t cache_gc_limit);
+
+using CDRewriteCompileLabelClassInnerArgs =
+    std::tuple<const FstClass &, const FstClass &, const FstClass &,
+               const FstClass &, CDRewriteDirection, CDRewriteMode, int64_t,
+               int64_t>;
+
+using CDRewriteCompileLabelClassArgs =
+    WithReturnValue<std::unique_ptr<FstClass>,
+                    CDRewriteCompileLabelClassInnerArgs>;
+
+template <class Arc>
+void CDRewriteCompileLabelClass(CDRewriteCompileLabelClassArgs *args) {
+  const Fst<Arc> &tau = *(std::get<0>(args->args).GetFst<Arc>());
+  const Fst<Arc> &lambda = *(std::get<1>(args->args).GetFst<Arc>());
+  const Fst<Arc> &rho = *(std::get<2>(args->args).GetFst<Arc>());
+  const Fst<Arc> &sigma = *(std::get<3>(args->args).GetFst<Arc>());
+  const CDRewriteDirection dir = std::get<4>(args->args);
+  const CDRewriteMode mode = std::get<5>(args->args);
+  const typename Arc::Label initial_boundary_marker = std::get<6>(args->args);
+  const typename Arc::Label final_boundary_marker = std::get<7>(args->args);
+  const auto fst = CDRewriteCompileLabelClass(tau, lambda, rho, sigma, dir,
+                                              mode, initial_boundary_marker,
+                                              final_boundary_marker);
+  if (fst->Properties(kError, false)) return;
+  args->retval = std::make_unique<FstClass>(*fst);
+}
+
+// Returns nullptr if the arc types of the arguments do not match, or if
+// compilation fails.
+std::unique_ptr<FstClass> CDRewriteCompileLabelClass(
+    const FstClass &tau, const FstClass &lambda, const FstClass &rho,
+    const FstClass &sigma, CDRewriteDirection dir, CDRewriteMode mode,
+    int64_t initial_boundary_marker, int64_t final_boundary_marker);
+
 }  // namespace script
 }  // namespace fst
 
@@ -0,0 +1,164 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_COMPILED_STRING_FST_H_
+#define PYNINI_COMPILED_STRING_FST_H_
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <fst/types.h>
+#include <fst/fst.h>
+#include <fst/properties.h>
+
+namespace fst {
+namespace internal {
+
+template <class A>
+class CompiledStringFstImpl : public FstImpl<A> {
+ public:
+  using Arc = A;
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+
+  using FstImpl<Arc>::SetType;
+  using FstImpl<Arc>::SetProperties;
+  using FstImpl<Arc>::Properties;
+
+  CompiledStringFstImpl(const std::vector<Label> &labels, Weight final_weight)
+      : final_weight_(std::move(final_weight)) {
+    SetType("CompiledStringFst");
+    arcs_.reserve(labels.size());
+    bool epsilons = false;
+    for (const auto label : labels) {
+      arcs_.emplace_back(label, label, arcs_.size() + 1);
+      if (label == 0) epsilons = true;
+    }
+    auto props = kCompiledStringProperties | kExpanded;
+    if (final_weight_ != Weight::One()) {
+      props &= ~kUnweighted;
+      props |= kWeighted;
+    }
+    props |= epsilons ? kEpsilons | kIEpsilons | kOEpsilons
+                      : kNoEpsilons | kNoIEpsilons | kNoOEpsilons;
+    SetProperties(props);
+  }
+
+  constexpr StateId Start() const { return 0; }
+
+  Weight Final(StateId s) const {
+    return IsFinal(s) ? final_weight_ : Weight::Zero();
+  }
+
+  StateId NumStates() const { return arcs_.size() + 1; }
+
+  size_t NumArcs(StateId s) const { return IsFinal(s) ? 0 : 1; }
+
+  size_t NumInputEpsilons(StateId s) const {
+    return !IsFinal(s) && arcs_[s].ilabel == 0;
+  }
+
+  size_t NumOutputEpsilons(StateId s) const { return NumInputEpsilons(s); }
+
+  void InitStateIterator(StateIteratorData<Arc> *data) const {
+    data->base = nullptr;
+    data->nstates = NumStates();
+  }
+
+  // The arc leaving state s is arcs_[s], so iterators read it in place.
+  void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const {
+    data->base = nullptr;
+    data->ref_count = nullptr;
+    data->arcs = IsFinal(s) ? nullptr : arcs_.data() + s;
+    data->narcs = NumArcs(s);
+  }
+
+ private:
+  bool IsFinal(StateId s) const { return s == arcs_.size(); }
+
+  // The arc leaving each state but the last, which is final.
+  std::vector<Arc> arcs_;
+  const Weight final_weight_;
+};
+
+}  // namespace internal
+
+// An immutable string FSA which stores its arcs, one per label, in a single
+// contiguous array. This is the representation which the string compiler
+// produces when asked for one: unlike a VectorFst, it needs no separate
+// allocation per state, so it takes several times less memory, and since the
+// arcs are adjacent in memory, composition visits them cache-efficiently.
+//
+// The state number is the index of the state's arc in the array; the state
+// after the last arc is final, with the given weight.
+template <class A>
+class CompiledStringFst
+    : public ImplToExpandedFst<internal::CompiledStringFstImpl<A>> {
+ public:
+  using Arc = A;
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+  using Impl = internal::CompiledStringFstImpl<Arc>;
+
+  // The empty string.
+  CompiledStringFst() : CompiledStringFst(std::vector<Label>()) {}
+
+  explicit CompiledStringFst(const std::vector<Label> &labels,
+                             Weight final_weight = Weight::One())
+      : ImplToExpandedFst<Impl>(
+            std::make_shared<Impl>(labels, std::move(final_weight))) {}
+
+  // The arc array is fixed at construction, so even thread-safe copies can
+  // share it rather than copying every label.
+  CompiledStringFst(const CompiledStringFst<Arc> &fst, bool safe = false)
+      : ImplToExpandedFst<Impl>(fst.GetSharedImpl()) {}
+
+  // Gets a copy of this CompiledStringFst. See Fst<>::Copy() for further doc.
+  CompiledStringFst *Copy(bool safe = false) const override {
+    return new CompiledStringFst<Arc>(*this, safe);
+  }
+
+  void InitStateIterator(StateIteratorData<Arc> *data) const override {
+    GetImpl()->InitStateIterator(data);
+  }
+
+  void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const override {
+    GetImpl()->InitArcIterator(s, data);
+  }
+
+  // Replaces the string; copies made beforehand are unaffected.
+  void Reset(const std::vector<Label> &labels,
+             Weight final_weight = Weight::One()) {
+    SetImpl(std::make_shared<Impl>(labels, std::move(final_weight)));
+  }
+
+ private:
+  using ImplToFst<Impl, ExpandedFst<Arc>>::GetImpl;
+  using ImplToFst<Impl, ExpandedFst<Arc>>::GetSharedImpl;
+  using ImplToFst<Impl, ExpandedFst<Arc>>::SetImpl;
+
+  CompiledStringFst &operator=(const CompiledStringFst &) = delete;
+};
+
+using StdCompiledStringFst = CompiledStringFst<StdArc>;
+
+}  // namespace fst
+
+#endif  // PYNINI_COMPILED_STRING_FST_H_
@@ -19,14 +19,21 @@
 
 // Computes the range-based concatenative closure of an FST.
 
+#include <algorithm>
 #include <cstdint>
+#include <limits>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include <fst/types.h>
+#include <fst/log.h>
+#include <fst/cache.h>
 #include <fst/closure.h>
 #include <fst/concat.h>
 #include <fst/fst.h>
 #include <fst/mutable-fst.h>
+#include <fst/replace.h>
 #include <fst/union.h>
 #include <fst/vector-fst.h>
 
@@ -50,6 +57,22 @@ void SetStartFinal(MutableFst<Arc> *fst) {
   Union(fst, *kStartFinal);
 }
 
+// Checks the range bounds, as documented below.
+inline bool CheckConcatRangeBounds(int32_t lower, int32_t upper) {
+  if (lower < 0 || upper < 0) {
+    FSTERROR() << "ConcatRange: range bounds must be positive, got {" << lower
+               << "," << upper << "}";
+    return false;
+  }
+  if (upper && lower > upper) {
+    FSTERROR()
+        << "ConcatRange: lower bound cannot be greater than upper bound, got {"
+        << lower << "," << upper << "}";
+    return false;
+  }
+  return true;
+}
+
 }  // namespace internal
 
 // This function is a generalization of FST closure and PCRE's curly brace
@@ -84,17 +107,8 @@ void SetStartFinal(MutableFst<Arc> *fst) {
 template <class Arc>
 void ConcatRange(MutableFst<Arc> *fst, int32_t lower = 0, int32_t upper = 0) {
   if (fst->Start() == kNoStateId) return;
-  if (lower < 0 || upper < 0) {
+  if (!internal::CheckConcatRangeBounds(lower, upper)) {
     fst->SetProperties(kError, kError);
-    FSTERROR() << "ConcatRange: range bounds must be positive, got {" << lower
-               << "," << upper << "}";
-    return;
-  }
-  if (upper && lower > upper) {
-    fst->SetProperties(kError, kError);
-    FSTERROR()
-        << "ConcatRange: lower bound cannot be greater than upper bound, got {"
-        << lower << "," << upper << "}";
     return;
   }
   const std::unique_ptr<const MutableFst<Arc>> copy(fst->Copy());
@@ -135,6 +149,67 @@ void ConcatRange(MutableFst<Arc> *fst, int32_t lower = 0, int32_t upper = 0) {
   }
 }
 
+// As above, but constructively computes the closure as a delayed FST which
+// shares a single copy of the input rather than concatenating up to `upper`
+// copies of it. The result is a ReplaceFst whose root is a chain of
+// max(lower, upper) + 1 states, each arc of which "calls" the input FST, so
+// its construction is cheap regardless of the bounds and of the size of the
+// input, and only the parts of it which are visited are ever expanded. The
+// input is scanned once to find a label it does not use for the calls, which
+// are replaced by epsilons.
+template <class Arc>
+std::unique_ptr<Fst<Arc>> ConcatRangeDelayed(
+    const Fst<Arc> &fst, int32_t lower = 0, int32_t upper = 0,
+    const CacheOptions &opts = CacheOptions()) {
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+  if (!internal::CheckConcatRangeBounds(lower, upper)) {
+    auto error = std::make_unique<VectorFst<Arc>>();
+    error->SetProperties(kError, kError);
+    return error;
+  }
+  if (fst.Start() == kNoStateId) return std::unique_ptr<Fst<Arc>>(fst.Copy());
+  Label max_label = 0;
+  for (StateIterator<Fst<Arc>> siter(fst); !siter.Done(); siter.Next()) {
+    for (ArcIterator<Fst<Arc>> aiter(fst, siter.Value()); !aiter.Done();
+         aiter.Next()) {
+      const auto &arc = aiter.Value();
+      max_label = std::max({max_label, arc.ilabel, arc.olabel});
+    }
+  }
+  if (max_label > std::numeric_limits<Label>::max() - 2) {
+    FSTERROR() << "ConcatRangeDelayed: No free label for the root";
+    auto error = std::make_unique<VectorFst<Arc>>();
+    error->SetProperties(kError, kError);
+    return error;
+  }
+  const Label root_label = max_label + 1;
+  const Label call_label = max_label + 2;
+  // With an infinite upper bound, the last state loops through the input;
+  // otherwise, each state at or past the lower bound is final.
+  VectorFst<Arc> root;
+  const StateId size = (upper ? upper : lower) + 1;
+  root.ReserveStates(size);
+  for (StateId state = 0; state < size; ++state) root.AddState();
+  root.SetStart(0);
+  for (StateId state = 0; state + 1 < size; ++state) {
+    root.AddArc(state, Arc(call_label, call_label, Weight::One(), state + 1));
+  }
+  if (upper) {
+    for (StateId state = lower; state < size; ++state) root.SetFinal(state);
+  } else {
+    root.AddArc(lower, Arc(call_label, call_label, Weight::One(), lower));
+    root.SetFinal(lower);
+  }
+  const std::vector<std::pair<Label, const Fst<Arc> *>> fst_pairs = {
+      {root_label, &root}, {call_label, &fst}};
+  ReplaceFstOptions<Arc> ropts(opts, root_label);
+  ropts.call_label_type = REPLACE_LABEL_NEITHER;
+  ropts.return_label_type = REPLACE_LABEL_NEITHER;
+  return std::make_unique<ReplaceFst<Arc>>(fst_pairs, ropts);
+}
+
 }  // namespace fst
 
 #endif  // PYNINI_CONCATRANGE_H_
@@ -17,6 +17,8 @@
 #include "concatrangescript.h"
 
 #include <cstdint>
+#include <memory>
+#include <utility>
 
 #include <fst/script/script-impl.h>
 
@@ -28,7 +30,17 @@ void ConcatRange(MutableFstClass *fst, int32_t lower, int32_t upper) {
   Apply<Operation<ConcatRangeArgs>>("ConcatRange", fst->ArcType(), &args);
 }
 
+std::unique_ptr<FstClass> ConcatRangeDelayed(const FstClass &fst,
+                                             int32_t lower, int32_t upper) {
+  ConcatRangeDelayedInnerArgs iargs(fst, lower, upper);
+  ConcatRangeDelayedArgs args(iargs);
+  Apply<Operation<ConcatRangeDelayedArgs>>("ConcatRangeDelayed",
+                                           fst.ArcType(), &args);
+  return std::move(args.retval);
+}
+
 REGISTER_FST_OPERATION_3ARCS(ConcatRange, ConcatRangeArgs);
+REGISTER_FST_OPERATION_3ARCS(ConcatRangeDelayed, ConcatRangeDelayedArgs);
 
 }  // namespace script
 }  // namespace fst
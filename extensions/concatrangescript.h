@@ -18,8 +18,10 @@
 #define PYNINI_CONCATRANGESCRIPT_H_
 
 #include <cstdint>
+#include <memory>
 #include <utility>
 
+#include <fst/script/arg-packs.h>
 #include <fst/script/fst-class.h>
 #include "concatrange.h"
 
@@ -36,6 +38,24 @@ void ConcatRange(ConcatRangeArgs *args) {
 
 void ConcatRange(MutableFstClass *fst, int32_t lower = 0, int32_t upper = 0);
 
+using ConcatRangeDelayedInnerArgs =
+    std::tuple<const FstClass &, int32_t, int32_t>;
+
+using ConcatRangeDelayedArgs =
+    WithReturnValue<std::unique_ptr<FstClass>, ConcatRangeDelayedInnerArgs>;
+
+template <class Arc>
+void ConcatRangeDelayed(ConcatRangeDelayedArgs *args) {
+  const Fst<Arc> &fst = *(std::get<0>(args->args).GetFst<Arc>());
+  const auto delayed = ConcatRangeDelayed(fst, std::get<1>(args->args),
+                                          std::get<2>(args->args));
+  args->retval = std::make_unique<FstClass>(*delayed);
+}
+
+std::unique_ptr<FstClass> ConcatRangeDelayed(const FstClass &fst,
+                                             int32_t lower = 0,
+                                             int32_t upper = 0);
+
 }  // namespace script
 }  // namespace fst
 
@@ -0,0 +1,249 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_CONST_FST_VIEW_H_
+#define PYNINI_CONST_FST_VIEW_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <fst/types.h>
+#include <fst/log.h>
+#include <fst/const-fst.h>
+#include <fst/fst.h>
+#include <fst/properties.h>
+#include <fst/symbol-table.h>
+#include <fst/util.h>
+
+namespace fst {
+namespace internal {
+
+// An input stream buffer over borrowed memory, so that FST headers can be
+// parsed in place; it supports the seeks needed to find the arrays.
+class MemoryStreamBuf : public std::streambuf {
+ public:
+  MemoryStreamBuf(const char *data, size_t size) {
+    auto *begin = const_cast<char *>(data);
+    setg(begin, begin, begin + size);
+  }
+
+ protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which) override {
+    if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+    char *base = dir == std::ios_base::beg   ? eback()
+                 : dir == std::ios_base::cur ? gptr()
+                                             : egptr();
+    if (off < eback() - base || off > egptr() - base) {
+      return pos_type(off_type(-1));
+    }
+    setg(eback(), base + off, egptr());
+    return pos_type(gptr() - eback());
+  }
+
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+  }
+};
+
+template <class A>
+class ConstFstViewImpl : public FstImpl<A> {
+ public:
+  using Arc = A;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+
+  using FstImpl<Arc>::Properties;
+  using FstImpl<Arc>::SetProperties;
+  using FstImpl<Arc>::SetType;
+
+  ConstFstViewImpl(const char *data, size_t size) {
+    // Matches the type of ConstFst<Arc>, whose images these are.
+    SetType("const");
+    if (!Init(data, size)) {
+      SetProperties(kError, kError);
+      states_ = nullptr;
+      arcs_ = nullptr;
+      nstates_ = 0;
+      start_ = kNoStateId;
+    }
+  }
+
+  StateId Start() const { return start_; }
+
+  Weight Final(StateId s) const { return states_[s].weight; }
+
+  StateId NumStates() const { return nstates_; }
+
+  size_t NumArcs(StateId s) const { return states_[s].narcs; }
+
+  size_t NumInputEpsilons(StateId s) const { return states_[s].niepsilons; }
+
+  size_t NumOutputEpsilons(StateId s) const { return states_[s].noepsilons; }
+
+  void InitStateIterator(StateIteratorData<Arc> *data) const {
+    data->base = nullptr;
+    data->nstates = nstates_;
+  }
+
+  void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const {
+    data->base = nullptr;
+    data->ref_count = nullptr;
+    data->arcs = arcs_ + states_[s].pos;
+    data->narcs = states_[s].narcs;
+  }
+
+ private:
+  // The layout of a state in a ConstFst<Arc> (with 32-bit offsets) image.
+  struct State {
+    Weight weight;
+    uint32_t pos;
+    uint32_t narcs;
+    uint32_t niepsilons;
+    uint32_t noepsilons;
+  };
+
+  // The versions of the ConstFst format; images of the older one are always
+  // aligned.
+  static constexpr int kAlignedFileVersion = 1;
+  static constexpr int kMinFileVersion = 1;
+
+  bool Init(const char *data, size_t size);
+
+  // Points the array at the next region of the stream, or, if the region is
+  // not suitably aligned in memory, at a copy of it.
+  template <class T>
+  bool MapRegion(const char *data, size_t size, std::istream &strm,
+                 size_t count, bool aligned, const T **array,
+                 std::vector<T> *copy);
+
+  const State *states_ = nullptr;
+  const Arc *arcs_ = nullptr;
+  StateId nstates_ = 0;
+  size_t narcs_ = 0;
+  StateId start_ = kNoStateId;
+  // Used only for regions which cannot be borrowed in place.
+  std::vector<State> states_copy_;
+  std::vector<Arc> arcs_copy_;
+};
+
+template <class Arc>
+bool ConstFstViewImpl<Arc>::Init(const char *data, size_t size) {
+  MemoryStreamBuf buf(data, size);
+  std::istream strm(&buf);
+  const FstReadOptions opts("ConstFstView");
+  FstHeader hdr;
+  if (!this->ReadHeader(strm, opts, kMinFileVersion, &hdr)) return false;
+  SetProperties(Properties() | kExpanded);
+  start_ = hdr.Start();
+  nstates_ = hdr.NumStates();
+  narcs_ = hdr.NumArcs();
+  const bool aligned = hdr.Version() == kAlignedFileVersion ||
+                       (hdr.GetFlags() & FstHeader::IS_ALIGNED);
+  return MapRegion(data, size, strm, nstates_, aligned, &states_,
+                   &states_copy_) &&
+         MapRegion(data, size, strm, narcs_, aligned, &arcs_, &arcs_copy_);
+}
+
+template <class Arc>
+template <class T>
+bool ConstFstViewImpl<Arc>::MapRegion(const char *data, size_t size,
+                                      std::istream &strm, size_t count,
+                                      bool aligned, const T **array,
+                                      std::vector<T> *copy) {
+  if (aligned && !AlignInput(strm)) {
+    LOG(ERROR) << "ConstFstView: Could not align input";
+    return false;
+  }
+  const auto pos = static_cast<size_t>(strm.tellg());
+  if (!strm || count > (size - pos) / sizeof(T)) {
+    LOG(ERROR) << "ConstFstView: Image is truncated";
+    return false;
+  }
+  const char *begin = data + pos;
+  if (reinterpret_cast<uintptr_t>(begin) % alignof(T) == 0) {
+    *array = reinterpret_cast<const T *>(begin);
+  } else {
+    copy->resize(count);
+    std::memcpy(copy->data(), begin, count * sizeof(T));
+    *array = copy->data();
+  }
+  strm.seekg(count * sizeof(T), std::ios_base::cur);
+  return true;
+}
+
+}  // namespace internal
+
+// An immutable FST over a borrowed ConstFst image, such as one written to a
+// shared memory segment or received as a pickle buffer, which is used in place
+// rather than copied; the memory must outlive the FST and all its copies.
+// Only images of ConstFst<Arc>, with 32-bit offsets, are supported. Images
+// should be aligned (e.g., written with --fst_align, or by
+// WriteConstFstImage), and placed at aligned addresses; otherwise, the arrays
+// are copied. The FST behaves like, and is written as, the ConstFst.
+template <class A>
+class ConstFstView : public ImplToExpandedFst<internal::ConstFstViewImpl<A>> {
+ public:
+  using Arc = A;
+  using StateId = typename Arc::StateId;
+  using Impl = internal::ConstFstViewImpl<Arc>;
+
+  ConstFstView(const char *data, size_t size)
+      : ImplToExpandedFst<Impl>(std::make_shared<Impl>(data, size)) {}
+
+  // The implementation only points into the borrowed image, and any arrays
+  // copied for alignment are never written after construction, so even
+  // thread-safe copies share it.
+  ConstFstView(const ConstFstView<Arc> &fst, bool safe = false)
+      : ImplToExpandedFst<Impl>(fst.GetSharedImpl()) {}
+
+  // Gets a copy of this ConstFstView. See Fst<>::Copy() for further doc.
+  ConstFstView *Copy(bool safe = false) const override {
+    return new ConstFstView<Arc>(*this, safe);
+  }
+
+  bool Write(std::ostream &strm, const FstWriteOptions &opts) const override {
+    return ConstFst<Arc>::WriteFst(*this, strm, opts);
+  }
+
+  bool Write(const std::string &source) const override {
+    return Fst<Arc>::WriteFile(source);
+  }
+
+  void InitStateIterator(StateIteratorData<Arc> *data) const override {
+    GetImpl()->InitStateIterator(data);
+  }
+
+  void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const override {
+    GetImpl()->InitArcIterator(s, data);
+  }
+
+ private:
+  using ImplToFst<Impl, ExpandedFst<Arc>>::GetImpl;
+  using ImplToFst<Impl, ExpandedFst<Arc>>::GetSharedImpl;
+
+  ConstFstView &operator=(const ConstFstView &) = delete;
+};
+
+}  // namespace fst
+
+#endif  // PYNINI_CONST_FST_VIEW_H_
@@ -0,0 +1,59 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "constfstviewscript.h"
+
+#include <istream>
+#include <sstream>
+
+#include <fst/log.h>
+#include <fst/fst.h>
+#include <fst/script/fst-class.h>
+#include <fst/script/script-impl.h>
+
+namespace fst {
+namespace script {
+
+FstClass *ViewConstFst(const char *data, size_t size) {
+  internal::MemoryStreamBuf buf(data, size);
+  std::istream strm(&buf);
+  FstHeader hdr;
+  if (!hdr.Read(strm, "ViewConstFst")) return nullptr;
+  ViewConstFstInnerArgs iargs(data, size);
+  ViewConstFstArgs args(iargs);
+  args.retval = nullptr;
+  Apply<Operation<ViewConstFstArgs>>("ViewConstFst", hdr.ArcType(), &args);
+  return args.retval;
+}
+
+bool WriteConstFstImage(const FstClass &fst, std::string *image) {
+  if (fst.FstType() != "const") {
+    LOG(ERROR) << "WriteConstFstImage: FST type " << fst.FstType()
+               << " is not const";
+    return false;
+  }
+  std::ostringstream strm;
+  const FstWriteOptions opts("WriteConstFstImage", /*write_header=*/true,
+                             /*write_isymbols=*/true, /*write_osymbols=*/true,
+                             /*align=*/true);
+  if (!fst.Write(strm, opts)) return false;
+  *image = strm.str();
+  return true;
+}
+
+REGISTER_FST_OPERATION_3ARCS(ViewConstFst, ViewConstFstArgs);
+
+}  // namespace script
+}  // namespace fst
@@ -0,0 +1,52 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_CONSTFSTVIEWSCRIPT_H_
+#define PYNINI_CONSTFSTVIEWSCRIPT_H_
+
+#include <cstddef>
+#include <string>
+#include <tuple>
+
+#include <fst/script/arg-packs.h>
+#include <fst/script/fst-class.h>
+#include "const-fst-view.h"
+
+namespace fst {
+namespace script {
+
+using ViewConstFstInnerArgs = std::tuple<const char *, size_t>;
+
+using ViewConstFstArgs = WithReturnValue<FstClass *, ViewConstFstInnerArgs>;
+
+template <class Arc>
+void ViewConstFst(ViewConstFstArgs *args) {
+  const ConstFstView<Arc> fst(std::get<0>(args->args), std::get<1>(args->args));
+  args->retval = fst.Properties(kError, false) ? nullptr : new FstClass(fst);
+}
+
+// Returns an FST over the ConstFst image in the buffer, which must outlive
+// it, or nullptr on error. The arc type is read from the image.
+FstClass *ViewConstFst(const char *data, size_t size);
+
+// Writes an aligned ConstFst image, as read by ViewConstFst, of an FST of
+// type "const".
+bool WriteConstFstImage(const FstClass &fst, std::string *image);
+
+}  // namespace script
+}  // namespace fst
+
+#endif  // PYNINI_CONSTFSTVIEWSCRIPT_H_
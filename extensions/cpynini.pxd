@@ -26,6 +26,8 @@ from libcpp.vector cimport vector
 
 from cintegral_types cimport int32
 from cintegral_types cimport int64
+from cintegral_types cimport uint64
+from cintegral_types cimport uint8
 
 from cpywrapfst cimport ComposeOptions
 from cpywrapfst cimport FstClass
@@ -194,12 +196,52 @@ cdef extern from "cdrewritescript.h" \
                         int64,
                         int64)
 
+  void CDRewriteCompileMany(const vector[const FstClass *] &,
+                            const vector[const FstClass *] &,
+                            const vector[const FstClass *] &,
+                            const FstClass &,
+                            const vector[MutableFstClass *] &,
+                            CDRewriteDirection,
+                            CDRewriteMode,
+                            int64,
+                            int64,
+                            int)
+
+  unique_ptr[FstClass] CDRewriteCompileDelayed(const FstClass &,
+                                               const FstClass &,
+                                               const FstClass &,
+                                               const FstClass &,
+                                               CDRewriteDirection,
+                                               CDRewriteMode,
+                                               int64,
+                                               int64,
+                                               size_t)
+
+  unique_ptr[FstClass] CDRewriteCompileLabelClass(const FstClass &,
+                                                  const FstClass &,
+                                                  const FstClass &,
+                                                  const FstClass &,
+                                                  CDRewriteDirection,
+                                                  CDRewriteMode,
+                                                  int64,
+                                                  int64)
+
 
 cdef extern from "concatrangescript.h" \
     namespace "fst::script" nogil:
 
   void ConcatRange(MutableFstClass *, int32, int32)
 
+  unique_ptr[FstClass] ConcatRangeDelayed(const FstClass &, int32, int32)
+
+
+cdef extern from "constfstviewscript.h" \
+    namespace "fst::script" nogil:
+
+  FstClass *ViewConstFst(const char *, size_t)
+
+  bool WriteConstFstImage(const FstClass &, string *)
+
 
 cdef extern from "getters.h" \
     namespace "fst::script" nogil:
@@ -214,6 +256,8 @@ cdef extern from "crossscript.h" \
 
   void Cross(const FstClass &, const FstClass &, MutableFstClass *)
 
+  unique_ptr[FstClass] CrossDelayed(const FstClass &, const FstClass &)
+
 cdef extern from "lenientlycomposescript.h" \
     namespace "fst::script" nogil:
 
@@ -223,11 +267,106 @@ cdef extern from "lenientlycomposescript.h" \
                         MutableFstClass *,
                         const ComposeOptions &)
 
+  cdef cppclass LenientComposerClass:
+
+    LenientComposerClass(const FstClass &,
+                         const FstClass &,
+                         const ComposeOptions &)
+
+    const string &ArcType()
+
+    bool Error()
+
+    bool Compose(const FstClass &, MutableFstClass *)
+
+    unique_ptr[FstClass] ComposeDelayed(const FstClass &)
+
+
+cdef extern from "levenshteinautomatonscript.h" \
+    namespace "fst::script" nogil:
+
+  cdef cppclass LevenshteinAutomatonClass:
+
+    LevenshteinAutomatonClass(const FstClass &,
+                              const FstClass &,
+                              double,
+                              double,
+                              double,
+                              int32)
+
+    const string &ArcType()
+
+    bool Error()
+
+    bool ClosestMatches(const FstClass &,
+                        int32,
+                        bool,
+                        vector[string] *,
+                        vector[double] *,
+                        TokenType,
+                        const SymbolTable *)
+
+
+cdef extern from "memorymap.h" \
+    namespace "fst" nogil:
+
+  cdef cppclass ScopedFstMemoryMap:
+
+    ScopedFstMemoryMap()
+
+
+cdef extern from "memoryusage.h" \
+    namespace "fst" nogil:
+
+  cdef cppclass MemoryStats:
+
+    size_t states
+    size_t arcs
+    size_t symbols
+    size_t caches
+
+    size_t Total()
+
+
+cdef extern from "memoryusagescript.h" \
+    namespace "fst::script" nogil:
+
+  MemoryStats MemoryUsage(const FstClass &)
+
+
+cdef extern from "optimize.h" \
+    namespace "fst" nogil:
+
+  cdef cppclass OptimizePhaseStats:
+
+    string name
+    double seconds
+    int64 input_states
+    int64 input_arcs
+    int64 output_states
+    int64 output_arcs
+
+  cdef cppclass OptimizeStats:
+
+    bool acceptor
+    bool determinized
+    uint8 encode_flags
+    bool limit_exceeded
+    vector[OptimizePhaseStats] phases
+
+  cdef cppclass OptimizeLimits:
+
+    int64 max_determinized_states
+    int64 max_determinized_bytes
+
 
 cdef extern from "optimizescript.h" \
     namespace "fst::script" nogil:
 
-  void Optimize(MutableFstClass *, bool)
+  bool Optimize(MutableFstClass *,
+                bool,
+                OptimizeStats *,
+                const OptimizeLimits &)
 
   void OptimizeAcceptor(MutableFstClass *, bool)
 
@@ -253,6 +392,9 @@ cdef extern from "pathsscript.h" \
 
     bool Error()
 
+    bool Extract(int64, vector[string] *, vector[string] *,
+                 vector[WeightClass] *)
+
     vector[int64] ILabels()
 
     string IString()
@@ -267,6 +409,205 @@ cdef extern from "pathsscript.h" \
 
     WeightClass Weight()
 
+  cdef cppclass ShortestStringIteratorClass:
+
+    ShortestStringIteratorClass(const FstClass &,
+                                TokenType,
+                                const SymbolTable *)
+
+    bool Done()
+
+    bool Error()
+
+    void Next()
+
+    bool String(string *)
+
+    WeightClass Weight()
+
+
+cdef extern from "rewritestats.h" \
+    namespace "fst" nogil:
+
+  cdef cppclass RewriteStats:
+
+    int64 lattice_states
+    int64 lattice_arcs
+    int64 paths
+    double compose_seconds
+    double dfa_seconds
+    double shortest_path_seconds
+    double print_seconds
+
+    void Clear()
+
+
+cdef extern from "rewritescript.h" \
+    namespace "fst::script" nogil:
+
+  bool StringViewRewriteLattice(const string &,
+                                const FstClass &,
+                                MutableFstClass *,
+                                TokenType)
+
+  bool StringViewTopRewrite(const string &,
+                            const FstClass &,
+                            string *,
+                            TokenType,
+                            TokenType,
+                            const SymbolTable *,
+                            RewriteStats *)
+
+  bool Matches(const FstClass &, const FstClass &, const FstClass &, bool *)
+
+  bool BatchTopRewrite(const vector[string] &,
+                       const FstClass &,
+                       vector[string] *,
+                       TokenType,
+                       const SymbolTable *,
+                       TokenType,
+                       const SymbolTable *,
+                       int)
+
+  bool BatchRewrites(const vector[string] &,
+                     const FstClass &,
+                     vector[vector[string]] *,
+                     TokenType,
+                     const SymbolTable *,
+                     TokenType,
+                     const SymbolTable *,
+                     int,
+                     int32)
+
+  bool BatchOptimalRewrites(const vector[string] &,
+                            const FstClass &,
+                            vector[vector[string]] *,
+                            TokenType,
+                            const SymbolTable *,
+                            TokenType,
+                            const SymbolTable *,
+                            int,
+                            int32)
+
+  bool BatchTopRewrites(const vector[string] &,
+                        const FstClass &,
+                        int32,
+                        vector[vector[string]] *,
+                        TokenType,
+                        const SymbolTable *,
+                        TokenType,
+                        const SymbolTable *,
+                        int)
+
+
+cdef extern from "rewritecache.h" \
+    namespace "fst" nogil:
+
+  cdef cppclass RewriteCacheKey:
+
+    uint64 rule
+    string query
+    int32 nshortest
+    string input
+
+  cdef cppclass RewriteCache:
+
+    RewriteCache(size_t, size_t)
+
+    bool Lookup(const RewriteCacheKey &, vector[string] *)
+
+    void Insert(const RewriteCacheKey &, vector[string])
+
+    void Clear()
+
+    size_t MaxBytes()
+
+    size_t NumShards()
+
+    size_t Size()
+
+    size_t NumBytes()
+
+    uint64 Hits()
+
+    uint64 Misses()
+
+    uint64 Evictions()
+
+
+cdef extern from "rewritecachescript.h" \
+    namespace "fst::script" nogil:
+
+  uint64 FstFingerprint(const FstClass &)
+
+
+cdef extern from "rulecascadescript.h" \
+    namespace "fst::script" nogil:
+
+  cdef cppclass RuleCascadeClass:
+
+    RuleCascadeClass(const vector[const FstClass *] &, bool, bool, size_t)
+
+    const string &ArcType()
+
+    bool Error()
+
+    bool Lazy()
+
+    bool LookAhead()
+
+    bool RewriteLattice(const FstClass &, MutableFstClass *)
+
+    bool TopRewrite(const FstClass &, string *, TokenType, const SymbolTable *)
+
+    bool OneTopRewrite(const FstClass &,
+                       string *,
+                       TokenType,
+                       const SymbolTable *,
+                       int32)
+
+    bool Rewrites(const FstClass &,
+                  vector[string] *,
+                  TokenType,
+                  const SymbolTable *,
+                  int32)
+
+    bool OptimalRewrites(const FstClass &,
+                         vector[string] *,
+                         TokenType,
+                         const SymbolTable *,
+                         int32)
+
+    bool TopRewrites(const FstClass &,
+                     int32,
+                     vector[string] *,
+                     TokenType,
+                     const SymbolTable *)
+
+    bool Matches(const FstClass &, const FstClass &, bool *)
+
+    MemoryStats MemoryUsage()
+
+
+cdef extern from "taggerscript.h" \
+    namespace "fst::script" nogil:
+
+  cdef cppclass TaggerClass:
+
+    TaggerClass(const FstClass &,
+                const FstClass &,
+                const string &,
+                const string &,
+                TokenType)
+
+    const string &ArcType()
+
+    bool Error()
+
+    bool Tag(const string &, string *)
+
+    bool TagIncremental(const string &, bool, string *, string *)
+
 
 cdef extern from "defaults.h" namespace "fst" nogil:
 
@@ -291,7 +632,7 @@ cdef extern from "stringcompile.h" \
   int64 kBosIndex
   int64 kEosIndex
 
-  const SymbolTable &GeneratedSymbols()
+  SymbolTable GeneratedSymbols()
 
 
 cdef extern from "stringcompilescript.h" \
@@ -312,14 +653,18 @@ cdef extern from "stringmapscript.h" \
                          TokenType,
                          TokenType,
                          const SymbolTable *,
-                         const SymbolTable *)
+                         const SymbolTable *,
+                         bool,
+                         int)
 
   bool StringMapCompile(const vector[vector[string]] &,
                         MutableFstClass *,
                         TokenType,
                         TokenType,
                         const SymbolTable *,
-                        const SymbolTable *)
+                        const SymbolTable *,
+                        bool,
+                        int)
 
 
 cdef extern from "stringprintscript.h" \
@@ -17,13 +17,84 @@
 #ifndef PYNINI_CROSS_H_
 #define PYNINI_CROSS_H_
 
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
 #include <fst/arc-map.h>
+#include <fst/cache.h>
 #include <fst/compose.h>
+#include <fst/expanded-fst.h>
 #include <fst/fst.h>
 #include <fst/mutable-fst.h>
 #include <fst/rmepsilon.h>
+#include <fst/vector-fst.h>
 
 namespace fst {
+namespace internal {
+
+// If the FST is an expanded string FST (i.e., it has a single path, possibly
+// with epsilons), returns true and appends the non-epsilon input (or, if
+// `output` is true, output) labels of that path and its weight; otherwise,
+// returns false. This gives up at the first state that shows otherwise, so it
+// is cheap for non-strings.
+template <class Arc>
+bool GetStringLabels(const Fst<Arc> &fst, bool output,
+                     std::vector<typename Arc::Label> *labels,
+                     typename Arc::Weight *weight) {
+  using Weight = typename Arc::Weight;
+  if (fst.Properties(kExpanded, false) != kExpanded) return false;
+  // Bounds the walk, so that a cyclic "string" is rejected.
+  const auto num_states =
+      static_cast<const ExpandedFst<Arc> &>(fst).NumStates();
+  auto state = fst.Start();
+  if (state == kNoStateId) return false;
+  *weight = Weight::One();
+  for (decltype(state) steps = 0; steps < num_states; ++steps) {
+    const auto num_arcs = fst.NumArcs(state);
+    const auto final_weight = fst.Final(state);
+    if (num_arcs == 0) {
+      if (final_weight == Weight::Zero()) return false;
+      *weight = Times(*weight, final_weight);
+      return true;
+    }
+    if (num_arcs > 1 || final_weight != Weight::Zero()) return false;
+    ArcIterator<Fst<Arc>> aiter(fst, state);
+    const auto &arc = aiter.Value();
+    const auto label = output ? arc.olabel : arc.ilabel;
+    if (label != 0) labels->push_back(label);
+    *weight = Times(*weight, arc.weight);
+    state = arc.nextstate;
+  }
+  return false;
+}
+
+// Writes the cross-product of two strings as a single path, pairing their
+// labels in order and padding the shorter with epsilons; the path weight is
+// the product of the strings' weights.
+template <class Arc>
+void StringCross(const std::vector<typename Arc::Label> &labels1,
+                 const typename Arc::Weight &weight1,
+                 const std::vector<typename Arc::Label> &labels2,
+                 const typename Arc::Weight &weight2, MutableFst<Arc> *ofst) {
+  using Weight = typename Arc::Weight;
+  ofst->DeleteStates();
+  const size_t size = std::max(labels1.size(), labels2.size());
+  ofst->ReserveStates(size + 1);
+  auto state = ofst->AddState();
+  ofst->SetStart(state);
+  for (size_t i = 0; i < size; ++i) {
+    const auto nextstate = ofst->AddState();
+    ofst->AddArc(state, Arc(i < labels1.size() ? labels1[i] : 0,
+                            i < labels2.size() ? labels2[i] : 0,
+                            Weight::One(), nextstate));
+    state = nextstate;
+  }
+  ofst->SetFinal(state, Times(weight1, weight2));
+}
+
+}  // namespace internal
 
 // This function combines two acceptors into a cross-product transducer; that
 // if U accepts V_U and L accepts V_L, then their cross-product U x L accepts
@@ -32,9 +103,23 @@ namespace fst {
 // had already been projected onto its input, and if called with a transducer
 // for the second argument (the lower language), it will act as if it had
 // already been projected onto its output.
+//
+// If both arguments are strings, the cross-product is written out directly as
+// a single path, without composition.
 template <class Arc>
 void Cross(const Fst<Arc> &ifst1, const Fst<Arc> &ifst2,
            MutableFst<Arc> *ofst) {
+  std::vector<typename Arc::Label> labels1;
+  std::vector<typename Arc::Label> labels2;
+  typename Arc::Weight weight1;
+  typename Arc::Weight weight2;
+  if (internal::GetStringLabels(ifst1, /*output=*/false, &labels1, &weight1) &&
+      internal::GetStringLabels(ifst2, /*output=*/true, &labels2, &weight2)) {
+    internal::StringCross(labels1, weight1, labels2, weight2, ofst);
+    ofst->SetInputSymbols(ifst1.InputSymbols());
+    ofst->SetOutputSymbols(ifst2.OutputSymbols());
+    return;
+  }
   static const ComposeOptions opts(/*connect=*/true,
                                    /*filter_type=*/MATCH_FILTER);
   static const OutputEpsilonMapper<Arc> oeps;
@@ -46,6 +131,36 @@ void Cross(const Fst<Arc> &ifst1, const Fst<Arc> &ifst2,
   ofst->SetOutputSymbols(ifst2.OutputSymbols());
 }
 
+// As above, but returns the cross-product as a delayed composition, with the
+// given cache options, so that only the part of it which is visited is ever
+// expanded. Unlike Cross, the result is not connected. As above, the
+// cross-product of two strings is written out directly (and eagerly), since
+// it is no larger than its arguments.
+template <class Arc>
+std::unique_ptr<Fst<Arc>> CrossDelayed(
+    const Fst<Arc> &ifst1, const Fst<Arc> &ifst2,
+    const CacheOptions &opts = CacheOptions()) {
+  std::vector<typename Arc::Label> labels1;
+  std::vector<typename Arc::Label> labels2;
+  typename Arc::Weight weight1;
+  typename Arc::Weight weight2;
+  if (internal::GetStringLabels(ifst1, /*output=*/false, &labels1, &weight1) &&
+      internal::GetStringLabels(ifst2, /*output=*/true, &labels2, &weight2)) {
+    auto ofst = std::make_unique<VectorFst<Arc>>();
+    internal::StringCross(labels1, weight1, labels2, weight2, ofst.get());
+    ofst->SetInputSymbols(ifst1.InputSymbols());
+    ofst->SetOutputSymbols(ifst2.OutputSymbols());
+    return ofst;
+  }
+  using M = Matcher<Fst<Arc>>;
+  const ComposeFstOptions<Arc, M, MatchComposeFilter<M>> copts(opts);
+  static const OutputEpsilonMapper<Arc> oeps;
+  static const InputEpsilonMapper<Arc> ieps;
+  return std::make_unique<ComposeFst<Arc>>(
+      RmEpsilonFst<Arc>(MakeArcMapFst(ifst1, oeps)),
+      RmEpsilonFst<Arc>(MakeArcMapFst(ifst2, ieps)), copts);
+}
+
 }  // namespace fst
 
 #endif  // PYNINI_CROSS_H_
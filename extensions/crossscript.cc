@@ -16,6 +16,9 @@
 
 #include "crossscript.h"
 
+#include <memory>
+#include <utility>
+
 #include <fst/script/fst-class.h>
 #include <fst/script/script-impl.h>
 
@@ -33,7 +36,17 @@ void Cross(const FstClass &ifst1, const FstClass &ifst2,
   Apply<Operation<CrossArgs>>("Cross", ofst->ArcType(), &args);
 }
 
+std::unique_ptr<FstClass> CrossDelayed(const FstClass &ifst1,
+                                       const FstClass &ifst2) {
+  if (!internal::ArcTypesMatch(ifst1, ifst2, "CrossDelayed")) return nullptr;
+  CrossDelayedInnerArgs iargs(ifst1, ifst2);
+  CrossDelayedArgs args(iargs);
+  Apply<Operation<CrossDelayedArgs>>("CrossDelayed", ifst1.ArcType(), &args);
+  return std::move(args.retval);
+}
+
 REGISTER_FST_OPERATION_3ARCS(Cross, CrossArgs);
+REGISTER_FST_OPERATION_3ARCS(CrossDelayed, CrossDelayedArgs);
 
 }  // namespace script
 }  // namespace fst
@@ -17,8 +17,10 @@
 #ifndef PYNINI_CROSSSCRIPT_H_
 #define PYNINI_CROSSSCRIPT_H_
 
+#include <memory>
 #include <utility>
 
+#include <fst/script/arg-packs.h>
 #include <fst/script/fst-class.h>
 #include "cross.h"
 
@@ -38,6 +40,23 @@ void Cross(CrossArgs *args) {
 
 void Cross(const FstClass &ifst1, const FstClass &ifst2, MutableFstClass *ofst);
 
+using CrossDelayedInnerArgs = std::tuple<const FstClass &, const FstClass &>;
+
+using CrossDelayedArgs =
+    WithReturnValue<std::unique_ptr<FstClass>, CrossDelayedInnerArgs>;
+
+template <class Arc>
+void CrossDelayed(CrossDelayedArgs *args) {
+  const Fst<Arc> &ifst1 = *(std::get<0>(args->args).GetFst<Arc>());
+  const Fst<Arc> &ifst2 = *(std::get<1>(args->args).GetFst<Arc>());
+  const auto fst = CrossDelayed(ifst1, ifst2);
+  args->retval = std::make_unique<FstClass>(*fst);
+}
+
+// Returns nullptr if the arc types of the arguments do not match.
+std::unique_ptr<FstClass> CrossDelayed(const FstClass &ifst1,
+                                       const FstClass &ifst2);
+
 }  // namespace script
 }  // namespace fst
 
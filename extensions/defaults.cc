@@ -22,8 +22,8 @@ namespace fst {
 namespace internal {
 
 StringDefaultsStack *StringDefaultsStack::Get() {
-  static auto *kInstance = new StringDefaultsStack();
-  return kInstance;
+  static thread_local StringDefaultsStack kInstance;
+  return &kInstance;
 }
 
 TokenType StringDefaultsStack::GetTokenType() const {
@@ -46,24 +46,23 @@ void StringDefaultsStack::Pop() { stack_.pop(); }
 
 }  // namespace internal
 
+// These look up the stack on each call, rather than caching it in a local
+// static, since the stack differs per thread.
+
 TokenType GetDefaultTokenType() {
-  static const auto *stack = internal::StringDefaultsStack::Get();
-  return stack->GetTokenType();
+  return internal::StringDefaultsStack::Get()->GetTokenType();
 }
 
 const SymbolTable *GetDefaultSymbols() {
-  static const auto *stack = internal::StringDefaultsStack::Get();
-  return stack->GetSymbols();
+  return internal::StringDefaultsStack::Get()->GetSymbols();
 }
 
 void PushDefaults(TokenType token_type, const SymbolTable *symbols) {
-  static auto *stack = internal::StringDefaultsStack::Get();
-  stack->Push(token_type, symbols);
+  internal::StringDefaultsStack::Get()->Push(token_type, symbols);
 }
 
 void PopDefaults() {
-  static auto *stack = internal::StringDefaultsStack::Get();
-  stack->Pop();
+  internal::StringDefaultsStack::Get()->Pop();
 }
 
 }  // namespace fst
@@ -17,8 +17,8 @@
 #ifndef PYNINI_DEFAULTS_H_
 #define PYNINI_DEFAULTS_H_
 
-// This module defines a singleton class which stores defaults for string
-// compilation.
+// This module defines a per-thread singleton class which stores defaults for
+// string compilation.
 
 #include <memory>
 #include <stack>
@@ -35,8 +35,14 @@ namespace internal {
 // a TokenType and an owned SymbolTable (or null). At creation, the stack is
 // initialized to {BYTE, nullptr}. Getter methods return the values at the
 // top of the stack.
+//
+// Each thread has its own stack, so threads can compile strings under
+// different defaults without synchronization; a new thread always starts with
+// the initial defaults. Pointers returned by `Get` and `GetSymbols` must not be
+// used by other threads.
 class StringDefaultsStack {
  public:
+  // Returns the calling thread's stack.
   static StringDefaultsStack *Get();
 
   // Returns the token type at the top of the stack.
@@ -66,6 +72,7 @@ class StringDefaultsStack {
 }  // namespace internal
 
 // Convenience methods, to eliminate the need to call Get on the singleton.
+// These all operate on the calling thread's stack.
 
 TokenType GetDefaultTokenType();
 
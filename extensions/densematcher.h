@@ -0,0 +1,372 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_DENSEMATCHER_H_
+#define PYNINI_DENSEMATCHER_H_
+
+// Direct-indexed matching for rules with high-fanout states.
+//
+// Composing a string with a rule spends most of its time finding, at each
+// state of the rule, the arcs matching the next input label; the default
+// SortedMatcher does so by binary search. The states of a byte or UTF-8 rule
+// which have many arcs (notably the sigma-star states of context-dependent
+// rewrite rules) tend to have labels drawn from a small range, so this
+// instead precomputes, for each such state, a table mapping each label in the
+// range directly to the position of the first arc with that label. The
+// tables are built once, when the rule is wrapped in a DenseMatcherFst; since
+// composition obtains its matchers from the FSTs being composed, every
+// rewrite function then uses them without further changes.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <fst/types.h>
+#include <fst/log.h>
+#include <fst/fst.h>
+#include <fst/matcher.h>
+#include <fst/properties.h>
+#include <fst/vector-fst.h>
+
+namespace fst {
+
+// For each state of an FST sorted on the given side with at least kMinArcs
+// arcs, and whose non-epsilon labels span a range of at most max(256, 4 *
+// the number of arcs) labels, stores the position of the first arc with each
+// label in the range. If the FST is not sorted, there are no tables.
+template <class Arc>
+class DenseMatcherTables {
+ public:
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+
+  static constexpr size_t kMinArcs = 8;
+
+  // The position of the first arc with each label, from first_label onwards;
+  // -1 where there is none.
+  struct Table {
+    Label first_label;
+    std::vector<int32_t> positions;
+  };
+
+  DenseMatcherTables(const ExpandedFst<Arc> &fst, MatchType match_type)
+      : tables_(fst.NumStates()) {
+    const auto sorted =
+        match_type == MATCH_INPUT ? kILabelSorted : kOLabelSorted;
+    if (!fst.Properties(sorted, true)) return;
+    std::vector<Label> labels;
+    for (StateId s = 0; s < fst.NumStates(); ++s) {
+      const auto narcs = fst.NumArcs(s);
+      if (narcs < kMinArcs ||
+          narcs > std::numeric_limits<int32_t>::max()) {
+        continue;
+      }
+      labels.clear();
+      for (ArcIterator<Fst<Arc>> aiter(fst, s); !aiter.Done(); aiter.Next()) {
+        const auto &arc = aiter.Value();
+        labels.push_back(match_type == MATCH_INPUT ? arc.ilabel : arc.olabel);
+      }
+      // Epsilons sort first, and are left to binary search.
+      const auto begin = std::upper_bound(labels.begin(), labels.end(), 0);
+      if (begin == labels.end()) continue;
+      const auto range =
+          static_cast<uint64_t>(labels.back()) - *begin + 1;
+      if (range > std::max<uint64_t>(256, 4 * narcs)) continue;
+      auto table = std::make_unique<Table>();
+      table->first_label = *begin;
+      table->positions.assign(range, -1);
+      for (auto it = labels.end(); it != begin; --it) {
+        table->positions[*(it - 1) - table->first_label] =
+            static_cast<int32_t>((it - 1) - labels.begin());
+      }
+      tables_[s] = std::move(table);
+    }
+  }
+
+  // Returns the table for the state, or nullptr if it has none.
+  const Table *Find(StateId s) const {
+    return s >= 0 && static_cast<size_t>(s) < tables_.size()
+               ? tables_[s].get()
+               : nullptr;
+  }
+
+ private:
+  std::vector<std::unique_ptr<const Table>> tables_;
+
+  DenseMatcherTables(const DenseMatcherTables &) = delete;
+  DenseMatcherTables &operator=(const DenseMatcherTables &) = delete;
+};
+
+// A matcher with the same semantics as SortedMatcher, which uses the tables
+// where available and binary search elsewhere. The FST must be sorted on the
+// matched side.
+template <class A>
+class DenseMatcher : public MatcherBase<A> {
+ public:
+  using Arc = A;
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+  using Tables = DenseMatcherTables<Arc>;
+
+  DenseMatcher(std::shared_ptr<const ExpandedFst<Arc>> fst,
+               MatchType match_type, std::shared_ptr<const Tables> tables)
+      : fst_(std::move(fst)),
+        tables_(std::move(tables)),
+        match_type_(match_type),
+        loop_(kNoLabel, 0, Weight::One(), kNoStateId) {
+    switch (match_type_) {
+      case MATCH_INPUT:
+      case MATCH_NONE:
+        break;
+      case MATCH_OUTPUT:
+        std::swap(loop_.ilabel, loop_.olabel);
+        break;
+      default:
+        FSTERROR() << "DenseMatcher: Bad match type";
+        match_type_ = MATCH_NONE;
+        error_ = true;
+    }
+  }
+
+  DenseMatcher(const DenseMatcher &matcher, bool safe = false)
+      : fst_(matcher.fst_),
+        tables_(matcher.tables_),
+        match_type_(matcher.match_type_),
+        loop_(matcher.loop_),
+        error_(matcher.error_) {}
+
+  DenseMatcher *Copy(bool safe = false) const override {
+    return new DenseMatcher(*this, safe);
+  }
+
+  MatchType Type(bool test) const override {
+    if (match_type_ == MATCH_NONE) return match_type_;
+    const auto true_prop =
+        match_type_ == MATCH_INPUT ? kILabelSorted : kOLabelSorted;
+    const auto false_prop =
+        match_type_ == MATCH_INPUT ? kNotILabelSorted : kNotOLabelSorted;
+    const auto props = fst_->Properties(true_prop | false_prop, test);
+    if (props & true_prop) return match_type_;
+    return props & false_prop ? MATCH_NONE : MATCH_UNKNOWN;
+  }
+
+  void SetState(StateId s) final {
+    if (state_ == s) return;
+    state_ = s;
+    if (match_type_ == MATCH_NONE) {
+      FSTERROR() << "DenseMatcher: Bad match type";
+      error_ = true;
+    }
+    aiter_.emplace(*fst_, s);
+    aiter_->SetFlags(kArcNoCache, kArcNoCache);
+    narcs_ = fst_->NumArcs(s);
+    table_ = tables_->Find(s);
+    loop_.nextstate = s;
+  }
+
+  bool Find(Label match_label) final {
+    if (error_) {
+      current_loop_ = false;
+      match_label_ = kNoLabel;
+      return false;
+    }
+    current_loop_ = match_label == 0;
+    match_label_ = match_label == kNoLabel ? 0 : match_label;
+    return Search() || current_loop_;
+  }
+
+  bool Done() const final {
+    if (current_loop_) return false;
+    if (aiter_->Done()) return true;
+    aiter_->SetFlags(LabelFlags(), kArcValueFlags);
+    return GetLabel() != match_label_;
+  }
+
+  const Arc &Value() const final {
+    if (current_loop_) return loop_;
+    aiter_->SetFlags(kArcValueFlags, kArcValueFlags);
+    return aiter_->Value();
+  }
+
+  void Next() final {
+    if (current_loop_) {
+      current_loop_ = false;
+    } else {
+      aiter_->Next();
+    }
+  }
+
+  Weight Final(StateId s) const final { return fst_->Final(s); }
+
+  ssize_t Priority(StateId s) final { return fst_->NumArcs(s); }
+
+  const Fst<Arc> &GetFst() const override { return *fst_; }
+
+  uint64_t Properties(uint64_t inprops) const override {
+    return inprops | (error_ ? kError : 0);
+  }
+
+ private:
+  uint8_t LabelFlags() const {
+    return match_type_ == MATCH_INPUT ? kArcILabelValue : kArcOLabelValue;
+  }
+
+  Label GetLabel() const {
+    const auto &arc = aiter_->Value();
+    return match_type_ == MATCH_INPUT ? arc.ilabel : arc.olabel;
+  }
+
+  // Positions the arc iterator at the first arc with the match label, if
+  // any, returning whether there is one.
+  bool Search() {
+    aiter_->SetFlags(LabelFlags(), kArcValueFlags);
+    if (table_ && match_label_ > 0) {
+      const auto offset =
+          static_cast<uint64_t>(match_label_) - table_->first_label;
+      if (match_label_ >= table_->first_label &&
+          offset < table_->positions.size() &&
+          table_->positions[offset] >= 0) {
+        aiter_->Seek(table_->positions[offset]);
+        return true;
+      }
+      aiter_->Seek(narcs_);
+      return false;
+    }
+    size_t low = 0;
+    size_t high = narcs_;
+    while (low < high) {
+      const auto mid = low + (high - low) / 2;
+      aiter_->Seek(mid);
+      if (GetLabel() < match_label_) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    aiter_->Seek(low);
+    return low < narcs_ && GetLabel() == match_label_;
+  }
+
+  std::shared_ptr<const ExpandedFst<Arc>> fst_;
+  std::shared_ptr<const Tables> tables_;
+  StateId state_ = kNoStateId;
+  mutable std::optional<ArcIterator<Fst<Arc>>> aiter_;
+  MatchType match_type_;
+  Label match_label_ = kNoLabel;
+  size_t narcs_ = 0;
+  const typename Tables::Table *table_ = nullptr;
+  Arc loop_;
+  bool current_loop_ = false;
+  bool error_ = false;
+};
+
+// Wraps an FST, behaving exactly like it except that composition matching on
+// its input labels uses a DenseMatcher, with tables built at construction.
+// The FST is copied (cheaply, for most FST types) or, if it is not expanded,
+// converted to a VectorFst; it should be input-label-sorted. Type and Write
+// are those of the wrapped FST, so the tables are never stored.
+template <class A>
+class DenseMatcherFst : public ExpandedFst<A> {
+ public:
+  using Arc = A;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+  using Tables = DenseMatcherTables<Arc>;
+
+  explicit DenseMatcherFst(const Fst<Arc> &fst)
+      : fst_(fst.Properties(kExpanded, false)
+                 ? static_cast<const ExpandedFst<Arc> *>(fst.Copy())
+                 : new VectorFst<Arc>(fst)),
+        tables_(std::make_shared<const Tables>(*fst_, MATCH_INPUT)) {}
+
+  // Copies share the tables.
+  DenseMatcherFst(const DenseMatcherFst &fst, bool safe = false)
+      : fst_(safe ? std::shared_ptr<const ExpandedFst<Arc>>(fst.fst_->Copy(true))
+                  : fst.fst_),
+        tables_(fst.tables_) {}
+
+  StateId Start() const override { return fst_->Start(); }
+
+  Weight Final(StateId s) const override { return fst_->Final(s); }
+
+  size_t NumArcs(StateId s) const override { return fst_->NumArcs(s); }
+
+  size_t NumInputEpsilons(StateId s) const override {
+    return fst_->NumInputEpsilons(s);
+  }
+
+  size_t NumOutputEpsilons(StateId s) const override {
+    return fst_->NumOutputEpsilons(s);
+  }
+
+  StateId NumStates() const override { return fst_->NumStates(); }
+
+  // The wrapper is never mutable, even if the wrapped FST is.
+  uint64_t Properties(uint64_t mask, bool test) const override {
+    return fst_->Properties(mask, test) & ~kMutable;
+  }
+
+  const std::string &Type() const override { return fst_->Type(); }
+
+  DenseMatcherFst *Copy(bool safe = false) const override {
+    return new DenseMatcherFst(*this, safe);
+  }
+
+  const SymbolTable *InputSymbols() const override {
+    return fst_->InputSymbols();
+  }
+
+  const SymbolTable *OutputSymbols() const override {
+    return fst_->OutputSymbols();
+  }
+
+  bool Write(std::ostream &strm, const FstWriteOptions &opts) const override {
+    return fst_->Write(strm, opts);
+  }
+
+  bool Write(const std::string &source) const override {
+    return fst_->Write(source);
+  }
+
+  void InitStateIterator(StateIteratorData<Arc> *data) const override {
+    fst_->InitStateIterator(data);
+  }
+
+  void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const override {
+    fst_->InitArcIterator(s, data);
+  }
+
+  MatcherBase<Arc> *InitMatcher(MatchType match_type) const override {
+    if (match_type != MATCH_INPUT) return fst_->InitMatcher(match_type);
+    return new DenseMatcher<Arc>(fst_, match_type, tables_);
+  }
+
+ private:
+  std::shared_ptr<const ExpandedFst<Arc>> fst_;
+  std::shared_ptr<const Tables> tables_;
+
+  DenseMatcherFst &operator=(const DenseMatcherFst &) = delete;
+};
+
+}  // namespace fst
+
+#endif  // PYNINI_DENSEMATCHER_H_
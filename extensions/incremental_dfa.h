@@ -0,0 +1,352 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_INCREMENTAL_DFA_H_
+#define PYNINI_INCREMENTAL_DFA_H_
+
+// Incremental construction of minimal acyclic automata from sorted lists of
+// strings, as described in:
+//
+// Daciuk, J., Mihov, S., Watson, B. W., and Watson, R. E. 2000. Incremental
+// construction of minimal acyclic finite-state automata. Computational
+// Linguistics 26(1): 3-16.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <fst/log.h>
+#include <fst/arc.h>
+#include <fst/mutable-fst.h>
+#include <fst/compat.h>
+
+namespace fst {
+namespace internal {
+
+// Builds the minimal acyclic automaton for a lexicographically sorted sequence
+// of entries, each of which consists of two label sequences and a weight, as
+// accepted by the prefix trees in prefix_tree.h. Each entry is added as a path
+// of input arcs, followed, unless kAcceptor is true, by an epsilon "bridge"
+// arc and a path of output arcs, ending in a final state; this is the same
+// path as in the corresponding prefix tree, so the result is equivalent to
+// that tree once it is minimized. For sorted input, only the path of the most
+// recent entry is ever modified, so states are merged with their registered
+// equivalents as soon as that path moves on, and memory use is bounded by the
+// size of the minimal automaton rather than that of the tree.
+//
+// Entries must be added in lexicographic order of their input labels and, for
+// entries with identical input labels, of their output labels; adjacent
+// duplicates have their weights summed. If an entry is added out of order,
+// Sorted() becomes false and all further entries are ignored; callers should
+// then fall back to a prefix tree.
+//
+// Only the final weights distinguish states; weights are not pushed, so the
+// result is minimal as an unweighted automaton over (label, final weight)
+// pairs.
+//
+// This class is neither thread-safe nor thread-hostile.
+template <class Arc, bool kAcceptor>
+class IncrementalMinimalDfa {
+ public:
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+
+  IncrementalMinimalDfa()
+      : register_(0, StateHash(this), StateEqual(this)), sorted_(true) {
+    offsets_.push_back(0);
+  }
+
+  // The number of states registered so far; this does not include the states
+  // along the path of the most recent entry.
+  StateId NumStates() const { return final_.size(); }
+
+  bool Sorted() const { return sorted_; }
+
+  // Add an entry, consisting of two label sequences and a weight. Each label
+  // sequence must be provided as a pair of iterators.
+  template <class Iterator1, class Iterator2, class T>
+  void Add(Iterator1 it1, Iterator1 end1, Iterator2 it2, Iterator2 end2,
+           T &&weight) {
+    if (!sorted_) return;
+    next_.clear();
+    for (Label ilabel : fst::make_range(it1, end1)) {
+      if (!ilabel) continue;  // Skips over epsilons.
+      next_.push_back({ilabel, INPUT});
+    }
+    if constexpr (!kAcceptor) {
+      next_.push_back({0, BRIDGE});
+      for (Label olabel : fst::make_range(it2, end2)) {
+        if (!olabel) continue;  // Skips over epsilons.
+        next_.push_back({olabel, OUTPUT});
+      }
+    }
+    if (path_.empty()) path_.emplace_back();
+    const size_t prefix =
+        std::mismatch(last_.begin(), last_.end(), next_.begin(), next_.end())
+            .first -
+        last_.begin();
+    if (prefix == last_.size() && prefix == next_.size()) {
+      // Duplicates the most recent entry.
+      auto &state = path_[prefix];
+      state.final = true;
+      state.weight = Plus(state.weight, std::forward<T>(weight));
+      return;
+    }
+    if (prefix < last_.size() &&
+        (prefix == next_.size() || next_[prefix] < last_[prefix])) {
+      sorted_ = false;
+      return;
+    }
+    RegisterPath(prefix);
+    if (path_.size() <= next_.size()) path_.resize(next_.size() + 1);
+    for (auto depth = prefix + 1; depth <= next_.size(); ++depth) {
+      auto &state = path_[depth];
+      state.arcs.clear();
+      state.final = false;
+      state.weight = Weight::Zero();
+      const auto &symbol = next_[depth - 1];
+      path_[depth - 1].arcs.push_back({symbol.label, symbol.side, kNoStateId});
+    }
+    auto &state = path_[next_.size()];
+    state.final = true;
+    state.weight = std::forward<T>(weight);
+    last_.swap(next_);
+  }
+
+  // With semiring One as a default.
+  template <class Iterator1, class Iterator2>
+  void Add(Iterator1 it1, Iterator1 end1, Iterator2 it2, Iterator2 end2) {
+    Add(it1, end1, it2, end2, Weight::One());
+  }
+
+  template <class Container1, class Container2, class T>
+  void Add(const Container1 &cont1, const Container2 &cont2, T &&weight) {
+    Add(cont1.begin(), cont1.end(), cont2.begin(), cont2.end(),
+        std::forward<T>(weight));
+  }
+
+  // With semiring One as a default.
+  template <class Container1, class Container2>
+  void Add(const Container1 &cont1, const Container2 &cont2) {
+    Add(cont1.begin(), cont1.end(), cont2.begin(), cont2.end(), Weight::One());
+  }
+
+  // Removes all entries.
+  void Clear() {
+    register_.clear();
+    offsets_.assign(1, 0);
+    arcs_.clear();
+    final_.clear();
+    weight_.clear();
+    path_.clear();
+    last_.clear();
+    sorted_ = true;
+  }
+
+  // Writes the minimal automaton to a mutable FST, with the start state
+  // numbered 0 and the remaining states numbered in breadth-first order. The
+  // entries are consumed, so this empties the automaton. Sorted() must be
+  // checked beforehand.
+  void ToFst(MutableFst<Arc> *fst) {
+    fst->DeleteStates();
+    if (!sorted_ || path_.empty()) {
+      Clear();
+      return;
+    }
+    RegisterPath(0);
+    const auto root = Register(&path_[0]);
+    const StateId num_states = NumStates();
+    fst->AddStates(num_states);
+    std::vector<StateId> order;
+    order.reserve(num_states);
+    std::vector<StateId> ids(num_states, kNoStateId);
+    ids[root] = 0;
+    order.push_back(root);
+    fst->SetStart(0);
+    for (size_t i = 0; i < order.size(); ++i) {
+      const auto s = order[i];
+      fst->ReserveArcs(i, offsets_[s + 1] - offsets_[s]);
+      if (final_[s]) fst->SetFinal(i, weight_[s]);
+      for (auto a = offsets_[s]; a < offsets_[s + 1]; ++a) {
+        const auto &arc = arcs_[a];
+        if (ids[arc.nextstate] == kNoStateId) {
+          ids[arc.nextstate] = order.size();
+          order.push_back(arc.nextstate);
+        }
+        fst->AddArc(i, MakeArc(arc, ids[arc.nextstate]));
+      }
+    }
+    Clear();
+  }
+
+ private:
+  // The kind of arc; the bridge sorts before any input arc so that an entry
+  // whose input is a prefix of another's comes first.
+  enum Side : uint8_t { BRIDGE, INPUT, OUTPUT };
+
+  struct Symbol {
+    Label label;
+    Side side;
+
+    bool operator==(const Symbol &other) const {
+      return label == other.label && side == other.side;
+    }
+
+    bool operator<(const Symbol &other) const {
+      return std::tie(side, label) < std::tie(other.side, other.label);
+    }
+  };
+
+  struct Transition {
+    Label label;
+    Side side;
+    StateId nextstate;
+  };
+
+  // A state along the path of the most recent entry, whose last arc, if any,
+  // leads to the next state along that path and is not yet resolved.
+  struct PathState {
+    PathState() : final(false), weight(Weight::Zero()) {}
+
+    std::vector<Transition> arcs;
+    bool final;
+    Weight weight;
+  };
+
+  class StateHash {
+   public:
+    explicit StateHash(const IncrementalMinimalDfa *dfa) : dfa_(dfa) {}
+
+    size_t operator()(StateId s) const {
+      size_t hash = dfa_->final_[s] ? dfa_->weight_[s].Hash() + 1 : 0;
+      for (auto a = dfa_->offsets_[s]; a < dfa_->offsets_[s + 1]; ++a) {
+        const auto &arc = dfa_->arcs_[a];
+        hash = hash * 7853 + arc.label;
+        hash = hash * 7867 + arc.side;
+        hash = hash * 7873 + arc.nextstate;
+      }
+      return hash;
+    }
+
+   private:
+    const IncrementalMinimalDfa *dfa_;
+  };
+
+  class StateEqual {
+   public:
+    explicit StateEqual(const IncrementalMinimalDfa *dfa) : dfa_(dfa) {}
+
+    bool operator()(StateId s1, StateId s2) const {
+      if (dfa_->final_[s1] != dfa_->final_[s2]) return false;
+      if (dfa_->final_[s1] && dfa_->weight_[s1] != dfa_->weight_[s2]) {
+        return false;
+      }
+      const auto begin1 = dfa_->offsets_[s1];
+      const auto begin2 = dfa_->offsets_[s2];
+      const auto size = dfa_->offsets_[s1 + 1] - begin1;
+      if (size != dfa_->offsets_[s2 + 1] - begin2) return false;
+      for (size_t i = 0; i < size; ++i) {
+        const auto &arc1 = dfa_->arcs_[begin1 + i];
+        const auto &arc2 = dfa_->arcs_[begin2 + i];
+        if (arc1.label != arc2.label || arc1.side != arc2.side ||
+            arc1.nextstate != arc2.nextstate) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+   private:
+    const IncrementalMinimalDfa *dfa_;
+  };
+
+  // Replaces the states along the path of the most recent entry below the
+  // given depth with their registered equivalents, registering them if need
+  // be, deepest first.
+  void RegisterPath(size_t depth) {
+    for (auto d = last_.size(); d > depth; --d) {
+      path_[d - 1].arcs.back().nextstate = Register(&path_[d]);
+    }
+  }
+
+  // Returns the registered state equivalent to the given state, registering
+  // it if there is none; all of its arcs must be resolved.
+  StateId Register(const PathState *state) {
+    const StateId s = NumStates();
+    arcs_.insert(arcs_.end(), state->arcs.begin(), state->arcs.end());
+    offsets_.push_back(arcs_.size());
+    final_.push_back(state->final);
+    weight_.push_back(state->final ? state->weight : Weight::Zero());
+    const auto [it, inserted] = register_.insert(s);
+    if (inserted) return s;
+    // Discards the candidate in favor of its equivalent.
+    offsets_.pop_back();
+    arcs_.resize(offsets_.back());
+    final_.pop_back();
+    weight_.pop_back();
+    return *it;
+  }
+
+  static Arc MakeArc(const Transition &arc, StateId nextstate) {
+    switch (arc.side) {
+      case INPUT:
+        return Arc(arc.label, kAcceptor ? arc.label : 0, nextstate);
+      case BRIDGE:
+        return Arc(0, 0, nextstate);
+      case OUTPUT:
+        return Arc(0, arc.label, nextstate);
+    }
+    return Arc(0, 0, nextstate);  // Unreachable.
+  }
+
+  // The registered states, each of which is kept only once; the arcs of state
+  // s are arcs_[offsets_[s], offsets_[s + 1]).
+  std::unordered_set<StateId, StateHash, StateEqual> register_;
+  std::vector<size_t> offsets_;
+  std::vector<Transition> arcs_;
+  std::vector<bool> final_;
+  std::vector<Weight> weight_;
+  // The path of the most recent entry, beginning at the start state; this may
+  // be longer than the entry, in which case the remaining states are unused.
+  std::vector<PathState> path_;
+  // The symbols of the most recent entry, and scratch space for the next one.
+  std::vector<Symbol> last_;
+  std::vector<Symbol> next_;
+  bool sorted_;
+
+  IncrementalMinimalDfa(const IncrementalMinimalDfa &) = delete;
+  IncrementalMinimalDfa &operator=(const IncrementalMinimalDfa &) = delete;
+};
+
+}  // namespace internal
+
+// Note that during `Add`, an `IncrementalAcceptorDfa` only looks at the first
+// of the two label sequences passed.
+template <class Arc>
+using IncrementalAcceptorDfa = internal::IncrementalMinimalDfa<Arc, true>;
+
+template <class Arc>
+using IncrementalTransducerDfa = internal::IncrementalMinimalDfa<Arc, false>;
+
+}  // namespace fst
+
+#endif  // PYNINI_INCREMENTAL_DFA_H_
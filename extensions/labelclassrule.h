@@ -0,0 +1,182 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_LABELCLASSRULE_H_
+#define PYNINI_LABELCLASSRULE_H_
+
+// Rules whose "any other symbol" transitions are single rho arcs.
+//
+// A context-dependent rewrite rule copies most symbols of a large alphabet
+// unchanged, and at nearly every state has one identity arc for each of them.
+// When the rule's transduction and contexts mention only a few symbols, all
+// the others behave alike, and the rule can be compiled over an alphabet in
+// which they are collapsed into a single label; see CDRewriteCompileLabelClass
+// in cdrewrite.h. LabelClassRuleFst holds such a rule, and supplies a rho
+// matcher for its input side, so that any composition with the rule on the
+// right, including those made by the rewrite functions, expands each arc with
+// that label to the symbol it matches, on its output side as well. Where the
+// rule cannot be on the right, it can be expanded into an ordinary rule.
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fst/types.h>
+#include <fst/arcsort.h>
+#include <fst/connect.h>
+#include <fst/expanded-fst.h>
+#include <fst/fst.h>
+#include <fst/matcher.h>
+#include <fst/mutable-fst.h>
+#include <fst/properties.h>
+#include <fst/vector-fst.h>
+
+namespace fst {
+
+// A rule in which arcs with the rho label stand for any input label which
+// does not label another arc leaving the same state; their output label, if it
+// is also the rho label, is the one matched. The rule must be sorted on its
+// input labels. The interpretation is supplied only by the matcher for the
+// input side, so the rule must be the right-hand side of any composition, and
+// copying it into a mutable FST gives an ordinary FST in which the rho label
+// is an ordinary label; Expand gives the equivalent ordinary rule instead. If
+// the rho label is kNoLabel, the rule is an ordinary one. The FST cannot be
+// written.
+template <class A>
+class LabelClassRuleFst : public ExpandedFst<A> {
+ public:
+  using Arc = A;
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+  using ClassMatcher = RhoMatcher<SortedMatcher<Fst<Arc>>>;
+
+  // The class labels are those which the rho label stands for.
+  LabelClassRuleFst(VectorFst<Arc> &&rule, Label rho_label,
+                    std::vector<Label> class_labels = {})
+      : rule_(std::make_shared<const VectorFst<Arc>>(std::move(rule))),
+        class_labels_(std::make_shared<const std::vector<Label>>(
+            std::move(class_labels))),
+        rho_label_(rho_label) {}
+
+  // The rule is immutable, so copies share it, even when thread-safe.
+  LabelClassRuleFst(const LabelClassRuleFst &fst, bool safe = false)
+      : rule_(fst.rule_),
+        class_labels_(fst.class_labels_),
+        rho_label_(fst.rho_label_) {}
+
+  Label RhoLabel() const { return rho_label_; }
+
+  // Writes the ordinary rule in which each rho arc is replaced by one arc for
+  // each of the class labels, and states only reachable by arcs blocking
+  // other labels from matching rho arcs are trimmed. Unlike the rule itself,
+  // this rejects labels which are neither mentioned nor in the class.
+  void Expand(MutableFst<Arc> *fst) const {
+    *fst = *rule_;
+    if (rho_label_ == kNoLabel) return;
+    std::vector<Arc> arcs;
+    for (StateId s = 0; s < fst->NumStates(); ++s) {
+      arcs.clear();
+      bool has_rho_arc = false;
+      for (ArcIterator<MutableFst<Arc>> aiter(*fst, s); !aiter.Done();
+           aiter.Next()) {
+        const auto &arc = aiter.Value();
+        if (arc.ilabel != rho_label_) {
+          arcs.push_back(arc);
+          continue;
+        }
+        has_rho_arc = true;
+        for (const auto label : *class_labels_) {
+          const auto olabel = arc.olabel == rho_label_ ? label : arc.olabel;
+          arcs.emplace_back(label, olabel, arc.weight, arc.nextstate);
+        }
+      }
+      if (!has_rho_arc) continue;
+      fst->DeleteArcs(s);
+      for (const auto &arc : arcs) fst->AddArc(s, arc);
+    }
+    Connect(fst);
+    ArcSort(fst, ILabelCompare<Arc>());
+  }
+
+  static const std::string &StaticType() {
+    static const auto *const type = new std::string("label_class_rule");
+    return *type;
+  }
+
+  StateId Start() const override { return rule_->Start(); }
+
+  Weight Final(StateId s) const override { return rule_->Final(s); }
+
+  StateId NumStates() const override { return rule_->NumStates(); }
+
+  size_t NumArcs(StateId s) const override { return rule_->NumArcs(s); }
+
+  size_t NumInputEpsilons(StateId s) const override {
+    return rule_->NumInputEpsilons(s);
+  }
+
+  size_t NumOutputEpsilons(StateId s) const override {
+    return rule_->NumOutputEpsilons(s);
+  }
+
+  uint64_t Properties(uint64_t mask, bool test) const override {
+    return rule_->Properties(mask, test) & ~kMutable;
+  }
+
+  const std::string &Type() const override { return StaticType(); }
+
+  LabelClassRuleFst *Copy(bool safe = false) const override {
+    return new LabelClassRuleFst(*this, safe);
+  }
+
+  const SymbolTable *InputSymbols() const override {
+    return rule_->InputSymbols();
+  }
+
+  const SymbolTable *OutputSymbols() const override {
+    return rule_->OutputSymbols();
+  }
+
+  void InitStateIterator(StateIteratorData<Arc> *data) const override {
+    rule_->InitStateIterator(data);
+  }
+
+  void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const override {
+    rule_->InitArcIterator(s, data);
+  }
+
+  // Composition requires a match on the input side wherever the current
+  // state has a rho arc.
+  MatcherBase<Arc> *InitMatcher(MatchType match_type) const override {
+    if (match_type != MATCH_INPUT || rho_label_ == kNoLabel) return nullptr;
+    return new ClassMatcher(*rule_, match_type, rho_label_,
+                            MATCHER_REWRITE_ALWAYS);
+  }
+
+ private:
+  std::shared_ptr<const VectorFst<Arc>> rule_;
+  std::shared_ptr<const std::vector<Label>> class_labels_;
+  const Label rho_label_;
+
+  LabelClassRuleFst &operator=(const LabelClassRuleFst &) = delete;
+};
+
+}  // namespace fst
+
+#endif  // PYNINI_LABELCLASSRULE_H_
@@ -22,6 +22,10 @@
 // Karttunen, L.. 1998. The proper treatment of Optimality Theory in
 // computational phonology. In Proc. FSMNLP, pages 1-12.
 
+#include <memory>
+
+#include <fst/arcsort.h>
+#include <fst/cache.h>
 #include <fst/compose.h>
 #include <fst/connect.h>
 #include <fst/determinize.h>
@@ -31,6 +35,7 @@
 #include <fst/project.h>
 #include <fst/rmepsilon.h>
 #include <fst/union.h>
+#include <fst/vector-fst.h>
 #include "checkprops.h"
 
 namespace fst {
@@ -54,13 +59,10 @@ namespace internal {
 //   input = Determinize[RmEpsilon[Project[Q, 'input']]];
 //   return Q | ((sigma - input) @ R);
 // }
+// As above, but assumes that sigma has already been checked.
 template <class Arc>
-void PriorityUnion(MutableFst<Arc> *fst1, const Fst<Arc> &fst2,
-                   const Fst<Arc> &sigma) {
-  if (!CheckUnweightedAcceptor(sigma, "PriorityUnion", "sigma")) {
-    fst1->SetProperties(kError, kError);
-    return;
-  }
+void PriorityUnionChecked(MutableFst<Arc> *fst1, const Fst<Arc> &fst2,
+                          const Fst<Arc> &sigma) {
   const ProjectFst<Arc> project(*fst1, ProjectType::INPUT);
   const RmEpsilonFst<Arc> rmepsilon(project);
   const DeterminizeFst<Arc> determinize(rmepsilon);
@@ -74,6 +76,16 @@ void PriorityUnion(MutableFst<Arc> *fst1, const Fst<Arc> &fst2,
   Union(fst1, compose);
 }
 
+template <class Arc>
+void PriorityUnion(MutableFst<Arc> *fst1, const Fst<Arc> &fst2,
+                   const Fst<Arc> &sigma) {
+  if (!CheckUnweightedAcceptor(sigma, "PriorityUnion", "sigma")) {
+    fst1->SetProperties(kError, kError);
+    return;
+  }
+  PriorityUnionChecked(fst1, fst2, sigma);
+}
+
 }  // namespace internal
 
 // Lenient composition of two FSTs X, Y is simply the priority union (with
@@ -93,6 +105,97 @@ void LenientlyCompose(const Fst<Arc> &ifst1, const Fst<Arc> &ifst2,
   if (opts.connect) Connect(ofst);
 }
 
+// Lenient composition with a fixed right-hand side, as when the same ranked
+// constraint is leniently composed with the candidates for every input. The
+// constraint and sigma are checked and arc-sorted once, when the composer is
+// constructed, rather than on every call. (The complement of the domain of
+// X @ Y depends on X, so it is still computed per call.)
+template <class Arc>
+class LenientComposer {
+ public:
+  // The constraint is input-label-sorted and sigma is output-label-sorted,
+  // copying them if they are not already sorted; delayed constraints are
+  // sorted lazily so that they are never fully expanded. The cache options
+  // are only used by Delayed.
+  LenientComposer(const Fst<Arc> &ifst2, const Fst<Arc> &sigma,
+                  const ComposeOptions &opts = ComposeOptions(),
+                  const CacheOptions &copts = CacheOptions())
+      : opts_(opts), copts_(copts) {
+    if (!CheckUnweightedAcceptor(sigma, "LenientComposer", "sigma") ||
+        ifst2.Properties(kError, false)) {
+      error_ = true;
+    }
+    if (ifst2.Properties(kILabelSorted, false) == kILabelSorted) {
+      ifst2_.reset(ifst2.Copy());
+    } else if (ifst2.Properties(kExpanded, false) != kExpanded) {
+      static const ILabelCompare<Arc> icomp;
+      ifst2_ = std::make_unique<ArcSortFst<Arc, ILabelCompare<Arc>>>(ifst2,
+                                                                     icomp);
+    } else if (ifst2.Properties(kILabelSorted, true) == kILabelSorted) {
+      ifst2_.reset(ifst2.Copy());
+    } else {
+      auto *copy = new VectorFst<Arc>(ifst2);
+      ArcSort(copy, ILabelCompare<Arc>());
+      ifst2_.reset(copy);
+    }
+    if (sigma.Properties(kOLabelSorted, true) == kOLabelSorted) {
+      sigma_.reset(sigma.Copy());
+    } else {
+      auto *copy = new VectorFst<Arc>(sigma);
+      ArcSort(copy, OLabelCompare<Arc>());
+      sigma_.reset(copy);
+    }
+  }
+
+  bool Error() const { return error_; }
+
+  // Leniently composes the input with the constraint, writing the result to
+  // the output FST, as in LenientlyCompose.
+  void operator()(const Fst<Arc> &ifst1, MutableFst<Arc> *ofst) const {
+    if (error_) {
+      ofst->DeleteStates();
+      ofst->SetProperties(kError, kError);
+      return;
+    }
+    Compose(ifst1, *ifst2_, ofst, opts_);
+    internal::PriorityUnionChecked(ofst, ifst1, *sigma_);
+    if (opts_.connect) Connect(ofst);
+  }
+
+  // Returns the lenient composition of the input with the constraint as a
+  // delayed FST, so that it can itself be the input to further lenient
+  // compositions (or rule applications) without being expanded. The result
+  // is not connected, and the composition filter option is ignored.
+  std::unique_ptr<Fst<Arc>> Delayed(const Fst<Arc> &ifst1) const {
+    if (error_) return ErrorFst();
+    const ComposeFstOptions<Arc> copts(copts_);
+    const ComposeFst<Arc> compose(ifst1, *ifst2_, copts);
+    const ProjectFst<Arc> project(compose, ProjectType::INPUT);
+    const RmEpsilonFst<Arc> rmepsilon(project);
+    const DeterminizeFst<Arc> determinize(rmepsilon);
+    const DifferenceFst<Arc> difference(*sigma_, determinize, copts_);
+    const ComposeFst<Arc> fallback(difference, ifst1, copts);
+    if (difference.Properties(kError, true) == kError) return ErrorFst();
+    return std::make_unique<UnionFst<Arc>>(compose, fallback);
+  }
+
+ private:
+  static std::unique_ptr<Fst<Arc>> ErrorFst() {
+    auto fst = std::make_unique<VectorFst<Arc>>();
+    fst->SetProperties(kError, kError);
+    return fst;
+  }
+
+  const ComposeOptions opts_;
+  const CacheOptions copts_;
+  bool error_ = false;
+  std::unique_ptr<const Fst<Arc>> ifst2_;
+  std::unique_ptr<const Fst<Arc>> sigma_;
+
+  LenientComposer(const LenientComposer &) = delete;
+  LenientComposer &operator=(const LenientComposer &) = delete;
+};
+
 }  // namespace fst
 
 #endif  // PYNINI_LENIENTLYCOMPOSE_H_
@@ -37,6 +37,20 @@ void LenientlyCompose(const FstClass &ifst1, const FstClass &ifst2,
 
 REGISTER_FST_OPERATION_3ARCS(LenientlyCompose, LenientlyComposeArgs);
 
+LenientComposerClass::LenientComposerClass(const FstClass &ifst2,
+                                           const FstClass &sigma,
+                                           const ComposeOptions &opts)
+    : impl_(nullptr) {
+  if (!internal::ArcTypesMatch(ifst2, sigma, "LenientComposerClass")) return;
+  arc_type_ = ifst2.ArcType();
+  InitLenientComposerClassArgs args(ifst2, sigma, opts, this);
+  Apply<Operation<InitLenientComposerClassArgs>>("InitLenientComposerClass",
+                                                 arc_type_, &args);
+}
+
+REGISTER_FST_OPERATION_3ARCS(InitLenientComposerClass,
+                             InitLenientComposerClassArgs);
+
 }  // namespace script
 }  // namespace fst
 
@@ -17,6 +17,8 @@
 #ifndef PYNINI_LENIENTLYCOMPOSESCRIPT_H_
 #define PYNINI_LENIENTLYCOMPOSESCRIPT_H_
 
+#include <memory>
+#include <string>
 #include <utility>
 
 #include <fst/script/fst-class.h>
@@ -42,6 +44,112 @@ void LenientlyCompose(const FstClass &ifst1, const FstClass &ifst2,
                       const FstClass &sigma, MutableFstClass *ofst,
                       const ComposeOptions &opts = ComposeOptions());
 
+// Virtual interface implemented by each concrete LenientComposerImpl<Arc>.
+class LenientComposerImplBase {
+ public:
+  virtual bool Error() const = 0;
+  virtual bool Compose(const FstClass &ifst1, MutableFstClass *ofst) const = 0;
+  virtual std::unique_ptr<FstClass> ComposeDelayed(
+      const FstClass &ifst1) const = 0;
+  virtual ~LenientComposerImplBase() {}
+};
+
+// Templated implementation. Each method fails, after logging, if the
+// arguments do not have the composer's arc type.
+template <class Arc>
+class LenientComposerImpl : public LenientComposerImplBase {
+ public:
+  LenientComposerImpl(const Fst<Arc> &ifst2, const Fst<Arc> &sigma,
+                      const ComposeOptions &opts)
+      : impl_(ifst2, sigma, opts) {}
+
+  bool Error() const override { return impl_.Error(); }
+
+  bool Compose(const FstClass &ifst1, MutableFstClass *ofst) const override {
+    const auto *typed_ifst1 = GetTypedFst(ifst1, "Compose");
+    if (!typed_ifst1) {
+      ofst->SetProperties(kError, kError);
+      return false;
+    }
+    auto *typed_ofst = ofst->GetMutableFst<Arc>();
+    if (!typed_ofst) {
+      LOG(ERROR) << "LenientComposer::Compose: Output arc type does not "
+                 << "match composer arc type";
+      ofst->SetProperties(kError, kError);
+      return false;
+    }
+    impl_(*typed_ifst1, typed_ofst);
+    return typed_ofst->Properties(kError, false) != kError;
+  }
+
+  std::unique_ptr<FstClass> ComposeDelayed(
+      const FstClass &ifst1) const override {
+    const auto *typed_ifst1 = GetTypedFst(ifst1, "ComposeDelayed");
+    if (!typed_ifst1) return nullptr;
+    const auto fst = impl_.Delayed(*typed_ifst1);
+    return std::make_unique<FstClass>(*fst);
+  }
+
+ private:
+  static const Fst<Arc> *GetTypedFst(const FstClass &fst,
+                                     const std::string &op_name) {
+    const auto *typed_fst = fst.GetFst<Arc>();
+    if (!typed_fst) {
+      LOG(ERROR) << "LenientComposer::" << op_name << ": Argument arc type "
+                 << fst.ArcType() << " does not match composer arc type "
+                 << Arc::Type();
+    }
+    return typed_fst;
+  }
+
+  LenientComposer<Arc> impl_;
+};
+
+class LenientComposerClass;
+
+using InitLenientComposerClassArgs =
+    std::tuple<const FstClass &, const FstClass &, const ComposeOptions &,
+               LenientComposerClass *>;
+
+// Untemplated user-facing class holding templated pimpl.
+class LenientComposerClass {
+ public:
+  LenientComposerClass(const FstClass &ifst2, const FstClass &sigma,
+                       const ComposeOptions &opts = ComposeOptions());
+
+  const std::string &ArcType() const { return arc_type_; }
+
+  bool Error() const { return !impl_ || impl_->Error(); }
+
+  bool Compose(const FstClass &ifst1, MutableFstClass *ofst) const {
+    if (!impl_) {
+      ofst->SetProperties(kError, kError);
+      return false;
+    }
+    return impl_->Compose(ifst1, ofst);
+  }
+
+  // Returns nullptr if the arc type of the argument does not match.
+  std::unique_ptr<FstClass> ComposeDelayed(const FstClass &ifst1) const {
+    return impl_ ? impl_->ComposeDelayed(ifst1) : nullptr;
+  }
+
+  template <class Arc>
+  friend void InitLenientComposerClass(InitLenientComposerClassArgs *args);
+
+ private:
+  std::string arc_type_;
+  std::unique_ptr<LenientComposerImplBase> impl_;
+};
+
+template <class Arc>
+void InitLenientComposerClass(InitLenientComposerClassArgs *args) {
+  const Fst<Arc> &ifst2 = *(std::get<0>(*args).GetFst<Arc>());
+  const Fst<Arc> &sigma = *(std::get<1>(*args).GetFst<Arc>());
+  std::get<3>(*args)->impl_ = std::make_unique<LenientComposerImpl<Arc>>(
+      ifst2, sigma, std::get<2>(*args));
+}
+
 }  // namespace script
 }  // namespace fst
 
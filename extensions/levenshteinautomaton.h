@@ -0,0 +1,332 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_LEVENSHTEINAUTOMATON_H_
+#define PYNINI_LEVENSHTEINAUTOMATON_H_
+
+// Approximate matching of strings against a fixed lexicon.
+//
+// Rather than composing each query with a (factored) edit transducer and the
+// lexicon and then searching the resulting lattice, this simulates the
+// Levenshtein automaton for the query, i.e., the standard edit distance
+// dynamic program, whose columns are the states of that automaton, and
+// intersects it on the fly with a deterministic copy of the lexicon. The
+// lexicon is searched best-first, so the closest matches are found without
+// visiting any lexicon prefix which cannot be extended into a match better
+// than them.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <fst/log.h>
+#include <fst/arc-map.h>
+#include <fst/arcsort.h>
+#include <fst/determinize.h>
+#include <fst/fst.h>
+#include <fst/project.h>
+#include <fst/rmepsilon.h>
+#include <fst/vector-fst.h>
+#include "cross.h"
+
+namespace fst {
+
+// Edit distance here is computed over the alphabet, the set of labels of a
+// "sigma" acceptor of single-label strings; query and lexicon labels outside
+// of that alphabet can be neither matched nor edited. Insertions (of lexicon
+// labels), deletions (of query labels), and substitutions each have a
+// positive cost, and if `bound` is positive, at most that many edits are
+// permitted. The lexicon is treated as an unweighted acceptor of its input
+// strings, and may be cyclic. Searches do not modify the automaton, so they
+// may be run concurrently. Sigma need not have this form, and callers may
+// fall back to general composition when it does not; such a sigma sets
+// Error() without logging an error.
+template <class Arc>
+class LevenshteinAutomaton {
+ public:
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+
+  LevenshteinAutomaton(const Fst<Arc> &lexicon, const Fst<Arc> &sigma,
+                       double insert_cost = 1, double delete_cost = 1,
+                       double substitute_cost = 1, int32_t bound = 0)
+      : insert_cost_(insert_cost),
+        delete_cost_(delete_cost),
+        substitute_cost_(substitute_cost),
+        layers_(bound > 0 ? bound + 1 : 1),
+        bounded_(bound > 0) {
+    if (insert_cost <= 0 || delete_cost <= 0 || substitute_cost <= 0) {
+      FSTERROR() << "LevenshteinAutomaton: Edit costs must be positive";
+      error_ = true;
+      return;
+    }
+    if (!GetAlphabet(sigma)) {
+      error_ = true;
+      return;
+    }
+    // Makes an unweighted, deterministic, epsilon-free copy of the lexicon.
+    VectorFst<Arc> copy(lexicon);
+    Project(&copy, ProjectType::INPUT);
+    ArcMap(&copy, RmWeightMapper<Arc>());
+    RmEpsilon(&copy);
+    Determinize(copy, &lexicon_);
+    ArcSort(&lexicon_, ILabelCompare<Arc>());
+    if (lexicon_.Properties(kError, false)) error_ = true;
+  }
+
+  bool Error() const { return error_; }
+
+  // Finds the lexicon strings closest to the query, best first: up to
+  // `nshortest` of them if it is positive, and if `optimal_only` is true,
+  // only those tied with the closest. Ties are broken in the order the
+  // matches are discovered. If the lexicon is cyclic and the search is
+  // unbounded, one of the first two is needed for the search to terminate.
+  // Returns false if the automaton is in an error state.
+  bool ClosestMatches(const std::vector<Label> &query, int32_t nshortest,
+                      bool optimal_only,
+                      std::vector<std::vector<Label>> *matches,
+                      std::vector<double> *costs) const;
+
+  // As above, but with the query given as a string FST; fails if it is not
+  // one.
+  bool ClosestMatches(const Fst<Arc> &query, int32_t nshortest,
+                      bool optimal_only,
+                      std::vector<std::vector<Label>> *matches,
+                      std::vector<double> *costs) const {
+    std::vector<Label> labels;
+    Weight unused_weight;
+    if (!internal::GetStringLabels(query, /*output=*/false, &labels,
+                                   &unused_weight)) {
+      LOG(ERROR) << "LevenshteinAutomaton::ClosestMatches: Query is not a "
+                 << "string FST";
+      return false;
+    }
+    return ClosestMatches(labels, nshortest, optimal_only, matches, costs);
+  }
+
+ private:
+  static constexpr double kInfinity = std::numeric_limits<double>::infinity();
+
+  // Tolerance used when comparing match costs with that of the closest.
+  static constexpr double kDelta = 1e-6;
+
+  // Index of a node in the trie of lexicon prefixes; the root, the empty
+  // prefix, is 0.
+  using PrefixId = int64_t;
+
+  // A column of the dynamic program for a lexicon prefix: the cell for query
+  // prefix length i and number of edits e is at i * layers_ + e, and holds the
+  // least cost of aligning the two prefixes with exactly e edits (or, if
+  // unbounded, with any number of them, in a single layer).
+  using Column = std::vector<double>;
+
+  // A partial match at a lexicon state or, once it is complete, at
+  // kNoStateId.
+  struct Entry {
+    double priority;
+    StateId state;
+    PrefixId prefix;
+    // Position of the column in the search's list of columns.
+    size_t column;
+    // Discovery order, used to break ties deterministically.
+    size_t order;
+  };
+
+  struct EntryCompare {
+    bool operator()(const Entry &lhs, const Entry &rhs) const {
+      if (lhs.priority != rhs.priority) return lhs.priority > rhs.priority;
+      return lhs.order > rhs.order;
+    }
+  };
+
+  bool GetAlphabet(const Fst<Arc> &sigma);
+
+  bool InAlphabet(Label label) const { return alphabet_.count(label); }
+
+  // Computes the column reached from `column` by the lexicon label.
+  void Extend(const std::vector<Label> &query, const Column &column,
+              Label label, Column *next) const;
+
+  // The least cost of any cell in the column, which is a lower bound on the
+  // cost of any match with this lexicon prefix.
+  static double MinCost(const Column &column) {
+    return *std::min_element(column.begin(), column.end());
+  }
+
+  // The least cost of aligning the whole query with the lexicon prefix.
+  double FinalCost(size_t query_size, const Column &column) const {
+    const auto begin = column.begin() + query_size * layers_;
+    return *std::min_element(begin, begin + layers_);
+  }
+
+  const double insert_cost_;
+  const double delete_cost_;
+  const double substitute_cost_;
+  const size_t layers_;
+  const bool bounded_;
+  bool error_ = false;
+  std::unordered_set<Label> alphabet_;
+  VectorFst<Arc> lexicon_;
+
+  LevenshteinAutomaton(const LevenshteinAutomaton &) = delete;
+  LevenshteinAutomaton &operator=(const LevenshteinAutomaton &) = delete;
+};
+
+template <class Arc>
+bool LevenshteinAutomaton<Arc>::GetAlphabet(const Fst<Arc> &sigma) {
+  const auto start = sigma.Start();
+  if (start == kNoStateId) {
+    VLOG(1) << "LevenshteinAutomaton: Empty alphabet";
+    return false;
+  }
+  if (sigma.Final(start) != Weight::Zero()) {
+    VLOG(1) << "LevenshteinAutomaton: Alphabet contains the empty string";
+    return false;
+  }
+  for (ArcIterator<Fst<Arc>> aiter(sigma, start); !aiter.Done();
+       aiter.Next()) {
+    const auto &arc = aiter.Value();
+    if (arc.ilabel == 0 || arc.ilabel != arc.olabel ||
+        sigma.Final(arc.nextstate) == Weight::Zero() ||
+        sigma.NumArcs(arc.nextstate) != 0) {
+      VLOG(1) << "LevenshteinAutomaton: Alphabet must be an acceptor of "
+              << "single-label strings";
+      return false;
+    }
+    alphabet_.insert(arc.ilabel);
+  }
+  return true;
+}
+
+template <class Arc>
+void LevenshteinAutomaton<Arc>::Extend(const std::vector<Label> &query,
+                                       const Column &column, Label label,
+                                       Column *next) const {
+  // In the unbounded case there is a single layer, and an edit stays in it.
+  const size_t step = bounded_ ? 1 : 0;
+  next->assign(column.size(), kInfinity);
+  if (!InAlphabet(label)) return;
+  for (size_t i = 0; i <= query.size(); ++i) {
+    const bool query_in_alphabet = i > 0 && InAlphabet(query[i - 1]);
+    for (size_t e = 0; e < layers_; ++e) {
+      auto &cell = (*next)[i * layers_ + e];
+      // Matches the query label.
+      if (query_in_alphabet && query[i - 1] == label) {
+        cell = std::min(cell, column[(i - 1) * layers_ + e]);
+      }
+      if (e < step) continue;
+      // Inserts the lexicon label.
+      cell = std::min(cell, column[i * layers_ + e - step] + insert_cost_);
+      if (!query_in_alphabet) continue;
+      // Substitutes the lexicon label for the query label.
+      if (query[i - 1] != label) {
+        cell = std::min(cell, column[(i - 1) * layers_ + e - step] +
+                                  substitute_cost_);
+      }
+      // Deletes the query label.
+      cell = std::min(cell,
+                      (*next)[(i - 1) * layers_ + e - step] + delete_cost_);
+    }
+  }
+}
+
+template <class Arc>
+bool LevenshteinAutomaton<Arc>::ClosestMatches(
+    const std::vector<Label> &query, int32_t nshortest, bool optimal_only,
+    std::vector<std::vector<Label>> *matches,
+    std::vector<double> *costs) const {
+  matches->clear();
+  costs->clear();
+  if (error_) return false;
+  const auto start = lexicon_.Start();
+  if (start == kNoStateId) return true;
+  // The column for the empty lexicon prefix, in which the query labels can
+  // only be deleted.
+  std::vector<Column> columns(1, Column((query.size() + 1) * layers_,
+                                        kInfinity));
+  {
+    auto &column = columns[0];
+    column[0] = 0;
+    const size_t step = bounded_ ? 1 : 0;
+    for (size_t i = 1, e = step; i <= query.size() && e < layers_;
+         ++i, e += step) {
+      if (!InAlphabet(query[i - 1])) break;
+      column[i * layers_ + e] = column[(i - 1) * layers_ + e - step] +
+                                delete_cost_;
+    }
+  }
+  // Trie of lexicon prefixes: the parent and last label of each node.
+  std::vector<std::pair<PrefixId, Label>> prefixes = {{-1, 0}};
+  std::priority_queue<Entry, std::vector<Entry>, EntryCompare> queue;
+  size_t num_pushed = 0;
+  queue.push(Entry{MinCost(columns[0]), start, 0, 0, num_pushed++});
+  double best = kInfinity;
+  Column next;
+  while (!queue.empty()) {
+    const auto entry = queue.top();
+    queue.pop();
+    if (optimal_only && entry.priority > best + kDelta) break;
+    if (entry.state == kNoStateId) {
+      // Since the lexicon is deterministic, each prefix is completed at most
+      // once.
+      matches->emplace_back();
+      auto &labels = matches->back();
+      for (auto prefix = entry.prefix; prefix != 0;
+           prefix = prefixes[prefix].first) {
+        labels.push_back(prefixes[prefix].second);
+      }
+      std::reverse(labels.begin(), labels.end());
+      costs->push_back(entry.priority);
+      best = std::min(best, entry.priority);
+      if (nshortest > 0 && matches->size() >= static_cast<size_t>(nshortest)) {
+        break;
+      }
+      continue;
+    }
+    // Moves the column out, since it is no longer needed once expanded.
+    const auto column = std::move(columns[entry.column]);
+    if (lexicon_.Final(entry.state) != Weight::Zero()) {
+      const auto cost = FinalCost(query.size(), column);
+      if (cost < kInfinity) {
+        queue.push(Entry{cost, kNoStateId, entry.prefix, 0, num_pushed++});
+      }
+    }
+    for (ArcIterator<VectorFst<Arc>> aiter(lexicon_, entry.state);
+         !aiter.Done(); aiter.Next()) {
+      const auto &arc = aiter.Value();
+      Extend(query, column, arc.ilabel, &next);
+      const auto priority = MinCost(next);
+      if (priority == kInfinity) continue;
+      const PrefixId prefix = prefixes.size();
+      prefixes.emplace_back(entry.prefix, arc.ilabel);
+      queue.push(Entry{priority, arc.nextstate, prefix, columns.size(),
+                       num_pushed++});
+      columns.push_back(std::move(next));
+      next.clear();
+    }
+  }
+  return true;
+}
+
+}  // namespace fst
+
+#endif  // PYNINI_LEVENSHTEINAUTOMATON_H_
@@ -0,0 +1,46 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "levenshteinautomatonscript.h"
+
+#include <cstdint>
+
+#include <fst/script/fst-class.h>
+#include <fst/script/script-impl.h>
+
+namespace fst {
+namespace script {
+
+LevenshteinAutomatonClass::LevenshteinAutomatonClass(
+    const FstClass &lexicon, const FstClass &sigma, double insert_cost,
+    double delete_cost, double substitute_cost, int32_t bound)
+    : impl_(nullptr) {
+  if (!internal::ArcTypesMatch(lexicon, sigma, "LevenshteinAutomatonClass")) {
+    return;
+  }
+  arc_type_ = lexicon.ArcType();
+  InitLevenshteinAutomatonClassArgs args(lexicon, sigma, insert_cost,
+                                         delete_cost, substitute_cost, bound,
+                                         this);
+  Apply<Operation<InitLevenshteinAutomatonClassArgs>>(
+      "InitLevenshteinAutomatonClass", arc_type_, &args);
+}
+
+REGISTER_FST_OPERATION_3ARCS(InitLevenshteinAutomatonClass,
+                             InitLevenshteinAutomatonClassArgs);
+
+}  // namespace script
+}  // namespace fst
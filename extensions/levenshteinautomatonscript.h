@@ -0,0 +1,135 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_LEVENSHTEINAUTOMATONSCRIPT_H_
+#define PYNINI_LEVENSHTEINAUTOMATONSCRIPT_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <fst/script/arg-packs.h>
+#include <fst/script/fstscript.h>
+#include "levenshteinautomaton.h"
+#include "stringprint.h"
+
+namespace fst {
+namespace script {
+
+// Virtual interface implemented by each concrete LevenshteinAutomatonImpl<Arc>.
+class LevenshteinAutomatonImplBase {
+ public:
+  virtual bool Error() const = 0;
+  virtual bool ClosestMatches(const FstClass &query, int32_t nshortest,
+                              bool optimal_only,
+                              std::vector<std::string> *matches,
+                              std::vector<double> *costs, TokenType ttype,
+                              const SymbolTable *syms) const = 0;
+  virtual ~LevenshteinAutomatonImplBase() {}
+};
+
+// Templated implementation.
+template <class Arc>
+class LevenshteinAutomatonImpl : public LevenshteinAutomatonImplBase {
+ public:
+  LevenshteinAutomatonImpl(const Fst<Arc> &lexicon, const Fst<Arc> &sigma,
+                           double insert_cost, double delete_cost,
+                           double substitute_cost, int32_t bound)
+      : impl_(lexicon, sigma, insert_cost, delete_cost, substitute_cost,
+              bound) {}
+
+  bool Error() const override { return impl_.Error(); }
+
+  bool ClosestMatches(const FstClass &query, int32_t nshortest,
+                      bool optimal_only, std::vector<std::string> *matches,
+                      std::vector<double> *costs, TokenType ttype,
+                      const SymbolTable *syms) const override {
+    const auto *typed_query = query.GetFst<Arc>();
+    if (!typed_query) {
+      LOG(ERROR) << "LevenshteinAutomaton::ClosestMatches: Query arc type "
+                 << query.ArcType() << " does not match automaton arc type "
+                 << Arc::Type();
+      return false;
+    }
+    std::vector<std::vector<typename Arc::Label>> labels;
+    if (!impl_.ClosestMatches(*typed_query, nshortest, optimal_only, &labels,
+                              costs)) {
+      return false;
+    }
+    ReusableStringPrinter<Arc> printer(ttype, syms);
+    matches->clear();
+    matches->reserve(labels.size());
+    for (const auto &match : labels) {
+      matches->emplace_back();
+      if (!printer.Append(match, &matches->back())) return false;
+    }
+    return true;
+  }
+
+ private:
+  LevenshteinAutomaton<Arc> impl_;
+};
+
+class LevenshteinAutomatonClass;
+
+using InitLevenshteinAutomatonClassArgs =
+    std::tuple<const FstClass &, const FstClass &, double, double, double,
+               int32_t, LevenshteinAutomatonClass *>;
+
+// Untemplated user-facing class holding templated pimpl.
+class LevenshteinAutomatonClass {
+ public:
+  LevenshteinAutomatonClass(const FstClass &lexicon, const FstClass &sigma,
+                            double insert_cost = 1, double delete_cost = 1,
+                            double substitute_cost = 1, int32_t bound = 0);
+
+  const std::string &ArcType() const { return arc_type_; }
+
+  bool Error() const { return !impl_ || impl_->Error(); }
+
+  bool ClosestMatches(const FstClass &query, int32_t nshortest,
+                      bool optimal_only, std::vector<std::string> *matches,
+                      std::vector<double> *costs,
+                      TokenType ttype = TokenType::BYTE,
+                      const SymbolTable *syms = nullptr) const {
+    return impl_ && impl_->ClosestMatches(query, nshortest, optimal_only,
+                                          matches, costs, ttype, syms);
+  }
+
+  template <class Arc>
+  friend void InitLevenshteinAutomatonClass(
+      InitLevenshteinAutomatonClassArgs *args);
+
+ private:
+  std::string arc_type_;
+  std::unique_ptr<LevenshteinAutomatonImplBase> impl_;
+};
+
+template <class Arc>
+void InitLevenshteinAutomatonClass(InitLevenshteinAutomatonClassArgs *args) {
+  const Fst<Arc> &lexicon = *(std::get<0>(*args).GetFst<Arc>());
+  const Fst<Arc> &sigma = *(std::get<1>(*args).GetFst<Arc>());
+  std::get<6>(*args)->impl_ = std::make_unique<LevenshteinAutomatonImpl<Arc>>(
+      lexicon, sigma, std::get<2>(*args), std::get<3>(*args),
+      std::get<4>(*args), std::get<5>(*args));
+}
+
+}  // namespace script
+}  // namespace fst
+
+#endif  // PYNINI_LEVENSHTEINAUTOMATONSCRIPT_H_
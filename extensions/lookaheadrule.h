@@ -0,0 +1,183 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_LOOKAHEADRULE_H_
+#define PYNINI_LOOKAHEADRULE_H_
+
+// Rules converted for lookahead composition.
+//
+// Composing with a context-dependent rewrite rule, or with a chain of them,
+// explores many paths through epsilon arcs which turn out to be dead ends and
+// are only later removed by connection. Lookahead composition avoids most of
+// these, by checking at each epsilon move whether the labels reachable from
+// its destination can match at all, but the rule must first be converted to a
+// form carrying reachability data over relabeled input labels, and the other
+// side of each composition relabeled to match. LookAheadRuleFst does both
+// conversions once, when the rule (or cascade) is loaded, and keeps what is
+// needed to relabel inputs; RewriteLattice recognizes it and relabels each
+// input before composing, so that the rewrite functions use lookahead
+// composition without further changes.
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fst/types.h>
+#include <fst/log.h>
+#include <fst/accumulator.h>
+#include <fst/cache.h>
+#include <fst/compose.h>
+#include <fst/const-fst.h>
+#include <fst/fst.h>
+#include <fst/lookahead-matcher.h>
+#include <fst/matcher-fst.h>
+#include <fst/matcher.h>
+#include <fst/mutable-fst.h>
+#include <fst/properties.h>
+#include <fst/vector-fst.h>
+
+namespace fst {
+namespace internal {
+
+inline constexpr char kILabelLookAheadRuleType[] = "ilabel_lookahead_rule";
+
+}  // namespace internal
+
+// A rule in input-label lookahead form; its input labels are relabeled.
+template <class Arc>
+using ILabelLookAheadRule = MatcherFst<
+    ConstFst<Arc>,
+    LabelLookAheadMatcher<SortedMatcher<ConstFst<Arc>>, ilabel_lookahead_flags,
+                          FastLogAccumulator<Arc>>,
+    internal::kILabelLookAheadRuleType, LabelLookAheadRelabeler<Arc>>;
+
+// A rule, or a cascade of rules composed lazily, in lookahead form. The input
+// labels of the rule are relabeled, so inputs must be relabeled likewise with
+// Relabel before composing; its output labels are unchanged. Conversion
+// expands every rule, including delayed ones. The FST cannot be written.
+template <class A>
+class LookAheadRuleFst : public Fst<A> {
+ public:
+  using Arc = A;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+
+  explicit LookAheadRuleFst(const Fst<Arc> &rule)
+      : first_(std::make_shared<const ILabelLookAheadRule<Arc>>(rule)),
+        rule_(first_) {}
+
+  // Converts each rule, from the last to the first, relabeling its output
+  // labels to match the input labels of the next rule, and chains them with
+  // delayed lookahead compositions using the given cache options. There must
+  // be at least one rule.
+  LookAheadRuleFst(const std::vector<const Fst<Arc> *> &rules,
+                   const CacheOptions &opts = CacheOptions()) {
+    std::vector<std::shared_ptr<const ILabelLookAheadRule<Arc>>> converted(
+        rules.size());
+    for (size_t i = rules.size(); i-- > 0;) {
+      if (i + 1 == rules.size()) {
+        converted[i] = std::make_shared<const ILabelLookAheadRule<Arc>>(
+            *rules[i]);
+      } else {
+        VectorFst<Arc> relabeled(*rules[i]);
+        LabelLookAheadRelabeler<Arc>::Relabel(&relabeled, *converted[i + 1],
+                                              /*relabel_input=*/false);
+        converted[i] =
+            std::make_shared<const ILabelLookAheadRule<Arc>>(relabeled);
+      }
+    }
+    first_ = converted[0];
+    rule_ = first_;
+    // Lookahead composition is selected automatically, since each rule
+    // after the first has a lookahead matcher on its input side.
+    for (size_t i = 1; i < converted.size(); ++i) {
+      rule_ = std::make_shared<const ComposeFst<Arc>>(*rule_, *converted[i],
+                                                      opts);
+    }
+  }
+
+  LookAheadRuleFst(const LookAheadRuleFst &fst, bool safe = false)
+      : first_(fst.first_),
+        rule_(safe ? std::shared_ptr<const Fst<Arc>>(fst.rule_->Copy(true))
+                   : fst.rule_) {}
+
+  // Relabels the output labels of an input to match the rule.
+  void Relabel(MutableFst<Arc> *input) const {
+    LabelLookAheadRelabeler<Arc>::Relabel(input, *first_,
+                                          /*relabel_input=*/false);
+  }
+
+  static const std::string &StaticType() {
+    static const auto *const type = new std::string("lookahead_rule");
+    return *type;
+  }
+
+  StateId Start() const override { return rule_->Start(); }
+
+  Weight Final(StateId s) const override { return rule_->Final(s); }
+
+  size_t NumArcs(StateId s) const override { return rule_->NumArcs(s); }
+
+  size_t NumInputEpsilons(StateId s) const override {
+    return rule_->NumInputEpsilons(s);
+  }
+
+  size_t NumOutputEpsilons(StateId s) const override {
+    return rule_->NumOutputEpsilons(s);
+  }
+
+  // The wrapper is neither expanded nor mutable, whatever the rule is.
+  uint64_t Properties(uint64_t mask, bool test) const override {
+    return rule_->Properties(mask, test) & ~(kExpanded | kMutable);
+  }
+
+  const std::string &Type() const override { return StaticType(); }
+
+  LookAheadRuleFst *Copy(bool safe = false) const override {
+    return new LookAheadRuleFst(*this, safe);
+  }
+
+  const SymbolTable *InputSymbols() const override {
+    return rule_->InputSymbols();
+  }
+
+  const SymbolTable *OutputSymbols() const override {
+    return rule_->OutputSymbols();
+  }
+
+  void InitStateIterator(StateIteratorData<Arc> *data) const override {
+    rule_->InitStateIterator(data);
+  }
+
+  void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const override {
+    rule_->InitArcIterator(s, data);
+  }
+
+  MatcherBase<Arc> *InitMatcher(MatchType match_type) const override {
+    return rule_->InitMatcher(match_type);
+  }
+
+ private:
+  std::shared_ptr<const ILabelLookAheadRule<Arc>> first_;
+  std::shared_ptr<const Fst<Arc>> rule_;
+
+  LookAheadRuleFst &operator=(const LookAheadRuleFst &) = delete;
+};
+
+}  // namespace fst
+
+#endif  // PYNINI_LOOKAHEADRULE_H_
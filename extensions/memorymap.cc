@@ -0,0 +1,62 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "memorymap.h"
+
+#include <mutex>
+#include <string>
+
+#include <fst/fst.h>
+
+namespace fst {
+namespace {
+
+// The flag values in effect before the outermost scope was entered.
+struct MemoryMapState {
+  std::mutex mutex;
+  int num_scopes = 0;
+  std::string read_mode;
+  bool align = false;
+};
+
+MemoryMapState &GetMemoryMapState() {
+  static auto *kState = new MemoryMapState;
+  return *kState;
+}
+
+}  // namespace
+
+ScopedFstMemoryMap::ScopedFstMemoryMap() {
+  auto &state = GetMemoryMapState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (state.num_scopes++ == 0) {
+    state.read_mode = FST_FLAGS_fst_read_mode;
+    state.align = FST_FLAGS_fst_align;
+    FST_FLAGS_fst_read_mode = "map";
+    FST_FLAGS_fst_align = true;
+  }
+}
+
+ScopedFstMemoryMap::~ScopedFstMemoryMap() {
+  auto &state = GetMemoryMapState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (--state.num_scopes == 0) {
+    FST_FLAGS_fst_read_mode = state.read_mode;
+    FST_FLAGS_fst_align = state.align;
+  }
+}
+
+}  // namespace fst
@@ -0,0 +1,54 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_MEMORYMAP_H_
+#define PYNINI_MEMORYMAP_H_
+
+// Support for memory-mapping the FSTs stored in FARs.
+//
+// OpenFst memory-maps an FST being read from a file, if its type supports it
+// (e.g., ConstFst), when the --fst_read_mode flag is "map", and pads FSTs being
+// written so that they can later be mapped when the --fst_align flag is true.
+// FAR readers and writers construct their read and write options from these
+// flags, so they are overridden while FAR members are being read or written.
+// Mapped FSTs share their pages, via the page cache, with every other process
+// mapping the same FAR, and are never copied onto the heap.
+
+namespace fst {
+
+// While any instance exists, FSTs are memory-mapped when read, if their type
+// supports it, and aligned when written; the previous flag values are restored
+// once the last instance is destroyed. Instances may be nested.
+//
+// This is not thread-safe. The flags are process-wide, and are read without
+// synchronization by every FST or FAR reader and writer, so no other thread
+// may read or write FSTs while an instance exists; those which do race with
+// the change, and may also map or align their FSTs. The internal mutex only
+// keeps the count of instances consistent.
+class ScopedFstMemoryMap {
+ public:
+  ScopedFstMemoryMap();
+
+  ~ScopedFstMemoryMap();
+
+ private:
+  ScopedFstMemoryMap(const ScopedFstMemoryMap &) = delete;
+  ScopedFstMemoryMap &operator=(const ScopedFstMemoryMap &) = delete;
+};
+
+}  // namespace fst
+
+#endif  // PYNINI_MEMORYMAP_H_
@@ -0,0 +1,161 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_MEMORYUSAGE_H_
+#define PYNINI_MEMORYUSAGE_H_
+
+// Approximate accounting of the memory held by FSTs and the caches built on
+// them, so that processes holding many grammars can cap what each may use.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <fst/cache.h>
+#include <fst/compose.h>
+#include <fst/fst.h>
+#include <fst/properties.h>
+#include <fst/symbol-table.h>
+#include <fst/vector-fst.h>
+
+namespace fst {
+
+// Approximate memory usage, in bytes. Container overhead beyond that of each
+// state, arc, and symbol (e.g., unused vector capacity) is not counted.
+struct MemoryStats {
+  // Storage for the states (including their final weights) and arcs of
+  // expanded FSTs; delayed FSTs are not counted, since counting their states
+  // would expand them.
+  size_t states = 0;
+  size_t arcs = 0;
+  // Storage for symbol tables; a table shared by both sides is counted once.
+  size_t symbols = 0;
+  // Memory held by caches, such as those of delayed compositions. Where the
+  // size of a cache cannot be observed, this is the limit it is bounded by.
+  size_t caches = 0;
+
+  size_t Total() const { return states + arcs + symbols + caches; }
+
+  MemoryStats &operator+=(const MemoryStats &other) {
+    states += other.states;
+    arcs += other.arcs;
+    symbols += other.symbols;
+    caches += other.caches;
+    return *this;
+  }
+};
+
+// A delayed composition which records the limit on its state cache, together
+// with those of any such compositions it is built on, since OpenFst does not
+// report either the size or the limit of a cache; MemoryUsage counts this
+// limit. If garbage collection is disabled, the cache is unbounded, and is not
+// counted.
+template <class A>
+class BoundedComposeFst : public ComposeFst<A> {
+ public:
+  using Arc = A;
+
+  BoundedComposeFst(const Fst<Arc> &fst1, const Fst<Arc> &fst2,
+                    const CacheOptions &opts = CacheOptions())
+      : ComposeFst<Arc>(fst1, fst2, opts),
+        cache_limit_((opts.gc ? opts.gc_limit : 0) + CacheLimit(fst1) +
+                     CacheLimit(fst2)) {}
+
+  BoundedComposeFst(const BoundedComposeFst &fst, bool safe = false)
+      : ComposeFst<Arc>(fst, safe), cache_limit_(fst.cache_limit_) {}
+
+  static const std::string &StaticType() {
+    static const auto *const type = new std::string("bounded_compose");
+    return *type;
+  }
+
+  const std::string &Type() const override { return StaticType(); }
+
+  BoundedComposeFst *Copy(bool safe = false) const override {
+    return new BoundedComposeFst(*this, safe);
+  }
+
+  // The sum of the limits on the caches of this composition and of those it
+  // is built on.
+  size_t CacheLimit() const { return cache_limit_; }
+
+  static size_t CacheLimit(const Fst<Arc> &fst) {
+    return fst.Type() == StaticType()
+               ? static_cast<const BoundedComposeFst &>(fst).CacheLimit()
+               : 0;
+  }
+
+ private:
+  const size_t cache_limit_;
+};
+
+namespace internal {
+
+// Whether two tables hold the same symbols; FSTs hold their own copies of
+// their tables, so a table shared by both sides is not the same object.
+inline bool SameSymbolTables(const SymbolTable *symbols1,
+                             const SymbolTable *symbols2) {
+  if (symbols1 == symbols2) return true;
+  if (!symbols1 || !symbols2) return false;
+  return symbols1->NumSymbols() == symbols2->NumSymbols() &&
+         symbols1->LabeledCheckSum() == symbols2->LabeledCheckSum();
+}
+
+// Each symbol is stored once, along with its label, and is indexed by hash.
+inline size_t SymbolTableMemoryUsage(const SymbolTable *symbols) {
+  if (!symbols) return 0;
+  size_t bytes = sizeof(SymbolTable) + symbols->Name().size();
+  for (const auto &item : *symbols) {
+    bytes += sizeof(std::string) + item.Symbol().size() + 2 * sizeof(int64_t);
+  }
+  return bytes;
+}
+
+}  // namespace internal
+
+// Returns the approximate memory usage of an FST. The states of a VectorFst
+// are allocated separately, and are counted as such; other expanded FSTs,
+// such as ConstFsts, are assumed to store their states in flat arrays. The
+// storage of a memory-mapped FST is counted, even though it may be shared
+// with other processes. The states of delayed FSTs are not counted, but the
+// cache limits of a BoundedComposeFst are.
+template <class Arc>
+MemoryStats MemoryUsage(const Fst<Arc> &fst) {
+  using Weight = typename Arc::Weight;
+  MemoryStats stats;
+  if (fst.Properties(kExpanded, false)) {
+    const size_t state_bytes =
+        fst.Type() == "vector"
+            ? sizeof(VectorState<Arc>) + sizeof(VectorState<Arc> *)
+            : sizeof(Weight) + 4 * sizeof(uint32_t);
+    for (StateIterator<Fst<Arc>> siter(fst); !siter.Done(); siter.Next()) {
+      stats.states += state_bytes;
+      stats.arcs += fst.NumArcs(siter.Value()) * sizeof(Arc);
+    }
+  }
+  stats.caches = BoundedComposeFst<Arc>::CacheLimit(fst);
+  const auto *isymbols = fst.InputSymbols();
+  const auto *osymbols = fst.OutputSymbols();
+  stats.symbols = internal::SymbolTableMemoryUsage(isymbols);
+  if (!internal::SameSymbolTables(isymbols, osymbols)) {
+    stats.symbols += internal::SymbolTableMemoryUsage(osymbols);
+  }
+  return stats;
+}
+
+}  // namespace fst
+
+#endif  // PYNINI_MEMORYUSAGE_H_
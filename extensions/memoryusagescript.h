@@ -0,0 +1,40 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_MEMORYUSAGESCRIPT_H_
+#define PYNINI_MEMORYUSAGESCRIPT_H_
+
+#include <fst/script/arg-packs.h>
+#include <fst/script/fst-class.h>
+#include "memoryusage.h"
+
+namespace fst {
+namespace script {
+
+using MemoryUsageArgs = WithReturnValue<MemoryStats, const FstClass &>;
+
+template <class Arc>
+void MemoryUsage(MemoryUsageArgs *args) {
+  const Fst<Arc> &fst = *args->args.GetFst<Arc>();
+  args->retval = MemoryUsage(fst);
+}
+
+MemoryStats MemoryUsage(const FstClass &fst);
+
+}  // namespace script
+}  // namespace fst
+
+#endif  // PYNINI_MEMORYUSAGESCRIPT_H_
@@ -26,21 +26,72 @@
 // construction of integrated speech recognition transducers. In Proc. ICASSP,
 // pages 761-764.
 
+#include <chrono>
 #include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <fst/types.h>
+#include <fst/log.h>
 #include <fst/arcsort.h>
+#include <fst/cache.h>
 #include <fst/determinize.h>
 #include <fst/encode.h>
 #include <fst/minimize.h>
 #include <fst/mutable-fst.h>
 #include <fst/rmepsilon.h>
 #include <fst/state-map.h>
+#include <fst/vector-fst.h>
 
 // These functions are generic optimization methods for mutable FSTs, inspired
 // by those originally included in Thrax.
 
 namespace fst {
+
+// Wall time and size of the FST before and after one phase of optimization;
+// the phases are "rmepsilon", "encode", "determinize", "minimize", "decode",
+// and "arcsum".
+struct OptimizePhaseStats {
+  std::string name;
+  double seconds = 0.0;
+  int64_t input_states = 0;
+  int64_t input_arcs = 0;
+  int64_t output_states = 0;
+  int64_t output_arcs = 0;
+};
+
+// Optionally records what the optimization functions did, for profiling.
+struct OptimizeStats {
+  void Clear() { *this = OptimizeStats(); }
+
+  // Whether the FST was optimized as an acceptor.
+  bool acceptor = false;
+  // Whether the FST was determinized.
+  bool determinized = false;
+  // The EncodeMapper flags used before determinization, or 0 if the FST was
+  // not encoded.
+  uint8_t encode_flags = 0;
+  // Whether determinization was abandoned because it exceeded OptimizeLimits.
+  bool limit_exceeded = false;
+  // The phases run, in order.
+  std::vector<OptimizePhaseStats> phases;
+};
+
+// Optional ceilings on the size of the determinized FST; negative values mean
+// no limit. If determinization would exceed either one, it is abandoned and
+// the FST is left epsilon-free but not determinized or minimized. The number
+// of bytes is estimated from the states and arcs of the result, and does not
+// include the bookkeeping of determinization itself.
+struct OptimizeLimits {
+  bool Unlimited() const {
+    return max_determinized_states < 0 && max_determinized_bytes < 0;
+  }
+
+  int64_t max_determinized_states = -1;
+  int64_t max_determinized_bytes = -1;
+};
+
 namespace internal {
 
 constexpr uint64_t kDoNotEncodeWeights =
@@ -48,18 +99,149 @@ constexpr uint64_t kDoNotEncodeWeights =
 
 // Helpers.
 
+template <class Arc>
+void CountStatesAndArcs(const MutableFst<Arc> &fst, int64_t *num_states,
+                        int64_t *num_arcs) {
+  *num_states = fst.NumStates();
+  *num_arcs = 0;
+  for (typename Arc::StateId s = 0; s < *num_states; ++s) {
+    *num_arcs += fst.NumArcs(s);
+  }
+}
+
+// Records a phase of optimization, which lasts for the lifetime of this
+// object, if stats is non-null; otherwise, this does nothing.
+template <class Arc>
+class OptimizePhase {
+ public:
+  OptimizePhase(const char *name, const MutableFst<Arc> &fst,
+                OptimizeStats *stats)
+      : fst_(fst), stats_(stats) {
+    if (!stats_) return;
+    phase_.name = name;
+    CountStatesAndArcs(fst_, &phase_.input_states, &phase_.input_arcs);
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  ~OptimizePhase() {
+    if (!stats_) return;
+    phase_.seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start_)
+                         .count();
+    CountStatesAndArcs(fst_, &phase_.output_states, &phase_.output_arcs);
+    stats_->phases.push_back(std::move(phase_));
+  }
+
+ private:
+  const MutableFst<Arc> &fst_;
+  OptimizeStats *stats_;
+  OptimizePhaseStats phase_;
+  std::chrono::steady_clock::time_point start_;
+
+  OptimizePhase(const OptimizePhase &) = delete;
+  OptimizePhase &operator=(const OptimizePhase &) = delete;
+};
+
 // Calls RmEpsilon if the FST is not (known to be) epsilon-free.
 template <class Arc>
-void MaybeRmEpsilon(MutableFst<Arc> *fst, bool compute_props = false) {
+void MaybeRmEpsilon(MutableFst<Arc> *fst, bool compute_props = false,
+                    OptimizeStats *stats = nullptr) {
   if (fst->Properties(kNoEpsilons, compute_props) != kNoEpsilons) {
+    OptimizePhase<Arc> phase("rmepsilon", *fst, stats);
     RmEpsilon(fst);
   }
 }
 
+// Determinizes the FST, unless the result would exceed the limits, in which
+// case the FST is left unchanged and false is returned. The determinized
+// states are expanded one at a time, in the order they are discovered, so
+// determinization stops as soon as a limit is reached.
+template <class Arc>
+bool BoundedDeterminize(MutableFst<Arc> *fst, const OptimizeLimits &limits) {
+  using StateId = typename Arc::StateId;
+  if (limits.Unlimited()) {
+    Determinize(*fst, fst);
+    return true;
+  }
+  // Expanded states need not be cached, since each is only visited once.
+  const DeterminizeFstOptions<Arc> opts(CacheOptions(true, 0));
+  const DeterminizeFst<Arc> dfst(*fst, opts);
+  VectorFst<Arc> result;
+  const auto start = dfst.Start();
+  const auto add_state = [&result](StateId s) {
+    while (result.NumStates() <= s) result.AddState();
+  };
+  int64_t num_arcs = 0;
+  if (start != kNoStateId) {
+    add_state(start);
+    result.SetStart(start);
+  }
+  // Determinized states are numbered densely in the order they are found.
+  for (StateId s = 0; s < result.NumStates(); ++s) {
+    const int64_t num_bytes =
+        result.NumStates() * sizeof(typename VectorFst<Arc>::State) +
+        num_arcs * sizeof(Arc);
+    if ((limits.max_determinized_states >= 0 &&
+         result.NumStates() > limits.max_determinized_states) ||
+        (limits.max_determinized_bytes >= 0 &&
+         num_bytes > limits.max_determinized_bytes)) {
+      LOG(WARNING) << "Optimize: Determinization exceeded the limit of "
+                   << limits.max_determinized_states << " states or "
+                   << limits.max_determinized_bytes
+                   << " bytes; leaving the FST undeterminized";
+      return false;
+    }
+    result.SetFinal(s, dfst.Final(s));
+    result.ReserveArcs(s, dfst.NumArcs(s));
+    for (ArcIterator<DeterminizeFst<Arc>> aiter(dfst, s); !aiter.Done();
+         aiter.Next()) {
+      const auto &arc = aiter.Value();
+      add_state(arc.nextstate);
+      result.AddArc(s, arc);
+      ++num_arcs;
+    }
+  }
+  if (dfst.Properties(kError, false)) result.SetProperties(kError, kError);
+  static constexpr auto kDeterminizedProperties =
+      kIDeterministic | kODeterministic;
+  const auto props = dfst.Properties(kDeterminizedProperties, false);
+  result.SetInputSymbols(fst->InputSymbols());
+  result.SetOutputSymbols(fst->OutputSymbols());
+  *fst = result;
+  fst->SetProperties(props, props);
+  return true;
+}
+
+// Returns false, leaving the FST unchanged, if determinization exceeds the
+// limits.
 template <class Arc>
-void DeterminizeAndMinimize(MutableFst<Arc> *fst) {
-  Determinize(*fst, fst);
+bool DeterminizeAndMinimize(MutableFst<Arc> *fst,
+                            OptimizeStats *stats = nullptr,
+                            const OptimizeLimits &limits = OptimizeLimits()) {
+  {
+    OptimizePhase<Arc> phase("determinize", *fst, stats);
+    if (!BoundedDeterminize(fst, limits)) {
+      if (stats) stats->limit_exceeded = true;
+      return false;
+    }
+  }
+  if (stats) stats->determinized = true;
+  OptimizePhase<Arc> phase("minimize", *fst, stats);
   Minimize(fst);
+  return true;
+}
+
+template <class Arc>
+void MinimizeWithStats(MutableFst<Arc> *fst, OptimizeStats *stats = nullptr) {
+  OptimizePhase<Arc> phase("minimize", *fst, stats);
+  Minimize(fst);
+}
+
+// Combines any remaining multi-arcs.
+template <class Arc>
+void ArcSum(MutableFst<Arc> *fst, OptimizeStats *stats = nullptr) {
+  OptimizePhase<Arc> phase("arcsum", *fst, stats);
+  StateMap(fst, ArcSumMapper<Arc>(*fst));
 }
 
 // Optimizes the FST according to the encoder flags:
@@ -67,80 +249,107 @@ void DeterminizeAndMinimize(MutableFst<Arc> *fst) {
 //   kEncodeLabels: optimize as a weighted acceptor
 //   kEncodeWeights: optimize as an unweighted transducer
 //   kEncodeLabels | kEncodeWeights: optimize as an unweighted acceptor
+//
+// Returns false if determinization exceeds the limits, in which case the FST
+// is left as it was.
 template <class Arc>
-void OptimizeAs(MutableFst<Arc> *fst, uint8_t flags) {
+bool OptimizeAs(MutableFst<Arc> *fst, uint8_t flags,
+                OptimizeStats *stats = nullptr,
+                const OptimizeLimits &limits = OptimizeLimits()) {
+  if (stats) stats->encode_flags = flags;
   EncodeMapper<Arc> encoder(flags);
-  Encode(fst, &encoder);
-  DeterminizeAndMinimize(fst);
+  {
+    OptimizePhase<Arc> phase("encode", *fst, stats);
+    Encode(fst, &encoder);
+  }
+  const bool success = DeterminizeAndMinimize(fst, stats, limits);
+  OptimizePhase<Arc> phase("decode", *fst, stats);
   Decode(fst, encoder);
+  return success;
 }
 
 // Generic FST optimization function to be used when the FST is known to be an
 // acceptor.
 template <class Arc>
-void OptimizeAcceptor(MutableFst<Arc> *fst, bool compute_props = false) {
+bool OptimizeAcceptor(MutableFst<Arc> *fst, bool compute_props = false,
+                      OptimizeStats *stats = nullptr,
+                      const OptimizeLimits &limits = OptimizeLimits()) {
+  if (stats) stats->acceptor = true;
   // If the FST is not (known to be) epsilon-free, perform epsilon-removal.
-  MaybeRmEpsilon(fst, compute_props);
+  MaybeRmEpsilon(fst, compute_props, stats);
   if (fst->Properties(kIDeterministic, compute_props) != kIDeterministic) {
     if constexpr ((Arc::Weight::Properties() & kIdempotent) == kIdempotent) {
       // If the FST is not known to have no weighted cycles, it is encoded
       // before determinization and minimization.
       if (!fst->Properties(kDoNotEncodeWeights, compute_props)) {
-        OptimizeAs(fst, kEncodeWeights);
+        if (!OptimizeAs(fst, kEncodeWeights, stats, limits)) return false;
         // Combines any remaining muti-arcs.
-        StateMap(fst, ArcSumMapper<Arc>(*fst));
+        ArcSum(fst, stats);
       } else {
-        DeterminizeAndMinimize(fst);
+        return DeterminizeAndMinimize(fst, stats, limits);
       }
     } else if (fst->Properties(kAcyclic, compute_props) == kAcyclic) {
       // "Any acyclic weighted automaton over a zero-sum-free semiring has
       // the twins property and is determinizable" (Mohri 2006).
-      DeterminizeAndMinimize(fst);
+      return DeterminizeAndMinimize(fst, stats, limits);
     }
   } else {
-    Minimize(fst);
+    MinimizeWithStats(fst, stats);
   }
+  return true;
 }
 
 // Generic FST optimization function to be used when the FST may be a
 // transducer.
 template <class Arc>
-void OptimizeTransducer(MutableFst<Arc> *fst, bool compute_props = false) {
+bool OptimizeTransducer(MutableFst<Arc> *fst, bool compute_props = false,
+                        OptimizeStats *stats = nullptr,
+                        const OptimizeLimits &limits = OptimizeLimits()) {
+  if (stats) stats->acceptor = false;
   // If the FST is not (known to be) epsilon-free, perform epsilon-removal.
-  MaybeRmEpsilon(fst, compute_props);
+  MaybeRmEpsilon(fst, compute_props, stats);
   if (fst->Properties(kIDeterministic, compute_props) != kIDeterministic) {
     if constexpr ((Arc::Weight::Properties() & kIdempotent) == kIdempotent) {
       // If the FST is not known to have no weighted cycles, it is encoded
       // before determinization and minimization.
       if (!fst->Properties(kDoNotEncodeWeights, compute_props)) {
-        OptimizeAs(fst, kEncodeLabels | kEncodeWeights);
+        if (!OptimizeAs(fst, kEncodeLabels | kEncodeWeights, stats, limits)) {
+          return false;
+        }
         // Combines any remaining muti-arcs.
-        StateMap(fst, ArcSumMapper<Arc>(*fst));
+        ArcSum(fst, stats);
       } else {
-        OptimizeAs(fst, kEncodeLabels);
+        return OptimizeAs(fst, kEncodeLabels, stats, limits);
       }
     } else if (fst->Properties(kAcyclic, compute_props) == kAcyclic) {
       // "Any acyclic weighted automaton over a zero-sum-free semiring has
       // the twins property and is determinizable" (Mohri 2006).
-      OptimizeAs(fst, kEncodeLabels);
+      return OptimizeAs(fst, kEncodeLabels, stats, limits);
     }
   } else {
-    Minimize(fst);
+    MinimizeWithStats(fst, stats);
   }
+  return true;
 }
 
 }  // namespace internal
 
 // Generic FST optimization function; use the more-specialized forms below if
-// the FST is known to be an acceptor or a transducer.
+// the FST is known to be an acceptor or a transducer. If stats is non-null,
+// it is overwritten with a record of the optimizations performed. Returns
+// false if determinization was abandoned because it exceeded the limits, in
+// which case the FST is epsilon-free but otherwise unoptimized.
 template <class Arc>
-void Optimize(MutableFst<Arc> *fst, bool compute_props = false) {
+bool Optimize(MutableFst<Arc> *fst, bool compute_props = false,
+              OptimizeStats *stats = nullptr,
+              const OptimizeLimits &limits = OptimizeLimits()) {
+  if (stats) stats->Clear();
   if (fst->Properties(kAcceptor, compute_props) != kAcceptor) {
     // The FST is (may be) a transducer.
-    internal::OptimizeTransducer(fst, compute_props);
+    return internal::OptimizeTransducer(fst, compute_props, stats, limits);
   } else {
     // The FST is (known to be) an acceptor.
-    internal::OptimizeAcceptor(fst, compute_props);
+    return internal::OptimizeAcceptor(fst, compute_props, stats, limits);
   }
 }
 
@@ -0,0 +1,84 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks of FST optimization.
+
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <fst/arc.h>
+#include <fst/union.h>
+#include <fst/vector-fst.h>
+#include "benchmark_util.h"
+#include "cross.h"
+#include "optimize.h"
+#include "stringcompile.h"
+
+namespace fst {
+namespace {
+
+using ::fst::benchmark_util::NumberName;
+using ::fst::benchmark_util::RandomWords;
+
+// The union of many string acceptors, as built by repeated `|` in a grammar:
+// non-deterministic, with an epsilon arc per string.
+VectorFst<StdArc> UnionOfWords(int num_words) {
+  VectorFst<StdArc> result;
+  for (const auto &word : RandomWords(num_words)) {
+    VectorFst<StdArc> fst;
+    StringCompile(word, &fst);
+    Union(&result, fst);
+  }
+  return result;
+}
+
+// The same, but of string transducers from digits to number names, which are
+// optimized by encoding labels.
+VectorFst<StdArc> UnionOfNumberNames(int max_number) {
+  VectorFst<StdArc> result;
+  for (int number = 0; number <= max_number; ++number) {
+    VectorFst<StdArc> input;
+    VectorFst<StdArc> output;
+    StringCompile(std::to_string(number), &input);
+    StringCompile(NumberName(number), &output);
+    VectorFst<StdArc> cross;
+    Cross(input, output, &cross);
+    Union(&result, cross);
+  }
+  return result;
+}
+
+void BM_OptimizeAcceptor(benchmark::State &state) {
+  const auto fst = UnionOfWords(state.range(0));
+  for (auto _ : state) {
+    VectorFst<StdArc> copy(fst);
+    Optimize(&copy);
+    benchmark::DoNotOptimize(copy.NumStates());
+  }
+}
+BENCHMARK(BM_OptimizeAcceptor)->Arg(100)->Arg(10000);
+
+void BM_OptimizeTransducer(benchmark::State &state) {
+  const auto fst = UnionOfNumberNames(state.range(0));
+  for (auto _ : state) {
+    VectorFst<StdArc> copy(fst);
+    Optimize(&copy);
+    benchmark::DoNotOptimize(copy.NumStates());
+  }
+}
+BENCHMARK(BM_OptimizeTransducer)->Arg(99)->Arg(999);
+
+}  // namespace
+}  // namespace fst
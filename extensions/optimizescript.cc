@@ -22,20 +22,23 @@
 namespace fst {
 namespace script {
 
-void Optimize(MutableFstClass *fst, bool compute_props) {
-  OptimizeArgs args(fst, compute_props);
+bool Optimize(MutableFstClass *fst, bool compute_props, OptimizeStats *stats,
+              const OptimizeLimits &limits) {
+  OptimizeInnerArgs iargs(fst, compute_props, stats, limits);
+  OptimizeArgs args(iargs);
   Apply<Operation<OptimizeArgs>>("Optimize", fst->ArcType(), &args);
+  return args.retval;
 }
 
 REGISTER_FST_OPERATION_3ARCS(Optimize, OptimizeArgs);
 
 void OptimizeDifferenceRhs(MutableFstClass *fst, bool compute_props) {
-  OptimizeArgs args(fst, compute_props);
-  Apply<Operation<OptimizeArgs>>("OptimizeDifferenceRhs", fst->ArcType(),
-                                 &args);
+  OptimizeDifferenceRhsArgs args(fst, compute_props);
+  Apply<Operation<OptimizeDifferenceRhsArgs>>("OptimizeDifferenceRhs",
+                                              fst->ArcType(), &args);
 }
 
-REGISTER_FST_OPERATION_3ARCS(OptimizeDifferenceRhs, OptimizeArgs);
+REGISTER_FST_OPERATION_3ARCS(OptimizeDifferenceRhs, OptimizeDifferenceRhsArgs);
 
 }  // namespace script
 }  // namespace fst
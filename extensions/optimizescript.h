@@ -19,24 +19,33 @@
 
 #include <utility>
 
+#include <fst/script/arg-packs.h>
 #include <fst/script/fst-class.h>
 #include "optimize.h"
 
 namespace fst {
 namespace script {
 
-using OptimizeArgs = std::tuple<MutableFstClass *, bool>;
+using OptimizeInnerArgs = std::tuple<MutableFstClass *, bool, OptimizeStats *,
+                                     const OptimizeLimits &>;
+
+using OptimizeArgs = WithReturnValue<bool, OptimizeInnerArgs>;
 
 template <class Arc>
 void Optimize(OptimizeArgs *args) {
-  MutableFst<Arc> *fst = std::get<0>(*args)->GetMutableFst<Arc>();
-  Optimize(fst, std::get<1>(*args));
+  MutableFst<Arc> *fst = std::get<0>(args->args)->GetMutableFst<Arc>();
+  args->retval = Optimize(fst, std::get<1>(args->args),
+                          std::get<2>(args->args), std::get<3>(args->args));
 }
 
-void Optimize(MutableFstClass *fst, bool compute_props = false);
+bool Optimize(MutableFstClass *fst, bool compute_props = false,
+              OptimizeStats *stats = nullptr,
+              const OptimizeLimits &limits = OptimizeLimits());
+
+using OptimizeDifferenceRhsArgs = std::tuple<MutableFstClass *, bool>;
 
 template <class Arc>
-void OptimizeDifferenceRhs(OptimizeArgs *args) {
+void OptimizeDifferenceRhs(OptimizeDifferenceRhsArgs *args) {
   MutableFst<Arc> *fst = std::get<0>(*args)->GetMutableFst<Arc>();
   OptimizeDifferenceRhs(fst, std::get<1>(*args));
 }
@@ -0,0 +1,68 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_PARALLEL_H_
+#define PYNINI_PARALLEL_H_
+
+// Simple helpers for distributing independent work items across threads.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace fst {
+namespace internal {
+
+// Returns the number of workers to use for `size` work items. If
+// `num_threads` is not positive, the hardware concurrency is used instead.
+inline size_t NumWorkers(size_t size, int num_threads) {
+  size_t workers = num_threads > 0 ? num_threads
+                                   : std::thread::hardware_concurrency();
+  if (workers == 0) workers = 1;
+  return std::max<size_t>(std::min(workers, size), 1);
+}
+
+// Calls `fn(worker, i)` for every `i` in [0, size), handing out items
+// dynamically to `NumWorkers(size, num_threads)` workers; the calling thread
+// is worker 0. Since each worker index is only ever used by a single thread,
+// it can be used to index per-worker scratch state. `fn` must be safe to
+// call concurrently for distinct items.
+template <class F>
+void ParallelFor(size_t size, int num_threads, F fn) {
+  const auto num_workers = NumWorkers(size, num_threads);
+  if (num_workers == 1) {
+    for (size_t i = 0; i < size; ++i) fn(0, i);
+    return;
+  }
+  std::atomic<size_t> next(0);
+  const auto work = [&fn, &next, size](size_t worker) {
+    for (auto i = next++; i < size; i = next++) fn(worker, i);
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(num_workers - 1);
+  for (size_t worker = 1; worker < num_workers; ++worker) {
+    threads.emplace_back(work, worker);
+  }
+  work(0);
+  for (auto &thread : threads) thread.join();
+}
+
+}  // namespace internal
+}  // namespace fst
+
+#endif  // PYNINI_PARALLEL_H_
@@ -27,9 +27,10 @@
 // StringPathIterator wrapper knows about this and also checks the input FST's
 // properties (e.g., to make sure that it is acyclic).
 
-#include <cstdint>
+#include <cstddef>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <fst/fst.h>
@@ -37,14 +38,15 @@
 
 namespace fst {
 
-constexpr int32_t kInitialStateIsFinal = -2;
-constexpr int32_t kNewState = -1;
-
 // An iterator to provide a succession of paths from an automaton. Calling
 // Next() gets the next path. Done() returns true if all the paths have been
 // visited. Accessible path values are ILabels()---the sequence of input
 // labels, OLabels()---for output labels, and Weight().
 //
+// Paths are visited in depth-first order: at each state, the path ending
+// there (if the state is final) comes before all paths which pass through it,
+// and those are ordered by the arc they take from it.
+//
 // Note that PathIterator is symbol table and string-agnostic; consider using
 // StringPathIterator if you need either.
 //
@@ -61,7 +63,7 @@ class PathIterator {
 
   explicit PathIterator(const Fst<Arc> &fst, bool check_acyclic = true);
 
-  bool Done() const { return path_states_.empty(); }
+  bool Done() const { return frames_.empty(); }
 
   // Checks if initialization was successful. Check this before accessing the
   // iterator if it was constructed with check_acyclic = true.
@@ -76,39 +78,76 @@ class PathIterator {
   void Reset();
 
   ArcWeight Weight() const {
-    auto weight = ArcWeight::One();
-    for (const auto &path_weight : path_weights_) {
-      weight = Times(weight, path_weight);
-    }
-    return weight;
+    return Times(prefix_weights_.back(), final_weight_);
   }
 
  protected:
   void SetError();
 
  private:
-  // Inserts labels and weights from an arc.
-  void VisitArc(const Arc &arc);
+  // The arcs leaving a state on the current path. Like ArcIterator, this
+  // reads the arc array directly when the FST exposes one, and otherwise
+  // defers to the FST's own arc iterator; unlike ArcIterator, it is movable,
+  // so frames can live in a vector whose storage is reused across paths.
+  class Frame {
+   public:
+    Frame(const Fst<Arc> &fst, StateId state) {
+      fst.InitArcIterator(state, &data_);
+    }
+
+    Frame(Frame &&other) noexcept
+        : data_(std::move(other.data_)), position_(other.position_) {
+      other.data_.ref_count = nullptr;
+    }
+
+    Frame &operator=(Frame &&) = delete;
+
+    ~Frame() {
+      if (data_.ref_count) --(*data_.ref_count);
+    }
+
+    bool Done() const {
+      return data_.base ? data_.base->Done() : position_ >= data_.narcs;
+    }
+
+    const Arc &Value() const {
+      return data_.base ? data_.base->Value() : data_.arcs[position_];
+    }
+
+    void Next() {
+      if (data_.base) {
+        data_.base->Next();
+      } else {
+        ++position_;
+      }
+    }
 
-  void MaybePopLabels();
+   private:
+    ArcIteratorData<Arc> data_;
+    size_t position_ = 0;
+  };
+
+  // Advances to the next final state in depth-first order.
+  void Advance();
 
   // If initialization failed.
   bool error_;
   // Copy of FST being iterated over.
   std::unique_ptr<const Fst<Arc>> fst_;
-  // Vector of states visited on this path.
-  std::vector<StateId> path_states_;
+  // One frame for each state on the current path, starting with the start
+  // state. Each frame is positioned at the next arc to be explored from its
+  // state, so backtracking never requires seeking.
+  std::vector<Frame> frames_;
   // Vector of input labels.
   std::vector<Label> path_ilabels_;
   // Vector of output labels.
   std::vector<Label> path_olabels_;
-  // Vector of weights.
-  std::vector<ArcWeight> path_weights_;
-  // Vector of offsets for each arc iterator for each state, so that we can
-  // remember where we left off. Note that -2 (kInitialStateIsFinal) and -1
-  // (kNewState) here have special meanings, on which see below.
-  std::vector<int32_t> arc_iterator_offsets_;
-  bool pop_labels_;
+  // Vector of prefix weights; the i-th element is the product of the weights
+  // of the first i arcs on the path, so it is one longer than the label
+  // vectors.
+  std::vector<ArcWeight> prefix_weights_;
+  // Final weight of the last state on the current path.
+  ArcWeight final_weight_;
 
   PathIterator(const PathIterator &) = delete;
   PathIterator &operator=(const PathIterator &) = delete;
@@ -116,7 +155,7 @@ class PathIterator {
 
 template <class Arc>
 PathIterator<Arc>::PathIterator(const Fst<Arc> &fst, bool check_acyclic)
-    : error_(false), fst_(fst.Copy()), pop_labels_(false) {
+    : error_(false), fst_(fst.Copy()) {
   if (check_acyclic && !fst.Properties(kAcyclic, true)) {
     SetError();
     FSTERROR() << "PathIterator: Cyclic FSTs have an infinite number of paths";
@@ -127,90 +166,53 @@ PathIterator<Arc>::PathIterator(const Fst<Arc> &fst, bool check_acyclic)
 
 template <class Arc>
 void PathIterator<Arc>::Reset() {
-  pop_labels_ = false;
+  frames_.clear();
+  path_ilabels_.clear();
+  path_olabels_.clear();
+  prefix_weights_.clear();
+  prefix_weights_.push_back(ArcWeight::One());
   const auto start = fst_->Start();
   if (start == kNoStateId) return;
-  // Seeds the search with the start state.
-  path_states_.push_back(start);
-  const auto weight = fst_->Final(start);
-  path_weights_.push_back(weight);
-  // If the initial state is also a final state, then Next() has immediate work
-  // to do, so we indicate that with kInitialStateIsFinal. Otherwise we set it
-  // to kNewState, which means "I haven't started the arc iterator at this state
-  // yet".
-  arc_iterator_offsets_.push_back(weight == ArcWeight::Zero() ?
-                                  kNewState : kInitialStateIsFinal);
-  Next();
+  // Seeds the search with the start state; if it is final, the empty path is
+  // the first path.
+  frames_.emplace_back(*fst_, start);
+  final_weight_ = fst_->Final(start);
+  if (final_weight_ == ArcWeight::Zero()) Advance();
 }
 
 template <class Arc>
 void PathIterator<Arc>::Next() {
   if (Done()) return;
-  if (arc_iterator_offsets_.back() == kInitialStateIsFinal) {
-    arc_iterator_offsets_.pop_back();
-    arc_iterator_offsets_.push_back(kNewState);
-    return;
-  }
-  // At the current state (the back of path_states_) we increment the
-  // arc_iterator offset (meaning that if it's -1, aka kNewState, then we set it
-  // to 0 and therefore start reading).
-  StateId nextstate;
-  while (!Done()) {
-    const auto offset = arc_iterator_offsets_.back() + 1;
-    arc_iterator_offsets_.pop_back();
-    arc_iterator_offsets_.push_back(offset);
-    ArcIterator<Fst<Arc>> aiter(*fst_, path_states_.back());
-    aiter.Seek(offset);
-    // If the arc iterator is done, then we are done at this state, and we move
-    // back.
-    if (aiter.Done()) {
-      MaybePopLabels();
-      path_states_.pop_back();
-      path_weights_.pop_back();
-      arc_iterator_offsets_.pop_back();
-      // Otherwise we proceed moving to the current arc's next state, then break
-      // out of this loop and attempt to move forward.
-    } else {
-      const auto &arc = aiter.Value();
-      MaybePopLabels();
-      path_weights_.pop_back();
-      VisitArc(arc);
-      nextstate = arc.nextstate;
-      break;
-    }
-  }
-  if (Done()) return;
-  // Now we proceed forward until we hit a final state.
-  while (nextstate != kNoStateId) {
-    path_states_.push_back(nextstate);
-    const auto weight = fst_->Final(nextstate);
-    if (weight == ArcWeight::Zero()) {
-      ArcIterator<Fst<Arc>> aiter(*fst_, nextstate);
-      if (aiter.Done()) {
-        // We reached a non-final state with no exiting arcs. Pop it. This
-        // shouldn't happen unless someone passes an unconnected machine.
-        path_states_.pop_back();
-        return;
-      } else {
-        const auto &arc = aiter.Value();
-        VisitArc(arc);
-        nextstate = arc.nextstate;
-        arc_iterator_offsets_.push_back(0);
+  Advance();
+}
+
+template <class Arc>
+void PathIterator<Arc>::Advance() {
+  while (!frames_.empty()) {
+    auto &frame = frames_.back();
+    if (frame.Done()) {
+      // All paths through this state have been visited, so we backtrack
+      // over the arc which led to it, if any.
+      frames_.pop_back();
+      if (!frames_.empty()) {
+        path_ilabels_.pop_back();
+        path_olabels_.pop_back();
+        prefix_weights_.pop_back();
       }
-    } else {
-      // If we are at a final state, we act as if we have taken a transition to
-      // a hallucinated superfinal state which is the "real" final state and
-      // which is the sole destination for any arc leaving a final state. This
-      // bit of pretend is necessary so that we don't actually rewind in the
-      // case that there are valid suffixes of the path terminating here, as in
-      // something like /foo(bar)?/. Path weights and arc iterator offsets will
-      // be popped on the next iteration, but we will not pop labels as no arcs
-      // in the input FST are being traversed here.
-      pop_labels_ = false;
-      path_weights_.push_back(weight);
-      arc_iterator_offsets_.push_back(-1);
-      return;
+      continue;
     }
+    // Otherwise we take the frame's next arc, moving the frame past it so
+    // that we resume with the following arc when we backtrack.
+    const auto &arc = frame.Value();
+    const auto nextstate = arc.nextstate;
+    path_ilabels_.push_back(arc.ilabel);
+    path_olabels_.push_back(arc.olabel);
+    prefix_weights_.push_back(Times(prefix_weights_.back(), arc.weight));
+    frame.Next();
+    // This may invalidate `frame` and `arc`.
+    frames_.emplace_back(*fst_, nextstate);
+    final_weight_ = fst_->Final(nextstate);
+    if (final_weight_ != ArcWeight::Zero()) return;
   }
 }
 
@@ -219,23 +221,6 @@ void PathIterator<Arc>::SetError() {
   error_ = true;
 }
 
-template <class Arc>
-void PathIterator<Arc>::VisitArc(const Arc &arc) {
-  path_ilabels_.push_back(arc.ilabel);
-  path_olabels_.push_back(arc.olabel);
-  path_weights_.push_back(arc.weight);
-}
-
-template <class Arc>
-void PathIterator<Arc>::MaybePopLabels() {
-  if (pop_labels_) {
-    path_ilabels_.pop_back();
-    path_olabels_.pop_back();
-  } else {
-    pop_labels_ = true;
-  }
-}
-
 // A useful alias when using StdArc.
 using StdPathIterator = PathIterator<StdArc>;
 
@@ -0,0 +1,59 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks of path iteration.
+
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <fst/arc.h>
+#include <fst/vector-fst.h>
+#include "benchmark_util.h"
+#include "paths.h"
+#include "stringmap.h"
+
+namespace fst {
+namespace {
+
+using ::fst::benchmark_util::NumberNameLines;
+
+// The argument is the largest number in the map, so there is one more path.
+void BM_PathIterator(benchmark::State &state) {
+  VectorFst<StdArc> fst;
+  StringMapCompile(NumberNameLines(state.range(0)), &fst);
+  for (auto _ : state) {
+    for (PathIterator<StdArc> paths(fst); !paths.Done(); paths.Next()) {
+      benchmark::DoNotOptimize(paths.OLabels().size());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * (state.range(0) + 1));
+}
+BENCHMARK(BM_PathIterator)->Arg(999)->Arg(99999);
+
+// The same, but also converts each path to strings.
+void BM_StringPathIterator(benchmark::State &state) {
+  VectorFst<StdArc> fst;
+  StringMapCompile(NumberNameLines(state.range(0)), &fst);
+  for (auto _ : state) {
+    for (StringPathIterator<StdArc> paths(fst); !paths.Done(); paths.Next()) {
+      benchmark::DoNotOptimize(paths.OString());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * (state.range(0) + 1));
+}
+BENCHMARK(BM_StringPathIterator)->Arg(999)->Arg(99999);
+
+}  // namespace
+}  // namespace fst
@@ -36,6 +36,17 @@ StringPathIteratorClass::StringPathIteratorClass(
 REGISTER_FST_OPERATION_3ARCS(InitStringPathIteratorClass,
                              InitStringPathIteratorClassArgs);
 
+ShortestStringIteratorClass::ShortestStringIteratorClass(
+    const FstClass &fst, TokenType token_type, const SymbolTable *symbols)
+    : impl_(nullptr) {
+  InitShortestStringIteratorClassArgs args(fst, token_type, symbols, this);
+  Apply<Operation<InitShortestStringIteratorClassArgs>>(
+      "InitShortestStringIteratorClass", fst.ArcType(), &args);
+}
+
+REGISTER_FST_OPERATION_3ARCS(InitShortestStringIteratorClass,
+                             InitShortestStringIteratorClassArgs);
+
 }  // namespace script
 }  // namespace fst
 
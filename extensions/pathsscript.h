@@ -19,11 +19,14 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include <fst/script/arg-packs.h>
 #include <fst/script/fstscript.h>
 #include "paths.h"
+#include "shorteststrings.h"
+#include "stringprint.h"
 
 namespace fst {
 namespace script {
@@ -33,6 +36,9 @@ class StringPathIteratorImplBase {
  public:
   virtual bool Done() const = 0;
   virtual bool Error() const = 0;
+  virtual bool Extract(int64_t limit, std::vector<std::string> *istrings,
+                       std::vector<std::string> *ostrings,
+                       std::vector<WeightClass> *weights) = 0;
   virtual void ILabels(std::vector<int64_t> *labels) const = 0;
   virtual std::vector<int64_t> ILabels() const = 0;
   virtual void IString(std::string *result) const = 0;
@@ -60,12 +66,33 @@ class StringPathIteratorImpl : public StringPathIteratorImplBase {
                                   const SymbolTable *output_symbols = nullptr)
       : impl_(new StringPathIterator<Arc>(fst, input_token_type,
                                           output_token_type, input_symbols,
-                                          output_symbols)) {}
+                                          output_symbols)),
+        iprinter_(input_token_type, input_symbols),
+        oprinter_(output_token_type, output_symbols) {}
 
   bool Done() const override { return impl_->Done(); }
 
   bool Error() const override { return impl_->Error(); }
 
+  // Appends the strings and weight of the current path and of each following
+  // path, up to `limit` paths in total (or all of them, if `limit` is
+  // negative), advancing the iterator past them.
+  bool Extract(int64_t limit, std::vector<std::string> *istrings,
+               std::vector<std::string> *ostrings,
+               std::vector<WeightClass> *weights) override {
+    for (int64_t i = 0; !impl_->Done() && (limit < 0 || i < limit);
+         ++i, impl_->Next()) {
+      istrings->emplace_back();
+      ostrings->emplace_back();
+      if (!iprinter_.Append(impl_->ILabels(), &istrings->back()) ||
+          !oprinter_.Append(impl_->OLabels(), &ostrings->back())) {
+        return false;
+      }
+      weights->emplace_back(impl_->Weight());
+    }
+    return true;
+  }
+
   void ILabels(std::vector<int64_t> *labels) const override {
     const auto &typed_labels = impl_->ILabels();
     labels->clear();
@@ -108,6 +135,9 @@ class StringPathIteratorImpl : public StringPathIteratorImplBase {
 
  private:
   std::unique_ptr<StringPathIterator<Arc>> impl_;
+  // Printers used by Extract, which reuse their buffers across paths.
+  ReusableStringPrinter<Arc> iprinter_;
+  ReusableStringPrinter<Arc> oprinter_;
 };
 
 class StringPathIteratorClass;
@@ -135,6 +165,12 @@ class StringPathIteratorClass {
 
   bool Error() const { return impl_->Error(); }
 
+  bool Extract(int64_t limit, std::vector<std::string> *istrings,
+               std::vector<std::string> *ostrings,
+               std::vector<WeightClass> *weights) {
+    return impl_->Extract(limit, istrings, ostrings, weights);
+  }
+
   void ILabels(std::vector<int64_t> *labels) const { impl_->ILabels(labels); }
 
   std::vector<int64_t> ILabels() const { return impl_->ILabels(); }
@@ -171,6 +207,83 @@ void InitStringPathIteratorClass(InitStringPathIteratorClassArgs *args) {
       std::get<4>(*args)));
 }
 
+// Virtual interface implemented by each concrete ShortestStringIteratorImpl.
+class ShortestStringIteratorImplBase {
+ public:
+  virtual bool Done() const = 0;
+  virtual bool Error() const = 0;
+  virtual void Next() = 0;
+  virtual bool String(std::string *result) = 0;
+  virtual WeightClass Weight() const = 0;
+  virtual ~ShortestStringIteratorImplBase() {}
+};
+
+// Templated implementation.
+template <class Arc>
+class ShortestStringIteratorImpl : public ShortestStringIteratorImplBase {
+ public:
+  explicit ShortestStringIteratorImpl(const Fst<Arc> &fst,
+                                      TokenType token_type = TokenType::BYTE,
+                                      const SymbolTable *symbols = nullptr)
+      : impl_(fst), printer_(token_type, symbols) {}
+
+  bool Done() const override { return impl_.Done(); }
+
+  bool Error() const override { return impl_.Error(); }
+
+  void Next() override { impl_.Next(); }
+
+  bool String(std::string *result) override {
+    result->clear();
+    return printer_.Append(impl_.Labels(), result);
+  }
+
+  WeightClass Weight() const override { return WeightClass(impl_.Weight()); }
+
+ private:
+  ShortestStringIterator<Arc> impl_;
+  ReusableStringPrinter<Arc> printer_;
+};
+
+class ShortestStringIteratorClass;
+
+using InitShortestStringIteratorClassArgs =
+    std::tuple<const FstClass &, TokenType, const SymbolTable *,
+               ShortestStringIteratorClass *>;
+
+// Untemplated user-facing class holding templated pimpl.
+class ShortestStringIteratorClass {
+ public:
+  explicit ShortestStringIteratorClass(const FstClass &fst,
+                                       TokenType token_type = TokenType::BYTE,
+                                       const SymbolTable *symbols = nullptr);
+
+  bool Done() const { return impl_->Done(); }
+
+  bool Error() const { return impl_->Error(); }
+
+  template <class Arc>
+  friend void InitShortestStringIteratorClass(
+      InitShortestStringIteratorClassArgs *args);
+
+  void Next() { impl_->Next(); }
+
+  bool String(std::string *result) { return impl_->String(result); }
+
+  WeightClass Weight() const { return impl_->Weight(); }
+
+ private:
+  std::unique_ptr<ShortestStringIteratorImplBase> impl_;
+};
+
+template <class Arc>
+void InitShortestStringIteratorClass(
+    InitShortestStringIteratorClassArgs *args) {
+  const Fst<Arc> &fst = *(std::get<0>(*args).GetFst<Arc>());
+  std::get<3>(*args)->impl_.reset(new ShortestStringIteratorImpl<Arc>(
+      fst, std::get<1>(*args), std::get<2>(*args)));
+}
+
 }  // namespace script
 }  // namespace fst
 
@@ -17,11 +17,17 @@
 #ifndef PYNINI_PREFIX_TREE_H_
 #define PYNINI_PREFIX_TREE_H_
 
+#include <algorithm>
 #include <array>
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <numeric>
 #include <stack>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #include <fst/log.h>
 #include <fst/arc.h>
@@ -310,6 +316,216 @@ class PrefixTree {
   PrefixTree &operator=(const PrefixTree &) = delete;
 };
 
+// Open-addressing hash table mapping (parent state, label) pairs to child
+// states. All entries live in a single flat array, so, unlike a map per node,
+// inserting a child does not require a separate heap allocation.
+template <class Label, class StateId>
+class PrefixTreeChildTable {
+ public:
+  PrefixTreeChildTable() : size_(0) {}
+
+  // Returns the child of parent along label, if any; otherwise, makes child
+  // the child of parent along label and returns it.
+  StateId FindOrInsert(StateId parent, Label label, StateId child) {
+    if (2 * (size_ + 1) > table_.size()) Grow();
+    auto &entry = Find(parent, label);
+    if (entry.child == kNoStateId) {
+      entry = {parent, label, child};
+      ++size_;
+    }
+    return entry.child;
+  }
+
+  void Clear() {
+    table_.clear();
+    size_ = 0;
+  }
+
+ private:
+  struct Entry {
+    StateId parent;
+    Label label;
+    StateId child;
+  };
+
+  static constexpr size_t kInitialSize = 64;
+
+  static size_t Hash(StateId parent, Label label) {
+    // Mixes the pair using the finalizer of MurmurHash3.
+    uint64_t h = (static_cast<uint64_t>(parent) << 32) ^
+                 static_cast<uint32_t>(label);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  // Returns the entry for the pair, or the empty entry where it belongs.
+  Entry &Find(StateId parent, Label label) {
+    const size_t mask = table_.size() - 1;
+    for (size_t i = Hash(parent, label) & mask;; i = (i + 1) & mask) {
+      auto &entry = table_[i];
+      if (entry.child == kNoStateId ||
+          (entry.parent == parent && entry.label == label)) {
+        return entry;
+      }
+    }
+  }
+
+  void Grow() {
+    std::vector<Entry> old(std::max(kInitialSize, 2 * table_.size()),
+                           Entry{kNoStateId, 0, kNoStateId});
+    table_.swap(old);
+    for (const auto &entry : old) {
+      if (entry.child != kNoStateId) Find(entry.parent, entry.label) = entry;
+    }
+  }
+
+  std::vector<Entry> table_;
+  size_t size_;
+};
+
+// A variant of PrefixTree which stores the tree in contiguous arrays indexed
+// by state, rather than as individually allocated nodes; each state records
+// its parent, the label of the arc from its parent, and its final weight, and
+// children are found using a single flat hash table. This greatly reduces the
+// number of allocations and the memory footprint for large string maps, and
+// ToFst is a linear walk over these arrays. The resulting FST is the same as
+// that built by the corresponding PrefixTree.
+//
+// This class is neither thread-safe nor thread-hostile.
+template <class Arc, bool kAcceptor>
+class FlatPrefixTree {
+ public:
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+
+  FlatPrefixTree() = default;
+
+  StateId NumStates() const { return parent_.size(); }
+
+  // Add an entry to the prefix tree, consisting of two label sequences and a
+  // weight. Each label sequence must be provided as a pair of iterators.
+  template <class Iterator1, class Iterator2, class T>
+  void Add(Iterator1 it1, Iterator1 end1, Iterator2 it2, Iterator2 end2,
+           T &&weight) {
+    if (parent_.empty()) AddState(kNoStateId, kNoLabel, INPUT);
+    StateId state = 0;
+    for (Label ilabel : fst::make_range(it1, end1)) {
+      if (!ilabel) continue;  // Skips over epsilons.
+      state = LookupOrInsertChild(state, ilabel, INPUT);
+    }
+    if constexpr (!kAcceptor) {
+      // The bridge to the output side uses the epsilon label, which cannot
+      // otherwise occur, since epsilons are skipped.
+      state = LookupOrInsertChild(state, 0, BRIDGE);
+      for (Label olabel : fst::make_range(it2, end2)) {
+        if (!olabel) continue;  // Skips over epsilons.
+        state = LookupOrInsertChild(state, olabel, OUTPUT);
+      }
+    }
+    final_[state] = true;
+    weight_[state] = Plus(weight_[state], std::forward<T>(weight));
+  }
+
+  // With semiring One as a default.
+  template <class Iterator1, class Iterator2>
+  void Add(Iterator1 it1, Iterator1 end1, Iterator2 it2, Iterator2 end2) {
+    Add(it1, end1, it2, end2, Weight::One());
+  }
+
+  template <class Container1, class Container2, class T>
+  void Add(const Container1 &cont1, const Container2 &cont2, T &&weight) {
+    Add(cont1.begin(), cont1.end(), cont2.begin(), cont2.end(),
+        std::forward<T>(weight));
+  }
+
+  // With semiring One as a default.
+  template <class Container1, class Container2>
+  void Add(const Container1 &cont1, const Container2 &cont2) {
+    Add(cont1.begin(), cont1.end(), cont2.begin(), cont2.end(), Weight::One());
+  }
+
+  // Removes all elements from this prefix tree.
+  void Clear() {
+    parent_.clear();
+    label_.clear();
+    side_.clear();
+    final_.clear();
+    weight_.clear();
+    children_.Clear();
+  }
+
+  // Write the current prefix tree transducer to a mutable FST.
+  void ToFst(MutableFst<Arc> *fst) const {
+    fst->DeleteStates();
+    const StateId num_states = NumStates();
+    if (num_states == 0) return;
+    fst->AddStates(num_states);
+    fst->SetStart(0);
+    // Orders the non-root states by their parent, then by label, so that the
+    // arcs leaving each state are added in label order.
+    std::vector<size_t> num_arcs(num_states, 0);
+    for (StateId s = 1; s < num_states; ++s) ++num_arcs[parent_[s]];
+    std::vector<StateId> order(num_states - 1);
+    std::iota(order.begin(), order.end(), 1);
+    std::sort(order.begin(), order.end(), [this](StateId s1, StateId s2) {
+      return std::tie(parent_[s1], label_[s1]) <
+             std::tie(parent_[s2], label_[s2]);
+    });
+    for (StateId s = 0; s < num_states; ++s) {
+      fst->ReserveArcs(s, num_arcs[s]);
+      if (final_[s]) fst->SetFinal(s, weight_[s]);
+    }
+    for (const auto s : order) fst->AddArc(parent_[s], MakeArc(s));
+  }
+
+ private:
+  // The kind of arc leading to a state.
+  enum Side : uint8_t { INPUT, BRIDGE, OUTPUT };
+
+  StateId AddState(StateId parent, Label label, Side side) {
+    parent_.push_back(parent);
+    label_.push_back(label);
+    side_.push_back(side);
+    final_.push_back(false);
+    weight_.push_back(Weight::Zero());
+    return parent_.size() - 1;
+  }
+
+  StateId LookupOrInsertChild(StateId parent, Label label, Side side) {
+    const StateId next = NumStates();
+    const auto child = children_.FindOrInsert(parent, label, next);
+    if (child == next) AddState(parent, label, side);
+    return child;
+  }
+
+  Arc MakeArc(StateId s) const {
+    switch (side_[s]) {
+      case INPUT:
+        return Arc(label_[s], kAcceptor ? label_[s] : 0, s);
+      case BRIDGE:
+        return Arc(0, 0, s);
+      case OUTPUT:
+        return Arc(0, label_[s], s);
+    }
+    return Arc(0, 0, s);  // Unreachable.
+  }
+
+  std::vector<StateId> parent_;
+  std::vector<Label> label_;
+  std::vector<Side> side_;
+  std::vector<bool> final_;
+  std::vector<Weight> weight_;
+  PrefixTreeChildTable<Label, StateId> children_;
+
+  FlatPrefixTree(const FlatPrefixTree &) = delete;
+  FlatPrefixTree &operator=(const FlatPrefixTree &) = delete;
+};
+
 }  // namespace internal
 
 template <class Arc>
@@ -322,6 +538,13 @@ template <class Arc>
 using AcceptorPrefixTree =
     internal::PrefixTree<Arc, internal::PrefixTreeAcceptorPolicy<Arc>>;
 
+// Variants of the above with flat, arena-like storage.
+template <class Arc>
+using FlatTransducerPrefixTree = internal::FlatPrefixTree<Arc, false>;
+
+template <class Arc>
+using FlatAcceptorPrefixTree = internal::FlatPrefixTree<Arc, true>;
+
 }  // namespace fst
 
 #endif  // PYNINI_PREFIX_TREE_H_
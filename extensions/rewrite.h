@@ -22,7 +22,9 @@
 // are optimized (e.g., with epsilon-removal and pruned determinization) so
 // that the output strings are unique.
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <utility>
@@ -36,14 +38,21 @@
 #include <fst/compose.h>
 #include <fst/determinize.h>
 #include <fst/fst.h>
-#include <fst/intersect.h>
 #include <fst/minimize.h>
 #include <fst/mutable-fst.h>
 #include <fst/project.h>
 #include <fst/rmepsilon.h>
 #include <fst/shortest-path.h>
+#include <fst/string.h>
 #include <fst/vector-fst.h>
+#include "compiled-string-fst.h"
+#include "lookaheadrule.h"
+#include "parallel.h"
 #include "paths.h"
+#include "rewritestats.h"
+#include "shorteststrings.h"
+#include "stringcompile.h"
+#include "string-view-fst.h"
 #include "stringprint.h"
 
 // Generic rewrite utilities for string inputs.
@@ -71,15 +80,49 @@ inline bool CheckNonEmptyAndCleanup(MutableFst<Arc> *lattice) {
 // Constructs a weighted, epsilon-free lattice of output strings given a
 // input FST and a rule FST.
 //
-// Callers may wish to arc-sort the input side of the rule ahead of time.
+// Callers may wish to arc-sort the input side of the rule ahead of time. If
+// the rule is a LookAheadRuleFst, the input is relabeled to match it, and
+// lookahead composition is used.
 template <class Arc>
 bool RewriteLattice(const Fst<Arc> &input, const Fst<Arc> &rule,
                     MutableFst<Arc> *lattice) {
+  if (rule.Type() == LookAheadRuleFst<Arc>::StaticType()) {
+    const auto &lookahead_rule =
+        static_cast<const LookAheadRuleFst<Arc> &>(rule);
+    VectorFst<Arc> relabeled(input);
+    lookahead_rule.Relabel(&relabeled);
+    // The automatic filter selects lookahead composition.
+    static const ComposeOptions lookahead_opts(true, AUTO_FILTER);
+    Compose(relabeled, lookahead_rule, lattice, lookahead_opts);
+    return internal::CheckNonEmptyAndCleanup(lattice);
+  }
   static const ComposeOptions opts(true, ALT_SEQUENCE_FILTER);
   Compose(input, rule, lattice, opts);
   return internal::CheckNonEmptyAndCleanup(lattice);
 }
 
+// Same, but composes the rule directly against a StringViewFst over the
+// input bytes, rather than against a compiled string FST. Since the input
+// is not compiled, bracketed spans are not interpreted as generated symbols,
+// and only the BYTE and UTF8 token types are supported.
+template <class Arc>
+bool RewriteLattice(absl::string_view input, const Fst<Arc> &rule,
+                    MutableFst<Arc> *lattice, TokenType token_type) {
+  switch (token_type) {
+    case TokenType::BYTE:
+      return RewriteLattice(StringViewFst<Arc, ByteViewer<Arc>>(input), rule,
+                            lattice);
+    case TokenType::UTF8:
+      return RewriteLattice(StringViewFst<Arc, UTF8Viewer<Arc>>(input), rule,
+                            lattice);
+    case TokenType::SYMBOL:
+      LOG(ERROR) << "RewriteLattice: Symbol token type is not supported for "
+                 << "string view input";
+      return false;
+  }
+  return false;  // Unreachable.
+}
+
 // Same, but supports PDT composition.
 template <class Arc>
 bool RewriteLattice(
@@ -103,10 +146,33 @@ bool RewriteLattice(
   return internal::CheckNonEmptyAndCleanup(lattice);
 }
 
+namespace internal {
+
+// Calls the RewriteLattice overload for the arguments, timing it and recording
+// the size of the lattice if there are stats.
+template <class Arc, class Input, class... Args>
+bool RewriteLatticeWithStats(RewriteStats *stats, const Input &input,
+                             const Fst<Arc> &rule, MutableFst<Arc> *lattice,
+                             Args &&...args) {
+  {
+    const RewritePhaseTimer timer(stats, &RewriteStats::compose_seconds);
+    if (!RewriteLattice(input, rule, lattice, std::forward<Args>(args)...)) {
+      return false;
+    }
+  }
+  RecordLattice(*lattice, stats);
+  return true;
+}
+
+}  // namespace internal
+
 // Given an epsilon-free lattice of output strings (such as produced by
-// RewriteLattice), attempts to determinize it, pruning non-optimal paths if
-// `optimal_only` is true. This is only valid in a semiring with the path
-// property.
+// RewriteLattice), attempts to determinize it, pruning paths whose weight is
+// worse than the best path's weight times `weight_threshold`. A threshold of
+// semiring one keeps only optimal paths, and semiring zero disables pruning.
+// This is only valid in a semiring with the path property. Pruning happens
+// during determinization, so states which are only reachable by paths outside
+// the beam are never constructed.
 //
 // To prevent unexpected blowup during determinization, a state threshold is
 // also used and a warning is logged if this exact threshold is reached. The
@@ -114,11 +180,10 @@ bool RewriteLattice(
 // plus a small constant factor. This is intended to be a sensible default
 // and is not an inherently meaningful value in and of itself.
 template <class Arc>
-void LatticeToDfa(MutableFst<Arc> *lattice, bool optimal_only,
-                  typename Arc::StateId state_multiplier = 4) {
+void LatticeToPrunedDfa(MutableFst<Arc> *lattice,
+                        const typename Arc::Weight &weight_threshold,
+                        typename Arc::StateId state_multiplier = 4) {
   using StateId = typename Arc::StateId;
-  using Weight = typename Arc::Weight;
-  const auto &weight_threshold = optimal_only ? Weight::One() : Weight::Zero();
   const StateId state_threshold = 256 + state_multiplier * lattice->NumStates();
   const DeterminizeOptions<Arc> opts(kDelta, weight_threshold, state_threshold);
   Determinize(*lattice, lattice, opts);
@@ -131,6 +196,16 @@ void LatticeToDfa(MutableFst<Arc> *lattice, bool optimal_only,
   }
 }
 
+// Same, but either keeps only optimal paths (if `optimal_only` is true) or
+// keeps all paths.
+template <class Arc>
+void LatticeToDfa(MutableFst<Arc> *lattice, bool optimal_only,
+                  typename Arc::StateId state_multiplier = 4) {
+  using Weight = typename Arc::Weight;
+  LatticeToPrunedDfa(lattice, optimal_only ? Weight::One() : Weight::Zero(),
+                     state_multiplier);
+}
+
 // Given an epsilon-free lattice of output strings (such as produced by
 // RewriteLattice), extracts n-shortest unique strings. This is only valid in a
 // semiring with the path property.
@@ -142,15 +217,59 @@ void LatticeToShortest(MutableFst<Arc> *lattice, int32_t nshortest = 1) {
   *lattice = shortest;
 }
 
+// Given a lattice of output strings (such as produced by RewriteLattice),
+// clears vector and writes the n-shortest unique strings to it, best first.
+// Unlike LatticeToShortest, this searches for strings lazily, stopping once
+// n have been found, and does not construct an n-best FST. This is only valid
+// in a semiring with the path property. If there are stats, the time spent
+// searching and printing and the number of strings found are added to them.
+template <class Arc>
+bool LatticeToShortestStrings(const Fst<Arc> &lattice, int32_t nshortest,
+                              std::vector<std::string> *output,
+                              TokenType ttype = TokenType::BYTE,
+                              const SymbolTable *syms = nullptr,
+                              RewriteStats *stats = nullptr) {
+  output->clear();
+  if (nshortest <= 0) return true;
+  internal::RewritePhaseTimer search_timer(stats,
+                                          &RewriteStats::shortest_path_seconds);
+  ShortestStringIterator<Arc> strings(lattice);
+  search_timer.Stop();
+  if (strings.Error()) return false;
+  ReusableStringPrinter<Arc> printer(ttype, syms);
+  while (!strings.Done()) {
+    output->emplace_back();
+    if (stats) ++stats->paths;
+    {
+      const internal::RewritePhaseTimer print_timer(
+          stats, &RewriteStats::print_seconds);
+      if (!printer.Append(strings.Labels(), &output->back())) return false;
+    }
+    if (output->size() == static_cast<size_t>(nshortest)) break;
+    search_timer.Start();
+    strings.Next();
+    search_timer.Stop();
+  }
+  return true;
+}
+
 // Given an epsilon-free lattice of output strings (such as produced by
 // RewriteLattice), extracts a single top string. This is only valid in a
-// semiring with the path property.
+// semiring with the path property. If there are stats, the time spent
+// searching and printing and the number of strings found are added to them.
 template <class Arc>
 bool LatticeToTopString(const Fst<Arc> &lattice, std::string *output,
                         TokenType ttype = TokenType::BYTE,
-                        const SymbolTable *syms = nullptr) {
+                        const SymbolTable *syms = nullptr,
+                        RewriteStats *stats = nullptr) {
   VectorFst<Arc> ofst;
-  ShortestPath(lattice, &ofst);
+  {
+    const internal::RewritePhaseTimer timer(
+        stats, &RewriteStats::shortest_path_seconds);
+    ShortestPath(lattice, &ofst);
+  }
+  if (stats) ++stats->paths;
+  const internal::RewritePhaseTimer timer(stats, &RewriteStats::print_seconds);
   return StringPrint(ofst, output, ttype, syms);
 }
 
@@ -185,37 +304,87 @@ bool LatticeToLabels(const Fst<Arc> &lattice,
   return true;
 }
 
-// Clears vector and writes lattice strings to it.
+// Clears vector and writes lattice strings to it. If there are stats, the time
+// spent enumerating and printing the strings, and their number, are added to
+// them.
 template <class Arc>
 bool LatticeToStrings(const Fst<Arc> &lattice, std::vector<std::string> *output,
                       TokenType ttype = TokenType::BYTE,
-                      const SymbolTable *syms = nullptr) {
+                      const SymbolTable *syms = nullptr,
+                      RewriteStats *stats = nullptr) {
+  const internal::RewritePhaseTimer timer(stats, &RewriteStats::print_seconds);
   output->clear();
-  // We have to do this check manually since StringPathIterator's check is
+  // We have to do this check manually since PathIterator's check is
   // potentially fatal.
   if (lattice.Properties(kAcyclic, true) != kAcyclic) {
     LOG(ERROR) << "Lattice is unexpectedly cyclic";
     return false;
   }
-  // Input token type and symbol table will be ignored.
-  StringPathIterator<Arc> paths(lattice, ttype, syms, /*check_acyclic=*/false);
+  PathIterator<Arc> paths(lattice, /*check_acyclic=*/false);
   if (paths.Error()) return false;
+  // A single printer is used for all paths so its scratch buffers are reused.
+  ReusableStringPrinter<Arc> printer(ttype, syms);
   for (; !paths.Done(); paths.Next()) {
     // Constructs these in-place.
     output->emplace_back();
-    paths.OString(&output->back());
+    if (stats) ++stats->paths;
+    if (!printer.Append(paths.OLabels(), &output->back())) return false;
   }
   return true;
 }
 
+// Same, but clears the batch and writes lattice strings into its single
+// buffer, avoiding a separate allocation per string.
+template <class Arc>
+bool LatticeToStrings(const Fst<Arc> &lattice, StringBatch *output,
+                      TokenType ttype = TokenType::BYTE,
+                      const SymbolTable *syms = nullptr) {
+  output->Clear();
+  if (lattice.Properties(kAcyclic, true) != kAcyclic) {
+    LOG(ERROR) << "Lattice is unexpectedly cyclic";
+    return false;
+  }
+  PathIterator<Arc> paths(lattice, /*check_acyclic=*/false);
+  if (paths.Error()) return false;
+  ReusableStringPrinter<Arc> printer(ttype, syms);
+  for (; !paths.Done(); paths.Next()) {
+    if (!printer.Append(paths.OLabels(), output->MutableBuffer())) {
+      output->Abandon();
+      return false;
+    }
+    output->Close();
+  }
+  return true;
+}
+
+// The rewrite functions below take optional stats; if these are non-null,
+// the size of the composed lattice, the time spent in each phase, and the
+// number of output strings are recorded in them.
+
 // Top rewrite.
 template <class Arc>
 bool TopRewrite(const Fst<Arc> &input, const Fst<Arc> &rule,
                 std::string *output, TokenType ttype = TokenType::BYTE,
-                const SymbolTable *syms = nullptr) {
+                const SymbolTable *syms = nullptr,
+                RewriteStats *stats = nullptr) {
+  VectorFst<Arc> lattice;
+  return internal::RewriteLatticeWithStats(stats, input, rule, &lattice) &&
+         LatticeToTopString(lattice, output, ttype, syms, stats);
+}
+
+// Same, but over a string view of the input; see the corresponding
+// RewriteLattice overload above.
+template <class Arc>
+bool TopRewrite(absl::string_view input, const Fst<Arc> &rule,
+                std::string *output, TokenType input_token_type,
+                TokenType output_token_type = TokenType::BYTE,
+                const SymbolTable *output_symbols = nullptr,
+                RewriteStats *stats = nullptr) {
   VectorFst<Arc> lattice;
-  return RewriteLattice(input, rule, &lattice) &&
-         LatticeToTopString(lattice, output, ttype, syms);
+  return internal::RewriteLatticeWithStats(stats, input, rule, &lattice,
+                                           input_token_type) &&
+         LatticeToTopString(lattice, output, output_token_type, output_symbols,
+                            stats);
 }
 
 // Top rewrite, returning false and logging if there's a tie.
@@ -223,11 +392,20 @@ template <class Arc>
 bool OneTopRewrite(const Fst<Arc> &input, const Fst<Arc> &rule,
                    std::string *output, TokenType ttype = TokenType::BYTE,
                    const SymbolTable *syms = nullptr,
-                   typename Arc::StateId state_multiplier = 4) {
+                   typename Arc::StateId state_multiplier = 4,
+                   RewriteStats *stats = nullptr) {
   VectorFst<Arc> lattice;
-  if (!RewriteLattice(input, rule, &lattice)) return false;
-  LatticeToDfa(&lattice, /*optimal_only=*/true, state_multiplier);
-  return LatticeToOneTopString(lattice, output, ttype, syms);
+  if (!internal::RewriteLatticeWithStats(stats, input, rule, &lattice)) {
+    return false;
+  }
+  {
+    const internal::RewritePhaseTimer timer(stats, &RewriteStats::dfa_seconds);
+    LatticeToDfa(&lattice, /*optimal_only=*/true, state_multiplier);
+  }
+  const internal::RewritePhaseTimer timer(stats, &RewriteStats::print_seconds);
+  if (!LatticeToOneTopString(lattice, output, ttype, syms)) return false;
+  if (stats) ++stats->paths;
+  return true;
 }
 
 // All rewrites.
@@ -236,11 +414,17 @@ bool Rewrites(const Fst<Arc> &input, const Fst<Arc> &rule,
               std::vector<std::string> *output,
               TokenType ttype = TokenType::BYTE,
               const SymbolTable *syms = nullptr,
-              typename Arc::StateId state_multiplier = 4) {
+              typename Arc::StateId state_multiplier = 4,
+              RewriteStats *stats = nullptr) {
   VectorFst<Arc> lattice;
-  if (!RewriteLattice(input, rule, &lattice)) return false;
-  LatticeToDfa(&lattice, /*optimal_only=*/false, state_multiplier);
-  return LatticeToStrings(lattice, output, ttype, syms);
+  if (!internal::RewriteLatticeWithStats(stats, input, rule, &lattice)) {
+    return false;
+  }
+  {
+    const internal::RewritePhaseTimer timer(stats, &RewriteStats::dfa_seconds);
+    LatticeToDfa(&lattice, /*optimal_only=*/false, state_multiplier);
+  }
+  return LatticeToStrings(lattice, output, ttype, syms, stats);
 }
 
 // The same, but with repeated string fields.
@@ -250,11 +434,17 @@ bool TopRewrites(const Fst<Arc> &input, const Fst<Arc> &rule,
                  std::vector<std::string> *output,
                  TokenType ttype = TokenType::BYTE,
                  const SymbolTable *syms = nullptr,
-                 typename Arc::StateId state_multiplier = 4) {
+                 typename Arc::StateId state_multiplier = 4,
+                 RewriteStats *stats = nullptr) {
   VectorFst<Arc> lattice;
-  if (!RewriteLattice(input, rule, &lattice)) return false;
-  LatticeToDfa(&lattice, /*optimal_only=*/true, state_multiplier);
-  return LatticeToStrings(lattice, output, ttype, syms);
+  if (!internal::RewriteLatticeWithStats(stats, input, rule, &lattice)) {
+    return false;
+  }
+  {
+    const internal::RewritePhaseTimer timer(stats, &RewriteStats::dfa_seconds);
+    LatticeToDfa(&lattice, /*optimal_only=*/true, state_multiplier);
+  }
+  return LatticeToStrings(lattice, output, ttype, syms, stats);
 }
 
 // The same, but with repeated string fields.
@@ -263,25 +453,221 @@ template <class Arc>
 bool TopRewrites(const Fst<Arc> &input, const Fst<Arc> &rule, int32_t nshortest,
                  std::vector<std::string> *output,
                  TokenType ttype = TokenType::BYTE,
-                 const SymbolTable *syms = nullptr) {
+                 const SymbolTable *syms = nullptr,
+                 RewriteStats *stats = nullptr) {
   VectorFst<Arc> lattice;
-  if (!RewriteLattice(input, rule, &lattice)) return false;
-  LatticeToShortest(&lattice, nshortest);
-  return LatticeToStrings(lattice, output, ttype, syms);
+  return internal::RewriteLatticeWithStats(stats, input, rule, &lattice) &&
+         LatticeToShortestStrings(lattice, nshortest, output, ttype, syms,
+                                  stats);
 }
 
+namespace internal {
+
+// Returns whether the FST has a successful path, searching it depth-first
+// from the start state and stopping at the first final state reached. Since
+// only the states visited are expanded, this is much cheaper than testing the
+// emptiness of a delayed FST by materializing it when a path is found early.
+template <class Arc>
+bool HasSuccessfulPath(const Fst<Arc> &fst) {
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+  const auto start = fst.Start();
+  if (start == kNoStateId) return false;
+  std::vector<bool> visited;
+  const auto visit = [&visited](StateId s) {
+    if (static_cast<size_t>(s) >= visited.size()) visited.resize(s + 1);
+    if (visited[s]) return false;
+    visited[s] = true;
+    return true;
+  };
+  std::vector<StateId> stack;
+  visit(start);
+  stack.push_back(start);
+  while (!stack.empty()) {
+    const auto state = stack.back();
+    stack.pop_back();
+    if (fst.Final(state) != Weight::Zero()) return true;
+    for (ArcIterator<Fst<Arc>> aiter(fst, state); !aiter.Done();
+         aiter.Next()) {
+      const auto &arc = aiter.Value();
+      if (arc.weight != Weight::Zero() && visit(arc.nextstate)) {
+        stack.push_back(arc.nextstate);
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace internal
+
 // The same, but with repeated string fields.
-// Determines whether a rule allows an input/output pair.
+// Determines whether a rule allows an input/output pair, and sets match
+// accordingly. Rather than constructing the lattice of output strings and
+// intersecting it with the output, this searches the delayed composition of
+// the input, the rule, and the output for a successful path, expanding only
+// the states it visits. Returns false if the rule rejects the input
+// altogether; this is checked only if there is no match, by searching the
+// delayed composition of the input and the rule in the same way, which shares
+// the states expanded by the first search.
+template <class Arc>
+bool Matches(const Fst<Arc> &input, const Fst<Arc> &output,
+             const Fst<Arc> &rule, bool *match) {
+  std::unique_ptr<VectorFst<Arc>> relabeled;
+  const Fst<Arc> *lhs = &input;
+  if (rule.Type() == LookAheadRuleFst<Arc>::StaticType()) {
+    // As in RewriteLattice, the input is relabeled to match the rule, whose
+    // lookahead matcher is then selected automatically.
+    relabeled = std::make_unique<VectorFst<Arc>>(input);
+    static_cast<const LookAheadRuleFst<Arc> &>(rule).Relabel(relabeled.get());
+    lhs = relabeled.get();
+  }
+  const ComposeFst<Arc> lattice(*lhs, rule);
+  // The output is matched on its input side, so it must be sorted.
+  if (output.Properties(kILabelSorted, true) == kILabelSorted) {
+    *match = internal::HasSuccessfulPath(ComposeFst<Arc>(lattice, output));
+  } else {
+    const ArcSortFst<Arc, ILabelCompare<Arc>> sorted(output,
+                                                     ILabelCompare<Arc>());
+    *match = internal::HasSuccessfulPath(ComposeFst<Arc>(lattice, sorted));
+  }
+  return *match || internal::HasSuccessfulPath(lattice);
+}
+
+// The same, but also returns false if the rule rejects the input.
 template <class Arc>
 bool Matches(const Fst<Arc> &input, const Fst<Arc> &output,
              const Fst<Arc> &rule) {
-  VectorFst<Arc> lattice;
-  if (!RewriteLattice(input, rule, &lattice)) return false;
-  static const OLabelCompare<Arc> ocomp;
-  ArcSort(&lattice, ocomp);
-  static const IntersectOptions opts(true, SEQUENCE_FILTER);
-  Intersect(lattice, output, &lattice, opts);
-  return lattice.Start() != kNoStateId;
+  bool match = false;
+  return Matches(input, output, rule, &match) && match;
+}
+
+// Batch rewriting utilities. These apply a single rule to many input strings,
+// distributing the work across `num_threads` threads (or the hardware
+// concurrency, if `num_threads` is not positive). The rule must not be
+// mutated while these are running, and callers may wish to arc-sort its
+// input side ahead of time.
+
+namespace internal {
+
+// Applies `rewrite(input, lattice, output)` to each input string. Inputs
+// are parsed on the calling thread, since parsing may add to the shared
+// table of generated symbols; composition and output extraction then run on
+// the workers, each of which reuses its own scratch lattice FST. Inputs are
+// built as CompiledStringFsts, which take a single allocation apiece.
+// Returns false if any input fails to parse or rewrite.
+template <class Arc, class Output, class RewriteFn>
+bool BatchRewrite(const std::vector<std::string> &inputs,
+                  std::vector<Output> *outputs, TokenType token_type,
+                  const SymbolTable *symbols, int num_threads,
+                  RewriteFn rewrite) {
+  using Label = typename Arc::Label;
+  std::vector<std::vector<Label>> labels(inputs.size());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    if (!StringToLabels(inputs[i], &labels[i], token_type, symbols)) {
+      LOG(ERROR) << "BatchRewrite: Failed to compile string `" << inputs[i]
+                 << "`";
+      return false;
+    }
+  }
+  outputs->clear();
+  outputs->resize(inputs.size());
+  const auto num_workers = NumWorkers(inputs.size(), num_threads);
+  std::vector<VectorFst<Arc>> scratch_lattices(num_workers);
+  std::atomic<bool> success(true);
+  ParallelFor(inputs.size(), num_workers, [&](size_t worker, size_t i) {
+    const CompiledStringFst<Arc> input(labels[i]);
+    if (!rewrite(input, &scratch_lattices[worker], &(*outputs)[i])) {
+      LOG(ERROR) << "BatchRewrite: Rewrite failed for string `" << inputs[i]
+                 << "`";
+      success = false;
+    }
+  });
+  return success;
+}
+
+}  // namespace internal
+
+// Top rewrite for each input.
+template <class Arc>
+bool BatchTopRewrite(const std::vector<std::string> &inputs,
+                     const Fst<Arc> &rule, std::vector<std::string> *outputs,
+                     TokenType input_token_type = TokenType::BYTE,
+                     const SymbolTable *input_symbols = nullptr,
+                     TokenType output_token_type = TokenType::BYTE,
+                     const SymbolTable *output_symbols = nullptr,
+                     int num_threads = 0) {
+  return internal::BatchRewrite<Arc>(
+      inputs, outputs, input_token_type, input_symbols, num_threads,
+      [&](const Fst<Arc> &input, MutableFst<Arc> *lattice,
+          std::string *output) {
+        return RewriteLattice(input, rule, lattice) &&
+               LatticeToTopString(*lattice, output, output_token_type,
+                                  output_symbols);
+      });
+}
+
+// All rewrites for each input.
+template <class Arc>
+bool BatchRewrites(const std::vector<std::string> &inputs,
+                   const Fst<Arc> &rule,
+                   std::vector<std::vector<std::string>> *outputs,
+                   TokenType input_token_type = TokenType::BYTE,
+                   const SymbolTable *input_symbols = nullptr,
+                   TokenType output_token_type = TokenType::BYTE,
+                   const SymbolTable *output_symbols = nullptr,
+                   int num_threads = 0,
+                   typename Arc::StateId state_multiplier = 4) {
+  return internal::BatchRewrite<Arc>(
+      inputs, outputs, input_token_type, input_symbols, num_threads,
+      [&](const Fst<Arc> &input, MutableFst<Arc> *lattice,
+          std::vector<std::string> *output) {
+        if (!RewriteLattice(input, rule, lattice)) return false;
+        LatticeToDfa(lattice, /*optimal_only=*/false, state_multiplier);
+        return LatticeToStrings(*lattice, output, output_token_type,
+                                output_symbols);
+      });
+}
+
+// All optimal rewrites for each input.
+template <class Arc>
+bool BatchOptimalRewrites(const std::vector<std::string> &inputs,
+                          const Fst<Arc> &rule,
+                          std::vector<std::vector<std::string>> *outputs,
+                          TokenType input_token_type = TokenType::BYTE,
+                          const SymbolTable *input_symbols = nullptr,
+                          TokenType output_token_type = TokenType::BYTE,
+                          const SymbolTable *output_symbols = nullptr,
+                          int num_threads = 0,
+                          typename Arc::StateId state_multiplier = 4) {
+  return internal::BatchRewrite<Arc>(
+      inputs, outputs, input_token_type, input_symbols, num_threads,
+      [&](const Fst<Arc> &input, MutableFst<Arc> *lattice,
+          std::vector<std::string> *output) {
+        if (!RewriteLattice(input, rule, lattice)) return false;
+        LatticeToDfa(lattice, /*optimal_only=*/true, state_multiplier);
+        return LatticeToStrings(*lattice, output, output_token_type,
+                                output_symbols);
+      });
+}
+
+// The top n rewrites for each input.
+template <class Arc>
+bool BatchTopRewrites(const std::vector<std::string> &inputs,
+                      const Fst<Arc> &rule, int32_t nshortest,
+                      std::vector<std::vector<std::string>> *outputs,
+                      TokenType input_token_type = TokenType::BYTE,
+                      const SymbolTable *input_symbols = nullptr,
+                      TokenType output_token_type = TokenType::BYTE,
+                      const SymbolTable *output_symbols = nullptr,
+                      int num_threads = 0) {
+  return internal::BatchRewrite<Arc>(
+      inputs, outputs, input_token_type, input_symbols, num_threads,
+      [&](const Fst<Arc> &input, MutableFst<Arc> *lattice,
+          std::vector<std::string> *output) {
+        return RewriteLattice(input, rule, lattice) &&
+               LatticeToShortestStrings(*lattice, nshortest, output,
+                                        output_token_type, output_symbols);
+      });
 }
 
 }  // namespace fst
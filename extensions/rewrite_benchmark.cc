@@ -0,0 +1,130 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks of rule application.
+
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <fst/arc.h>
+#include <fst/vector-fst.h>
+#include "benchmark_util.h"
+#include "densematcher.h"
+#include "rewrite.h"
+#include "stringcompile.h"
+
+namespace fst {
+namespace {
+
+using ::fst::benchmark_util::NumberGrammar;
+using ::fst::benchmark_util::RandomText;
+
+// Inputs are padded with spaces, since the number grammar rewrites numbers
+// between spaces. The argument is the number of words in the input.
+std::string Input(int num_words) { return " " + RandomText(num_words) + " "; }
+
+const VectorFst<StdArc> &Rule() {
+  static const auto *kRule = new VectorFst<StdArc>(NumberGrammar<StdArc>());
+  return *kRule;
+}
+
+// The same rule, matched by direct lookup at its high-fanout states.
+const DenseMatcherFst<StdArc> &DenseRule() {
+  static const auto *kRule = new DenseMatcherFst<StdArc>(Rule());
+  return *kRule;
+}
+
+// Composes against a compiled string FST.
+void BM_RewriteLattice(benchmark::State &state) {
+  const auto &rule = Rule();
+  const auto input = Input(state.range(0));
+  for (auto _ : state) {
+    VectorFst<StdArc> compiled;
+    StringCompile(input, &compiled);
+    VectorFst<StdArc> lattice;
+    benchmark::DoNotOptimize(RewriteLattice(compiled, rule, &lattice));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_RewriteLattice)->Arg(10)->Arg(1000);
+
+// Composes against a StringViewFst over the input.
+void BM_RewriteLatticeStringView(benchmark::State &state) {
+  const auto &rule = Rule();
+  const auto input = Input(state.range(0));
+  for (auto _ : state) {
+    VectorFst<StdArc> lattice;
+    benchmark::DoNotOptimize(
+        RewriteLattice(input, rule, &lattice, TokenType::BYTE));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_RewriteLatticeStringView)->Arg(10)->Arg(1000);
+
+void BM_RewriteLatticeDenseMatcher(benchmark::State &state) {
+  const auto &rule = DenseRule();
+  const auto input = Input(state.range(0));
+  for (auto _ : state) {
+    VectorFst<StdArc> lattice;
+    benchmark::DoNotOptimize(
+        RewriteLattice(input, rule, &lattice, TokenType::BYTE));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_RewriteLatticeDenseMatcher)->Arg(10)->Arg(1000);
+
+void BM_TopRewrite(benchmark::State &state) {
+  const auto &rule = Rule();
+  const auto input = Input(state.range(0));
+  for (auto _ : state) {
+    std::string output;
+    benchmark::DoNotOptimize(
+        TopRewrite(input, rule, &output, TokenType::BYTE));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_TopRewrite)->Arg(10)->Arg(1000);
+
+void BM_TopRewriteDenseMatcher(benchmark::State &state) {
+  const auto &rule = DenseRule();
+  const auto input = Input(state.range(0));
+  for (auto _ : state) {
+    std::string output;
+    benchmark::DoNotOptimize(
+        TopRewrite(input, rule, &output, TokenType::BYTE));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_TopRewriteDenseMatcher)->Arg(10)->Arg(1000);
+
+// Checks that the rule allows its top rewrite of the input.
+void BM_Matches(benchmark::State &state) {
+  const auto &rule = Rule();
+  const auto input = Input(state.range(0));
+  std::string output;
+  TopRewrite(input, rule, &output, TokenType::BYTE);
+  VectorFst<StdArc> compiled_input;
+  StringCompile(input, &compiled_input);
+  VectorFst<StdArc> compiled_output;
+  StringCompile(output, &compiled_output);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Matches(compiled_input, compiled_output, rule));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_Matches)->Arg(10)->Arg(1000);
+
+}  // namespace
+}  // namespace fst
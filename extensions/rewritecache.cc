@@ -0,0 +1,117 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "rewritecache.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+namespace fst {
+
+RewriteCache::RewriteCache(size_t max_bytes, size_t num_shards)
+    : max_bytes_(max_bytes),
+      shard_max_bytes_(max_bytes / std::max<size_t>(num_shards, 1)),
+      hits_(0),
+      misses_(0),
+      evictions_(0) {
+  shards_.resize(std::max<size_t>(num_shards, 1));
+  for (auto &shard : shards_) shard = std::make_unique<Shard>();
+}
+
+bool RewriteCache::Lookup(const Key &key, std::vector<std::string> *outputs) {
+  auto &shard = GetShard(key);
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+      shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+      *outputs = it->second->outputs;
+      ++hits_;
+      return true;
+    }
+  }
+  ++misses_;
+  return false;
+}
+
+void RewriteCache::Insert(const Key &key, std::vector<std::string> outputs) {
+  const auto bytes = EntryBytes(key, outputs);
+  auto &shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.index.find(key);
+  if (it != shard.index.end()) {
+    shard.bytes -= it->second->bytes;
+    shard.entries.erase(it->second);
+    shard.index.erase(it);
+  }
+  if (bytes > shard_max_bytes_) return;
+  Evict(&shard, shard_max_bytes_ - bytes);
+  it = shard.index.emplace(key, shard.entries.end()).first;
+  shard.entries.push_front(Entry{&it->first, std::move(outputs), bytes});
+  it->second = shard.entries.begin();
+  shard.bytes += bytes;
+}
+
+void RewriteCache::Clear() {
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->entries.clear();
+    shard->index.clear();
+    shard->bytes = 0;
+  }
+}
+
+size_t RewriteCache::Size() const {
+  size_t size = 0;
+  for (const auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    size += shard->index.size();
+  }
+  return size;
+}
+
+size_t RewriteCache::NumBytes() const {
+  size_t bytes = 0;
+  for (const auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    bytes += shard->bytes;
+  }
+  return bytes;
+}
+
+size_t RewriteCache::EntryBytes(const Key &key,
+                                const std::vector<std::string> &outputs) {
+  // Counts the strings' contents, plus a rough allowance for the list node,
+  // the index node and the strings themselves.
+  size_t bytes = sizeof(Entry) + sizeof(Key) + 4 * sizeof(void *) +
+                 key.query.size() + key.input.size();
+  for (const auto &output : outputs) {
+    bytes += sizeof(output) + output.size();
+  }
+  return bytes;
+}
+
+void RewriteCache::Evict(Shard *shard, size_t max_bytes) {
+  while (shard->bytes > max_bytes) {
+    const auto &entry = shard->entries.back();
+    shard->bytes -= entry.bytes;
+    shard->index.erase(shard->index.find(*entry.key));
+    shard->entries.pop_back();
+    ++evictions_;
+  }
+}
+
+}  // namespace fst
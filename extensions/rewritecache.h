@@ -0,0 +1,174 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_REWRITECACHE_H_
+#define PYNINI_REWRITECACHE_H_
+
+// A cache of the results of rewriting strings with rules.
+//
+// Rewrite traffic tends to be highly repetitive, so callers applying the same
+// rules to many inputs may keep the outputs of each query, keyed by a
+// fingerprint of the rule, and skip composition entirely when the query is
+// repeated. The cache is bounded in bytes, evicting the least recently used
+// entries first, and is split into independently locked shards so that
+// concurrent callers rarely contend.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fst/fst.h>
+
+namespace fst {
+
+// Identifies a query. The rule is a fingerprint of the rule (or cascade of
+// rules) applied, such as computed by FstFingerprint below, and the query is
+// the name of the rewrite function, together with any options (e.g., token
+// types) which affect its result. The number of shortest paths should be 0
+// for queries which do not use it.
+struct RewriteCacheKey {
+  uint64_t rule = 0;
+  std::string query;
+  int32_t nshortest = 0;
+  std::string input;
+
+  bool operator==(const RewriteCacheKey &other) const {
+    return rule == other.rule && nshortest == other.nshortest &&
+           query == other.query && input == other.input;
+  }
+};
+
+class RewriteCache {
+ public:
+  using Key = RewriteCacheKey;
+
+  // The cache holds up to max_bytes bytes, split evenly across the shards.
+  explicit RewriteCache(size_t max_bytes, size_t num_shards = 16);
+
+  // If the key is present, copies its outputs and returns true, making it the
+  // most recently used entry in its shard; otherwise returns false.
+  bool Lookup(const Key &key, std::vector<std::string> *outputs);
+
+  // Adds or replaces the outputs for the key, evicting the least recently
+  // used entries in its shard as needed. Entries too large for a shard are
+  // not cached at all.
+  void Insert(const Key &key, std::vector<std::string> outputs);
+
+  // Removes all entries; the counters are not reset.
+  void Clear();
+
+  size_t MaxBytes() const { return max_bytes_; }
+
+  size_t NumShards() const { return shards_.size(); }
+
+  // The number of entries.
+  size_t Size() const;
+
+  // The approximate number of bytes used by the entries.
+  size_t NumBytes() const;
+
+  uint64_t Hits() const { return hits_; }
+
+  uint64_t Misses() const { return misses_; }
+
+  uint64_t Evictions() const { return evictions_; }
+
+ private:
+  struct KeyHash {
+    size_t operator()(const Key &key) const {
+      size_t hash = std::hash<std::string>()(key.input);
+      hash = hash * 7853 + std::hash<std::string>()(key.query);
+      hash = hash * 7867 + key.rule;
+      return hash * 7873 + key.nshortest;
+    }
+  };
+
+  // The key is owned by the shard's index.
+  struct Entry {
+    const Key *key;
+    std::vector<std::string> outputs;
+    size_t bytes;
+  };
+
+  using EntryList = std::list<Entry>;
+
+  // Entries are kept in order of use, most recent first.
+  struct Shard {
+    mutable std::mutex mutex;
+    EntryList entries;
+    std::unordered_map<Key, EntryList::iterator, KeyHash> index;
+    size_t bytes = 0;
+  };
+
+  static size_t EntryBytes(const Key &key,
+                           const std::vector<std::string> &outputs);
+
+  Shard &GetShard(const Key &key) {
+    return *shards_[KeyHash()(key) % shards_.size()];
+  }
+
+  // Removes least recently used entries from the shard until it holds no more
+  // than the given number of bytes; the caller must hold the shard's lock.
+  void Evict(Shard *shard, size_t max_bytes);
+
+  const size_t max_bytes_;
+  const size_t shard_max_bytes_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+  std::atomic<uint64_t> evictions_;
+
+  RewriteCache(const RewriteCache &) = delete;
+  RewriteCache &operator=(const RewriteCache &) = delete;
+};
+
+// Computes a fingerprint of an FST's topology, labels and weights, for use as
+// a cache key. Equal FSTs have equal fingerprints, but FSTs which are
+// equivalent without being equal (e.g., with states numbered differently) do
+// not. This visits every state and arc, expanding delayed FSTs.
+template <class Arc>
+uint64_t FstFingerprint(const Fst<Arc> &fst) {
+  static constexpr uint64_t kPrime = 1099511628211ULL;
+  uint64_t hash = 14695981039346656037ULL;
+  const auto mix = [&hash](uint64_t value) { hash = (hash ^ value) * kPrime; };
+  mix(std::hash<std::string>()(Arc::Type()));
+  mix(fst.Start());
+  for (StateIterator<Fst<Arc>> siter(fst); !siter.Done(); siter.Next()) {
+    const auto state = siter.Value();
+    mix(state);
+    mix(fst.Final(state).Hash());
+    for (ArcIterator<Fst<Arc>> aiter(fst, state); !aiter.Done();
+         aiter.Next()) {
+      const auto &arc = aiter.Value();
+      mix(arc.ilabel);
+      mix(arc.olabel);
+      mix(arc.weight.Hash());
+      mix(arc.nextstate);
+    }
+  }
+  return hash;
+}
+
+}  // namespace fst
+
+#endif  // PYNINI_REWRITECACHE_H_
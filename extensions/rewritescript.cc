@@ -0,0 +1,145 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "rewritescript.h"
+
+#include <cstdint>
+
+#include <fst/script/script-impl.h>
+
+namespace fst {
+namespace script {
+
+bool StringViewRewriteLattice(const std::string &input, const FstClass &rule,
+                              MutableFstClass *lattice, TokenType token_type) {
+  if (!internal::ArcTypesMatch(rule, *lattice, "StringViewRewriteLattice")) {
+    lattice->SetProperties(kError, kError);
+    return false;
+  }
+  StringViewRewriteLatticeInnerArgs iargs(input, rule, lattice, token_type);
+  StringViewRewriteLatticeArgs args(iargs);
+  Apply<Operation<StringViewRewriteLatticeArgs>>("StringViewRewriteLattice",
+                                                 rule.ArcType(), &args);
+  return args.retval;
+}
+
+REGISTER_FST_OPERATION_3ARCS(StringViewRewriteLattice,
+                             StringViewRewriteLatticeArgs);
+
+bool StringViewTopRewrite(const std::string &input, const FstClass &rule,
+                          std::string *output, TokenType input_token_type,
+                          TokenType output_token_type,
+                          const SymbolTable *output_symbols,
+                          RewriteStats *stats) {
+  StringViewTopRewriteInnerArgs iargs(input, rule, output, input_token_type,
+                                      output_token_type, output_symbols, stats);
+  StringViewTopRewriteArgs args(iargs);
+  Apply<Operation<StringViewTopRewriteArgs>>("StringViewTopRewrite",
+                                             rule.ArcType(), &args);
+  return args.retval;
+}
+
+REGISTER_FST_OPERATION_3ARCS(StringViewTopRewrite, StringViewTopRewriteArgs);
+
+bool Matches(const FstClass &input, const FstClass &output,
+             const FstClass &rule, bool *match) {
+  if (!internal::ArcTypesMatch(input, rule, "Matches") ||
+      !internal::ArcTypesMatch(output, rule, "Matches")) {
+    return false;
+  }
+  MatchesInnerArgs iargs(input, output, rule, match);
+  MatchesArgs args(iargs);
+  Apply<Operation<MatchesArgs>>("Matches", rule.ArcType(), &args);
+  return args.retval;
+}
+
+REGISTER_FST_OPERATION_3ARCS(Matches, MatchesArgs);
+
+bool BatchTopRewrite(const std::vector<std::string> &inputs,
+                     const FstClass &rule, std::vector<std::string> *outputs,
+                     TokenType input_token_type,
+                     const SymbolTable *input_symbols,
+                     TokenType output_token_type,
+                     const SymbolTable *output_symbols, int num_threads) {
+  BatchTopRewriteInnerArgs iargs(inputs, rule, outputs, input_token_type,
+                                 input_symbols, output_token_type,
+                                 output_symbols, num_threads);
+  BatchTopRewriteArgs args(iargs);
+  Apply<Operation<BatchTopRewriteArgs>>("BatchTopRewrite", rule.ArcType(),
+                                        &args);
+  return args.retval;
+}
+
+REGISTER_FST_OPERATION_3ARCS(BatchTopRewrite, BatchTopRewriteArgs);
+
+bool BatchRewrites(const std::vector<std::string> &inputs,
+                   const FstClass &rule,
+                   std::vector<std::vector<std::string>> *outputs,
+                   TokenType input_token_type,
+                   const SymbolTable *input_symbols,
+                   TokenType output_token_type,
+                   const SymbolTable *output_symbols, int num_threads,
+                   int32_t state_multiplier) {
+  BatchRewritesInnerArgs iargs(inputs, rule, outputs, input_token_type,
+                               input_symbols, output_token_type,
+                               output_symbols, num_threads, state_multiplier);
+  BatchRewritesArgs args(iargs);
+  Apply<Operation<BatchRewritesArgs>>("BatchRewrites", rule.ArcType(), &args);
+  return args.retval;
+}
+
+REGISTER_FST_OPERATION_3ARCS(BatchRewrites, BatchRewritesArgs);
+
+bool BatchOptimalRewrites(const std::vector<std::string> &inputs,
+                          const FstClass &rule,
+                          std::vector<std::vector<std::string>> *outputs,
+                          TokenType input_token_type,
+                          const SymbolTable *input_symbols,
+                          TokenType output_token_type,
+                          const SymbolTable *output_symbols, int num_threads,
+                          int32_t state_multiplier) {
+  BatchRewritesInnerArgs iargs(inputs, rule, outputs, input_token_type,
+                               input_symbols, output_token_type,
+                               output_symbols, num_threads, state_multiplier);
+  BatchRewritesArgs args(iargs);
+  Apply<Operation<BatchRewritesArgs>>("BatchOptimalRewrites", rule.ArcType(),
+                                      &args);
+  return args.retval;
+}
+
+REGISTER_FST_OPERATION_3ARCS(BatchOptimalRewrites, BatchRewritesArgs);
+
+bool BatchTopRewrites(const std::vector<std::string> &inputs,
+                      const FstClass &rule, int32_t nshortest,
+                      std::vector<std::vector<std::string>> *outputs,
+                      TokenType input_token_type,
+                      const SymbolTable *input_symbols,
+                      TokenType output_token_type,
+                      const SymbolTable *output_symbols, int num_threads) {
+  BatchTopRewritesInnerArgs iargs(inputs, rule, nshortest, outputs,
+                                  input_token_type, input_symbols,
+                                  output_token_type, output_symbols,
+                                  num_threads);
+  BatchTopRewritesArgs args(iargs);
+  Apply<Operation<BatchTopRewritesArgs>>("BatchTopRewrites", rule.ArcType(),
+                                         &args);
+  return args.retval;
+}
+
+REGISTER_FST_OPERATION_3ARCS(BatchTopRewrites, BatchTopRewritesArgs);
+
+}  // namespace script
+}  // namespace fst
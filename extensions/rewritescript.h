@@ -0,0 +1,194 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_REWRITESCRIPT_H_
+#define PYNINI_REWRITESCRIPT_H_
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <fst/fstlib.h>
+#include <fst/script/arg-packs.h>
+#include <fst/script/fstscript.h>
+#include "rewrite.h"
+
+namespace fst {
+namespace script {
+
+using StringViewRewriteLatticeInnerArgs =
+    std::tuple<const std::string &, const FstClass &, MutableFstClass *,
+               TokenType>;
+
+using StringViewRewriteLatticeArgs =
+    WithReturnValue<bool, StringViewRewriteLatticeInnerArgs>;
+
+template <class Arc>
+void StringViewRewriteLattice(StringViewRewriteLatticeArgs *args) {
+  const Fst<Arc> &rule = *std::get<1>(args->args).GetFst<Arc>();
+  MutableFst<Arc> *lattice = std::get<2>(args->args)->GetMutableFst<Arc>();
+  args->retval = RewriteLattice(absl::string_view(std::get<0>(args->args)),
+                                rule, lattice, std::get<3>(args->args));
+}
+
+bool StringViewRewriteLattice(const std::string &input, const FstClass &rule,
+                              MutableFstClass *lattice,
+                              TokenType token_type = TokenType::BYTE);
+
+using StringViewTopRewriteInnerArgs =
+    std::tuple<const std::string &, const FstClass &, std::string *,
+               TokenType, TokenType, const SymbolTable *, RewriteStats *>;
+
+using StringViewTopRewriteArgs =
+    WithReturnValue<bool, StringViewTopRewriteInnerArgs>;
+
+template <class Arc>
+void StringViewTopRewrite(StringViewTopRewriteArgs *args) {
+  const Fst<Arc> &rule = *std::get<1>(args->args).GetFst<Arc>();
+  args->retval = TopRewrite(absl::string_view(std::get<0>(args->args)), rule,
+                            std::get<2>(args->args), std::get<3>(args->args),
+                            std::get<4>(args->args), std::get<5>(args->args),
+                            std::get<6>(args->args));
+}
+
+bool StringViewTopRewrite(const std::string &input, const FstClass &rule,
+                          std::string *output,
+                          TokenType input_token_type = TokenType::BYTE,
+                          TokenType output_token_type = TokenType::BYTE,
+                          const SymbolTable *output_symbols = nullptr,
+                          RewriteStats *stats = nullptr);
+
+using MatchesInnerArgs =
+    std::tuple<const FstClass &, const FstClass &, const FstClass &, bool *>;
+
+using MatchesArgs = WithReturnValue<bool, MatchesInnerArgs>;
+
+template <class Arc>
+void Matches(MatchesArgs *args) {
+  const Fst<Arc> &input = *std::get<0>(args->args).GetFst<Arc>();
+  const Fst<Arc> &output = *std::get<1>(args->args).GetFst<Arc>();
+  const Fst<Arc> &rule = *std::get<2>(args->args).GetFst<Arc>();
+  args->retval = Matches(input, output, rule, std::get<3>(args->args));
+}
+
+// Returns false if the arc types do not match, or if the rule rejects the
+// input.
+bool Matches(const FstClass &input, const FstClass &output,
+             const FstClass &rule, bool *match);
+
+using BatchTopRewriteInnerArgs =
+    std::tuple<const std::vector<std::string> &, const FstClass &,
+               std::vector<std::string> *, TokenType, const SymbolTable *,
+               TokenType, const SymbolTable *, int>;
+
+using BatchTopRewriteArgs = WithReturnValue<bool, BatchTopRewriteInnerArgs>;
+
+template <class Arc>
+void BatchTopRewrite(BatchTopRewriteArgs *args) {
+  const Fst<Arc> &rule = *std::get<1>(args->args).GetFst<Arc>();
+  args->retval = BatchTopRewrite(
+      std::get<0>(args->args), rule, std::get<2>(args->args),
+      std::get<3>(args->args), std::get<4>(args->args),
+      std::get<5>(args->args), std::get<6>(args->args),
+      std::get<7>(args->args));
+}
+
+bool BatchTopRewrite(const std::vector<std::string> &inputs,
+                     const FstClass &rule, std::vector<std::string> *outputs,
+                     TokenType input_token_type = TokenType::BYTE,
+                     const SymbolTable *input_symbols = nullptr,
+                     TokenType output_token_type = TokenType::BYTE,
+                     const SymbolTable *output_symbols = nullptr,
+                     int num_threads = 0);
+
+// This is shared by BatchRewrites and BatchOptimalRewrites.
+using BatchRewritesInnerArgs =
+    std::tuple<const std::vector<std::string> &, const FstClass &,
+               std::vector<std::vector<std::string>> *, TokenType,
+               const SymbolTable *, TokenType, const SymbolTable *, int,
+               int32_t>;
+
+using BatchRewritesArgs = WithReturnValue<bool, BatchRewritesInnerArgs>;
+
+template <class Arc>
+void BatchRewrites(BatchRewritesArgs *args) {
+  const Fst<Arc> &rule = *std::get<1>(args->args).GetFst<Arc>();
+  args->retval = BatchRewrites(
+      std::get<0>(args->args), rule, std::get<2>(args->args),
+      std::get<3>(args->args), std::get<4>(args->args),
+      std::get<5>(args->args), std::get<6>(args->args),
+      std::get<7>(args->args), std::get<8>(args->args));
+}
+
+bool BatchRewrites(const std::vector<std::string> &inputs,
+                   const FstClass &rule,
+                   std::vector<std::vector<std::string>> *outputs,
+                   TokenType input_token_type = TokenType::BYTE,
+                   const SymbolTable *input_symbols = nullptr,
+                   TokenType output_token_type = TokenType::BYTE,
+                   const SymbolTable *output_symbols = nullptr,
+                   int num_threads = 0, int32_t state_multiplier = 4);
+
+template <class Arc>
+void BatchOptimalRewrites(BatchRewritesArgs *args) {
+  const Fst<Arc> &rule = *std::get<1>(args->args).GetFst<Arc>();
+  args->retval = BatchOptimalRewrites(
+      std::get<0>(args->args), rule, std::get<2>(args->args),
+      std::get<3>(args->args), std::get<4>(args->args),
+      std::get<5>(args->args), std::get<6>(args->args),
+      std::get<7>(args->args), std::get<8>(args->args));
+}
+
+bool BatchOptimalRewrites(const std::vector<std::string> &inputs,
+                          const FstClass &rule,
+                          std::vector<std::vector<std::string>> *outputs,
+                          TokenType input_token_type = TokenType::BYTE,
+                          const SymbolTable *input_symbols = nullptr,
+                          TokenType output_token_type = TokenType::BYTE,
+                          const SymbolTable *output_symbols = nullptr,
+                          int num_threads = 0, int32_t state_multiplier = 4);
+
+using BatchTopRewritesInnerArgs =
+    std::tuple<const std::vector<std::string> &, const FstClass &, int32_t,
+               std::vector<std::vector<std::string>> *, TokenType,
+               const SymbolTable *, TokenType, const SymbolTable *, int>;
+
+using BatchTopRewritesArgs = WithReturnValue<bool, BatchTopRewritesInnerArgs>;
+
+template <class Arc>
+void BatchTopRewrites(BatchTopRewritesArgs *args) {
+  const Fst<Arc> &rule = *std::get<1>(args->args).GetFst<Arc>();
+  args->retval = BatchTopRewrites(
+      std::get<0>(args->args), rule, std::get<2>(args->args),
+      std::get<3>(args->args), std::get<4>(args->args),
+      std::get<5>(args->args), std::get<6>(args->args),
+      std::get<7>(args->args), std::get<8>(args->args));
+}
+
+bool BatchTopRewrites(const std::vector<std::string> &inputs,
+                      const FstClass &rule, int32_t nshortest,
+                      std::vector<std::vector<std::string>> *outputs,
+                      TokenType input_token_type = TokenType::BYTE,
+                      const SymbolTable *input_symbols = nullptr,
+                      TokenType output_token_type = TokenType::BYTE,
+                      const SymbolTable *output_symbols = nullptr,
+                      int num_threads = 0);
+
+}  // namespace script
+}  // namespace fst
+
+#endif  // PYNINI_REWRITESCRIPT_H_
@@ -0,0 +1,101 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_REWRITESTATS_H_
+#define PYNINI_REWRITESTATS_H_
+
+// Optional instrumentation of individual rewrite calls.
+
+#include <chrono>
+#include <cstdint>
+
+#include <fst/fst.h>
+
+namespace fst {
+
+// Statistics for a single rewrite call. The rewrite functions which take one
+// fill it in if it is non-null, and leave any fields for phases they do not
+// perform untouched, so callers should clear it between calls; when it is
+// null, no clock is read.
+struct RewriteStats {
+  // Size of the composed lattice, after projection and epsilon-removal.
+  int64_t lattice_states = 0;
+  int64_t lattice_arcs = 0;
+  // Number of output strings enumerated.
+  int64_t paths = 0;
+  // Time spent in each phase, in seconds. Composition includes the cleanup
+  // of the lattice; shortest-path search includes the search for the n
+  // shortest strings, except for the time spent printing them.
+  double compose_seconds = 0.0;
+  double dfa_seconds = 0.0;
+  double shortest_path_seconds = 0.0;
+  double print_seconds = 0.0;
+
+  void Clear() { *this = RewriteStats(); }
+};
+
+namespace internal {
+
+// Adds the time for which it is running to one of the phases of the stats, if
+// any. It starts running when constructed, and stops when destroyed.
+class RewritePhaseTimer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  RewritePhaseTimer(RewriteStats *stats, double RewriteStats::*phase)
+      : seconds_(stats ? &(stats->*phase) : nullptr) {
+    Start();
+  }
+
+  ~RewritePhaseTimer() { Stop(); }
+
+  void Start() {
+    if (!seconds_ || running_) return;
+    start_ = Clock::now();
+    running_ = true;
+  }
+
+  void Stop() {
+    if (!seconds_ || !running_) return;
+    *seconds_ += std::chrono::duration<double>(Clock::now() - start_).count();
+    running_ = false;
+  }
+
+ private:
+  double *seconds_;
+  bool running_ = false;
+  Clock::time_point start_;
+
+  RewritePhaseTimer(const RewritePhaseTimer &) = delete;
+  RewritePhaseTimer &operator=(const RewritePhaseTimer &) = delete;
+};
+
+// Records the size of the composed lattice, if there are stats.
+template <class Arc>
+void RecordLattice(const Fst<Arc> &lattice, RewriteStats *stats) {
+  if (!stats) return;
+  stats->lattice_states = 0;
+  stats->lattice_arcs = 0;
+  for (StateIterator<Fst<Arc>> siter(lattice); !siter.Done(); siter.Next()) {
+    ++stats->lattice_states;
+    stats->lattice_arcs += lattice.NumArcs(siter.Value());
+  }
+}
+
+}  // namespace internal
+}  // namespace fst
+
+#endif  // PYNINI_REWRITESTATS_H_
@@ -0,0 +1,301 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_RULECASCADE_H_
+#define PYNINI_RULECASCADE_H_
+
+// A rule cascade applies a series of rewrite rules, in order, to an input.
+// Rather than materializing an intermediate lattice after each rule is
+// applied, the rules are composed with each other once, either offline (by
+// precomposing them into a single rule) or on-the-fly (as a chain of delayed
+// compositions, whose state cache persists across calls).
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fst/types.h>
+#include <fst/log.h>
+#include <fst/arcsort.h>
+#include <fst/cache.h>
+#include <fst/compose.h>
+#include <fst/fst.h>
+#include <fst/properties.h>
+#include <fst/vector-fst.h>
+#include "densematcher.h"
+#include "labelclassrule.h"
+#include "lookaheadrule.h"
+#include "memoryusage.h"
+#include "rewrite.h"
+
+namespace fst {
+
+template <class Arc>
+class RuleCascade {
+ public:
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+
+  // The rules are input-label-sorted (if they are not already) and copied;
+  // delayed rules, such as those from CDRewriteCompileDelayed, are sorted
+  // lazily so that they are never fully expanded.
+  // If `lazy` is false, the rules are precomposed into a single rule, which
+  // is expensive up front but makes each rewrite a single composition.
+  // Otherwise, the rules are combined into a chain of delayed compositions
+  // using the given cache options, so that only the part of the cascade
+  // reached by actual inputs is ever expanded. Either way, each expanded
+  // rule is wrapped in a DenseMatcherFst, so that composition matches its
+  // high-fanout states by direct lookup. If `lookahead` is true, the rules
+  // (or the precomposed rule) are instead converted to a LookAheadRuleFst,
+  // so that every composition uses lookahead to avoid exploring dead-end
+  // paths; this expands delayed rules. The state cache of each delayed
+  // composition is bounded by opts.gc_limit bytes. A LabelClassRuleFst keeps
+  // its rho matcher wherever it is the right-hand side of a composition, that
+  // is, unless it is the first of several rules or lookahead is used; there,
+  // it is expanded into an ordinary rule.
+  explicit RuleCascade(const std::vector<const Fst<Arc> *> &rules,
+                       bool lazy = false, bool lookahead = false,
+                       const CacheOptions &opts = CacheOptions())
+      : lazy_(lazy), lookahead_(lookahead) {
+    if (rules.empty()) {
+      FSTERROR() << "RuleCascade: No rules provided";
+      auto *empty = new VectorFst<Arc>();
+      empty->SetProperties(kError, kError);
+      cascade_.reset(empty);
+      error_ = true;
+      return;
+    }
+    std::vector<std::unique_ptr<const Fst<Arc>>> sorted;
+    sorted.reserve(rules.size());
+    size_t delayed_caches = 0;
+    for (const auto *rule : rules) {
+      if (rule->Properties(kError, false)) error_ = true;
+      if (IsLabelClassRule(*rule)) {
+        if (!lookahead_ && (!sorted.empty() || rules.size() == 1)) {
+          sorted.emplace_back(rule->Copy());
+        } else {
+          auto *expanded = new VectorFst<Arc>();
+          static_cast<const LabelClassRuleFst<Arc> &>(*rule).Expand(expanded);
+          sorted.emplace_back(expanded);
+        }
+      } else if (rule->Properties(kILabelSorted, false) == kILabelSorted) {
+        sorted.emplace_back(rule->Copy());
+      } else if (rule->Properties(kExpanded, false) != kExpanded) {
+        // Testing or sorting a delayed rule would expand it entirely, so it
+        // is instead sorted lazily, as it is visited.
+        static const ILabelCompare<Arc> icomp;
+        delayed_caches += fst::MemoryUsage(*rule).caches;
+        sorted.emplace_back(
+            new ArcSortFst<Arc, ILabelCompare<Arc>>(*rule, icomp));
+      } else if (rule->Properties(kILabelSorted, true) == kILabelSorted) {
+        sorted.emplace_back(rule->Copy());
+      } else {
+        auto *copy = new VectorFst<Arc>(*rule);
+        ArcSort(copy, ILabelCompare<Arc>());
+        sorted.emplace_back(copy);
+      }
+    }
+    if (lazy_) {
+      // The lookahead conversion of each rule has the same states and arcs.
+      for (const auto &rule : sorted) usage_ += fst::MemoryUsage(*rule);
+      if (opts.gc) usage_.caches = (sorted.size() - 1) * opts.gc_limit;
+      usage_.caches += delayed_caches;
+    }
+    if (lazy_ && lookahead_) {
+      std::vector<const Fst<Arc> *> chain;
+      chain.reserve(sorted.size());
+      for (const auto &rule : sorted) chain.push_back(rule.get());
+      cascade_ = std::make_unique<LookAheadRuleFst<Arc>>(chain, opts);
+    } else if (lazy_) {
+      for (auto &rule : sorted) {
+        // A dense matcher would replace the rho matcher of a label class rule.
+        if (rule->Properties(kExpanded, false) && !IsLabelClassRule(*rule)) {
+          rule = std::make_unique<DenseMatcherFst<Arc>>(*rule);
+        }
+      }
+      const ComposeFstOptions<Arc> copts(opts);
+      cascade_ = std::move(sorted[0]);
+      for (size_t i = 1; i < sorted.size(); ++i) {
+        cascade_ = std::make_unique<ComposeFst<Arc>>(*cascade_, *sorted[i],
+                                                     copts);
+      }
+    } else if (IsLabelClassRule(*sorted[0])) {
+      // This is the only rule, and copying it would lose its rho matcher.
+      usage_ = fst::MemoryUsage(*sorted[0]);
+      cascade_ = std::move(sorted[0]);
+    } else {
+      auto composed = std::make_unique<VectorFst<Arc>>(*sorted[0]);
+      for (size_t i = 1; i < sorted.size(); ++i) {
+        Compose(*composed, *sorted[i], composed.get());
+      }
+      ArcSort(composed.get(), ILabelCompare<Arc>());
+      usage_ = fst::MemoryUsage(*composed);
+      if (lookahead_) {
+        cascade_ = std::make_unique<LookAheadRuleFst<Arc>>(*composed);
+      } else {
+        cascade_ = std::make_unique<DenseMatcherFst<Arc>>(*composed);
+      }
+    }
+    if (cascade_->Properties(kError, false)) error_ = true;
+    if (lazy_) copies_.emplace_back(cascade_->Copy(true));
+    num_copies_ = copies_.size();
+  }
+
+  // Whether the cascade was constructed with delayed composition.
+  bool Lazy() const { return lazy_; }
+
+  // Whether the cascade was constructed for lookahead composition.
+  bool LookAhead() const { return lookahead_; }
+
+  bool Error() const { return error_; }
+
+  // The cascade viewed as a single rule. In lazy mode, rewrites use copies of
+  // it, which are made as needed, so it must not be used while rewrites run
+  // on other threads.
+  const Fst<Arc> &Rule() const { return *cascade_; }
+
+  // The approximate memory used by the cascade: that of the expanded rules it
+  // holds, which may be shared with the caller's copies, and in lazy mode, the
+  // limit on the state cache of each delayed composition, which OpenFst does
+  // not report the size of, and that of each delayed rule (e.g., from
+  // CDRewriteCompileDelayed), for each copy of the cascade made so far.
+  MemoryStats MemoryUsage() const {
+    MemoryStats usage = usage_;
+    if (lazy_) {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      usage.caches *= num_copies_;
+    }
+    return usage;
+  }
+
+  // The following mirror the free functions in rewrite.h. In lazy mode, the
+  // delayed compositions' caches are mutated on access, so each concurrent
+  // call uses its own thread-safe copy of the cascade; copies are kept for
+  // later calls, so that their caches persist.
+
+  bool RewriteLattice(const Fst<Arc> &input, MutableFst<Arc> *lattice) const {
+    return WithCascade([&](const Fst<Arc> &cascade) {
+      return fst::RewriteLattice(input, cascade, lattice);
+    });
+  }
+
+  bool TopRewrite(const Fst<Arc> &input, std::string *output,
+                  TokenType ttype = TokenType::BYTE,
+                  const SymbolTable *syms = nullptr) const {
+    return WithCascade([&](const Fst<Arc> &cascade) {
+      return fst::TopRewrite(input, cascade, output, ttype, syms);
+    });
+  }
+
+  bool OneTopRewrite(const Fst<Arc> &input, std::string *output,
+                     TokenType ttype = TokenType::BYTE,
+                     const SymbolTable *syms = nullptr,
+                     StateId state_multiplier = 4) const {
+    return WithCascade([&](const Fst<Arc> &cascade) {
+      return fst::OneTopRewrite(input, cascade, output, ttype, syms,
+                                state_multiplier);
+    });
+  }
+
+  bool Rewrites(const Fst<Arc> &input, std::vector<std::string> *output,
+                TokenType ttype = TokenType::BYTE,
+                const SymbolTable *syms = nullptr,
+                StateId state_multiplier = 4) const {
+    return WithCascade([&](const Fst<Arc> &cascade) {
+      return fst::Rewrites(input, cascade, output, ttype, syms,
+                           state_multiplier);
+    });
+  }
+
+  // All optimal rewrites.
+  bool TopRewrites(const Fst<Arc> &input, std::vector<std::string> *output,
+                   TokenType ttype = TokenType::BYTE,
+                   const SymbolTable *syms = nullptr,
+                   StateId state_multiplier = 4) const {
+    return WithCascade([&](const Fst<Arc> &cascade) {
+      return fst::TopRewrites(input, cascade, output, ttype, syms,
+                              state_multiplier);
+    });
+  }
+
+  // The top n rewrites.
+  bool TopRewrites(const Fst<Arc> &input, int32_t nshortest,
+                   std::vector<std::string> *output,
+                   TokenType ttype = TokenType::BYTE,
+                   const SymbolTable *syms = nullptr) const {
+    return WithCascade([&](const Fst<Arc> &cascade) {
+      return fst::TopRewrites(input, cascade, nshortest, output, ttype, syms);
+    });
+  }
+
+  // Sets match to whether the cascade allows an input/output pair; returns
+  // false if it rejects the input altogether.
+  bool Matches(const Fst<Arc> &input, const Fst<Arc> &output,
+               bool *match) const {
+    return WithCascade([&](const Fst<Arc> &cascade) {
+      return fst::Matches(input, output, cascade, match);
+    });
+  }
+
+ private:
+  static bool IsLabelClassRule(const Fst<Arc> &rule) {
+    return rule.Type() == LabelClassRuleFst<Arc>::StaticType();
+  }
+
+  // Calls the function with the cascade, or in lazy mode, with an idle copy
+  // of it, which is only held by this call. The lock is only held to take
+  // and return the copy, so calls on different threads run in parallel.
+  template <class Function>
+  bool WithCascade(Function function) const {
+    if (!lazy_) return function(*cascade_);
+    std::unique_ptr<const Fst<Arc>> copy;
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      if (copies_.empty()) {
+        copy.reset(cascade_->Copy(true));
+        ++num_copies_;
+      } else {
+        copy = std::move(copies_.back());
+        copies_.pop_back();
+      }
+    }
+    const bool result = function(*copy);
+    const std::lock_guard<std::mutex> lock(mutex_);
+    copies_.push_back(std::move(copy));
+    return result;
+  }
+
+  const bool lazy_;
+  const bool lookahead_;
+  bool error_ = false;
+  // In lazy mode, this is only copied, and never used for rewrites itself.
+  std::unique_ptr<const Fst<Arc>> cascade_;
+  MemoryStats usage_;
+  mutable std::mutex mutex_;
+  // Idle copies of the cascade, and the number of copies made, in lazy mode.
+  mutable std::vector<std::unique_ptr<const Fst<Arc>>> copies_;
+  mutable size_t num_copies_ = 0;
+
+  RuleCascade(const RuleCascade &) = delete;
+  RuleCascade &operator=(const RuleCascade &) = delete;
+};
+
+}  // namespace fst
+
+#endif  // PYNINI_RULECASCADE_H_
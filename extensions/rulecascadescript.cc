@@ -0,0 +1,47 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "rulecascadescript.h"
+
+#include <fst/script/fst-class.h>
+#include <fst/script/script-impl.h>
+
+namespace fst {
+namespace script {
+
+RuleCascadeClass::RuleCascadeClass(const std::vector<const FstClass *> &rules,
+                                   bool lazy, bool lookahead,
+                                   size_t cache_gc_limit)
+    : impl_(nullptr) {
+  if (rules.empty()) {
+    LOG(ERROR) << "RuleCascadeClass: No rules provided";
+    return;
+  }
+  for (size_t i = 1; i < rules.size(); ++i) {
+    if (!internal::ArcTypesMatch(*rules[0], *rules[i], "RuleCascadeClass")) {
+      return;
+    }
+  }
+  arc_type_ = rules[0]->ArcType();
+  InitRuleCascadeClassArgs args(rules, lazy, lookahead, cache_gc_limit, this);
+  Apply<Operation<InitRuleCascadeClassArgs>>("InitRuleCascadeClass",
+                                             arc_type_, &args);
+}
+
+REGISTER_FST_OPERATION_3ARCS(InitRuleCascadeClass, InitRuleCascadeClassArgs);
+
+}  // namespace script
+}  // namespace fst
@@ -0,0 +1,256 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_RULECASCADESCRIPT_H_
+#define PYNINI_RULECASCADESCRIPT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <fst/script/arg-packs.h>
+#include <fst/script/fstscript.h>
+#include "memoryusage.h"
+#include "rulecascade.h"
+
+namespace fst {
+namespace script {
+
+// Virtual interface implemented by each concrete RuleCascadeImpl<Arc>.
+class RuleCascadeImplBase {
+ public:
+  virtual bool Error() const = 0;
+  virtual bool Lazy() const = 0;
+  virtual bool LookAhead() const = 0;
+  virtual bool RewriteLattice(const FstClass &input,
+                              MutableFstClass *lattice) const = 0;
+  virtual bool TopRewrite(const FstClass &input, std::string *output,
+                          TokenType ttype,
+                          const SymbolTable *syms) const = 0;
+  virtual bool OneTopRewrite(const FstClass &input, std::string *output,
+                             TokenType ttype, const SymbolTable *syms,
+                             int32_t state_multiplier) const = 0;
+  virtual bool Rewrites(const FstClass &input,
+                        std::vector<std::string> *output, TokenType ttype,
+                        const SymbolTable *syms,
+                        int32_t state_multiplier) const = 0;
+  virtual bool OptimalRewrites(const FstClass &input,
+                               std::vector<std::string> *output,
+                               TokenType ttype, const SymbolTable *syms,
+                               int32_t state_multiplier) const = 0;
+  virtual bool TopRewrites(const FstClass &input, int32_t nshortest,
+                           std::vector<std::string> *output, TokenType ttype,
+                           const SymbolTable *syms) const = 0;
+  virtual bool Matches(const FstClass &input, const FstClass &output,
+                       bool *match) const = 0;
+  virtual MemoryStats MemoryUsage() const = 0;
+  virtual ~RuleCascadeImplBase() {}
+};
+
+// Templated implementation. Each method returns false, after logging, if
+// the arguments do not have the cascade's arc type.
+template <class Arc>
+class RuleCascadeImpl : public RuleCascadeImplBase {
+ public:
+  RuleCascadeImpl(const std::vector<const Fst<Arc> *> &rules, bool lazy,
+                  bool lookahead, size_t cache_gc_limit)
+      : impl_(rules, lazy, lookahead,
+              CacheOptions(/*gc=*/true, cache_gc_limit)) {}
+
+  bool Error() const override { return impl_.Error(); }
+
+  bool Lazy() const override { return impl_.Lazy(); }
+
+  bool LookAhead() const override { return impl_.LookAhead(); }
+
+  bool RewriteLattice(const FstClass &input,
+                      MutableFstClass *lattice) const override {
+    const auto *typed_input = GetTypedFst(input, "RewriteLattice");
+    if (!typed_input) return false;
+    auto *typed_lattice = lattice->GetMutableFst<Arc>();
+    if (!typed_lattice) {
+      LOG(ERROR) << "RuleCascade::RewriteLattice: Lattice arc type does not "
+                 << "match cascade arc type";
+      return false;
+    }
+    return impl_.RewriteLattice(*typed_input, typed_lattice);
+  }
+
+  bool TopRewrite(const FstClass &input, std::string *output, TokenType ttype,
+                  const SymbolTable *syms) const override {
+    const auto *typed_input = GetTypedFst(input, "TopRewrite");
+    return typed_input && impl_.TopRewrite(*typed_input, output, ttype, syms);
+  }
+
+  bool OneTopRewrite(const FstClass &input, std::string *output,
+                     TokenType ttype, const SymbolTable *syms,
+                     int32_t state_multiplier) const override {
+    const auto *typed_input = GetTypedFst(input, "OneTopRewrite");
+    return typed_input && impl_.OneTopRewrite(*typed_input, output, ttype,
+                                              syms, state_multiplier);
+  }
+
+  bool Rewrites(const FstClass &input, std::vector<std::string> *output,
+                TokenType ttype, const SymbolTable *syms,
+                int32_t state_multiplier) const override {
+    const auto *typed_input = GetTypedFst(input, "Rewrites");
+    return typed_input &&
+           impl_.Rewrites(*typed_input, output, ttype, syms, state_multiplier);
+  }
+
+  bool OptimalRewrites(const FstClass &input,
+                       std::vector<std::string> *output, TokenType ttype,
+                       const SymbolTable *syms,
+                       int32_t state_multiplier) const override {
+    const auto *typed_input = GetTypedFst(input, "OptimalRewrites");
+    return typed_input && impl_.TopRewrites(*typed_input, output, ttype, syms,
+                                            state_multiplier);
+  }
+
+  bool TopRewrites(const FstClass &input, int32_t nshortest,
+                   std::vector<std::string> *output, TokenType ttype,
+                   const SymbolTable *syms) const override {
+    const auto *typed_input = GetTypedFst(input, "TopRewrites");
+    return typed_input &&
+           impl_.TopRewrites(*typed_input, nshortest, output, ttype, syms);
+  }
+
+  bool Matches(const FstClass &input, const FstClass &output,
+               bool *match) const override {
+    const auto *typed_input = GetTypedFst(input, "Matches");
+    const auto *typed_output = GetTypedFst(output, "Matches");
+    return typed_input && typed_output &&
+           impl_.Matches(*typed_input, *typed_output, match);
+  }
+
+  MemoryStats MemoryUsage() const override { return impl_.MemoryUsage(); }
+
+ private:
+  static const Fst<Arc> *GetTypedFst(const FstClass &fst,
+                                     const std::string &op_name) {
+    const auto *typed_fst = fst.GetFst<Arc>();
+    if (!typed_fst) {
+      LOG(ERROR) << "RuleCascade::" << op_name << ": Argument arc type "
+                 << fst.ArcType() << " does not match cascade arc type "
+                 << Arc::Type();
+    }
+    return typed_fst;
+  }
+
+  RuleCascade<Arc> impl_;
+};
+
+class RuleCascadeClass;
+
+using InitRuleCascadeClassArgs =
+    std::tuple<const std::vector<const FstClass *> &, bool, bool, size_t,
+               RuleCascadeClass *>;
+
+// Untemplated user-facing class holding templated pimpl.
+class RuleCascadeClass {
+ public:
+  explicit RuleCascadeClass(const std::vector<const FstClass *> &rules,
+                            bool lazy = false, bool lookahead = false,
+                            size_t cache_gc_limit = kDefaultCacheGcLimit);
+
+  // The default limit, in bytes, on the state cache of each delayed
+  // composition in a lazy cascade.
+  static constexpr size_t kDefaultCacheGcLimit = 1 << 20;
+
+  const std::string &ArcType() const { return arc_type_; }
+
+  bool Error() const { return !impl_ || impl_->Error(); }
+
+  bool Lazy() const { return impl_ && impl_->Lazy(); }
+
+  bool LookAhead() const { return impl_ && impl_->LookAhead(); }
+
+  bool RewriteLattice(const FstClass &input, MutableFstClass *lattice) const {
+    return impl_ && impl_->RewriteLattice(input, lattice);
+  }
+
+  bool TopRewrite(const FstClass &input, std::string *output,
+                  TokenType ttype = TokenType::BYTE,
+                  const SymbolTable *syms = nullptr) const {
+    return impl_ && impl_->TopRewrite(input, output, ttype, syms);
+  }
+
+  bool OneTopRewrite(const FstClass &input, std::string *output,
+                     TokenType ttype = TokenType::BYTE,
+                     const SymbolTable *syms = nullptr,
+                     int32_t state_multiplier = 4) const {
+    return impl_ &&
+           impl_->OneTopRewrite(input, output, ttype, syms, state_multiplier);
+  }
+
+  bool Rewrites(const FstClass &input, std::vector<std::string> *output,
+                TokenType ttype = TokenType::BYTE,
+                const SymbolTable *syms = nullptr,
+                int32_t state_multiplier = 4) const {
+    return impl_ &&
+           impl_->Rewrites(input, output, ttype, syms, state_multiplier);
+  }
+
+  bool OptimalRewrites(const FstClass &input,
+                       std::vector<std::string> *output,
+                       TokenType ttype = TokenType::BYTE,
+                       const SymbolTable *syms = nullptr,
+                       int32_t state_multiplier = 4) const {
+    return impl_ && impl_->OptimalRewrites(input, output, ttype, syms,
+                                           state_multiplier);
+  }
+
+  bool TopRewrites(const FstClass &input, int32_t nshortest,
+                   std::vector<std::string> *output,
+                   TokenType ttype = TokenType::BYTE,
+                   const SymbolTable *syms = nullptr) const {
+    return impl_ && impl_->TopRewrites(input, nshortest, output, ttype, syms);
+  }
+
+  bool Matches(const FstClass &input, const FstClass &output,
+               bool *match) const {
+    return impl_ && impl_->Matches(input, output, match);
+  }
+
+  MemoryStats MemoryUsage() const {
+    return impl_ ? impl_->MemoryUsage() : MemoryStats();
+  }
+
+  template <class Arc>
+  friend void InitRuleCascadeClass(InitRuleCascadeClassArgs *args);
+
+ private:
+  std::string arc_type_;
+  std::unique_ptr<RuleCascadeImplBase> impl_;
+};
+
+template <class Arc>
+void InitRuleCascadeClass(InitRuleCascadeClassArgs *args) {
+  std::vector<const Fst<Arc> *> typed_rules;
+  for (const auto *rule : std::get<0>(*args)) {
+    typed_rules.push_back(rule->GetFst<Arc>());
+  }
+  std::get<4>(*args)->impl_ = std::make_unique<RuleCascadeImpl<Arc>>(
+      typed_rules, std::get<1>(*args), std::get<2>(*args), std::get<3>(*args));
+}
+
+}  // namespace script
+}  // namespace fst
+
+#endif  // PYNINI_RULECASCADESCRIPT_H_
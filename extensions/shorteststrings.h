@@ -0,0 +1,246 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_SHORTESTSTRINGS_H_
+#define PYNINI_SHORTESTSTRINGS_H_
+
+// Lazy enumeration of the unique output strings of an automaton, in order of
+// weight.
+//
+// Unlike n-best extraction with ShortestPath, which builds the full n-best
+// FST (determinizing on the fly to ensure uniqueness) before any string can
+// be read, this performs a best-first search over the input FST and yields
+// each string as soon as it is known to be the next best. Callers who stop
+// after the first few strings pay only for the search needed to find them.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <fst/log.h>
+#include <fst/fst.h>
+#include <fst/shortest-distance.h>
+#include <fst/weight.h>
+
+namespace fst {
+
+// Iterates over the unique output strings of an FST in order of increasing
+// weight; each string's weight is that of its best path. Ties are broken in
+// the order the strings are discovered. This is only valid in a semiring with
+// the path property. Output epsilons are ignored, so strings which differ only
+// in the placement of epsilons are considered identical.
+//
+// The search is A*-like: partial paths are prioritized by their prefix weight
+// times the exact distance from their state to the final states, computed
+// once in advance. Since a partial path which reaches a state with a given
+// output prefix is dominated by any better partial path which reached the
+// same state with the same prefix, each such pair is expanded at most once;
+// this bounds the work needed even for highly ambiguous lattices. The FST may
+// be cyclic, in which case there are infinitely many strings and enumeration
+// must be stopped by the caller.
+template <class Arc>
+class ShortestStringIterator {
+ public:
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+  using ArcWeight = typename Arc::Weight;
+
+  explicit ShortestStringIterator(const Fst<Arc> &fst);
+
+  bool Done() const { return done_; }
+
+  // Checks if initialization was successful.
+  bool Error() const { return error_; }
+
+  // The output labels of the current string, without epsilons.
+  const std::vector<Label> &Labels() const { return labels_; }
+
+  // The weight of the current string.
+  const ArcWeight &Weight() const { return weight_; }
+
+  void Next();
+
+ private:
+  // Index of a node in the trie of output prefixes; the root, the empty
+  // prefix, is 0.
+  using PrefixId = int64_t;
+
+  // A partial path, at a state of the FST or, once its final weight has been
+  // applied, at the hallucinated superfinal state (kNoStateId).
+  struct Entry {
+    ArcWeight priority;
+    ArcWeight prefix_weight;
+    StateId state;
+    PrefixId prefix;
+    // Discovery order, used to break ties deterministically.
+    size_t order;
+  };
+
+  // Orders the queue so that the best (and, among equals, the earliest)
+  // entry is on top.
+  struct EntryCompare {
+    bool operator()(const Entry &lhs, const Entry &rhs) const {
+      static const NaturalLess<ArcWeight> less;
+      if (less(rhs.priority, lhs.priority)) return true;
+      if (less(lhs.priority, rhs.priority)) return false;
+      return lhs.order > rhs.order;
+    }
+  };
+
+  struct PairHash {
+    template <class T, class U>
+    size_t operator()(const std::pair<T, U> &pair) const {
+      return std::hash<T>()(pair.first) * 7853 + std::hash<U>()(pair.second);
+    }
+  };
+
+  // Returns the prefix extended by the label, adding it to the trie if
+  // needed; epsilons leave the prefix unchanged.
+  PrefixId Extend(PrefixId prefix, Label label);
+
+  void Push(const ArcWeight &priority, const ArcWeight &prefix_weight,
+            StateId state, PrefixId prefix);
+
+  // Advances to the next unique string.
+  void Advance();
+
+  bool done_;
+  bool error_;
+  std::unique_ptr<const Fst<Arc>> fst_;
+  // Distance from each state to the final states.
+  std::vector<ArcWeight> distance_;
+  std::priority_queue<Entry, std::vector<Entry>, EntryCompare> queue_;
+  size_t num_pushed_;
+  // Trie of output prefixes: the parent and last label of each node, and an
+  // index of nodes by parent and label.
+  std::vector<std::pair<PrefixId, Label>> prefixes_;
+  std::unordered_map<std::pair<PrefixId, Label>, PrefixId, PairHash> children_;
+  // Pairs of states and prefixes which have already been expanded.
+  std::unordered_set<std::pair<StateId, PrefixId>, PairHash> expanded_;
+  // Prefixes which have already been emitted as complete strings.
+  std::unordered_set<PrefixId> emitted_;
+  std::vector<Label> labels_;
+  ArcWeight weight_;
+
+  ShortestStringIterator(const ShortestStringIterator &) = delete;
+  ShortestStringIterator &operator=(const ShortestStringIterator &) = delete;
+};
+
+template <class Arc>
+ShortestStringIterator<Arc>::ShortestStringIterator(const Fst<Arc> &fst)
+    : done_(true),
+      error_(false),
+      fst_(fst.Copy()),
+      num_pushed_(0),
+      prefixes_{{-1, 0}},
+      weight_(ArcWeight::Zero()) {
+  if ((ArcWeight::Properties() & (kPath | kSemiring)) !=
+      (kPath | kSemiring)) {
+    error_ = true;
+    FSTERROR() << "ShortestStringIterator: Weight needs to have the path "
+               << "property and be distributive: " << ArcWeight::Type();
+    return;
+  }
+  const auto start = fst_->Start();
+  if (start == kNoStateId) return;
+  ShortestDistance(*fst_, &distance_, /*reverse=*/true);
+  if (distance_.size() == 1 && !distance_[0].Member()) {
+    error_ = true;
+    FSTERROR() << "ShortestStringIterator: Failed to compute shortest "
+               << "distances";
+    return;
+  }
+  if (static_cast<size_t>(start) >= distance_.size() ||
+      distance_[start] == ArcWeight::Zero()) {
+    return;
+  }
+  done_ = false;
+  Push(distance_[start], ArcWeight::One(), start, 0);
+  Advance();
+}
+
+template <class Arc>
+void ShortestStringIterator<Arc>::Next() {
+  if (Done()) return;
+  Advance();
+}
+
+template <class Arc>
+typename ShortestStringIterator<Arc>::PrefixId
+ShortestStringIterator<Arc>::Extend(PrefixId prefix, Label label) {
+  if (label == 0) return prefix;
+  const auto [it, inserted] =
+      children_.emplace(std::make_pair(prefix, label), prefixes_.size());
+  if (inserted) prefixes_.emplace_back(prefix, label);
+  return it->second;
+}
+
+template <class Arc>
+void ShortestStringIterator<Arc>::Push(const ArcWeight &priority,
+                                       const ArcWeight &prefix_weight,
+                                       StateId state, PrefixId prefix) {
+  queue_.push(Entry{priority, prefix_weight, state, prefix, num_pushed_++});
+}
+
+template <class Arc>
+void ShortestStringIterator<Arc>::Advance() {
+  while (!queue_.empty()) {
+    const auto entry = queue_.top();
+    queue_.pop();
+    if (entry.state == kNoStateId) {
+      // A complete path; the first to be popped for each prefix is the best
+      // path for that string.
+      if (!emitted_.insert(entry.prefix).second) continue;
+      labels_.clear();
+      for (auto prefix = entry.prefix; prefix != 0;
+           prefix = prefixes_[prefix].first) {
+        labels_.push_back(prefixes_[prefix].second);
+      }
+      std::reverse(labels_.begin(), labels_.end());
+      weight_ = entry.prefix_weight;
+      return;
+    }
+    if (!expanded_.emplace(entry.state, entry.prefix).second) continue;
+    const auto final_weight = fst_->Final(entry.state);
+    if (final_weight != ArcWeight::Zero()) {
+      const auto weight = Times(entry.prefix_weight, final_weight);
+      Push(weight, weight, kNoStateId, entry.prefix);
+    }
+    for (ArcIterator<Fst<Arc>> aiter(*fst_, entry.state); !aiter.Done();
+         aiter.Next()) {
+      const auto &arc = aiter.Value();
+      // States which cannot reach a final state are never explored.
+      if (static_cast<size_t>(arc.nextstate) >= distance_.size()) continue;
+      const auto &distance = distance_[arc.nextstate];
+      if (distance == ArcWeight::Zero()) continue;
+      const auto prefix_weight = Times(entry.prefix_weight, arc.weight);
+      Push(Times(prefix_weight, distance), prefix_weight, arc.nextstate,
+           Extend(entry.prefix, arc.olabel));
+    }
+  }
+  done_ = true;
+}
+
+}  // namespace fst
+
+#endif  // PYNINI_SHORTESTSTRINGS_H_
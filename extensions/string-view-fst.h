@@ -17,7 +17,10 @@
 #ifndef PYNINI_STRING_VIEW_FST_H_
 #define PYNINI_STRING_VIEW_FST_H_
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <utility>
 
 #include <fst/types.h>
@@ -28,11 +31,10 @@
 
 namespace fst {
 
-// A viewer returns a single arc given the byte offset. If the byte offset
-// is "invalid" (i.e., a non-initial byte in a multibyte code point) then the
-// arc labels returned are negative and the destination state ID is simply
-// the next byte. Otherwise, the arc label returned is non-negative and the
-// destination state ID is the next "valid" state.
+// A viewer returns a single arc given the byte offset of the start of a
+// token, whose destination state ID is the offset of the next token, and
+// determines whether a byte offset starts a token at all (i.e., is not a
+// non-initial byte in a multibyte code point).
 template <class Arc>
 class ByteViewer {
  public:
@@ -45,6 +47,10 @@ class ByteViewer {
     return Arc(ch, ch, byte_offset + 1);
   }
 
+  static constexpr bool IsTokenStart(absl::string_view, StateId) {
+    return true;
+  }
+
   static constexpr TokenType TokenType() { return TokenType::BYTE; }
 };
 
@@ -69,6 +75,10 @@ class UTF8Viewer {
                byte_offset + label_size.second);
   }
 
+  static bool IsTokenStart(absl::string_view view, StateId byte_offset) {
+    return (view[byte_offset] & 0xc0) != 0x80;
+  }
+
   static constexpr TokenType TokenType() { return TokenType::UTF8; }
 
  private:
@@ -106,8 +116,8 @@ class ArcIterator<StringViewFst<Arc, Viewer>> : public ArcIteratorBase<Arc> {
   using StateId = typename Arc::StateId;
 
   explicit ArcIterator(const StringViewFst<Arc, Viewer> &fst, StateId state) :
-      arc_(viewer_(fst.GetImpl()->view(), state)),
-      done_(!fst.NumArcs(state) || arc_.ilabel < 0) {}
+      done_(!fst.NumArcs(state)),
+      arc_(done_ ? Arc() : viewer_(fst.GetImpl()->view(), state)) {}
 
   bool Done() const final { return done_; }
 
@@ -127,8 +137,8 @@ class ArcIterator<StringViewFst<Arc, Viewer>> : public ArcIteratorBase<Arc> {
 
  private:
   Viewer viewer_;  // Stateless.
-  const Arc arc_;
   bool done_;
+  const Arc arc_;
 };
 
 namespace internal {
@@ -159,7 +169,9 @@ class StringViewFstImpl : public FstImpl<A> {
 
   StateId NumStates() const { return view_.size() + 1; }
 
-  size_t NumArcs(StateId s) const { return IsFinal(s) ? 0 : 1; }
+  size_t NumArcs(StateId s) const {
+    return IsFinal(s) || !Viewer::IsTokenStart(view_, s) ? 0 : 1;
+  }
 
   constexpr size_t NumInputEpsilons(StateId) const { return 0; }
 
@@ -170,6 +182,26 @@ class StringViewFstImpl : public FstImpl<A> {
     data->nstates = NumStates();
   }
 
+  // Decodes the arc leaving the state into a slot, and points the arc
+  // iterator data at it, so that generic arc iteration neither allocates nor
+  // makes virtual calls. The iterator holds the slot through its reference
+  // count until it is destroyed, after which the slot is reused; there are
+  // thus only as many slots as iterators that were live at once.
+  void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const {
+    data->base = nullptr;
+    data->narcs = NumArcs(s);
+    if (data->narcs == 0) {
+      data->arcs = nullptr;
+      data->ref_count = nullptr;
+      return;
+    }
+    auto *slot = GetFreeSlot();
+    slot->arc = Viewer()(view_, s);
+    slot->ref_count = 1;
+    data->arcs = &slot->arc;
+    data->ref_count = &slot->ref_count;
+  }
+
   // Returns the string view itself; used by pseudo-friend classes.
   absl::string_view view() const { return view_; }
 
@@ -180,21 +212,49 @@ class StringViewFstImpl : public FstImpl<A> {
       kAcyclic | kInitialAcyclic | kTopSorted |
       (Viewer::TokenType() == TokenType::BYTE ? kString : 0);
 
+  struct ArcSlot {
+    Arc arc;
+    int ref_count = 0;
+  };
+
+  // Number of slots examined for one no longer held before adding another,
+  // which bounds the work done when many iterators are live, as in a
+  // depth-first visit.
+  static constexpr size_t kMaxSlotProbes = 4;
+
   bool IsFinal(StateId s) const { return s == view_.size(); }
 
+  ArcSlot *GetFreeSlot() const {
+    const auto nprobes = std::min(slots_.size(), kMaxSlotProbes);
+    for (size_t i = 0; i < nprobes; ++i) {
+      next_slot_ = (next_slot_ + 1) % slots_.size();
+      auto &slot = slots_[next_slot_];
+      if (slot.ref_count == 0) return &slot;
+    }
+    // Unlike a vector, a deque does not move its elements as it grows.
+    next_slot_ = slots_.size();
+    return &slots_.emplace_back();
+  }
+
   absl::string_view view_;
+  mutable std::deque<ArcSlot> slots_;
+  mutable size_t next_slot_ = 0;
 };
 
 template <class A, class Viewer>
 constexpr uint64_t StringViewFstImpl<A, Viewer>::kStaticProperties;
 
+template <class A, class Viewer>
+constexpr size_t StringViewFstImpl<A, Viewer>::kMaxSlotProbes;
+
 }  // namespace internal
 
 // A stringview left-to-right FSA that creates an on-the-fly acceptor for a
-// byte buffer passed as a string_view. The FSA does not allocate, own, copy
-// or store the document that it processes. The FSA is not an ExpandedFst, as
-// that may require a pass over the entire string to count the number of
-// codepoints.
+// byte buffer passed as a string_view. The FSA does not own, copy or store the
+// document that it processes. Arcs are decoded on the fly, as each state is
+// visited, and generic arc iteration (e.g., during composition) recycles the
+// arcs it decodes, so its memory use does not grow with the length of the
+// document.
 //
 // The state number is the byte offset into the string, and this means that
 // the states are not guaranteed to be fully connected when multibyte sequences
@@ -202,7 +262,7 @@ constexpr uint64_t StringViewFstImpl<A, Viewer>::kStaticProperties;
 // unreachable states with no arcs.
 //
 // The string viewed is expected not to mutate during the lifetime, but the
-// StringViewFst is essentially stateless except for the arc currently being
+// StringViewFst is essentially stateless except for the arcs currently being
 // viewed.
 //
 // UTF8View provides a UTF-32 codepoint per arc, and ByteView provides a byte
@@ -224,9 +284,12 @@ class StringViewFst
   explicit StringViewFst(absl::string_view view)
       : ImplToExpandedFst<Impl>(std::make_shared<Impl>(view)) {}
 
+  // The implementation recycles arc slots without locking, so thread-safe
+  // copies get their own; others share it.
   StringViewFst(const StringViewFst<Arc, Viewer> &fst, bool safe = false)
-      : ImplToExpandedFst<Impl>(std::make_shared<Impl>(
-            fst.GetImpl()->view())) {}
+      : ImplToExpandedFst<Impl>(
+            safe ? std::make_shared<Impl>(fst.GetImpl()->view())
+                 : fst.GetSharedImpl()) {}
 
   // Gets a copy of this StringViewFst. See Fst<>::Copy() for further doc.
   StringViewFst *Copy(bool safe = false) const override {
@@ -238,12 +301,12 @@ class StringViewFst
   }
 
   void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const override {
-    data->base =
-        std::make_unique<ArcIterator<StringViewFst<Arc, Viewer>>>(*this, s);
+    GetImpl()->InitArcIterator(s, data);
   }
 
  private:
   using ImplToFst<Impl, ExpandedFst<Arc>>::GetImpl;
+  using ImplToFst<Impl, ExpandedFst<Arc>>::GetSharedImpl;
 
   StringViewFst &operator=(const StringViewFst &) = delete;
 };
@@ -0,0 +1,119 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks comparing composition against a StringViewFst over the input with
+// composition against the input compiled into a VectorFst, as alternative
+// first steps of the rewrite pipeline.
+
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <fst/arc.h>
+#include <fst/vector-fst.h>
+#include "benchmark_util.h"
+#include "rewrite.h"
+#include "string-view-fst.h"
+#include "stringcompile.h"
+
+namespace fst {
+namespace {
+
+using ::fst::benchmark_util::NumberGrammar;
+using ::fst::benchmark_util::RandomText;
+
+// The first argument is the number of words in the input, and the second the
+// largest number rewritten by the rule, which determines its size.
+std::string Input(int num_words) { return " " + RandomText(num_words) + " "; }
+
+void BM_ComposeCompiled(benchmark::State &state) {
+  const auto rule = NumberGrammar<StdArc>(state.range(1));
+  const auto input = Input(state.range(0));
+  for (auto _ : state) {
+    VectorFst<StdArc> compiled;
+    StringCompile(input, &compiled);
+    VectorFst<StdArc> lattice;
+    benchmark::DoNotOptimize(RewriteLattice(compiled, rule, &lattice));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_ComposeCompiled)->ArgsProduct({{1, 100, 10000}, {99, 9999}});
+
+void BM_ComposeStringView(benchmark::State &state) {
+  const auto rule = NumberGrammar<StdArc>(state.range(1));
+  const auto input = Input(state.range(0));
+  for (auto _ : state) {
+    VectorFst<StdArc> lattice;
+    benchmark::DoNotOptimize(
+        RewriteLattice(input, rule, &lattice, TokenType::BYTE));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_ComposeStringView)->ArgsProduct({{1, 100, 10000}, {99, 9999}});
+
+// The same, in UTF-8 mode; the numbers grammar only contains ASCII, so this
+// measures the cost of decoding.
+void BM_ComposeCompiledUtf8(benchmark::State &state) {
+  const auto rule = NumberGrammar<StdArc>(state.range(1));
+  const auto input = Input(state.range(0));
+  for (auto _ : state) {
+    VectorFst<StdArc> compiled;
+    StringCompile(input, &compiled, TokenType::UTF8);
+    VectorFst<StdArc> lattice;
+    benchmark::DoNotOptimize(RewriteLattice(compiled, rule, &lattice));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_ComposeCompiledUtf8)->ArgsProduct({{1, 100, 10000}, {9999}});
+
+void BM_ComposeStringViewUtf8(benchmark::State &state) {
+  const auto rule = NumberGrammar<StdArc>(state.range(1));
+  const auto input = Input(state.range(0));
+  for (auto _ : state) {
+    VectorFst<StdArc> lattice;
+    benchmark::DoNotOptimize(
+        RewriteLattice(input, rule, &lattice, TokenType::UTF8));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_ComposeStringViewUtf8)->ArgsProduct({{1, 100, 10000}, {9999}});
+
+// Visits every arc through the generic Fst interface, as composition does.
+void VisitArcs(const Fst<StdArc> &fst, benchmark::State &state) {
+  for (auto _ : state) {
+    for (StateIterator<Fst<StdArc>> siter(fst); !siter.Done(); siter.Next()) {
+      for (ArcIterator<Fst<StdArc>> aiter(fst, siter.Value()); !aiter.Done();
+           aiter.Next()) {
+        benchmark::DoNotOptimize(aiter.Value().ilabel);
+      }
+    }
+  }
+}
+
+void BM_ArcIterationCompiled(benchmark::State &state) {
+  VectorFst<StdArc> compiled;
+  StringCompile(RandomText(state.range(0)), &compiled);
+  VisitArcs(compiled, state);
+}
+BENCHMARK(BM_ArcIterationCompiled)->Arg(10000);
+
+void BM_ArcIterationStringView(benchmark::State &state) {
+  const auto input = RandomText(state.range(0));
+  const StdByteStringViewFst view(input);
+  VisitArcs(view, state);
+}
+BENCHMARK(BM_ArcIterationStringView)->Arg(10000);
+
+}  // namespace
+}  // namespace fst
@@ -19,10 +19,25 @@
 #include <cstdint>
 
 #include <cstdlib>
+#include <mutex>
 
 namespace fst {
 namespace internal {
 
+void GeneratedSymbolIndex::Clear() {
+  for (auto &shard : shards_) {
+    for (auto &bucket : shard.buckets) {
+      const auto *node = bucket.load(std::memory_order_relaxed);
+      bucket.store(nullptr, std::memory_order_relaxed);
+      while (node != nullptr) {
+        const auto *next = node->next;
+        delete node;
+        node = next;
+      }
+    }
+  }
+}
+
 StringCompiler *StringCompiler::Get() {
   static auto *kInstance = new StringCompiler();
   return kInstance;
@@ -42,11 +57,19 @@ int64_t StringCompiler::StringSymbolToLabel(const std::string &token) {
   // Special handling for BOS and EOS markers in CDRewrite.
   if (token == kBosString) return kBosIndex;
   if (token == kEosString) return kEosIndex;
-  // NB: If one were to make this thread-compatible, one would merely need to
-  // grab a lock here and release it at the end of the function.
-  // General symbol lookup.
-  const auto label = generated_.AddSymbol(token, max_generated_);
-  if (label == max_generated_) ++max_generated_;
+  // General symbol lookup; symbols generated previously are found without
+  // locking.
+  const auto label = index_.Find(token);
+  if (label != kNoLabel) return label;
+  return index_.FindOrInsert(token, [this](absl::string_view symbol) {
+    return AddGeneratedSymbol(symbol);
+  });
+}
+
+int64_t StringCompiler::AddGeneratedSymbol(absl::string_view token) {
+  std::lock_guard<std::mutex> lock(generated_mutex_);
+  const auto label = max_generated_++;
+  generated_.AddSymbol(token, label);
   return label;
 }
 
@@ -63,13 +86,22 @@ int64_t StringCompiler::NumericalOrStringSymbolToLabel(
 // There are roughly 130,000 such code points in this area.
 StringCompiler::StringCompiler()
     : generated_(kGeneratedSymbolsName), max_generated_(0xF0000) {
-  generated_.AddSymbol(kEpsilonString);
+  index_.LockAll();
+  ResetLocked();
+  index_.UnlockAll();
 }
 
 void StringCompiler::Reset() {
-  // This is duplicated from the above constructor.
+  index_.LockAll();
+  ResetLocked();
+  index_.UnlockAll();
+}
+
+void StringCompiler::ResetLocked() {
+  std::lock_guard<std::mutex> lock(generated_mutex_);
+  index_.Clear();
   generated_ = SymbolTable(kGeneratedSymbolsName);
-  generated_.AddSymbol(kEpsilonString);
+  index_.InsertLocked(kEpsilonString, generated_.AddSymbol(kEpsilonString));
   max_generated_ = 0xF0000;
 }
 
@@ -79,7 +111,33 @@ bool StringCompiler::MergeIntoGeneratedSymbols(
     LOG(WARNING) << "Must provide a non-null remap";
     return false;
   }
+  std::vector<std::pair<int64_t, int64_t>> pairs;
+  const bool success = MergeIntoGeneratedSymbols(symtab, &pairs);
+  // As with emplace, the first remapping of a label is kept.
+  remap->insert(pairs.begin(), pairs.end());
+  return success;
+}
+
+bool StringCompiler::MergeIntoGeneratedSymbols(const SymbolTable &symtab,
+                                               GeneratedSymbolRemap *remap) {
+  if (remap == nullptr) {
+    LOG(WARNING) << "Must provide a non-null remap";
+    return false;
+  }
+  std::vector<std::pair<int64_t, int64_t>> pairs;
+  const bool success = MergeIntoGeneratedSymbols(symtab, &pairs);
+  remap->Reset(pairs);
+  return success;
+}
+
+bool StringCompiler::MergeIntoGeneratedSymbols(
+    const SymbolTable &symtab,
+    std::vector<std::pair<int64_t, int64_t>> *remap) {
   bool success = true;
+  // Insertions are blocked so the index stays in sync with the symbol table;
+  // lookups of existing symbols may proceed.
+  index_.LockAll();
+  std::unique_lock<std::mutex> lock(generated_mutex_);
   for (const auto &item : symtab) {
     const int64_t label = item.Label();
     const std::string symbol = item.Symbol();
@@ -100,6 +158,7 @@ bool StringCompiler::MergeIntoGeneratedSymbols(
     if (slx == kNoSymbol && lsx.empty()) {
       // Case 1: Both new
       generated_.AddSymbol(symbol, label);
+      index_.InsertLocked(symbol, label);
       VLOG(2) << "Loaded symbol " << symbol << " with label " << label;
       // On success, keeps track of the maximum + 1 for the next available
       // label.
@@ -109,14 +168,15 @@ bool StringCompiler::MergeIntoGeneratedSymbols(
       // something else.
       int64_t new_label = max_generated_++;
       generated_.AddSymbol(symbol, new_label);
+      index_.InsertLocked(symbol, new_label);
 
-      remap->emplace(label, new_label);
+      remap->emplace_back(label, new_label);
       VLOG(2) << "Remapping " << symbol << " to new label " << new_label;
     } else if (lsx.empty()) {
       // Case 3: label is new, but symbol is there and therefore mapped to
       // something else.
       const int64_t old_label = slx;
-      remap->emplace(label, old_label);
+      remap->emplace_back(label, old_label);
       VLOG(2) << "Remapping " << symbol << " to old label " << old_label;
     } else {
       // Case 4: Both symbol and label already exist.
@@ -133,11 +193,13 @@ bool StringCompiler::MergeIntoGeneratedSymbols(
         success = false;
       } else {
         // Both are there but assigned to other things.
-        remap->emplace(label, old_label);
+        remap->emplace_back(label, old_label);
         VLOG(2) << "Remapping " << symbol << " to old label " << old_label;
       }
     }
   }
+  lock.unlock();
+  index_.UnlockAll();
   return success;
 }
 
@@ -145,7 +207,7 @@ bool StringCompiler::MergeIntoGeneratedSymbols(
 
 // Convenience methods, to eliminate the need to call Get on the singleton.
 
-const SymbolTable &GeneratedSymbols() {
+SymbolTable GeneratedSymbols() {
   static auto *compiler = internal::StringCompiler::Get();
   return compiler->GeneratedSymbols();
 }
@@ -158,6 +220,12 @@ bool MergeIntoGeneratedSymbols(const SymbolTable &symtab,
   return compiler->MergeIntoGeneratedSymbols(symtab, remap);
 }
 
+bool MergeIntoGeneratedSymbols(const SymbolTable &symtab,
+                               GeneratedSymbolRemap *remap) {
+  static auto *compiler = internal::StringCompiler::Get();
+  return compiler->MergeIntoGeneratedSymbols(symtab, remap);
+}
+
 void ResetGeneratedSymbols() {
   static auto *compiler = internal::StringCompiler::Get();
   compiler->Reset();
@@ -17,21 +17,30 @@
 #ifndef PYNINI_STRINGCOMPILE_H_
 #define PYNINI_STRINGCOMPILE_H_
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <iterator>
 #include <map>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include <fst/types.h>
 #include <fst/icu.h>
+#include <fst/fst.h>
 #include <fst/mutable-fst.h>
 #include <fst/properties.h>
 #include <fst/string.h>
 #include <fst/symbol-table.h>
 
 #include <fst/compat.h>
+#include "compiled-string-fst.h"
+#include "parallel.h"
 
 // This module contains a singleton class which can compile strings into string
 // FSTs, keeping track of so-called generated labels.
@@ -67,8 +76,206 @@ constexpr int64_t kEosIndex = 0xF8FF;
 constexpr char kBosString[] = "BOS";
 constexpr char kEosString[] = "EOS";
 
+// A relabeling of generated symbols, such as is produced by merging a table
+// of them into the generated symbols. Rather than a tree, it is usually a
+// dense array spanning the remapped labels, which are normally all in the
+// private-use range, so that each arc label is mapped with a range check and
+// an index. If the labels are too sparse for that, as when arbitrary pairs are
+// given, it is instead a sorted array of pairs, searched only for labels in
+// the span. Labels outside the span, or inside it but not remapped, map to
+// themselves.
+class GeneratedSymbolRemap {
+ public:
+  GeneratedSymbolRemap() = default;
+
+  explicit GeneratedSymbolRemap(
+      const std::vector<std::pair<int64_t, int64_t>> &pairs) {
+    Reset(pairs);
+  }
+
+  // Replaces the remapping; if a label occurs several times, the first
+  // occurrence is used.
+  void Reset(const std::vector<std::pair<int64_t, int64_t>> &pairs) {
+    labels_.clear();
+    sparse_.clear();
+    first_ = 0;
+    span_ = 0;
+    if (pairs.empty()) return;
+    auto first = pairs.front().first;
+    auto last = first;
+    for (const auto &[from, to] : pairs) {
+      first = std::min(first, from);
+      last = std::max(last, from);
+    }
+    first_ = first;
+    span_ = static_cast<uint64_t>(last) - static_cast<uint64_t>(first) + 1;
+    if (span_ / kMaxSpanPerPair > pairs.size()) {
+      sparse_ = pairs;
+      std::stable_sort(sparse_.begin(), sparse_.end(),
+                       [](const auto &lhs, const auto &rhs) {
+                         return lhs.first < rhs.first;
+                       });
+      sparse_.erase(std::unique(sparse_.begin(), sparse_.end(),
+                                [](const auto &lhs, const auto &rhs) {
+                                  return lhs.first == rhs.first;
+                                }),
+                    sparse_.end());
+      return;
+    }
+    labels_.resize(span_, kNoLabel);
+    for (const auto &[from, to] : pairs) {
+      auto &label = labels_[from - first_];
+      if (label == kNoLabel) label = to;
+    }
+  }
+
+  bool Empty() const { return span_ == 0; }
+
+  // Whether the label is in the span of the remapping; labels outside it
+  // are never remapped.
+  bool InSpan(int64_t label) const {
+    return static_cast<uint64_t>(label - first_) < span_;
+  }
+
+  int64_t operator()(int64_t label) const {
+    if (!InSpan(label)) return label;
+    if (labels_.empty()) {
+      const auto it = std::lower_bound(
+          sparse_.begin(), sparse_.end(), label,
+          [](const auto &pair, int64_t label) { return pair.first < label; });
+      return it != sparse_.end() && it->first == label ? it->second : label;
+    }
+    const auto mapped = labels_[label - first_];
+    return mapped == kNoLabel ? label : mapped;
+  }
+
+ private:
+  // The dense array is used only if it has at most this many entries for each
+  // pair.
+  static constexpr uint64_t kMaxSpanPerPair = 16;
+
+  int64_t first_ = 0;
+  uint64_t span_ = 0;
+  // The new label for each label in the span, or kNoLabel if it is unchanged;
+  // empty if the sparse representation is used.
+  std::vector<int64_t> labels_;
+  // Otherwise, the pairs, sorted by the label remapped, with one per label.
+  std::vector<std::pair<int64_t, int64_t>> sparse_;
+};
+
 namespace internal {
 
+// Insert-only concurrent index from generated symbol strings to their labels.
+//
+// Each bucket is a singly-linked list of immutable nodes whose head is
+// published with release semantics, so lookups never take a lock: a reader
+// either sees a fully-constructed node or does not see it at all. Insertions
+// lock only the shard which owns the symbol, so threads generating distinct
+// symbols rarely contend. The bucket count is fixed, since there are at most
+// roughly 130,000 generated symbols.
+class GeneratedSymbolIndex {
+ public:
+  GeneratedSymbolIndex() = default;
+  GeneratedSymbolIndex(const GeneratedSymbolIndex &) = delete;
+  GeneratedSymbolIndex &operator=(const GeneratedSymbolIndex &) = delete;
+
+  ~GeneratedSymbolIndex() { Clear(); }
+
+  // Returns the label of the symbol, or kNoLabel if it is not present. This
+  // is safe to call concurrently with all other methods except Clear.
+  int64_t Find(absl::string_view symbol) const {
+    const auto hash = Hash(symbol);
+    return Find(GetShard(hash).buckets[GetBucket(hash)], symbol);
+  }
+
+  // Returns the label of the symbol, inserting it with the label returned by
+  // `new_label(symbol)` if it is not already present. The callback is called
+  // at most once per symbol, with the owning shard locked.
+  template <class NewLabel>
+  int64_t FindOrInsert(absl::string_view symbol, NewLabel new_label) {
+    const auto hash = Hash(symbol);
+    auto &shard = GetShard(hash);
+    auto &bucket = shard.buckets[GetBucket(hash)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto label = Find(bucket, symbol);
+    if (label != kNoLabel) return label;
+    return Push(&bucket, symbol, new_label(symbol));
+  }
+
+  // Blocks insertions (but not lookups) until UnlockAll is called; this is
+  // used to atomically update the index and the generated symbol table.
+  void LockAll() {
+    for (auto &shard : shards_) shard.mutex.lock();
+  }
+
+  void UnlockAll() {
+    for (auto &shard : shards_) shard.mutex.unlock();
+  }
+
+  // Inserts or overwrites a symbol; the caller must hold LockAll.
+  void InsertLocked(absl::string_view symbol, int64_t label) {
+    const auto hash = Hash(symbol);
+    Push(&GetShard(hash).buckets[GetBucket(hash)], symbol, label);
+  }
+
+  // Removes all symbols. This must not be called concurrently with any other
+  // method, since it frees nodes readers may be traversing.
+  void Clear();
+
+ private:
+  struct Node {
+    Node(absl::string_view symbol, int64_t label, const Node *next)
+        : symbol(symbol), label(label), next(next) {}
+
+    const std::string symbol;
+    const int64_t label;
+    const Node *const next;
+  };
+
+  using Bucket = std::atomic<const Node *>;
+
+  static constexpr size_t kNumShards = 16;
+  static constexpr size_t kBucketsPerShard = 1024;
+
+  struct Shard {
+    std::mutex mutex;
+    std::array<Bucket, kBucketsPerShard> buckets = {};
+  };
+
+  static size_t Hash(absl::string_view symbol) {
+    return std::hash<absl::string_view>()(symbol);
+  }
+
+  Shard &GetShard(size_t hash) { return shards_[hash % kNumShards]; }
+
+  const Shard &GetShard(size_t hash) const {
+    return shards_[hash % kNumShards];
+  }
+
+  static size_t GetBucket(size_t hash) {
+    return (hash / kNumShards) % kBucketsPerShard;
+  }
+
+  static int64_t Find(const Bucket &bucket, absl::string_view symbol) {
+    for (const auto *node = bucket.load(std::memory_order_acquire);
+         node != nullptr; node = node->next) {
+      if (node->symbol == symbol) return node->label;
+    }
+    return kNoLabel;
+  }
+
+  // Prepends a node to the bucket; the caller must hold its shard lock. A
+  // later node shadows any earlier node for the same symbol.
+  static int64_t Push(Bucket *bucket, absl::string_view symbol, int64_t label) {
+    bucket->store(
+        new Node(symbol, label, bucket->load(std::memory_order_relaxed)),
+        std::memory_order_release);
+    return label;
+  }
+
+  std::array<Shard, kNumShards> shards_;
+};
+
 // String compiler used by Pynini; used as a singleton.
 class StringCompiler {
  public:
@@ -78,12 +285,19 @@ class StringCompiler {
   // TokenType::SYMBOL, then the user must pass a symbol table used to label the
   // string.
   template <class Label>
-  bool StringToLabels(const std::string &str, std::vector<Label> *labels,
+  bool StringToLabels(absl::string_view str, std::vector<Label> *labels,
                       TokenType token_type = TokenType::BYTE,
                       const SymbolTable *symbols = nullptr) {
     switch (token_type) {
       case TokenType::BYTE:
       case TokenType::UTF8: {
+        const bool byte = token_type == TokenType::BYTE;
+        // Fast path: without brackets or escapes, the whole string is a
+        // single unbracketed span and can be decoded directly.
+        if (!HasSpecialCharacters(str)) {
+          labels->reserve(labels->size() + str.size());
+          return ProcessUnbracketedSpan(str, labels, byte);
+        }
         bool inside_brackets = false;
         std::string chunk;
         for (auto it = str.begin(); it != str.end(); ++it) {
@@ -93,8 +307,7 @@ class StringCompiler {
               LOG(ERROR) << "StringToLabels: Unmatched [";
               return false;
             }
-            if (!ProcessUnbracketedSpan(chunk, labels,
-                                        token_type == TokenType::BYTE)) {
+            if (!ProcessUnbracketedSpan(chunk, labels, byte)) {
               return false;
             }
             chunk.clear();
@@ -143,8 +356,7 @@ class StringCompiler {
           LOG(ERROR) << "StringToLabels: Unmatched [";
           return false;
         }
-        return ProcessUnbracketedSpan(chunk, labels,
-                                      token_type == TokenType::BYTE);
+        return ProcessUnbracketedSpan(chunk, labels, byte);
       }
       case TokenType::SYMBOL: {
         // The empty string is valid.
@@ -185,8 +397,30 @@ class StringCompiler {
     return true;
   }
 
-  // Returns a symbol table populated with the generated symbols.
-  const SymbolTable &GeneratedSymbols() const { return generated_; }
+  // Same, but produces a CompiledStringFst, which stores the string's arcs in
+  // a single array rather than allocating each state separately.
+  template <class Arc>
+  bool Compile(const std::string &str, CompiledStringFst<Arc> *fst,
+               TokenType token_type = TokenType::BYTE,
+               const SymbolTable *symbols = nullptr,
+               typename Arc::Weight weight = Arc::Weight::One()) {
+    std::vector<typename Arc::Label> labels;
+    if (!StringToLabels(str, &labels, token_type, symbols)) {
+      LOG(ERROR) << "Failed to compile string `" << str << "`"
+                 << ", with token_type: " << token_type;
+      return false;
+    }
+    fst->Reset(labels, std::move(weight));
+    return true;
+  }
+
+  // Returns a copy of the symbol table populated with the generated symbols,
+  // taken while no symbol is being generated. Copies share their
+  // representation until either is modified, so this is cheap.
+  SymbolTable GeneratedSymbols() {
+    std::lock_guard<std::mutex> lock(generated_mutex_);
+    return generated_;
+  }
 
   // Merges an existing `SymbolTable` of generated symbols (potentially from
   // another thread or from a file read on disk) and merges its generated
@@ -195,7 +429,13 @@ class StringCompiler {
   // generated SymbolTable will be populated during this run.
   bool MergeIntoGeneratedSymbols(const SymbolTable &symtab,
                                  std::map<int64_t, int64_t> *remap);
-  // Resets `StringCompiler` to its state at construction.
+
+  // Same, but populates a dense remapping, which is much faster to apply.
+  bool MergeIntoGeneratedSymbols(const SymbolTable &symtab,
+                                 GeneratedSymbolRemap *remap);
+
+  // Resets `StringCompiler` to its state at construction. This must not be
+  // called concurrently with string compilation.
   void Reset();
 
  private:
@@ -205,6 +445,12 @@ class StringCompiler {
   StringCompiler(const StringCompiler &) = delete;
   StringCompiler &operator=(const StringCompiler &) = delete;
 
+  // Does the work of MergeIntoGeneratedSymbols, appending (label, new label)
+  // pairs to the remapping.
+  bool MergeIntoGeneratedSymbols(
+      const SymbolTable &symtab,
+      std::vector<std::pair<int64_t, int64_t>> *remap);
+
   int64_t NumericalSymbolToLabel(const std::string &token) const;
   int64_t StringSymbolToLabel(const std::string &token);
   int64_t NumericalOrStringSymbolToLabel(const std::string &token);
@@ -231,9 +477,18 @@ class StringCompiler {
     return true;
   }
 
+  // Returns true if the string contains a bracket or a backslash. Each scan
+  // uses memchr, which is vectorized by the C library, rather than testing
+  // every character against all three.
+  static bool HasSpecialCharacters(absl::string_view str) {
+    return std::memchr(str.data(), '[', str.size()) != nullptr ||
+           std::memchr(str.data(), ']', str.size()) != nullptr ||
+           std::memchr(str.data(), '\\', str.size()) != nullptr;
+  }
+
   // Processes a BYTE or a UTF8 span outside brackets.
   template <class Label>
-  bool ProcessUnbracketedSpan(const std::string &span,
+  bool ProcessUnbracketedSpan(absl::string_view span,
                               std::vector<Label> *labels, bool byte) {
     return byte ? ByteStringToLabels(span, labels)
                 : UTF8StringToLabels(span, labels);
@@ -263,6 +518,19 @@ class StringCompiler {
     fst->SetProperties(props, props);
   }
 
+  // Adds a new generated symbol to `generated_`; the caller must hold the
+  // relevant index lock, so the symbol is known not to be present.
+  int64_t AddGeneratedSymbol(absl::string_view token);
+
+  // Resets the generated symbols; the caller must hold all index locks.
+  void ResetLocked();
+
+  // Callers may compile strings without holding the Python interpreter lock,
+  // so generated symbols are looked up through a concurrent index; the mutex
+  // only guards updates to `generated_` and `max_generated_`, which mirror
+  // the index. Index locks are always acquired before the mutex.
+  GeneratedSymbolIndex index_;
+  std::mutex generated_mutex_;
   SymbolTable generated_;
   // The highest-numbered generated symbol currently present.
   int64_t max_generated_;
@@ -272,22 +540,83 @@ class StringCompiler {
 
 // Convenience methods, to eliminate the need to call Get on the singleton.
 
-const SymbolTable &GeneratedSymbols();
+SymbolTable GeneratedSymbols();
 
 namespace thrax_internal {
 
 bool MergeIntoGeneratedSymbols(const SymbolTable &symtab,
                                std::map<int64_t, int64_t> *remap);
 
+bool MergeIntoGeneratedSymbols(const SymbolTable &symtab,
+                               GeneratedSymbolRemap *remap);
+
 void ResetGeneratedSymbols();
 
+// Applies a remapping of generated symbols to the labels of an FST. The FST is
+// scanned first, and only modified if it has a label to remap, so that FSTs
+// with no generated labels are neither copied, if their implementations are
+// shared, nor have their properties recomputed. Returns whether it was
+// modified.
+template <class Arc>
+bool RelabelGeneratedSymbols(const GeneratedSymbolRemap &remap,
+                             MutableFst<Arc> *fst) {
+  if (remap.Empty()) return false;
+  const auto remapped = [&remap](typename Arc::Label label) {
+    return remap.InSpan(label) && remap(label) != label;
+  };
+  bool found = false;
+  for (StateIterator<Fst<Arc>> siter(*fst); !found && !siter.Done();
+       siter.Next()) {
+    for (ArcIterator<Fst<Arc>> aiter(*fst, siter.Value()); !aiter.Done();
+         aiter.Next()) {
+      const auto &arc = aiter.Value();
+      if (remapped(arc.ilabel) || remapped(arc.olabel)) {
+        found = true;
+        break;
+      }
+    }
+  }
+  if (!found) return false;
+  for (StateIterator<MutableFst<Arc>> siter(*fst); !siter.Done();
+       siter.Next()) {
+    for (MutableArcIterator<MutableFst<Arc>> aiter(fst, siter.Value());
+         !aiter.Done(); aiter.Next()) {
+      auto arc = aiter.Value();
+      if (!remapped(arc.ilabel) && !remapped(arc.olabel)) continue;
+      arc.ilabel = remap(arc.ilabel);
+      arc.olabel = remap(arc.olabel);
+      aiter.SetValue(arc);
+    }
+  }
+  return true;
+}
+
+// Same, but relabels many FSTs (e.g., all those loaded from a set of FARs),
+// distributed across `num_threads` threads, or the hardware concurrency if
+// that is not positive. The FSTs must be distinct, and must not share their
+// implementations with FSTs used elsewhere during relabeling. Returns the
+// number of FSTs modified.
+template <class Arc>
+size_t RelabelGeneratedSymbols(const GeneratedSymbolRemap &remap,
+                               const std::vector<MutableFst<Arc> *> &fsts,
+                               int num_threads = 0) {
+  if (remap.Empty()) return 0;
+  std::atomic<size_t> modified(0);
+  internal::ParallelFor(fsts.size(), num_threads,
+                        [&](size_t /*worker*/, size_t i) {
+                          if (RelabelGeneratedSymbols(remap, fsts[i])) {
+                            ++modified;
+                          }
+                        });
+  return modified;
+}
+
 }  // namespace thrax_internal
 
 template <class Label>
-bool StringToLabels(const std::string &str,
-                                         std::vector<Label> *labels,
-                                         TokenType token_type = TokenType::BYTE,
-                                         const SymbolTable *symbols = nullptr) {
+bool StringToLabels(absl::string_view str, std::vector<Label> *labels,
+                    TokenType token_type = TokenType::BYTE,
+                    const SymbolTable *symbols = nullptr) {
   static auto *compiler = internal::StringCompiler::Get();
   return compiler->StringToLabels(str, labels, token_type, symbols);
 }
@@ -302,6 +631,16 @@ bool StringCompile(
   return compiler->Compile(str, fst, token_type, symbols, weight);
 }
 
+template <class Arc>
+bool StringCompile(
+    const std::string &str, CompiledStringFst<Arc> *fst,
+    TokenType token_type = TokenType::BYTE,
+    const SymbolTable *symbols = nullptr,
+    typename Arc::Weight weight = Arc::Weight::One()) {
+  static auto *compiler = internal::StringCompiler::Get();
+  return compiler->Compile(str, fst, token_type, symbols, weight);
+}
+
 }  // namespace fst
 
 #endif  // PYNINI_STRINGCOMPILE_H_
@@ -0,0 +1,138 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks of string tokenization and compilation.
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <fst/arc.h>
+#include <fst/vector-fst.h>
+#include "benchmark_util.h"
+#include "compiled-string-fst.h"
+#include "stringcompile.h"
+
+namespace fst {
+namespace {
+
+using ::fst::benchmark_util::RandomText;
+
+// The argument is the number of words in the input.
+void BM_StringToLabelsByte(benchmark::State &state) {
+  auto *compiler = internal::StringCompiler::Get();
+  const auto input = RandomText(state.range(0));
+  std::vector<int64_t> labels;
+  for (auto _ : state) {
+    labels.clear();
+    benchmark::DoNotOptimize(
+        compiler->StringToLabels(input, &labels, TokenType::BYTE));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_StringToLabelsByte)->Arg(10)->Arg(10000);
+
+// The input is mostly two-byte Cyrillic code points.
+void BM_StringToLabelsUtf8(benchmark::State &state) {
+  auto *compiler = internal::StringCompiler::Get();
+  std::string input;
+  for (const char c : RandomText(state.range(0))) {
+    input += c == ' ' ? std::string(" ")
+                      : std::string{'\xd0', static_cast<char>(0x90 + c % 32)};
+  }
+  std::vector<int64_t> labels;
+  for (auto _ : state) {
+    labels.clear();
+    benchmark::DoNotOptimize(
+        compiler->StringToLabels(input, &labels, TokenType::UTF8));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_StringToLabelsUtf8)->Arg(10)->Arg(10000);
+
+// Every word is a bracketed generated symbol.
+void BM_StringToLabelsGeneratedSymbols(benchmark::State &state) {
+  auto *compiler = internal::StringCompiler::Get();
+  std::string bracketed = "[";
+  for (const char c : RandomText(state.range(0))) {
+    bracketed += c == ' ' ? std::string("][") : std::string(1, c);
+  }
+  bracketed += "]";
+  std::vector<int64_t> labels;
+  for (auto _ : state) {
+    labels.clear();
+    benchmark::DoNotOptimize(
+        compiler->StringToLabels(bracketed, &labels, TokenType::BYTE));
+  }
+  state.SetBytesProcessed(state.iterations() * bracketed.size());
+}
+BENCHMARK(BM_StringToLabelsGeneratedSymbols)->Arg(10)->Arg(10000);
+
+void BM_StringCompile(benchmark::State &state) {
+  const auto input = RandomText(state.range(0));
+  for (auto _ : state) {
+    VectorFst<StdArc> fst;
+    benchmark::DoNotOptimize(StringCompile(input, &fst));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_StringCompile)->Arg(10)->Arg(10000);
+
+void BM_StringCompileCompiledStringFst(benchmark::State &state) {
+  const auto input = RandomText(state.range(0));
+  for (auto _ : state) {
+    CompiledStringFst<StdArc> fst;
+    benchmark::DoNotOptimize(StringCompile(input, &fst));
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_StringCompileCompiledStringFst)->Arg(10)->Arg(10000);
+
+// The arguments are the number of FSTs, each compiled from ten words, of
+// which one in ten has generated symbols to remap, and the number of threads,
+// or zero for the hardware concurrency.
+void BM_RelabelGeneratedSymbols(benchmark::State &state) {
+  constexpr int64_t kFirstGenerated = 0xF0000;
+  std::vector<std::pair<int64_t, int64_t>> pairs;
+  // Swaps pairs of generated labels, so that each iteration undoes the last.
+  for (int64_t i = 0; i < 256; ++i) {
+    pairs.emplace_back(kFirstGenerated + i, kFirstGenerated + (i ^ 1));
+  }
+  const GeneratedSymbolRemap remap(pairs);
+  std::vector<VectorFst<StdArc>> fsts(state.range(0));
+  for (size_t i = 0; i < fsts.size(); ++i) {
+    StringCompile(RandomText(10), &fsts[i]);
+    if (i % 10 == 0) {
+      fsts[i].AddArc(fsts[i].Start(),
+                     StdArc(kFirstGenerated, kFirstGenerated,
+                            fsts[i].Start()));
+    }
+  }
+  std::vector<MutableFst<StdArc> *> ptrs;
+  for (auto &fst : fsts) ptrs.push_back(&fst);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(thrax_internal::RelabelGeneratedSymbols(
+        remap, ptrs, state.range(1)));
+  }
+}
+// Wall time is reported, since the work is done on other threads.
+BENCHMARK(BM_RelabelGeneratedSymbols)
+    ->ArgsProduct({{100, 10000}, {1, 4, 0}})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace fst
@@ -0,0 +1,189 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Tests of generated-symbol remapping, against the std::map remapping it
+// replaces.
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <fst/arc.h>
+#include <fst/equal.h>
+#include <fst/symbol-table.h>
+#include <fst/vector-fst.h>
+#include "stringcompile.h"
+
+namespace fst {
+namespace {
+
+constexpr int64_t kFirstGenerated = 0xF0000;
+
+// Maps labels as MergeIntoGeneratedSymbols' std::map remapping is applied:
+// labels not in the map are unchanged, and the first occurrence of a label
+// wins, as with emplace.
+class MapRemap {
+ public:
+  explicit MapRemap(const std::vector<std::pair<int64_t, int64_t>> &pairs) {
+    for (const auto &[from, to] : pairs) map_.emplace(from, to);
+  }
+
+  explicit MapRemap(std::map<int64_t, int64_t> map) : map_(std::move(map)) {}
+
+  int64_t operator()(int64_t label) const {
+    const auto it = map_.find(label);
+    return it == map_.end() ? label : it->second;
+  }
+
+ private:
+  std::map<int64_t, int64_t> map_;
+};
+
+// Checks that the remaps agree on every label in [first, last].
+void ExpectSameRemap(const GeneratedSymbolRemap &remap, const MapRemap &map,
+                     int64_t first, int64_t last) {
+  for (int64_t label = first; label <= last; ++label) {
+    EXPECT_EQ(remap(label), map(label)) << "label " << label;
+  }
+}
+
+TEST(GeneratedSymbolRemapTest, EmptyRemapIsIdentity) {
+  const GeneratedSymbolRemap remap;
+  EXPECT_TRUE(remap.Empty());
+  EXPECT_FALSE(remap.InSpan(kFirstGenerated));
+  EXPECT_EQ(remap(kFirstGenerated), kFirstGenerated);
+}
+
+TEST(GeneratedSymbolRemapTest, DenseRemapMatchesMap) {
+  std::vector<std::pair<int64_t, int64_t>> pairs;
+  // Remaps every other label in a short, contiguous range.
+  for (int64_t i = 0; i < 64; i += 2) {
+    pairs.emplace_back(kFirstGenerated + i, kFirstGenerated + 1000 + i);
+  }
+  const GeneratedSymbolRemap remap(pairs);
+  EXPECT_FALSE(remap.Empty());
+  EXPECT_TRUE(remap.InSpan(kFirstGenerated + 1));
+  EXPECT_FALSE(remap.InSpan(kFirstGenerated + 63));
+  ExpectSameRemap(remap, MapRemap(pairs), kFirstGenerated - 8,
+                  kFirstGenerated + 72);
+}
+
+TEST(GeneratedSymbolRemapTest, SparseRemapMatchesMap) {
+  // These are far too far apart for a dense array.
+  const std::vector<std::pair<int64_t, int64_t>> pairs = {
+      {kFirstGenerated + 100000, kFirstGenerated + 1},
+      {1, kFirstGenerated + 2},
+      {kFirstGenerated, 2},
+  };
+  const GeneratedSymbolRemap remap(pairs);
+  const MapRemap map(pairs);
+  EXPECT_TRUE(remap.InSpan(kFirstGenerated + 50000));
+  for (const auto &[from, to] : pairs) {
+    ExpectSameRemap(remap, map, from - 8, from + 8);
+  }
+  ExpectSameRemap(remap, map, kFirstGenerated + 49992, kFirstGenerated + 50008);
+  EXPECT_EQ(remap(kFirstGenerated + 200000), kFirstGenerated + 200000);
+}
+
+TEST(GeneratedSymbolRemapTest, FirstOccurrenceWins) {
+  // The first of these is dense, the second sparse.
+  for (const int64_t other : {kFirstGenerated + 1, kFirstGenerated + 100000}) {
+    const std::vector<std::pair<int64_t, int64_t>> pairs = {
+        {kFirstGenerated, 10}, {other, 11}, {kFirstGenerated, 12}, {other, 13}};
+    const GeneratedSymbolRemap remap(pairs);
+    EXPECT_EQ(remap(kFirstGenerated), 10);
+    EXPECT_EQ(remap(other), 11);
+    ExpectSameRemap(remap, MapRemap(pairs), kFirstGenerated - 2,
+                    kFirstGenerated + 2);
+  }
+}
+
+TEST(GeneratedSymbolRemapTest, MergeMatchesMapOverload) {
+  // The incoming table's "bar" takes the label of the generated "foo", and
+  // its "foo" has a label of its own, so both are remapped.
+  SymbolTable symtab;
+  symtab.AddSymbol("<epsilon>", 0);
+  symtab.AddSymbol("bar", kFirstGenerated);
+  symtab.AddSymbol("foo", kFirstGenerated + 5);
+  const auto merge = [&symtab](auto *remap) {
+    thrax_internal::ResetGeneratedSymbols();
+    VectorFst<StdArc> fst;
+    EXPECT_TRUE(StringCompile("[foo]", &fst));
+    return thrax_internal::MergeIntoGeneratedSymbols(symtab, remap);
+  };
+  std::map<int64_t, int64_t> map;
+  ASSERT_TRUE(merge(&map));
+  EXPECT_EQ(map.size(), 2u);
+  GeneratedSymbolRemap remap;
+  ASSERT_TRUE(merge(&remap));
+  ExpectSameRemap(remap, MapRemap(std::move(map)), 0, kFirstGenerated + 16);
+  thrax_internal::ResetGeneratedSymbols();
+}
+
+TEST(RelabelGeneratedSymbolsTest, RelabelsBothSides) {
+  const GeneratedSymbolRemap remap({{kFirstGenerated, kFirstGenerated + 1}});
+  VectorFst<StdArc> fst;
+  fst.AddState();
+  fst.AddState();
+  fst.SetStart(0);
+  fst.SetFinal(1);
+  fst.AddArc(0, StdArc('a', kFirstGenerated, 1));
+  fst.AddArc(0, StdArc(kFirstGenerated, 'b', 1));
+  ASSERT_TRUE(thrax_internal::RelabelGeneratedSymbols(remap, &fst));
+  ArcIterator<VectorFst<StdArc>> aiter(fst, 0);
+  EXPECT_EQ(aiter.Value().ilabel, 'a');
+  EXPECT_EQ(aiter.Value().olabel, kFirstGenerated + 1);
+  aiter.Next();
+  EXPECT_EQ(aiter.Value().ilabel, kFirstGenerated + 1);
+  EXPECT_EQ(aiter.Value().olabel, 'b');
+}
+
+TEST(RelabelGeneratedSymbolsTest, FstWithoutGeneratedLabelsIsUntouched) {
+  const GeneratedSymbolRemap remap({{kFirstGenerated, kFirstGenerated + 1}});
+  VectorFst<StdArc> fst;
+  ASSERT_TRUE(StringCompile("abc", &fst));
+  const VectorFst<StdArc> original(fst);
+  // A copy shares its implementation, which would be copied on mutation.
+  VectorFst<StdArc> shared(fst);
+  const auto props = shared.Properties(kFstProperties, false);
+  EXPECT_FALSE(thrax_internal::RelabelGeneratedSymbols(remap, &shared));
+  EXPECT_EQ(shared.Properties(kFstProperties, false), props);
+  EXPECT_TRUE(Equal(shared, original));
+  // None of several FSTs is modified either.
+  std::vector<MutableFst<StdArc> *> fsts = {&fst, &shared};
+  EXPECT_EQ(thrax_internal::RelabelGeneratedSymbols(remap, fsts, 2), 0);
+  EXPECT_TRUE(Equal(fst, original));
+}
+
+TEST(RelabelGeneratedSymbolsTest, BatchCountsModifiedFsts) {
+  const GeneratedSymbolRemap remap({{kFirstGenerated, kFirstGenerated + 1}});
+  std::vector<VectorFst<StdArc>> fsts(10);
+  std::vector<MutableFst<StdArc> *> ptrs;
+  for (size_t i = 0; i < fsts.size(); ++i) {
+    ASSERT_TRUE(StringCompile("abc", &fsts[i]));
+    if (i % 3 == 0) {
+      fsts[i].AddArc(fsts[i].Start(),
+                     StdArc(kFirstGenerated, kFirstGenerated,
+                            fsts[i].Start()));
+    }
+    ptrs.push_back(&fsts[i]);
+  }
+  EXPECT_EQ(thrax_internal::RelabelGeneratedSymbols(remap, ptrs, 4), 4);
+}
+
+}  // namespace
+}  // namespace fst
@@ -16,14 +16,36 @@
 
 #include "stringfile.h"
 
+#include <fstream>
+#include <ios>
+
 #include "stringutil.h"
 
 namespace fst {
 namespace internal {
 
+StringFile::StringFile(const std::string &source)
+    : pos_(0), linenum_(0), done_(false), source_(source) {
+  std::ifstream istrm(source, std::ios_base::in | std::ios_base::binary);
+  if (istrm) {
+    istrm.seekg(0, istrm.end);
+    const auto size = istrm.tellg();
+    istrm.seekg(0, istrm.beg);
+    if (istrm && size >= 0) {
+      file_.reset(MappedFile::Map(istrm, /*memorymap=*/true, source, size));
+    }
+  }
+  if (file_) {
+    data_ = absl::string_view(static_cast<const char *>(file_->data()),
+                              file_->size());
+  }
+  Next();
+}
+
 void StringFile::Reset() {
-  istrm_.clear();
-  istrm_.seekg(0, istrm_.beg);
+  pos_ = 0;
+  linenum_ = 0;
+  done_ = false;
   Next();
 }
 
@@ -31,11 +53,32 @@ void StringFile::Reset() {
 void StringFile::Next() {
   do {
     ++linenum_;
-    if (!std::getline(istrm_, line_)) return;
-    line_ = StripCommentAndRemoveEscape(line_);
+    if (pos_ >= data_.size()) {
+      line_ = absl::string_view();
+      done_ = true;
+      return;
+    }
+    auto end = data_.find('\n', pos_);
+    if (end == absl::string_view::npos) end = data_.size();
+    line_ = StripCommentAndRemoveEscape(data_.substr(pos_, end - pos_),
+                                        &buffer_);
+    pos_ = end + 1;
   } while (line_.empty());
 }
 
+void ColumnStringFile::Parse() {
+  row_.clear();
+  const auto line = sf_.GetString();
+  if (line.empty()) return;
+  size_t start = 0;
+  for (auto end = line.find('\t'); end != absl::string_view::npos;
+       end = line.find('\t', start)) {
+    row_.push_back(line.substr(start, end - start));
+    start = end + 1;
+  }
+  row_.push_back(line.substr(start));
+}
+
 void ColumnStringFile::Reset() {
   sf_.Reset();
   Parse();
@@ -48,4 +91,3 @@ void ColumnStringFile::Next() {
 
 }  // namespace internal
 }  // namespace fst
-
@@ -17,44 +17,53 @@
 #ifndef PYNINI_STRINGFILE_H_
 #define PYNINI_STRINGFILE_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
-#include <fstream>
 #include <fst/compat.h>
-
+#include <fst/mapped-file.h>
 
 namespace fst {
 namespace internal {
 
 // Basic line-by-line file iterator, with support for line numbers and
-// \# comment stripping.
+// \# comment stripping. The file is memory-mapped (where possible) and lines
+// are returned as views into it, so no allocation is needed per line.
 class StringFile {
  public:
-  // Opens a file input stream using the provided filename.
-  explicit StringFile(const std::string &source)
-      : istrm_(source), linenum_(0), source_(source) {
-    Next();
-  }
+  // Maps the file with the provided filename.
+  explicit StringFile(const std::string &source);
 
   void Reset();
 
   void Next();
 
-  bool Done() const { return !istrm_; }
+  bool Done() const { return done_; }
+
+  // The view is invalidated by the next call to Next or Reset.
+  absl::string_view GetString() const { return line_; }
 
-  const std::string &GetString() const { return line_; }
+  // Whether the current line is a view into the file itself, rather than into
+  // a buffer holding its unescaped copy; if so, it remains valid as long as the
+  // file is open.
+  bool IsMapped() const { return line_.data() != buffer_.data(); }
 
   size_t LineNumber() const { return linenum_; }
 
   const std::string &Filename() const { return source_; }
 
-  bool Error() const { return !istrm_.is_open() || istrm_.bad(); }
+  bool Error() const { return !file_; }
 
  private:
-  std::ifstream istrm_;
-  std::string line_;
+  std::unique_ptr<MappedFile> file_;
+  absl::string_view data_;
+  size_t pos_;
+  absl::string_view line_;
+  // Holds the current line if unescaping was required.
+  std::string buffer_;
   size_t linenum_;
+  bool done_;
   const std::string source_;
 };
 
@@ -71,8 +80,16 @@ class ColumnStringFile {
 
   bool Done() const { return sf_.Done(); }
 
-  // Access to the underlying row vector.
-  const std::vector<std::string> &Row() const { return row_; }
+  // Access to the underlying row vector. The views are invalidated by the next
+  // call to Next or Reset.
+  const std::vector<absl::string_view> &Row() const { return row_; }
+
+  // The current line, with its columns still joined by tab.
+  absl::string_view Line() const { return sf_.GetString(); }
+
+  // Whether the views of the current row remain valid until the file is
+  // closed; see StringFile::IsMapped.
+  bool IsMapped() const { return sf_.IsMapped(); }
 
   size_t LineNumber() const { return sf_.LineNumber(); }
 
@@ -81,10 +98,11 @@ class ColumnStringFile {
   bool Error() const { return sf_.Error(); }
 
  private:
-  void Parse() { row_ = fst::StringSplit(sf_.GetString(), '\t'); }
+  void Parse();
 
   StringFile sf_;
-  std::vector<std::string> row_;
+  // Reused across rows, so that splitting does not allocate.
+  std::vector<absl::string_view> row_;
 };
 
 }  // namespace internal
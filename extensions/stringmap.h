@@ -18,18 +18,28 @@
 #define PYNINI_STRINGMAP_H_
 
 // This file contains functions for compiling FSTs from pairs of strings
-// using a prefix tree.
+// using a prefix tree, or, for sorted input, directly as a minimal DFA.
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <sstream>
 #include <string>
+#include <system_error>
 #include <tuple>
 #include <utility>
 #include <vector>
 
 #include <fstream>
+#include <fst/float-weight.h>
 #include <fst/mutable-fst.h>
 #include <fst/string.h>
 #include <fst/symbol-table.h>
+#include "incremental_dfa.h"
+#include "parallel.h"
 #include "prefix_tree.h"
 #include "stringcompile.h"
 #include "stringfile.h"
@@ -37,8 +47,69 @@
 #include <fst/compat.h>
 
 namespace fst {
+
+// How string maps are compiled; see StringMapCompileWithAcceptorCheck.
+enum class StringMapMode : uint8_t {
+  PREFIX_TREE,
+  FLAT_PREFIX_TREE,
+  MINIMAL_DFA,
+};
+
 namespace internal {
 
+// Reads a weight from a string map column with the weight's operator>>.
+template <class Weight>
+bool StringMapReadWeight(absl::string_view wstring, Weight *weight) {
+  std::istringstream strm{std::string(wstring)};
+  strm >> *weight;
+  return static_cast<bool>(strm);
+}
+
+// Parses a weight from a string map column. In general this reads it from a
+// stream.
+template <class Weight>
+struct StringMapWeightParser {
+  static bool Parse(absl::string_view wstring, Weight *weight) {
+    return StringMapReadWeight(wstring, weight);
+  }
+};
+
+// Tropical and log weights are instead parsed with std::from_chars, which is
+// independent of the locale and needs no allocation. Anything it does not
+// accept in full (e.g., a leading '+' or whitespace), or which does not end in
+// a digit or point (e.g., "Infinity"), is left to the stream, so the accepted
+// syntax is unchanged. Standard libraries which lack floating-point
+// std::from_chars (e.g., older versions of libc++) always use the stream.
+template <class T>
+struct StringMapFloatWeightParser {
+  template <class Weight>
+  static bool Parse(absl::string_view wstring, Weight *weight) {
+#if defined(__cpp_lib_to_chars)
+    if (wstring.empty() ||
+        !(std::isdigit(static_cast<unsigned char>(wstring.back())) ||
+          wstring.back() == '.')) {
+      return StringMapReadWeight(wstring, weight);
+    }
+    T value;
+    const auto *end = wstring.data() + wstring.size();
+    const auto [ptr, ec] = std::from_chars(wstring.data(), end, value);
+    if (ec == std::errc() && ptr == end) {
+      *weight = Weight(value);
+      return true;
+    }
+#endif  // __cpp_lib_to_chars
+    return StringMapReadWeight(wstring, weight);
+  }
+};
+
+template <class T>
+struct StringMapWeightParser<TropicalWeightTpl<T>>
+    : StringMapFloatWeightParser<T> {};
+
+template <class T>
+struct StringMapWeightParser<LogWeightTpl<T>> : StringMapFloatWeightParser<T> {
+};
+
 // Helper class for constructing string maps.
 template <class Arc, class PTree>
 class StringMapCompiler {
@@ -55,38 +126,113 @@ class StringMapCompiler {
         input_symbols_(input_symbols),
         output_symbols_(output_symbols) {}
 
+  // A tokenized line, ready to be inserted into the prefix tree.
+  struct Entry {
+    std::vector<Label> ilabels;
+    std::vector<Label> olabels;
+    Weight weight;
+  };
+
   // One-string version.
-  bool Add(const std::string &iostring) {
+  bool Add(absl::string_view iostring) {
     return Add(iostring, iostring, Weight::One());
   }
 
   // Two-string version.
-  bool Add(const std::string &istring, const std::string &ostring,
+  bool Add(absl::string_view istring, absl::string_view ostring,
            Weight weight = Weight::One()) {
-    std::vector<Label> ilabels;
-    if (!StringToLabels(istring, &ilabels, input_token_type_, input_symbols_))
+    Entry entry;
+    if (!Tokenize(istring, ostring, std::move(weight), &entry)) return false;
+    Insert(&entry);
+    return true;
+  }
+
+  // Three-string version, which also requires us to parse the weight.
+  bool Add(absl::string_view istring, absl::string_view ostring,
+           absl::string_view wstring) {
+    Entry entry;
+    if (!Tokenize(istring, ostring, wstring, &entry)) return false;
+    Insert(&entry);
+    return true;
+  }
+
+  // Tokenizes a line without inserting it, reusing the storage of the entry.
+  // This may be called concurrently for lines which do not contain generated
+  // symbols (see MayGenerateSymbols); since the labels assigned to generated
+  // symbols depend on the order in which they are first seen, the remaining
+  // lines must be tokenized in order.
+  bool Tokenize(absl::string_view istring, absl::string_view ostring,
+                Weight weight, Entry *entry) const {
+    entry->ilabels.clear();
+    if (!StringToLabels(istring, &entry->ilabels, input_token_type_,
+                        input_symbols_)) {
       return false;
-    std::vector<Label> olabels;
-    if (!StringToLabels(ostring, &olabels, output_token_type_, output_symbols_))
+    }
+    entry->olabels.clear();
+    if (!StringToLabels(ostring, &entry->olabels, output_token_type_,
+                        output_symbols_)) {
       return false;
-    ptree_.Add(ilabels, olabels, std::move(weight));
+    }
+    entry->weight = std::move(weight);
     return true;
   }
 
-  // Three-string version, which also requires us to parse the weight.
-  bool Add(const std::string &istring, const std::string &ostring,
-           const std::string &wstring) {
-    std::istringstream strm(wstring);
+  bool Tokenize(absl::string_view istring, absl::string_view ostring,
+                absl::string_view wstring, Entry *entry) const {
     Weight weight;
-    strm >> weight;
-    if (!strm) {
-       LOG(ERROR) << "StringMapCompiler::Add: Bad weight: " << wstring;
-       return false;
+    if (!StringMapWeightParser<Weight>::Parse(wstring, &weight)) {
+      LOG(ERROR) << "StringMapCompiler::Add: Bad weight: " << wstring;
+      return false;
+    }
+    return Tokenize(istring, ostring, std::move(weight), entry);
+  }
+
+  // Tokenizes a line of one, two, or three strings.
+  template <class StringType>
+  bool Tokenize(const std::vector<StringType> &line, Entry *entry) const {
+    switch (line.size()) {
+      case 1:
+        return Tokenize(line[0], line[0], Weight::One(), entry);
+      case 2:
+        return Tokenize(line[0], line[1], Weight::One(), entry);
+      case 3:
+        return Tokenize(line[0], line[1], line[2], entry);
+      default:
+        return false;
     }
-    return Add(istring, ostring, std::move(weight));
   }
 
-  void Compile(MutableFst<Arc> *fst) const { ptree_.ToFst(fst); }
+  // Whether tokenizing the strings may assign new generated symbols.
+  bool MayGenerateSymbols(absl::string_view istring,
+                          absl::string_view ostring) const {
+    return (input_token_type_ != TokenType::SYMBOL &&
+            istring.find('[') != absl::string_view::npos) ||
+           (output_token_type_ != TokenType::SYMBOL &&
+            ostring.find('[') != absl::string_view::npos);
+  }
+
+  template <class StringType>
+  bool MayGenerateSymbols(const std::vector<StringType> &line) const {
+    switch (line.size()) {
+      case 1:
+        return MayGenerateSymbols(line[0], line[0]);
+      case 2:
+      case 3:
+        return MayGenerateSymbols(line[0], line[1]);
+      default:
+        return false;
+    }
+  }
+
+  // Inserts a tokenized line into the prefix tree.
+  void Insert(Entry *entry) {
+    ptree_.Add(entry->ilabels, entry->olabels, std::move(entry->weight));
+  }
+
+  // This may consume the entries, depending on PTree.
+  void Compile(MutableFst<Arc> *fst) { ptree_.ToFst(fst); }
+
+  const PTree &Tree() const { return ptree_; }
 
  private:
   const TokenType input_token_type_;
@@ -97,7 +243,7 @@ class StringMapCompiler {
 };
 
 template <class StringType>
-bool StringMapLineIsAcceptor(std::vector<StringType> line) {
+bool StringMapLineIsAcceptor(const std::vector<StringType> &line) {
   switch (line.size()) {
     case 1:
       return true;
@@ -151,7 +297,7 @@ inline bool StringMapCheckRepresentableAsAcceptor(
 }
 
 template <class StringType>
-bool StringMapCheckRepresentableAsAcceptor(std::vector<StringType> lines,
+bool StringMapCheckRepresentableAsAcceptor(const std::vector<StringType> &lines,
                                            TokenType input_token_type,
                                            TokenType output_token_type,
                                            const SymbolTable *input_symbols,
@@ -166,39 +312,186 @@ bool StringMapCheckRepresentableAsAcceptor(std::vector<StringType> lines,
   return true;
 }
 
-template <class PTree, class Arc>
-bool StringMapCompile(internal::ColumnStringFile *csf, MutableFst<Arc> *fst,
-                      TokenType input_token_type, TokenType output_token_type,
-                      const SymbolTable *input_symbols,
-                      const SymbolTable *output_symbols) {
-  internal::StringMapCompiler<Arc, PTree> compiler(
-      input_token_type, output_token_type, input_symbols, output_symbols);
+// Number of lines tokenized per batch when compiling a string map with more
+// than one thread; this bounds the memory used for tokenized lines.
+constexpr size_t kStringMapBatchSize = 1 << 16;
+
+// Tokenizes `size` lines concurrently using `tokenize(i, entry)`, then inserts
+// them into the compiler in order. Lines for which `deferred(i)` holds are
+// instead tokenized in order on the calling thread, so that generated symbols
+// are numbered as they would be by a serial pass. Since insertion is also in
+// order, the resulting prefix tree is identical to the serial one. On failure,
+// `log_error(i)` is called for the first ill-formed line.
+template <class Compiler, class Tokenize, class Deferred, class LogError>
+bool StringMapAddBatch(size_t size, int num_threads, const Tokenize &tokenize,
+                       const Deferred &deferred, const LogError &log_error,
+                       Compiler *compiler,
+                       std::vector<typename Compiler::Entry> *entries) {
+  enum Status : char { kDeferred, kTokenized, kFailed };
+  if (entries->size() < size) entries->resize(size);
+  std::vector<Status> status(size);
+  ParallelFor(size, num_threads, [&](size_t, size_t i) {
+    if (deferred(i)) {
+      status[i] = kDeferred;
+    } else {
+      status[i] = tokenize(i, &(*entries)[i]) ? kTokenized : kFailed;
+    }
+  });
+  for (size_t i = 0; i < size; ++i) {
+    auto *entry = &(*entries)[i];
+    if (status[i] == kFailed ||
+        (status[i] == kDeferred && !tokenize(i, entry))) {
+      log_error(i);
+      return false;
+    }
+    compiler->Insert(entry);
+  }
+  return true;
+}
+
+// The rows of the current batch are kept as views into the file. Views into a
+// line which had to be unescaped are only valid until the next row is read, so
+// such lines are copied, into a deque so that the copies are never moved.
+template <class Compiler>
+bool StringMapAddBatched(internal::ColumnStringFile *csf, int num_threads,
+                         Compiler *compiler) {
+  using Entry = typename Compiler::Entry;
+  std::vector<std::vector<absl::string_view>> rows;
+  std::vector<absl::string_view> lines;
+  std::deque<std::string> buffers;
+  std::vector<size_t> linenums;
+  std::vector<Entry> entries;
+  const auto tokenize = [&rows, compiler](size_t i, Entry *entry) {
+    return compiler->Tokenize(rows[i], entry);
+  };
+  const auto deferred = [&rows, compiler](size_t i) {
+    return compiler->MayGenerateSymbols(rows[i]);
+  };
+  const auto log_error = [&](size_t i) {
+    LOG(ERROR) << "StringFileCompile: Ill-formed line " << linenums[i]
+               << " in file " << csf->Filename() << ": `" << lines[i] << "`";
+  };
+  for (csf->Reset(); !csf->Done();) {
+    size_t size = 0;
+    for (; size < kStringMapBatchSize && !csf->Done(); ++size, csf->Next()) {
+      if (size == rows.size()) {
+        rows.emplace_back();
+        lines.emplace_back();
+        buffers.emplace_back();
+        linenums.emplace_back();
+      }
+      const auto &row = csf->Row();
+      const auto line = csf->Line();
+      rows[size] = row;
+      lines[size] = line;
+      if (!csf->IsMapped()) {
+        // The columns are views into the line, so are moved to the copy.
+        auto &buffer = buffers[size];
+        buffer.assign(line.data(), line.size());
+        lines[size] = buffer;
+        for (auto &column : rows[size]) {
+          column = absl::string_view(
+              buffer.data() + (column.data() - line.data()), column.size());
+        }
+      }
+      linenums[size] = csf->LineNumber();
+    }
+    if (!StringMapAddBatch(size, num_threads, tokenize, deferred, log_error,
+                           compiler, &entries)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class Compiler>
+bool StringMapAddBatched(const std::vector<std::vector<std::string>> &lines,
+                         int num_threads, Compiler *compiler) {
+  using Entry = typename Compiler::Entry;
+  std::vector<Entry> entries;
+  for (size_t begin = 0; begin < lines.size(); begin += kStringMapBatchSize) {
+    const auto *batch = lines.data() + begin;
+    const auto tokenize = [batch, compiler](size_t i, Entry *entry) {
+      return compiler->Tokenize(batch[i], entry);
+    };
+    const auto deferred = [batch, compiler](size_t i) {
+      return compiler->MayGenerateSymbols(batch[i]);
+    };
+    const auto log_error = [batch](size_t i) {
+      LOG(ERROR) << "StringMapCompile: Ill-formed line: `"
+                 << fst::StringJoin(batch[i], "\t") << "`";
+    };
+    const auto size = std::min(kStringMapBatchSize, lines.size() - begin);
+    if (!StringMapAddBatch(size, num_threads, tokenize, deferred, log_error,
+                           compiler, &entries)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class Weight, class Compiler>
+bool StringMapAddBatched(
+    const std::vector<std::tuple<std::string, std::string, Weight>> &lines,
+    int num_threads, Compiler *compiler) {
+  using Entry = typename Compiler::Entry;
+  std::vector<Entry> entries;
+  for (size_t begin = 0; begin < lines.size(); begin += kStringMapBatchSize) {
+    const auto *batch = lines.data() + begin;
+    const auto tokenize = [batch, compiler](size_t i, Entry *entry) {
+      return compiler->Tokenize(std::get<0>(batch[i]), std::get<1>(batch[i]),
+                                std::get<2>(batch[i]), entry);
+    };
+    const auto deferred = [batch, compiler](size_t i) {
+      return compiler->MayGenerateSymbols(std::get<0>(batch[i]),
+                                          std::get<1>(batch[i]));
+    };
+    const auto log_error = [batch](size_t i) {
+      LOG(ERROR) << "StringMapCompile: Ill-formed line: `("
+                 << std::get<0>(batch[i]) << ", " << std::get<1>(batch[i])
+                 << ", " << std::get<2>(batch[i]) << ")`";
+    };
+    const auto size = std::min(kStringMapBatchSize, lines.size() - begin);
+    if (!StringMapAddBatch(size, num_threads, tokenize, deferred, log_error,
+                           compiler, &entries)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Adds the lines of a string map to the compiler; if num_threads is not 1,
+// they are tokenized in batches (see StringMapAddBatch).
+template <class Compiler>
+bool StringMapAdd(internal::ColumnStringFile *csf, int num_threads,
+                  Compiler *compiler) {
+  if (num_threads != 1) return StringMapAddBatched(csf, num_threads, compiler);
   for (csf->Reset(); !csf->Done(); csf->Next()) {
     const auto &line = csf->Row();
-    const auto log_line_compilation_error = [&csf, &line]() {
+    const auto log_line_compilation_error = [&csf]() {
       LOG(ERROR) << "StringFileCompile: Ill-formed line " << csf->LineNumber()
-                 << " in file " << csf->Filename() << ": `"
-                 << fst::StringJoin(line, "\t") << "`";
+                 << " in file " << csf->Filename() << ": `" << csf->Line()
+                 << "`";
       return false;
     };
+    // The columns are passed as views into the file, without copying.
     switch (line.size()) {
       case 1: {
-        if (!compiler.Add(std::string(line[0]))) {
+        if (!compiler->Add(line[0])) {
           log_line_compilation_error();
           return false;
         }
         break;
       }
       case 2: {
-        if (!compiler.Add(std::string(line[0]), std::string(line[1]))) {
+        if (!compiler->Add(line[0], line[1])) {
           log_line_compilation_error();
           return false;
         }
         break;
       }
       case 3: {
-        if (!compiler.Add(std::string(line[0]), std::string(line[1]),
-                          std::string(line[2]))) {
+        if (!compiler->Add(line[0], line[1], line[2])) {
           log_line_compilation_error();
           return false;
         }
@@ -210,18 +503,15 @@ bool StringMapCompile(internal::ColumnStringFile *csf, MutableFst<Arc> *fst,
       }
     }
   }
-  compiler.Compile(fst);
   return true;
 }
 
-template <class PTree, class Arc>
-bool StringMapCompile(const std::vector<std::vector<std::string>> &lines,
-                      MutableFst<Arc> *fst, TokenType input_token_type,
-                      TokenType output_token_type,
-                      const SymbolTable *input_symbols,
-                      const SymbolTable *output_symbols) {
-  internal::StringMapCompiler<Arc, PTree> compiler(
-      input_token_type, output_token_type, input_symbols, output_symbols);
+template <class Compiler>
+bool StringMapAdd(const std::vector<std::vector<std::string>> &lines,
+                  int num_threads, Compiler *compiler) {
+  if (num_threads != 1) {
+    return StringMapAddBatched(lines, num_threads, compiler);
+  }
   for (const auto &line : lines) {
     const auto log_line_compilation_error = [&line]() {
       LOG(ERROR) << "StringMapCompile: Ill-formed line: `"
@@ -230,21 +520,21 @@ bool StringMapCompile(const std::vector<std::vector<std::string>> &lines,
     };
     switch (line.size()) {
       case 1: {
-        if (!compiler.Add(line[0])) {
+        if (!compiler->Add(line[0])) {
           log_line_compilation_error();
           return false;
         }
         break;
       }
       case 2: {
-        if (!compiler.Add(line[0], line[1])) {
+        if (!compiler->Add(line[0], line[1])) {
           log_line_compilation_error();
           return false;
         }
         break;
       }
       case 3: {
-        if (!compiler.Add(line[0], line[1], line[2])) {
+        if (!compiler->Add(line[0], line[1], line[2])) {
           log_line_compilation_error();
           return false;
         }
@@ -256,54 +546,121 @@ bool StringMapCompile(const std::vector<std::vector<std::string>> &lines,
       }
     }
   }
-  compiler.Compile(fst);
   return true;
 }
 
-template <class PTree, class Arc>
-bool StringMapCompile(
-    const std::vector<
-        std::tuple<std::string, std::string, typename Arc::Weight>> &lines,
-    MutableFst<Arc> *fst, TokenType input_token_type = TokenType::BYTE,
-    TokenType output_token_type = TokenType::BYTE,
-    const SymbolTable *input_symbols = nullptr,
-    const SymbolTable *output_symbols = nullptr) {
-  internal::StringMapCompiler<Arc, PTree> compiler(
-      input_token_type, output_token_type, input_symbols, output_symbols);
+template <class Weight, class Compiler>
+bool StringMapAdd(
+    const std::vector<std::tuple<std::string, std::string, Weight>> &lines,
+    int num_threads, Compiler *compiler) {
+  if (num_threads != 1) {
+    return StringMapAddBatched(lines, num_threads, compiler);
+  }
   for (const auto &line : lines) {
     const auto &istring = std::get<0>(line);
     const auto &ostring = std::get<1>(line);
     const auto &weight = std::get<2>(line);
-    if (!compiler.Add(istring, ostring, weight)) {
+    if (!compiler->Add(istring, ostring, weight)) {
       LOG(ERROR) << "StringMapCompile: Ill-formed line: `(" << istring << ", "
                  << ostring << ", " << weight << ")`";
       return false;
     }
   }
+  return true;
+}
+
+// Compiles a string map using the given prefix tree type.
+template <class PTree, class Arc, class Container>
+bool StringMapCompile(const Container &container, MutableFst<Arc> *fst,
+                      TokenType input_token_type, TokenType output_token_type,
+                      const SymbolTable *input_symbols,
+                      const SymbolTable *output_symbols, int num_threads) {
+  internal::StringMapCompiler<Arc, PTree> compiler(
+      input_token_type, output_token_type, input_symbols, output_symbols);
+  if (!StringMapAdd(container, num_threads, &compiler)) return false;
   compiler.Compile(fst);
   return true;
 }
 
+// Compiles a string map using the given incremental DFA type. If the lines
+// turn out not to be sorted, sorted is set to false and nothing is written.
+template <class Dfa, class Arc, class Container>
+bool StringMapCompileMinimal(const Container &container, MutableFst<Arc> *fst,
+                             TokenType input_token_type,
+                             TokenType output_token_type,
+                             const SymbolTable *input_symbols,
+                             const SymbolTable *output_symbols, int num_threads,
+                             bool *sorted) {
+  internal::StringMapCompiler<Arc, Dfa> compiler(
+      input_token_type, output_token_type, input_symbols, output_symbols);
+  if (!StringMapAdd(container, num_threads, &compiler)) return false;
+  *sorted = compiler.Tree().Sorted();
+  if (*sorted) compiler.Compile(fst);
+  return true;
+}
+
+// With StringMapMode::PREFIX_TREE, each node of the prefix tree is allocated
+// separately, whereas with StringMapMode::FLAT_PREFIX_TREE, the tree is
+// stored in flat arrays (see FlatPrefixTree); both produce the same FST, but
+// the latter is much faster and uses much less memory for large string maps.
+// With StringMapMode::MINIMAL_DFA, the minimal deterministic acyclic automaton
+// is built directly, without first building the prefix tree (see
+// IncrementalMinimalDfa); this requires the lines to be sorted by input string
+// and then by output string, and otherwise falls back to the flat prefix tree
+// at the cost of a second pass over the lines. If num_threads is not 1, lines
+// are tokenized in batches by that many threads (or, if it is not positive, by
+// one per core) before being inserted in order; the result is the same as with
+// one thread.
 template <class Arc, class Container>
 bool StringMapCompileWithAcceptorCheck(
-    Container container, MutableFst<Arc> *fst,
+    const Container &container, MutableFst<Arc> *fst,
     TokenType input_token_type = TokenType::BYTE,
     TokenType output_token_type = TokenType::BYTE,
     const SymbolTable *input_symbols = nullptr,
-    const SymbolTable *output_symbols = nullptr) {
+    const SymbolTable *output_symbols = nullptr,
+    StringMapMode mode = StringMapMode::FLAT_PREFIX_TREE,
+    int num_threads = 1) {
   const bool representable_as_acceptor =
       internal::StringMapCheckRepresentableAsAcceptor(
           container, input_token_type, output_token_type, input_symbols,
           output_symbols);
-  if (representable_as_acceptor) {
-    return internal::StringMapCompile<AcceptorPrefixTree<Arc>>(
-        container, fst, input_token_type, output_token_type, input_symbols,
-        output_symbols);
-  } else {
-    return internal::StringMapCompile<TransducerPrefixTree<Arc>>(
-        container, fst, input_token_type, output_token_type, input_symbols,
-        output_symbols);
+  switch (mode) {
+    case StringMapMode::MINIMAL_DFA: {
+      bool sorted = true;
+      const bool success =
+          representable_as_acceptor
+              ? internal::StringMapCompileMinimal<IncrementalAcceptorDfa<Arc>>(
+                    container, fst, input_token_type, output_token_type,
+                    input_symbols, output_symbols, num_threads, &sorted)
+              : internal::StringMapCompileMinimal<
+                    IncrementalTransducerDfa<Arc>>(
+                    container, fst, input_token_type, output_token_type,
+                    input_symbols, output_symbols, num_threads, &sorted);
+      if (!success || sorted) return success;
+      [[fallthrough]];
+    }
+    case StringMapMode::FLAT_PREFIX_TREE: {
+      if (representable_as_acceptor) {
+        return internal::StringMapCompile<FlatAcceptorPrefixTree<Arc>>(
+            container, fst, input_token_type, output_token_type, input_symbols,
+            output_symbols, num_threads);
+      }
+      return internal::StringMapCompile<FlatTransducerPrefixTree<Arc>>(
+          container, fst, input_token_type, output_token_type, input_symbols,
+          output_symbols, num_threads);
+    }
+    case StringMapMode::PREFIX_TREE: {
+      if (representable_as_acceptor) {
+        return internal::StringMapCompile<AcceptorPrefixTree<Arc>>(
+            container, fst, input_token_type, output_token_type, input_symbols,
+            output_symbols, num_threads);
+      }
+      return internal::StringMapCompile<TransducerPrefixTree<Arc>>(
+          container, fst, input_token_type, output_token_type, input_symbols,
+          output_symbols, num_threads);
+    }
   }
+  return false;  // Unreachable.
 }
 
 }  // namespace internal
@@ -311,19 +668,22 @@ bool StringMapCompileWithAcceptorCheck(
 // Compiles deterministic FST representing the union of the cross-product of
 // pairs of weighted string cross-products from a TSV file of string triples.
 // It will be an acceptor if all lines represent the same istring and ostring
-// and also the (token_type, symbols) is the same for input and output.
+// and also the (token_type, symbols) is the same for input and output. See
+// StringMapCompileWithAcceptorCheck for the meaning of mode and num_threads.
 template <class Arc>
 bool StringFileCompile(
     const std::string &source, MutableFst<Arc> *fst,
     TokenType input_token_type = TokenType::BYTE,
     TokenType output_token_type = TokenType::BYTE,
     const SymbolTable *input_symbols = nullptr,
-    const SymbolTable *output_symbols = nullptr) {
+    const SymbolTable *output_symbols = nullptr,
+    StringMapMode mode = StringMapMode::FLAT_PREFIX_TREE,
+    int num_threads = 1) {
   internal::ColumnStringFile csf(source);
   if (csf.Error()) return false;  // File opening failed.
   return internal::StringMapCompileWithAcceptorCheck(
       &csf, fst, input_token_type, output_token_type, input_symbols,
-      output_symbols);
+      output_symbols, mode, num_threads);
 }
 
 // Compiles deterministic FST representing the union of the cross-product of
@@ -336,10 +696,12 @@ bool StringMapCompile(
     TokenType input_token_type = TokenType::BYTE,
     TokenType output_token_type = TokenType::BYTE,
     const SymbolTable *input_symbols = nullptr,
-    const SymbolTable *output_symbols = nullptr) {
+    const SymbolTable *output_symbols = nullptr,
+    StringMapMode mode = StringMapMode::FLAT_PREFIX_TREE,
+    int num_threads = 1) {
   return internal::StringMapCompileWithAcceptorCheck(
       lines, fst, input_token_type, output_token_type, input_symbols,
-      output_symbols);
+      output_symbols, mode, num_threads);
 }
 
 // Compiles deterministic FST representing the union of the cross-product of
@@ -354,10 +716,12 @@ bool StringMapCompile(
     MutableFst<Arc> *fst, TokenType input_token_type = TokenType::BYTE,
     TokenType output_token_type = TokenType::BYTE,
     const SymbolTable *input_symbols = nullptr,
-    const SymbolTable *output_symbols = nullptr) {
+    const SymbolTable *output_symbols = nullptr,
+    StringMapMode mode = StringMapMode::FLAT_PREFIX_TREE,
+    int num_threads = 1) {
   return internal::StringMapCompileWithAcceptorCheck(
       lines, fst, input_token_type, output_token_type, input_symbols,
-      output_symbols);
+      output_symbols, mode, num_threads);
 }
 
 }  // namespace fst
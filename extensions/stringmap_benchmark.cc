@@ -0,0 +1,98 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks of string map compilation, across prefix tree implementations.
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <fst/arc.h>
+#include <fst/vector-fst.h>
+#include "benchmark_util.h"
+#include "stringmap.h"
+
+namespace fst {
+namespace {
+
+using ::fst::benchmark_util::NumberNameLines;
+using ::fst::benchmark_util::RandomWords;
+
+// Lines of a lexicon of random words, as acceptor entries, sorted so that
+// the minimal DFA can be built incrementally.
+std::vector<std::vector<std::string>> LexiconLines(int num_words) {
+  auto words = RandomWords(num_words);
+  std::sort(words.begin(), words.end());
+  std::vector<std::vector<std::string>> lines;
+  lines.reserve(words.size());
+  for (auto &word : words) lines.push_back({std::move(word)});
+  return lines;
+}
+
+// The first argument is the StringMapMode, the second the number of lines.
+void BM_StringMapCompileAcceptor(benchmark::State &state) {
+  const auto mode = static_cast<StringMapMode>(state.range(0));
+  const auto lines = LexiconLines(state.range(1));
+  for (auto _ : state) {
+    VectorFst<StdArc> fst;
+    StringMapCompile(lines, &fst, TokenType::BYTE, TokenType::BYTE, nullptr,
+                     nullptr, mode);
+    benchmark::DoNotOptimize(fst.NumStates());
+  }
+  state.SetItemsProcessed(state.iterations() * lines.size());
+}
+BENCHMARK(BM_StringMapCompileAcceptor)
+    ->ArgsProduct({{static_cast<int>(StringMapMode::PREFIX_TREE),
+                    static_cast<int>(StringMapMode::FLAT_PREFIX_TREE),
+                    static_cast<int>(StringMapMode::MINIMAL_DFA)},
+                   {1000, 100000}});
+
+// Number names are transducer entries, and are not sorted, so MINIMAL_DFA
+// falls back to the flat prefix tree.
+void BM_StringMapCompileTransducer(benchmark::State &state) {
+  const auto mode = static_cast<StringMapMode>(state.range(0));
+  const auto lines = NumberNameLines(state.range(1));
+  for (auto _ : state) {
+    VectorFst<StdArc> fst;
+    StringMapCompile(lines, &fst, TokenType::BYTE, TokenType::BYTE, nullptr,
+                     nullptr, mode);
+    benchmark::DoNotOptimize(fst.NumStates());
+  }
+  state.SetItemsProcessed(state.iterations() * lines.size());
+}
+BENCHMARK(BM_StringMapCompileTransducer)
+    ->ArgsProduct({{static_cast<int>(StringMapMode::PREFIX_TREE),
+                    static_cast<int>(StringMapMode::FLAT_PREFIX_TREE),
+                    static_cast<int>(StringMapMode::MINIMAL_DFA)},
+                   {9999, 99999}});
+
+// Tokenizes lines in parallel; the argument is the number of threads.
+void BM_StringMapCompileThreads(benchmark::State &state) {
+  const auto lines = NumberNameLines(99999);
+  for (auto _ : state) {
+    VectorFst<StdArc> fst;
+    StringMapCompile(lines, &fst, TokenType::UTF8, TokenType::UTF8, nullptr,
+                     nullptr, StringMapMode::FLAT_PREFIX_TREE,
+                     state.range(0));
+    benchmark::DoNotOptimize(fst.NumStates());
+  }
+  state.SetItemsProcessed(state.iterations() * lines.size());
+}
+BENCHMARK(BM_StringMapCompileThreads)->Arg(1)->Arg(4)->UseRealTime();
+
+}  // namespace
+}  // namespace fst
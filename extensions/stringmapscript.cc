@@ -24,10 +24,11 @@ namespace script {
 bool StringFileCompile(const std::string &source, MutableFstClass *fst,
                        TokenType input_token_type, TokenType output_token_type,
                        const SymbolTable *input_symbols,
-                       const SymbolTable *output_symbols) {
+                       const SymbolTable *output_symbols, bool minimize,
+                       int num_threads) {
   StringFileCompileInnerArgs iargs(source, fst, input_token_type,
                                    output_token_type, input_symbols,
-                                   output_symbols);
+                                   output_symbols, minimize, num_threads);
   StringFileCompileArgs args(iargs);
   Apply<Operation<StringFileCompileArgs>>("StringFileCompile", fst->ArcType(),
                                           &args);
@@ -40,10 +41,11 @@ bool StringMapCompile(const std::vector<std::vector<std::string>> &lines,
                       MutableFstClass *fst, TokenType input_token_type,
                       TokenType output_token_type,
                       const SymbolTable *input_symbols,
-                      const SymbolTable *output_symbols) {
+                      const SymbolTable *output_symbols, bool minimize,
+                      int num_threads) {
   StringMapCompileInnerArgs1 iargs(lines, fst, input_token_type,
                                    output_token_type, input_symbols,
-                                   output_symbols);
+                                   output_symbols, minimize, num_threads);
   StringMapCompileArgs1 args(iargs);
   Apply<Operation<StringMapCompileArgs1>>("StringMapCompile", fst->ArcType(),
                                           &args);
@@ -56,10 +58,10 @@ bool StringMapCompile(
     const std::vector<std::tuple<std::string, std::string, WeightClass>> &lines,
     MutableFstClass *fst, TokenType input_token_type,
     TokenType output_token_type, const SymbolTable *input_symbols,
-    const SymbolTable *output_symbols) {
+    const SymbolTable *output_symbols, bool minimize, int num_threads) {
   StringMapCompileInnerArgs2 iargs(lines, fst, input_token_type,
                                    output_token_type, input_symbols,
-                                   output_symbols);
+                                   output_symbols, minimize, num_threads);
   StringMapCompileArgs2 args(iargs);
   Apply<Operation<StringMapCompileArgs2>>("StringMapCompile", fst->ArcType(),
                                           &args);
@@ -31,46 +31,55 @@
 namespace fst {
 namespace script {
 
+inline StringMapMode StringMapModeFromMinimize(bool minimize) {
+  return minimize ? StringMapMode::MINIMAL_DFA
+                  : StringMapMode::FLAT_PREFIX_TREE;
+}
+
 using StringFileCompileInnerArgs =
     std::tuple<const std::string &, MutableFstClass *, TokenType, TokenType,
-               const SymbolTable *, const SymbolTable *>;
+               const SymbolTable *, const SymbolTable *, bool, int>;
 
 using StringFileCompileArgs = WithReturnValue<bool, StringFileCompileInnerArgs>;
 
 template <class Arc>
 void StringFileCompile(StringFileCompileArgs *args) {
   MutableFst<Arc> *fst = std::get<1>(args->args)->GetMutableFst<Arc>();
-  args->retval =
-      StringFileCompile(std::get<0>(args->args), fst, std::get<2>(args->args),
-                        std::get<3>(args->args), std::get<4>(args->args),
-                        std::get<5>(args->args));
+  args->retval = StringFileCompile(
+      std::get<0>(args->args), fst, std::get<2>(args->args),
+      std::get<3>(args->args), std::get<4>(args->args), std::get<5>(args->args),
+      StringMapModeFromMinimize(std::get<6>(args->args)),
+      std::get<7>(args->args));
 }
 
 bool StringFileCompile(const std::string &source, MutableFstClass *fst,
                        TokenType input_token_type = TokenType::BYTE,
                        TokenType output_token_type = TokenType::BYTE,
                        const SymbolTable *input_symbols = nullptr,
-                       const SymbolTable *output_symbols = nullptr);
+                       const SymbolTable *output_symbols = nullptr,
+                       bool minimize = false, int num_threads = 1);
 
 using StringMapCompileInnerArgs1 =
     std::tuple<const std::vector<std::vector<std::string>> &, MutableFstClass *,
-               TokenType, TokenType, const SymbolTable *, const SymbolTable *>;
+               TokenType, TokenType, const SymbolTable *, const SymbolTable *,
+               bool, int>;
 
 using StringMapCompileArgs1 = WithReturnValue<bool, StringMapCompileInnerArgs1>;
 
 template <class Arc>
 void StringMapCompile(StringMapCompileArgs1 *args) {
   MutableFst<Arc> *fst = std::get<1>(args->args)->GetMutableFst<Arc>();
-  args->retval =
-      StringMapCompile(std::get<0>(args->args), fst, std::get<2>(args->args),
-                       std::get<3>(args->args), std::get<4>(args->args),
-                       std::get<5>(args->args));
+  args->retval = StringMapCompile(
+      std::get<0>(args->args), fst, std::get<2>(args->args),
+      std::get<3>(args->args), std::get<4>(args->args), std::get<5>(args->args),
+      StringMapModeFromMinimize(std::get<6>(args->args)),
+      std::get<7>(args->args));
 }
 
 using StringMapCompileInnerArgs2 = std::tuple<
     const std::vector<std::tuple<std::string, std::string, WeightClass>> &,
     MutableFstClass *, TokenType, TokenType, const SymbolTable *,
-    const SymbolTable *>;
+    const SymbolTable *, bool, int>;
 
 using StringMapCompileArgs2 = WithReturnValue<bool, StringMapCompileInnerArgs2>;
 
@@ -89,7 +98,9 @@ void StringMapCompile(StringMapCompileArgs2 *args) {
   MutableFst<Arc> *fst = std::get<1>(args->args)->GetMutableFst<Arc>();
   args->retval = StringMapCompile(
       lines, fst, std::get<2>(args->args), std::get<3>(args->args),
-      std::get<4>(args->args), std::get<5>(args->args));
+      std::get<4>(args->args), std::get<5>(args->args),
+      StringMapModeFromMinimize(std::get<6>(args->args)),
+      std::get<7>(args->args));
 }
 
 bool StringMapCompile(const std::vector<std::vector<std::string>> &lines,
@@ -97,14 +108,16 @@ bool StringMapCompile(const std::vector<std::vector<std::string>> &lines,
                       TokenType input_token_type = TokenType::BYTE,
                       TokenType output_token_type = TokenType::BYTE,
                       const SymbolTable *input_symbols = nullptr,
-                      const SymbolTable *output_symbols = nullptr);
+                      const SymbolTable *output_symbols = nullptr,
+                      bool minimize = false, int num_threads = 1);
 
 bool StringMapCompile(
     const std::vector<std::tuple<std::string, std::string, WeightClass>> &lines,
     MutableFstClass *fst, TokenType input_token_type = TokenType::BYTE,
     TokenType output_token_type = TokenType::BYTE,
     const SymbolTable *input_symbols = nullptr,
-    const SymbolTable *output_symbols = nullptr);
+    const SymbolTable *output_symbols = nullptr, bool minimize = false,
+    int num_threads = 1);
 
 }  // namespace script
 }  // namespace fst
@@ -17,22 +17,230 @@
 #ifndef PYNINI_STRINGPRINT_H_
 #define PYNINI_STRINGPRINT_H_
 
+// Functions and classes for printing string FSTs and label sequences.
+//
+// Unlike OpenFst's StringPrinter, which copies the symbol table when it is
+// constructed and builds each result in a string stream, the
+// ReusableStringPrinter defined here borrows the symbol table and appends
+// directly to the caller's string; callers which print many strings should
+// keep a single printer (and output buffer) around.
+
+#include <cstddef>
 #include <string>
+#include <vector>
 
-#include <fst/fst-decl.h>
+#include <fst/log.h>
+#include <fst/fst.h>
 #include <fst/string.h>
+#include <fst/symbol-table.h>
+#include <fst/compat.h>
 
 namespace fst {
 
+// A batch of strings stored in one contiguous buffer; the i-th string spans
+// [offsets[i], offsets[i + 1]).
+class StringBatch {
+ public:
+  StringBatch() : offsets_{0} {}
+
+  size_t Size() const { return offsets_.size() - 1; }
+
+  absl::string_view operator[](size_t i) const {
+    return absl::string_view(buffer_.data() + offsets_[i],
+                             offsets_[i + 1] - offsets_[i]);
+  }
+
+  const std::string &Buffer() const { return buffer_; }
+
+  const std::vector<size_t> &Offsets() const { return offsets_; }
+
+  // Removes all strings, but retains the allocated capacity.
+  void Clear() {
+    buffer_.clear();
+    offsets_.resize(1);
+  }
+
+  void Reserve(size_t size, size_t bytes) {
+    offsets_.reserve(size + 1);
+    buffer_.reserve(bytes);
+  }
+
+  // Returns the buffer, to which the caller appends the next string before
+  // calling Close.
+  std::string *MutableBuffer() { return &buffer_; }
+
+  // Marks the end of the string appended since the last call.
+  void Close() { offsets_.push_back(buffer_.size()); }
+
+  // Discards anything appended since the last call to Close.
+  void Abandon() { buffer_.resize(offsets_.back()); }
+
+ private:
+  std::string buffer_;
+  std::vector<size_t> offsets_;
+};
+
+// Prints label sequences, or the output projection of string FSTs, as
+// strings. The symbol table, if any, is not copied, and so must outlive the
+// printer. A printer may be reused for any number of calls, but is not
+// thread-safe.
+template <class Arc>
+class ReusableStringPrinter {
+ public:
+  using Label = typename Arc::Label;
+  using Weight = typename Arc::Weight;
+
+  explicit ReusableStringPrinter(TokenType token_type = TokenType::BYTE,
+                                 const SymbolTable *symbols = nullptr)
+      : token_type_(token_type), symbols_(symbols) {}
+
+  // Replaces the contents of `str` with the string of a string FST.
+  bool operator()(const Fst<Arc> &fst, std::string *str) {
+    str->clear();
+    return Append(fst, str);
+  }
+
+  // Appends the string of a string FST to `str`.
+  bool Append(const Fst<Arc> &fst, std::string *str) {
+    return FstToLabels(fst) && Append(labels_, str);
+  }
+
+  // Appends the string of a label sequence to `str`; epsilons are omitted.
+  bool Append(const std::vector<Label> &labels, std::string *str) {
+    switch (token_type_) {
+      case TokenType::BYTE: {
+        str->reserve(str->size() + labels.size());
+        for (const auto label : labels) {
+          if (label != 0) str->push_back(static_cast<char>(label));
+        }
+        return true;
+      }
+      case TokenType::UTF8: {
+        str->reserve(str->size() + labels.size());
+        for (const auto label : labels) {
+          if (!AppendUTF8(label, str)) return false;
+        }
+        return true;
+      }
+      case TokenType::SYMBOL: {
+        if (symbols_ == nullptr) {
+          LOG(ERROR) << "ReusableStringPrinter: Symbol table required for "
+                     << "SYMBOL token type";
+          return false;
+        }
+        if (!LabelsToString(labels, &scratch_, token_type_, symbols_)) {
+          return false;
+        }
+        str->append(scratch_);
+        return true;
+      }
+    }
+    return false;  // Unreachable.
+  }
+
+  // Prints each label sequence as one more string in the batch. If any
+  // sequence cannot be printed, the strings printed so far are kept.
+  bool Append(const std::vector<std::vector<Label>> &labels,
+              StringBatch *batch) {
+    size_t bytes = batch->Buffer().size();
+    for (const auto &sequence : labels) bytes += sequence.size();
+    batch->Reserve(batch->Size() + labels.size(), bytes);
+    for (const auto &sequence : labels) {
+      if (!Append(sequence, batch->MutableBuffer())) {
+        batch->Abandon();
+        return false;
+      }
+      batch->Close();
+    }
+    return true;
+  }
+
+ private:
+  // Reads a string FST's output labels into `labels_`; as with StringPrinter,
+  // the FST must be a single path whose last state is its only final one.
+  bool FstToLabels(const Fst<Arc> &fst) {
+    labels_.clear();
+    auto state = fst.Start();
+    if (state == kNoStateId) {
+      LOG(ERROR) << "ReusableStringPrinter: FST is empty";
+      return false;
+    }
+    while (fst.Final(state) == Weight::Zero()) {
+      ArcIterator<Fst<Arc>> aiter(fst, state);
+      if (aiter.Done()) {
+        LOG(ERROR) << "ReusableStringPrinter: FST is not a string";
+        return false;
+      }
+      const auto &arc = aiter.Value();
+      labels_.push_back(arc.olabel);
+      state = arc.nextstate;
+      aiter.Next();
+      if (!aiter.Done()) {
+        LOG(ERROR) << "ReusableStringPrinter: FST is not a string";
+        return false;
+      }
+    }
+    if (fst.NumArcs(state) != 0) {
+      LOG(ERROR) << "ReusableStringPrinter: FST is not a string";
+      return false;
+    }
+    return true;
+  }
+
+  // Encodes a single code point as UTF-8; zero is treated as epsilon. As in
+  // LabelsToUTF8String, labels which UTF-8 cannot encode are rejected.
+  static bool AppendUTF8(Label label, std::string *str) {
+    if (label < 0) {
+      VLOG(1) << "ReusableStringPrinter: Invalid character found: " << label;
+      return false;
+    } else if (label == 0) {
+      // Epsilon.
+    } else if (label < 0x80) {
+      str->push_back(static_cast<char>(label));
+    } else if (label < 0x800) {
+      str->push_back(static_cast<char>((label >> 6) | 0xC0));
+      str->push_back(static_cast<char>((label & 0x3F) | 0x80));
+    } else if (label < 0x10000) {
+      str->push_back(static_cast<char>((label >> 12) | 0xE0));
+      str->push_back(static_cast<char>(((label >> 6) & 0x3F) | 0x80));
+      str->push_back(static_cast<char>((label & 0x3F) | 0x80));
+    } else if (label < 0x200000) {
+      str->push_back(static_cast<char>((label >> 18) | 0xF0));
+      str->push_back(static_cast<char>(((label >> 12) & 0x3F) | 0x80));
+      str->push_back(static_cast<char>(((label >> 6) & 0x3F) | 0x80));
+      str->push_back(static_cast<char>((label & 0x3F) | 0x80));
+    } else {
+      VLOG(1) << "ReusableStringPrinter: Unknown character found: " << label;
+      return false;
+    }
+    return true;
+  }
+
+  const TokenType token_type_;
+  const SymbolTable *const symbols_;
+  // Scratch buffers retained across calls.
+  std::vector<Label> labels_;
+  std::string scratch_;
+};
+
 template <class Arc>
 bool StringPrint(const Fst<Arc> &fst, std::string *str,
                  TokenType token_type = TokenType::BYTE,
                  const SymbolTable *symbols = nullptr) {
-  const StringPrinter<Arc> printer(token_type, symbols);
+  ReusableStringPrinter<Arc> printer(token_type, symbols);
   return printer(fst, str);
 }
 
+// Clears the batch and prints each label sequence into it.
+template <class Arc>
+bool StringPrint(const std::vector<std::vector<typename Arc::Label>> &labels,
+                 StringBatch *batch, TokenType token_type = TokenType::BYTE,
+                 const SymbolTable *symbols = nullptr) {
+  ReusableStringPrinter<Arc> printer(token_type, symbols);
+  batch->Clear();
+  return printer.Append(labels, batch);
+}
+
 }  // namespace fst
 
 #endif  // PYNINI_STRINGPRINT_H_
-
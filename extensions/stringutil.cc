@@ -45,6 +45,33 @@ std::string StripCommentAndRemoveEscape(const std::string &line) {
   return RemoveEscape(StripComment(line));
 }
 
+absl::string_view StripCommentAndRemoveEscape(absl::string_view line,
+                                              std::string *buffer) {
+  bool escaped = false;
+  char prev_char = '\0';
+  for (size_t i = 0; i < line.size(); ++i) {
+    const char this_char = line[i];
+    if (this_char == '#') {
+      if (prev_char != '\\') {
+        // Strips comment and any trailing whitespace.
+        line = fst::StripTrailingAsciiWhitespace(line.substr(0, i));
+        break;
+      }
+      escaped = true;
+    }
+    prev_char = this_char;
+  }
+  if (!escaped) return line;
+  buffer->clear();
+  for (size_t i = 0; i < line.size(); ++i) {
+    if (line[i] == '\\' && i + 1 < line.size() && line[i + 1] == '#') {
+      continue;
+    }
+    buffer->push_back(line[i]);
+  }
+  return *buffer;
+}
+
 std::string Escape(const std::string &str) {
   std::string result;
   result.reserve(str.size());
@@ -19,6 +19,8 @@
 
 #include <string>
 
+#include <fst/compat.h>
+
 namespace fst {
 
 // Defines comment syntax for string files.
@@ -30,6 +32,12 @@ namespace fst {
 // a comment) escape it with '\'; the escaping '\' in "\#" also removed.
 std::string StripCommentAndRemoveEscape(const std::string &line);
 
+// Same, but avoids copying the line. The result is a view of line, unless
+// there is an escaped '#' to remove, in which case the unescaped line is
+// written to buffer and the result is a view of it.
+absl::string_view StripCommentAndRemoveEscape(absl::string_view line,
+                                              std::string *buffer);
+
 // Escapes characters (namely, backslash and square brackets) used to indicate
 // generated symbols.
 std::string Escape(const std::string &str);
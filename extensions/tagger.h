@@ -0,0 +1,227 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_TAGGER_H_
+#define PYNINI_TAGGER_H_
+
+// Streaming tagging of the substrings of a text matched by an acceptor.
+//
+// Rather than compiling the text into a string FST, composing it with a
+// context-dependent rewrite rule which inserts tags around matches, and
+// searching for the best output, the tagger scans the text buffer through a
+// StringViewFst, running a deterministic copy of the matcher (built once) from
+// each position. Output before the earliest position at which a match might
+// still begin is written immediately, so arbitrarily large texts can be
+// tagged chunk by chunk in memory bounded by the longest live match attempt.
+
+#include <cstddef>
+#include <string>
+#include <unordered_set>
+#include <utility>
+
+#include <fst/log.h>
+#include <fst/arcsort.h>
+#include <fst/determinize.h>
+#include <fst/fst.h>
+#include <fst/matcher.h>
+#include <fst/project.h>
+#include <fst/rmepsilon.h>
+#include <fst/string.h>
+#include <fst/vector-fst.h>
+#include "checkprops.h"
+#include "string-view-fst.h"
+
+namespace fst {
+
+// Matches are non-overlapping and chosen from left to right: at each position,
+// the match with the best weight (and among those, the longest) is tagged, and
+// scanning resumes after it; empty matches are ignored. Where the
+// corresponding obligatory rewrite rule has a unique best output, as when the
+// matcher is unweighted and no match is a proper prefix of a match beginning
+// at the same position, this is the same output. Every label in the text must
+// be in the alphabet of sigma_star, or tagging fails. Only byte and UTF-8 token
+// types are supported. Tagging does not modify the tagger, so calls may be
+// made concurrently.
+template <class Arc>
+class Tagger {
+ public:
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+
+  Tagger(const Fst<Arc> &matcher, const Fst<Arc> &sigma_star,
+         const std::string &ltag, const std::string &rtag,
+         TokenType token_type = TokenType::BYTE)
+      : ltag_(ltag), rtag_(rtag), token_type_(token_type) {
+    if (token_type_ == TokenType::SYMBOL) {
+      FSTERROR() << "Tagger: Symbol token type is not supported";
+      error_ = true;
+      return;
+    }
+    if (!CheckUnweightedAcceptor(sigma_star, "Tagger", "sigma_star")) {
+      error_ = true;
+      return;
+    }
+    for (StateIterator<Fst<Arc>> siter(sigma_star); !siter.Done();
+         siter.Next()) {
+      for (ArcIterator<Fst<Arc>> aiter(sigma_star, siter.Value());
+           !aiter.Done(); aiter.Next()) {
+        alphabet_.insert(aiter.Value().ilabel);
+      }
+    }
+    VectorFst<Arc> copy(matcher);
+    Project(&copy, ProjectType::INPUT);
+    RmEpsilon(&copy);
+    Determinize(copy, &matcher_);
+    ArcSort(&matcher_, ILabelCompare<Arc>());
+    if (matcher_.Properties(kError, false)) error_ = true;
+  }
+
+  bool Error() const { return error_; }
+
+  // Tags a complete text, appending the result to the output.
+  bool Tag(absl::string_view input, std::string *output) const {
+    return Scan(input, /*final=*/true, output) == input.size();
+  }
+
+  // Tags the next chunk of a text. The chunk is appended to the pending text,
+  // and the part of it which can already be tagged is removed from it and
+  // appended to the output; the rest remains pending. If `final` is true, the
+  // chunk ends the text, and nothing remains pending.
+  bool TagIncremental(absl::string_view chunk, bool final,
+                      std::string *pending, std::string *output) const {
+    pending->append(chunk.data(), chunk.size());
+    const auto consumed = Scan(*pending, final, output);
+    if (consumed == std::string::npos) {
+      pending->clear();
+      return false;
+    }
+    pending->erase(0, consumed);
+    return true;
+  }
+
+ private:
+  // Tags as much of the buffer as possible, returning the number of bytes
+  // consumed, or npos on error.
+  size_t Scan(absl::string_view buffer, bool final, std::string *output) const {
+    if (error_) return std::string::npos;
+    return token_type_ == TokenType::UTF8
+               ? Scan<UTF8Viewer<Arc>>(buffer, final, output)
+               : Scan<ByteViewer<Arc>>(buffer, final, output);
+  }
+
+  template <class Viewer>
+  size_t Scan(absl::string_view buffer, bool final, std::string *output) const;
+
+  // The number of bytes in the token starting at the offset, or 0 if the token
+  // is truncated by the end of the buffer.
+  template <class Viewer>
+  static size_t TokenSize(absl::string_view buffer, size_t offset);
+
+  const std::string ltag_;
+  const std::string rtag_;
+  const TokenType token_type_;
+  bool error_ = false;
+  std::unordered_set<Label> alphabet_;
+  VectorFst<Arc> matcher_;
+
+  Tagger(const Tagger &) = delete;
+  Tagger &operator=(const Tagger &) = delete;
+};
+
+template <class Arc>
+template <class Viewer>
+size_t Tagger<Arc>::TokenSize(absl::string_view buffer, size_t offset) {
+  size_t size = 1;
+  if (Viewer::TokenType() == TokenType::UTF8) {
+    const int c = buffer[offset] & 0xff;
+    size += (c >= 0xc0) + (c >= 0xe0) + (c >= 0xf0) + (c >= 0xf8) + (c >= 0xfc);
+  }
+  return offset + size <= buffer.size() ? size : 0;
+}
+
+template <class Arc>
+template <class Viewer>
+size_t Tagger<Arc>::Scan(absl::string_view buffer, bool final,
+                         std::string *output) const {
+  const StringViewFst<Arc, Viewer> text(buffer);
+  SortedMatcher<VectorFst<Arc>> matcher(matcher_, MATCH_INPUT);
+  const auto start = matcher_.Start();
+  size_t position = 0;
+  while (position < buffer.size()) {
+    const auto size = TokenSize<Viewer>(buffer, position);
+    // A truncated token at the end of a chunk is left pending.
+    if (size == 0 && !final) return position;
+    // Finds the best match beginning at this position.
+    size_t match_end = std::string::npos;
+    auto match_weight = Weight::Zero();
+    auto state = start;
+    auto weight = Weight::One();
+    size_t offset = position;
+    while (state != kNoStateId) {
+      if (offset > position) {
+        const auto final_weight = Times(weight, matcher_.Final(state));
+        if (final_weight != Weight::Zero() &&
+            !NaturalLess<Weight>()(match_weight, final_weight)) {
+          match_end = offset;
+          match_weight = final_weight;
+        }
+      }
+      if (matcher_.NumArcs(state) == 0) break;
+      if (offset == buffer.size() || TokenSize<Viewer>(buffer, offset) == 0) {
+        // The match might continue into the next chunk.
+        if (!final) return position;
+        break;
+      }
+      ArcIterator<StringViewFst<Arc, Viewer>> aiter(text, offset);
+      const auto &token = aiter.Value();
+      if (!alphabet_.count(token.ilabel)) {
+        LOG(ERROR) << "Tagger: Label " << token.ilabel << " at byte " << offset
+                   << " is not in the alphabet";
+        return std::string::npos;
+      }
+      matcher.SetState(state);
+      if (!matcher.Find(token.ilabel)) break;
+      const auto &arc = matcher.Value();
+      weight = Times(weight, arc.weight);
+      state = arc.nextstate;
+      offset = token.nextstate;
+    }
+    if (match_end != std::string::npos) {
+      output->append(ltag_);
+      output->append(buffer.data() + position, match_end - position);
+      output->append(rtag_);
+      position = match_end;
+    } else if (size == 0) {
+      LOG(ERROR) << "Tagger: Truncated UTF-8 byte sequence";
+      return std::string::npos;
+    } else {
+      ArcIterator<StringViewFst<Arc, Viewer>> aiter(text, position);
+      if (!alphabet_.count(aiter.Value().ilabel)) {
+        LOG(ERROR) << "Tagger: Label " << aiter.Value().ilabel << " at byte "
+                   << position << " is not in the alphabet";
+        return std::string::npos;
+      }
+      output->append(buffer.data() + position, size);
+      position += size;
+    }
+  }
+  return position;
+}
+
+}  // namespace fst
+
+#endif  // PYNINI_TAGGER_H_
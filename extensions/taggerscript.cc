@@ -0,0 +1,40 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "taggerscript.h"
+
+#include <string>
+
+#include <fst/script/fst-class.h>
+#include <fst/script/script-impl.h>
+
+namespace fst {
+namespace script {
+
+TaggerClass::TaggerClass(const FstClass &matcher, const FstClass &sigma_star,
+                         const std::string &ltag, const std::string &rtag,
+                         TokenType token_type)
+    : impl_(nullptr) {
+  if (!internal::ArcTypesMatch(matcher, sigma_star, "TaggerClass")) return;
+  arc_type_ = matcher.ArcType();
+  InitTaggerClassArgs args(matcher, sigma_star, ltag, rtag, token_type, this);
+  Apply<Operation<InitTaggerClassArgs>>("InitTaggerClass", arc_type_, &args);
+}
+
+REGISTER_FST_OPERATION_3ARCS(InitTaggerClass, InitTaggerClassArgs);
+
+}  // namespace script
+}  // namespace fst
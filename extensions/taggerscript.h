@@ -0,0 +1,113 @@
+// Copyright 2016-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef PYNINI_TAGGERSCRIPT_H_
+#define PYNINI_TAGGERSCRIPT_H_
+
+#include <memory>
+#include <string>
+#include <tuple>
+
+#include <fst/script/arg-packs.h>
+#include <fst/script/fstscript.h>
+#include "tagger.h"
+
+namespace fst {
+namespace script {
+
+// Virtual interface implemented by each concrete TaggerImpl<Arc>.
+class TaggerImplBase {
+ public:
+  virtual bool Error() const = 0;
+  virtual bool Tag(absl::string_view input, std::string *output) const = 0;
+  virtual bool TagIncremental(absl::string_view chunk, bool final,
+                              std::string *pending,
+                              std::string *output) const = 0;
+  virtual ~TaggerImplBase() {}
+};
+
+// Templated implementation.
+template <class Arc>
+class TaggerImpl : public TaggerImplBase {
+ public:
+  TaggerImpl(const Fst<Arc> &matcher, const Fst<Arc> &sigma_star,
+             const std::string &ltag, const std::string &rtag,
+             TokenType token_type)
+      : impl_(matcher, sigma_star, ltag, rtag, token_type) {}
+
+  bool Error() const override { return impl_.Error(); }
+
+  bool Tag(absl::string_view input, std::string *output) const override {
+    return impl_.Tag(input, output);
+  }
+
+  bool TagIncremental(absl::string_view chunk, bool final,
+                      std::string *pending,
+                      std::string *output) const override {
+    return impl_.TagIncremental(chunk, final, pending, output);
+  }
+
+ private:
+  Tagger<Arc> impl_;
+};
+
+class TaggerClass;
+
+using InitTaggerClassArgs =
+    std::tuple<const FstClass &, const FstClass &, const std::string &,
+               const std::string &, TokenType, TaggerClass *>;
+
+// Untemplated user-facing class holding templated pimpl.
+class TaggerClass {
+ public:
+  TaggerClass(const FstClass &matcher, const FstClass &sigma_star,
+              const std::string &ltag, const std::string &rtag,
+              TokenType token_type = TokenType::BYTE);
+
+  const std::string &ArcType() const { return arc_type_; }
+
+  bool Error() const { return !impl_ || impl_->Error(); }
+
+  bool Tag(absl::string_view input, std::string *output) const {
+    return impl_ && impl_->Tag(input, output);
+  }
+
+  bool TagIncremental(absl::string_view chunk, bool final,
+                      std::string *pending, std::string *output) const {
+    return impl_ && impl_->TagIncremental(chunk, final, pending, output);
+  }
+
+  template <class Arc>
+  friend void InitTaggerClass(InitTaggerClassArgs *args);
+
+ private:
+  std::string arc_type_;
+  std::unique_ptr<TaggerImplBase> impl_;
+};
+
+template <class Arc>
+void InitTaggerClass(InitTaggerClassArgs *args) {
+  const Fst<Arc> &matcher = *(std::get<0>(*args).GetFst<Arc>());
+  const Fst<Arc> &sigma_star = *(std::get<1>(*args).GetFst<Arc>());
+  std::get<5>(*args)->impl_ = std::make_unique<TaggerImpl<Arc>>(
+      matcher, sigma_star, std::get<2>(*args), std::get<3>(*args),
+      std::get<4>(*args));
+}
+
+}  // namespace script
+}  // namespace fst
+
+#endif  // PYNINI_TAGGERSCRIPT_H_
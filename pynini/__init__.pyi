@@ -62,7 +62,7 @@ CDRewriteDirection = Literal["ltr", "rtl", "sim"]
 CDRewriteMode = Literal["obl", "opt"]
 FarFileMode = Literal["r", "w"]
 
-FstLike = Union[Fst, str]
+FstLike = Union[Fst, _Fst, str]
 TokenType = Union[SymbolTableView, _TokenTypeFlag]
 
 # Helper functions.
@@ -72,6 +72,47 @@ class _ContextDecoratorNone(ContextManager[None]):
   def __call__(self, func: _GenericCallable) -> _GenericCallable: ...
 
 def default_token_type(token_type: TokenType) -> _ContextDecoratorNone: ...
+def get_default_token_type() -> TokenType: ...
+
+class OptimizeStats:
+  @property
+  def acceptor(self) -> bool: ...
+  @property
+  def determinized(self) -> bool: ...
+  @property
+  def encode_flags(self) -> int: ...
+  @property
+  def limit_exceeded(self) -> bool: ...
+  @property
+  def phases(self) -> List[Tuple[str, float, int, int, int, int]]: ...
+
+class RewriteStats:
+  @property
+  def lattice_states(self) -> int: ...
+  @property
+  def lattice_arcs(self) -> int: ...
+  @property
+  def paths(self) -> int: ...
+  @property
+  def compose_seconds(self) -> float: ...
+  @property
+  def dfa_seconds(self) -> float: ...
+  @property
+  def shortest_path_seconds(self) -> float: ...
+  @property
+  def print_seconds(self) -> float: ...
+
+class MemoryStats:
+  @property
+  def states(self) -> int: ...
+  @property
+  def arcs(self) -> int: ...
+  @property
+  def symbols(self) -> int: ...
+  @property
+  def caches(self) -> int: ...
+  @property
+  def total(self) -> int: ...
 
 T = TypeVar("T", bound="Fst")
 class Fst(_VectorFst):
@@ -87,7 +128,12 @@ class Fst(_VectorFst):
             input_token_type: Optional[TokenType] = ...,
             output_token_type: Optional[TokenType] = ...
   ) -> _StringPathIterator: ...
+  def shortest_strings(
+      self,
+      token_type: Optional[TokenType] = ...) -> _ShortestStringIterator: ...
   def string(self, token_type: Optional[TokenType] = ...) -> str: ...
+  def freeze(self) -> FrozenFst: ...
+  def memory_usage(self) -> MemoryStats: ...
   # The following all override their definition in MutableFst.
   def copy(self: T) -> T: ...
   def closure(self: T, lower: int = ..., upper: int = ...) -> T: ...
@@ -98,7 +144,13 @@ class Fst(_VectorFst):
   @property
   def star(self) -> Fst: ...
   def concat(self: T, fst2: FstLike) -> T: ...
-  def optimize(self: T, compute_props: bool = ...) -> T: ...
+  def optimize(self: T,
+               compute_props: bool = ...,
+               stats: Optional[OptimizeStats] = ...,
+               max_determinized_states: int = ...,
+               max_determinized_bytes: int = ...) -> T: ...
+  @property
+  def optimize_limit_exceeded(self) -> bool: ...
   def union(self: T, *fsts2: FstLike) -> T: ...
   # Operator overloads.
   def __eq__(self, other: FstLike) -> bool: ...
@@ -117,6 +169,21 @@ class Fst(_VectorFst):
   def __rmatmul__(self, other: FstLike) -> Fst: ...
   def __ror__(self, other: FstLike) -> Fst: ...
 
+class _FstImage: ...
+
+class FrozenFst(_Fst):
+  def __repr__(self) -> str: ...
+  @classmethod
+  def from_buffer(cls, buffer: Any) -> FrozenFst: ...
+  def to_buffer(self) -> _FstImage: ...
+  def memory_usage(self) -> MemoryStats: ...
+  def paths(self,
+            input_token_type: Optional[TokenType] = ...,
+            output_token_type: Optional[TokenType] = ...
+  ) -> _StringPathIterator: ...
+  def string(self, token_type: Optional[TokenType] = ...) -> str: ...
+  def __reduce_ex__(self, protocol: int) -> Tuple[Any, ...]: ...
+
 # Utility functions
 def escape(string: str) -> str: ...
 
@@ -129,6 +196,7 @@ def accep(astring: str,
 def cross(fst1: FstLike,
           fst2: FstLike,
           weight: Optional[WeightLike] = ...) -> Fst: ...
+def lazy_cross(fst1: FstLike, fst2: FstLike) -> _Fst: ...
 def cdrewrite(
     tau: FstLike,
     l: FstLike,
@@ -137,6 +205,30 @@ def cdrewrite(
     direction: CDRewriteDirection = ...,
     mode: CDRewriteMode = ...
 ) -> Fst: ...
+def cdrewrite_many(
+    rules: Iterable[Tuple[FstLike, FstLike, FstLike]],
+    sigma_star: FstLike,
+    direction: CDRewriteDirection = ...,
+    mode: CDRewriteMode = ...,
+    num_threads: int = ...
+) -> List[Fst]: ...
+def lazy_cdrewrite(
+    tau: FstLike,
+    l: FstLike,
+    r: FstLike,
+    sigma_star: FstLike,
+    direction: CDRewriteDirection = ...,
+    mode: CDRewriteMode = ...,
+    cache_gc_limit: int = ...
+) -> _Fst: ...
+def label_class_cdrewrite(
+    tau: FstLike,
+    l: FstLike,
+    r: FstLike,
+    sigma_star: FstLike,
+    direction: CDRewriteDirection = ...,
+    mode: CDRewriteMode = ...
+) -> _Fst: ...
 def leniently_compose(fst1: FstLike,
                       fst2: FstLike,
                       sigma: FstLike,
@@ -145,12 +237,58 @@ def leniently_compose(fst1: FstLike,
 def string_file(filename: _Filename,
                 arc_type: _ArcTypeFlag = ...,
                 input_token_type: Optional[TokenType] = ...,
-                output_token_type: Optional[TokenType] = ...) -> Fst: ...
+                output_token_type: Optional[TokenType] = ...,
+                minimize: bool = ...,
+                num_threads: int = ...) -> Fst: ...
 def string_map(lines: Iterable[Union[str, Iterable[str]]],
                arc_type: _ArcTypeFlag = ...,
                input_token_type: Optional[TokenType] = ...,
-               output_token_type: Optional[TokenType] = ...) -> Fst: ...
-def generated_symbols() -> SymbolTableView: ...
+               output_token_type: Optional[TokenType] = ...,
+               minimize: bool = ...,
+               num_threads: int = ...) -> Fst: ...
+def generated_symbols() -> SymbolTable: ...
+
+# Rewriting.
+
+def string_view_rewrite_lattice(
+    astring: str,
+    rule: FstLike,
+    token_type: Optional[TokenType] = ...) -> Fst: ...
+def string_view_top_rewrite(
+    astring: str,
+    rule: FstLike,
+    input_token_type: Optional[TokenType] = ...,
+    output_token_type: Optional[TokenType] = ...,
+    stats: Optional[RewriteStats] = ...) -> str: ...
+def matches(istring: FstLike,
+            ostring: FstLike,
+            rule: FstLike,
+            input_token_type: Optional[TokenType] = ...,
+            output_token_type: Optional[TokenType] = ...) -> bool: ...
+def batch_top_rewrite(strings: Iterable[str],
+                      rule: FstLike,
+                      input_token_type: Optional[TokenType] = ...,
+                      output_token_type: Optional[TokenType] = ...,
+                      num_threads: int = ...) -> List[str]: ...
+def batch_rewrites(strings: Iterable[str],
+                   rule: FstLike,
+                   input_token_type: Optional[TokenType] = ...,
+                   output_token_type: Optional[TokenType] = ...,
+                   num_threads: int = ...,
+                   state_multiplier: int = ...) -> List[List[str]]: ...
+def batch_optimal_rewrites(
+    strings: Iterable[str],
+    rule: FstLike,
+    input_token_type: Optional[TokenType] = ...,
+    output_token_type: Optional[TokenType] = ...,
+    num_threads: int = ...,
+    state_multiplier: int = ...) -> List[List[str]]: ...
+def batch_top_rewrites(strings: Iterable[str],
+                       rule: FstLike,
+                       nshortest: int,
+                       input_token_type: Optional[TokenType] = ...,
+                       output_token_type: Optional[TokenType] = ...,
+                       num_threads: int = ...) -> List[List[str]]: ...
 
 
 # # Decorator for one-argument constructive FST operations.
@@ -330,6 +468,119 @@ def mpdt_expand(fst: FstLike,
 def mpdt_reverse(fst: FstLike,
                  parens: MPdtParentheses) -> Tuple[Fst, MPdtParentheses]: ...
 
+class RuleCascadeEngine:
+  def __repr__(self) -> str: ...
+  def __init__(self,
+               rules: Iterable[Union[FstLike, _Fst]],
+               lazy: bool = ...,
+               lookahead: bool = ...,
+               cache_gc_limit: int = ...) -> None: ...
+  def arc_type(self) -> str: ...
+  def lazy(self) -> bool: ...
+  def lookahead(self) -> bool: ...
+  def memory_usage(self) -> MemoryStats: ...
+  def rewrite_lattice(self,
+                      astring: FstLike,
+                      token_type: Optional[TokenType] = ...) -> Fst: ...
+  def matches(self,
+              istring: FstLike,
+              ostring: FstLike,
+              input_token_type: Optional[TokenType] = ...,
+              output_token_type: Optional[TokenType] = ...) -> bool: ...
+  def rewrites(self,
+               astring: FstLike,
+               input_token_type: Optional[TokenType] = ...,
+               output_token_type: Optional[TokenType] = ...,
+               state_multiplier: int = ...) -> List[str]: ...
+  def top_rewrites(self,
+                   astring: FstLike,
+                   nshortest: int,
+                   input_token_type: Optional[TokenType] = ...,
+                   output_token_type: Optional[TokenType] = ...) -> List[str]: ...
+  def top_rewrite(self,
+                  astring: FstLike,
+                  input_token_type: Optional[TokenType] = ...,
+                  output_token_type: Optional[TokenType] = ...) -> str: ...
+  def optimal_rewrites(self,
+                       astring: FstLike,
+                       input_token_type: Optional[TokenType] = ...,
+                       output_token_type: Optional[TokenType] = ...,
+                       state_multiplier: int = ...) -> List[str]: ...
+
+class LenientComposer:
+  def __repr__(self) -> str: ...
+  def __init__(self,
+               nu: FstLike,
+               sigma_star: FstLike,
+               compose_filter: ComposeFilter = ...,
+               connect: bool = ...) -> None: ...
+  def arc_type(self) -> str: ...
+  def __call__(self,
+               mu: Union[FstLike, _Fst],
+               lazy: bool = ...) -> Union[Fst, _Fst]: ...
+
+class LevenshteinAutomatonEngine:
+  def __repr__(self) -> str: ...
+  def __init__(self,
+               lexicon: FstLike,
+               sigma: FstLike,
+               insert_cost: float = ...,
+               delete_cost: float = ...,
+               substitute_cost: float = ...,
+               bound: int = ...) -> None: ...
+  def arc_type(self) -> str: ...
+  def closest_matches(
+      self,
+      query: FstLike,
+      nshortest: int = ...,
+      optimal_only: bool = ...,
+      input_token_type: Optional[TokenType] = ...,
+      output_token_type: Optional[TokenType] = ...) -> List[Tuple[str, float]]: ...
+
+class TaggerEngine:
+  def __repr__(self) -> str: ...
+  def __init__(self,
+               matcher: FstLike,
+               sigma_star: FstLike,
+               ltag: str,
+               rtag: str,
+               token_type: Optional[TokenType] = ...) -> None: ...
+  def arc_type(self) -> str: ...
+  def tag(self, text: str) -> str: ...
+  def tag_stream(self, chunks: Iterable[str]) -> Iterator[str]: ...
+
+def fingerprint(fst: Union[FstLike, _Fst]) -> int: ...
+
+def memory_usage(fst: Union[FstLike, _Fst]) -> MemoryStats: ...
+
+class RewriteCache:
+  def __repr__(self) -> str: ...
+  def __init__(self, max_bytes: int = ..., num_shards: int = ...) -> None: ...
+  def __len__(self) -> int: ...
+  def lookup(
+      self,
+      rule: int,
+      query: str,
+      astring: str,
+      nshortest: int = ...,
+      input_token_type: Optional[TokenType] = ...,
+      output_token_type: Optional[TokenType] = ...) -> Optional[List[str]]: ...
+  def insert(self,
+             rule: int,
+             query: str,
+             astring: str,
+             outputs: Iterable[str],
+             nshortest: int = ...,
+             input_token_type: Optional[TokenType] = ...,
+             output_token_type: Optional[TokenType] = ...) -> None: ...
+  def clear(self) -> None: ...
+  def max_bytes(self) -> int: ...
+  def num_bytes(self) -> int: ...
+  def memory_usage(self) -> MemoryStats: ...
+  def hits(self) -> int: ...
+  def misses(self) -> int: ...
+  def evictions(self) -> int: ...
+
 class _StringPathIterator:
   def __repr__(self) -> str: ...
   def __init__(self,
@@ -338,6 +589,8 @@ class _StringPathIterator:
                output_token_type: Optional[TokenType] = ...) -> None: ...
   def done(self) -> bool: ...
   def error(self) -> bool: ...
+  def extract_all(self,
+                  limit: int = ...) -> List[Tuple[str, str, Weight]]: ...
   def ilabels(self) -> List[_Label]: ...
   def olabels(self) -> List[_Label]: ...
   def istring(self) -> str: ...
@@ -350,12 +603,21 @@ class _StringPathIterator:
   def weight(self) -> Weight: ...
   def weights(self) -> Iterator[Weight]: ...
 
+class _ShortestStringIterator:
+  def __repr__(self) -> str: ...
+  def __init__(self,
+               fst: FstLike,
+               token_type: Optional[TokenType] = ...) -> None: ...
+  def __iter__(self) -> _ShortestStringIterator: ...
+  def __next__(self) -> Tuple[str, Weight]: ...
+
 class Far:
   def __init__(self,
                filename: _Filename,
                mode: FarFileMode = ...,
                arc_type: _ArcTypeFlag = ...,
-               far_type: FarType = ...) -> None: ...
+               far_type: FarType = ...,
+               memory_map: bool = ...) -> None: ...
   def error(self) -> bool: ...
   # TODO(wolfsonkin): Maybe just return string.
   def arc_type(self) -> _ArcTypeFlag: ...
@@ -365,16 +627,16 @@ class Far:
   def name(self) -> str: ...
   def done(self) -> bool: ...
   def find(self, key: str) -> bool: ...
-  def get_fst(self) -> Fst: ...
+  def get_fst(self) -> _Fst: ...
   def get_key(self) -> str: ...
   def next(self) -> None: ...
   def reset(self) -> None: ...
-  def __getitem__(self, key: str) -> Fst: ...
-  def __next__(self) -> Tuple[str, Fst]: ...
+  def __getitem__(self, key: str) -> _Fst: ...
+  def __next__(self) -> Tuple[str, _Fst]: ...
   def __iter__(self) -> Far: ...
-  def add(self, key: str, fst: Fst) -> None: ...
+  def add(self, key: str, fst: _Fst) -> None: ...
   # TODO(wolfsonkin): Make this support FstLike.
-  def __setitem__(self, key: str, fst: Fst) -> None: ...
+  def __setitem__(self, key: str, fst: _Fst) -> None: ...
   def close(self) -> None: ...
   # Adds support for use as a PEP-343 context manager.
   def __enter__(self) -> Far: ...
@@ -482,7 +744,10 @@ from _pywrapfst import ENCODE_WEIGHTS
 # `s/self: T/fst: FstLike/` and `s/-> T/-> Fst/`.
 
 def arcsort(fst: FstLike, sort_type: SortType = ...) -> Fst: ...
-def closure(fst: FstLike, lower: int = ..., upper: int = ...) -> Fst: ...
+def closure(fst: FstLike,
+            lower: int = ...,
+            upper: int = ...,
+            lazy: bool = ...) -> Union[Fst, _Fst]: ...
 def connect(fst: FstLike) -> Fst: ...
 def decode(fst: FstLike, mapper: EncodeMapper) -> Fst: ...
 def encode(fst: FstLike, mapper: EncodeMapper) -> Fst: ...
@@ -490,7 +755,11 @@ def invert(fst: FstLike) -> Fst: ...
 def minimize(fst: FstLike,
              delta: float = ...,
              allow_nondet: bool = ...) -> Fst: ...
-def optimize(fst: FstLike, compute_props: bool = ...) -> Fst: ...
+def optimize(fst: FstLike,
+             compute_props: bool = ...,
+             stats: Optional[OptimizeStats] = ...,
+             max_determinized_states: int = ...,
+             max_determinized_bytes: int = ...) -> Fst: ...
 def project(fst: FstLike, project_type: ProjectType) -> Fst: ...
 def relabel_pairs(
     fst: FstLike,
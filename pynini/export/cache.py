@@ -0,0 +1,267 @@
+# Copyright 2016-2020 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+"""Content-addressed cache of compiled FSTs for grammar exports.
+
+A build cache stores the results of expensive FST constructions on disk, keyed
+by a hash of everything the result depends on: the function computing it,
+including its code if it is written in Python, the serialized form of every
+argument FST, the contents of every input file, the other parameters, and the
+Pynini version. A later build with the same inputs reads the stored result
+rather than recomputing it, so editing one lexicon only rebuilds the rules which
+depend on it. For example:
+
+  build_cache = cache.BuildCache('/tmp/grm_cache')
+  lexicon = build_cache.string_file('lexicon.tsv')
+  rule = build_cache.cdrewrite(lexicon, '', '', sigma_star)
+
+Token types left unspecified (i.e., None) are resolved using the defaults in
+force when the function is called, which are not part of the key; grammars
+which change the default token type should pass token types explicitly to
+cached functions. Cached functions must otherwise depend only on their
+arguments; in particular, only their own code is hashed, and not that of the
+functions they call, which must not change between builds using the same
+cache. A build cache without a directory computes every result directly.
+"""
+
+import hashlib
+import os
+import tempfile
+import types
+from typing import Any, Callable, Iterable, Optional, Union
+
+import logging
+
+import pynini
+import pywrapfst
+
+_Filename = Union[str, os.PathLike]
+
+
+def _update(hasher: Any, value: Any) -> None:
+  """Updates a hash with a fingerprint of an argument.
+
+  Args:
+    hasher: A hashlib hash object.
+    value: An FST, symbol table, string, number, or a container of these.
+
+  Raises:
+    TypeError: Cannot fingerprint argument.
+  """
+  # Each value is tagged with its type and length, so that distinct argument
+  # lists never produce the same byte sequence.
+  def tagged(tag: bytes, data: bytes) -> None:
+    hasher.update(tag)
+    hasher.update(len(data).to_bytes(8, 'little'))
+    hasher.update(data)
+
+  if isinstance(value, pywrapfst.Fst):
+    tagged(b'F', value.write_to_string())
+  elif isinstance(value, pywrapfst.SymbolTableView):
+    tagged(b'Y', value.labeled_checksum())
+  elif isinstance(value, str):
+    tagged(b'S', value.encode('utf8'))
+  elif isinstance(value, bytes):
+    tagged(b'B', value)
+  elif value is None or isinstance(value, (bool, int, float)):
+    tagged(b'N', repr(value).encode('utf8'))
+  elif isinstance(value, (list, tuple)):
+    tagged(b'L', len(value).to_bytes(8, 'little'))
+    for item in value:
+      _update(hasher, item)
+  elif isinstance(value, dict):
+    tagged(b'D', len(value).to_bytes(8, 'little'))
+    for key in sorted(value):
+      _update(hasher, key)
+      _update(hasher, value[key])
+  else:
+    raise TypeError(f'Cannot fingerprint argument of type {type(value)}')
+
+
+def _update_code(hasher: Any, code: types.CodeType) -> None:
+  """Updates a hash with a fingerprint of the code of a function.
+
+  This covers its bytecode, the names and constants it uses, and, recursively,
+  the code of the functions and classes defined within it.
+
+  Args:
+    hasher: A hashlib hash object.
+    code: A code object.
+  """
+  _update(hasher, code.co_code)
+  _update(hasher, list(code.co_names))
+  for const in code.co_consts:
+    if isinstance(const, types.CodeType):
+      _update_code(hasher, const)
+    elif isinstance(const, frozenset):
+      # The iteration order of a set of strings varies between processes.
+      _update(hasher, sorted(repr(item) for item in const))
+    else:
+      _update(hasher, f'{type(const).__name__}:{const!r}')
+
+
+def _optimize(fst: pynini.FstLike, compute_props: bool) -> pynini.Fst:
+  """Returns an optimized copy of the FST."""
+  if isinstance(fst, pynini.Fst):
+    fst = fst.copy()
+  elif isinstance(fst, pywrapfst.Fst):
+    fst = pynini.Fst.from_pywrapfst(fst)
+  else:
+    fst = pynini.accep(fst)
+  return fst.optimize(compute_props)
+
+
+class BuildCache:
+  """On-disk cache of compiled FSTs, keyed by the hash of their inputs."""
+
+  def __init__(self, directory: Optional[_Filename] = None) -> None:
+    """Creates a build cache.
+
+    Args:
+      directory: The directory in which results are stored, which is created if
+        necessary; if None, the cache is disabled.
+    """
+    self._directory = None if directory is None else os.fspath(directory)
+    if self._directory is not None:
+      os.makedirs(self._directory, exist_ok=True)
+      logging.info('Using build cache in \'%s\'.', self._directory)
+    self.hits = 0
+    self.misses = 0
+
+  @property
+  def enabled(self) -> bool:
+    return self._directory is not None
+
+  def key(self,
+          function: Callable[..., Any],
+          *args,
+          files: Iterable[_Filename] = (),
+          **kwargs) -> str:
+    """Computes the key for a function call.
+
+    Args:
+      function: The function called; it is identified by its module and
+        qualified name and, if it is written in Python, its code.
+      *args: Positional arguments.
+      files: Paths to files read by the function, whose contents are hashed.
+      **kwargs: Keyword arguments.
+
+    Returns:
+      A hexadecimal digest.
+
+    Raises:
+      TypeError: Cannot fingerprint argument.
+    """
+    hasher = hashlib.sha256()
+    _update(hasher, pynini.__version__)
+    _update(hasher, f'{function.__module__}.{function.__qualname__}')
+    # Functions implemented in C (e.g., those of Pynini itself) have no code
+    # object, and are fixed by the Pynini version.
+    code = getattr(function, '__code__', None)
+    if code is not None:
+      _update_code(hasher, code)
+    _update(hasher, list(args))
+    _update(hasher, kwargs)
+    for filename in files:
+      with open(filename, 'rb') as source:
+        _update(hasher, source.read())
+    return hasher.hexdigest()
+
+  def _path(self, key: str) -> str:
+    return os.path.join(self._directory, f'{key}.fst')
+
+  def get(self, key: str) -> Optional[pynini.Fst]:
+    """Returns the stored result for a key, or None if there is none."""
+    if not self.enabled:
+      return None
+    path = self._path(key)
+    if not os.path.exists(path):
+      return None
+    try:
+      return pynini.Fst.read(path)
+    except pynini.FstIOError:
+      logging.warning('Ignoring unreadable build cache entry \'%s\'.', path)
+      return None
+
+  def put(self, key: str, fst: pynini.Fst) -> None:
+    """Stores the result for a key."""
+    if not self.enabled:
+      return
+    # Writes to a temporary file first, so that concurrent builds never read a
+    # partially written entry.
+    (fd, temp_path) = tempfile.mkstemp(dir=self._directory, suffix='.tmp')
+    os.close(fd)
+    try:
+      fst.write(temp_path)
+      os.replace(temp_path, self._path(key))
+    except:
+      os.remove(temp_path)
+      raise
+
+  def call(self,
+           function: Callable[..., pynini.Fst],
+           *args,
+           files: Iterable[_Filename] = (),
+           **kwargs) -> pynini.Fst:
+    """Calls a function, or reuses the stored result of an identical call.
+
+    Args:
+      function: A function returning an FST, which depends only on its
+        arguments and on the contents of the files.
+      *args: Positional arguments.
+      files: Paths to files read by the function.
+      **kwargs: Keyword arguments.
+
+    Returns:
+      The FST returned by the function.
+
+    Raises:
+      TypeError: Cannot fingerprint argument.
+    """
+    if not self.enabled:
+      return function(*args, **kwargs)
+    files = list(files)
+    key = self.key(function, *args, files=files, **kwargs)
+    fst = self.get(key)
+    if fst is not None:
+      self.hits += 1
+      logging.info('Reusing cached result of %s.', function.__qualname__)
+      return fst
+    self.misses += 1
+    fst = function(*args, **kwargs)
+    self.put(key, fst)
+    return fst
+
+  # Cached versions of common compilation steps.
+
+  def cdrewrite(self,
+                tau: pynini.FstLike,
+                l: pynini.FstLike,
+                r: pynini.FstLike,
+                sigma_star: pynini.FstLike,
+                direction: pynini.CDRewriteDirection = 'ltr',
+                mode: pynini.CDRewriteMode = 'obl') -> pynini.Fst:
+    """Cached `pynini.cdrewrite`."""
+    return self.call(pynini.cdrewrite, tau, l, r, sigma_star, direction, mode)
+
+  def string_file(self, filename: _Filename, **kwargs) -> pynini.Fst:
+    """Cached `pynini.string_file`, keyed by the contents of the file."""
+    return self.call(
+        pynini.string_file, os.fspath(filename), files=[filename], **kwargs)
+
+  def optimize(self,
+               fst: pynini.FstLike,
+               compute_props: bool = False) -> pynini.Fst:
+    """Returns an optimized copy of the FST, as computed by `Fst.optimize`."""
+    return self.call(_optimize, fst, compute_props)
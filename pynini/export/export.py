@@ -15,16 +15,24 @@
 
 """Helper classes for generating FAR files with Pynini."""
 
+from concurrent import futures
 import os
-from typing import Union
+import time
+from typing import Callable, Dict, Mapping, Optional, Tuple, Union
 
 import logging
 
 import pynini
+from pynini.export import cache
 
 _Filename = Union[str, os.PathLike]
 
 
+def get_max_workers(num_threads: int) -> int:
+  """Returns the thread count, or the number of CPUs if it is not positive."""
+  return num_threads if num_threads > 0 else (os.cpu_count() or 1)
+
+
 class Exporter:
   """Helper class to collect and export FSTs into an FAR archive file.
 
@@ -42,7 +50,9 @@ class Exporter:
   def __init__(self,
                filename: _Filename,
                arc_type: str = 'standard',
-               far_type: pynini.FarType = 'default') -> None:
+               far_type: pynini.FarType = 'default',
+               memory_map: bool = False,
+               cache_dir: Optional[_Filename] = None) -> None:
     """Creates an exporter that writes a FAR archive file upon destruction.
 
     Args:
@@ -50,12 +60,19 @@ class Exporter:
       arc_type: A string with the arc type ("standard", "log", "log64").
       far_type: A string with the file type
                 ("default", "sstable", "sttable", "stlist").
+      memory_map: If true, the FSTs are written as input-arc-sorted, aligned
+                  ConstFsts, which readers can memory-map (see `pynini.Far`).
+      cache_dir: An optional directory in which compiled FSTs are cached across
+                 builds (see `cache.BuildCache`); the cache is available to
+                 generators as the `cache` attribute.
     """
     logging.info('Setting up exporter for \'%s\'.', filename)
     self._fsts = {}
     self._filename = os.fspath(filename)
     self._arc_type = arc_type
     self._far_type = far_type
+    self._memory_map = memory_map
+    self.cache = cache.BuildCache(cache_dir)
     self._is_open = True
 
   def __setitem__(self, name: str, fst: pynini.Fst) -> None:
@@ -69,10 +86,111 @@ class Exporter:
     logging.info('Adding FST \'%s\' to archive \'%s\'.', name, self._filename)
     self._fsts[name] = fst
 
+  def export_cdrewrites(
+      self,
+      rules: Mapping[str, Tuple[pynini.FstLike, pynini.FstLike,
+                                pynini.FstLike]],
+      sigma_star: pynini.FstLike,
+      direction: pynini.CDRewriteDirection = 'ltr',
+      mode: pynini.CDRewriteMode = 'obl',
+      num_threads: int = 0) -> Dict[str, pynini.Fst]:
+    """Compiles and registers independent context-dependent rewrite rules.
+
+    The rules share the same alphabet, and are compiled concurrently (see
+    `pynini.cdrewrite_many`), which is much faster than compiling them one after
+    another when a grammar defines many rules.
+
+    Args:
+      rules: A mapping from names to (tau, l, r) triples, as passed to
+        `pynini.cdrewrite`.
+      sigma_star: A cyclic, unweighted acceptor representing the closure over
+        the alphabet.
+      direction: A string specifying the direction of rule application.
+      mode: A string specifying the mode of rule application.
+      num_threads: The maximum number of threads to use; if not positive, the
+        hardware concurrency is used.
+
+    Rules found in the build cache are not recompiled.
+
+    Returns:
+      A dictionary mapping the names to the compiled rules, which can then be
+      combined further.
+    """
+    compiled = {}
+    keys = {}
+    for name, (tau, l, r) in rules.items():
+      # Uses the same key as `cache.BuildCache.cdrewrite`.
+      if self.cache.enabled:
+        keys[name] = self.cache.key(pynini.cdrewrite, tau, l, r, sigma_star,
+                                    direction, mode)
+        fst = self.cache.get(keys[name])
+        if fst is not None:
+          compiled[name] = fst
+    names = [name for name in rules if name not in compiled]
+    logging.info('Compiling %d rules for archive \'%s\' (%d cached).',
+                 len(names), self._filename, len(compiled))
+    fsts = pynini.cdrewrite_many([rules[name] for name in names], sigma_star,
+                                 direction, mode, num_threads)
+    for name, fst in zip(names, fsts):
+      if self.cache.enabled:
+        self.cache.put(keys[name], fst)
+      compiled[name] = fst
+    compiled = {name: compiled[name] for name in rules}
+    for name, fst in compiled.items():
+      self[name] = fst
+    return compiled
+
+  def export_builders(self,
+                      builders: Mapping[str, Callable[[], pynini.Fst]],
+                      num_threads: int = 0) -> Dict[str, pynini.Fst]:
+    """Builds and registers independent FSTs concurrently.
+
+    Each builder is a function of no arguments which returns the FST to be
+    registered under its name. The builders are run in a pool of threads; since
+    Pynini releases the GIL during FST operations, builders which spend most of
+    their time in such operations (e.g., optimization, composition, or rule
+    compilation) run in parallel. Each builder runs with the caller's default
+    token type (see `pynini.default_token_type`). The time taken by each
+    builder is logged.
+
+    Args:
+      builders: A mapping from names to functions returning FSTs; these must
+        not depend on each other.
+      num_threads: The maximum number of threads to use; if not positive, the
+        number of CPUs is used.
+
+    Returns:
+      A dictionary mapping the names to the built FSTs, which can then be
+      combined further.
+    """
+
+    # Defaults are per-thread, so the caller's are reapplied in each worker.
+    token_type = pynini.get_default_token_type()
+
+    def build(name: str) -> pynini.Fst:
+      start = time.perf_counter()
+      with pynini.default_token_type(token_type):
+        fst = builders[name]()
+      logging.info('Built FST \'%s\' for archive \'%s\' in %.3f s.', name,
+                   self._filename,
+                   time.perf_counter() - start)
+      return fst
+
+    names = list(builders)
+    logging.info('Building %d FSTs for archive \'%s\'.', len(names),
+                 self._filename)
+    with futures.ThreadPoolExecutor(
+        max_workers=get_max_workers(num_threads)) as executor:
+      built = dict(zip(names, executor.map(build, names)))
+    for name, fst in built.items():
+      self[name] = fst
+    return built
+
   def close(self) -> None:
     """Writes the registered FSTs into the given file and closes it."""
     assert self._is_open
     logging.info('Writing FSTs into \'%s\'.', self._filename)
+    archive_start = time.perf_counter()
     # TODO(b/123775699): Currently pytype is unable to resolve
     # the usage of typing.Literal for pynini.Far.__init__'s far_type, producing
     # the error:
@@ -83,11 +201,19 @@ class Exporter:
     # Once typing.Literal support no longer makes this error, drop
     # the below pytype disable comment.
     with pynini.Far(
-        self._filename, 'w', arc_type=self._arc_type,
-        far_type=self._far_type) as sink:  # pytype: disable=wrong-arg-types
+        self._filename,
+        'w',
+        arc_type=self._arc_type,
+        far_type=self._far_type,
+        memory_map=self._memory_map) as sink:  # pytype: disable=wrong-arg-types
       for name in sorted(self._fsts):
         logging.info('Writing FST \'%s\' into \'%s\'.', name, self._filename)
+        start = time.perf_counter()
         sink[name] = self._fsts[name]
-    logging.info('Writing FSTs into \'%s\' done.', self._filename)
+        logging.info('Wrote FST \'%s\' into \'%s\' in %.3f s.', name,
+                     self._filename,
+                     time.perf_counter() - start)
+    logging.info('Writing FSTs into \'%s\' done in %.3f s.', self._filename,
+                 time.perf_counter() - archive_start)
     self._is_open = False
 
@@ -33,6 +33,11 @@ corresponding name. The generator_main function must be referenced with
 
 and should be used in a compile_grm_py BUILD rule to build the FAR.
 
+Expensive compilation steps can be reused across builds by calling them through
+the exporter's build cache (see cache.py) and passing --cache_dir, e.g.:
+
+  lexicon = exporter.cache.string_file('lexicon.tsv')
+
 For an example, see grm_example.py.
 """
 
@@ -44,6 +49,12 @@ from absl import flags
 from pynini.export import export
 
 flags.DEFINE_string('output', None, 'The output FAR file.')
+flags.DEFINE_bool(
+    'memory_map', False,
+    'Write the FSTs as arc-sorted ConstFsts, which can be memory-mapped.')
+flags.DEFINE_string(
+    'cache_dir', None,
+    'An optional directory in which compiled FSTs are cached across builds.')
 FLAGS = flags.FLAGS
 
 # Expose this definition as `grm.Exporter`.
@@ -65,7 +76,10 @@ def run(generator_main: Callable[[export.Exporter], None]) -> None:
       if unused_argv:
         raise app.UsageError(
             f'Unexpected command line arguments: {unused_argv}')
-      exporter = export.Exporter(FLAGS.output)
+      exporter = export.Exporter(
+          FLAGS.output,
+          memory_map=FLAGS.memory_map,
+          cache_dir=FLAGS.cache_dir)
       generator_main(exporter)
       exporter.close()
     except:
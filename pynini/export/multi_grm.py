@@ -28,7 +28,13 @@ which can contain lines of the form
   my_exporter[fst_name] = fst
 
 to export a given FST under a corresponding name into the file identified by the
-given designator. The generator main function should be have a:
+given designator. Independent FSTs may instead be built concurrently with
+
+  my_exporter.export_builders({fst_name: builder, ...})
+
+where each builder is a function of no arguments returning an FST. Each FAR has
+its own writer, and the FARs are written concurrently (see --num_threads). The
+generator main function should be have a:
 
   if __name__ == '__main__':
     multi_grm.run(generator_main)
@@ -36,6 +42,7 @@ given designator. The generator main function should be have a:
 For an example, see multi_grm_example.py.
 """
 
+from concurrent import futures
 from typing import Callable, Mapping
 
 from absl import app
@@ -48,6 +55,16 @@ from pynini.export import export
 flags.DEFINE_string('outputs', None,
                     ('The output FAR files in the form '
                      'designator1=file1,designator2=file2,...'))
+flags.DEFINE_bool(
+    'memory_map', False,
+    'Write the FSTs as arc-sorted ConstFsts, which can be memory-mapped.')
+flags.DEFINE_string(
+    'cache_dir', None,
+    'An optional directory in which compiled FSTs are cached across builds.')
+flags.DEFINE_integer(
+    'num_threads', 0,
+    ('The maximum number of FARs to write concurrently; if not positive, the '
+     'number of CPUs is used.'))
 FLAGS = flags.FLAGS
 
 ExporterMapping = Mapping[str, export.Exporter]
@@ -97,12 +114,20 @@ def run(generator_main: Callable[[ExporterMapping], None]) -> None:
         raise app.UsageError(
             '--outputs must specify at least one name=file pair.')
       exporter_map = {
-          designator: export.Exporter(filename)
+          designator: export.Exporter(
+              filename,
+              memory_map=FLAGS.memory_map,
+              cache_dir=FLAGS.cache_dir)
           for designator, filename in target_file_pair.items()
       }
       generator_main(exporter_map)
-      for ex in exporter_map.values():
-        ex.close()
+      # Each target has its own FAR writer, so they are written concurrently.
+      with futures.ThreadPoolExecutor(
+          max_workers=export.get_max_workers(FLAGS.num_threads)) as executor:
+        for future in [
+            executor.submit(ex.close) for ex in exporter_map.values()
+        ]:
+          future.result()
     except:
       FLAGS.stderrthreshold = 'fatal'
       raise
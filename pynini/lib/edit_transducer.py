@@ -29,10 +29,12 @@ Here, we provide three concrete classes:
   Levenshtein distance from the lattice.
 * LevenshteinAutomaton: Uses the edit transducer and an
   input vocabulary to construct a right-factored lexicon from which one can
-  compute the closest matches.
+  compute the closest matches. String queries are matched natively, without
+  constructing the lattice.
 """
 
-from typing import Iterable, List
+import itertools
+from typing import Iterable, List, Optional
 
 import pynini
 from pynini.lib import pynutil
@@ -88,6 +90,7 @@ class EditTransducer:
     # Left factor; note that we divide the edit costs by two because they also
     # will be incurred when traversing the right factor.
     sigma = pynini.union(*alphabet).optimize()
+    self._sigma = sigma
     insert = pynutil.insert(f"[{self.INSERT}]", weight=insert_cost / 2)
     delete = pynini.cross(
         sigma, pynini.accep(f"[{self.DELETE}]", weight=delete_cost / 2))
@@ -186,6 +189,20 @@ class LevenshteinAutomaton(LevenshteinDistance):
     compiled_lexicon = pynini.union(*lexicon)
     self._l_o = self._e_o @ compiled_lexicon
     self._l_o.optimize(True)
+    # Native engine for string queries. Since each edit is split between the
+    # two factors, the lattice charges (insert_cost + delete_cost) / 2 for both
+    # insertions and deletions, and the engine is set up to match. The engine
+    # needs positive costs and a single-symbol alphabet; otherwise, only the
+    # lattice is used.
+    indel_cost = (insert_cost + delete_cost) / 2
+    self._engine: Optional[pynini.LevenshteinAutomatonEngine] = None
+    if indel_cost > 0 and substitute_cost > 0:
+      try:
+        self._engine = pynini.LevenshteinAutomatonEngine(
+            compiled_lexicon, self._sigma, indel_cost, indel_cost,
+            substitute_cost, bound)
+      except pynini.FstOpError:
+        pass
 
   def _create_levenshtein_automaton_lattice(
       self, query: pynini.FstLike) -> pynini.Fst:
@@ -216,7 +233,12 @@ class LevenshteinAutomaton(LevenshteinDistance):
 
     Returns:
       The closest string in the lexicon.
+
+    Raises:
+      Error: No string in the lexicon is close enough to the query.
     """
+    if self._engine is not None and isinstance(query, str):
+      return self._native_closest_matches(query, 1, False)[0]
     lattice = self._create_levenshtein_automaton_lattice(query)
     return pynini.shortestpath(lattice).string()
 
@@ -234,9 +256,46 @@ class LevenshteinAutomaton(LevenshteinDistance):
 
     Returns:
       A list of the closest strings in the lexicon.
+
+    Raises:
+      Error: No string in the lexicon is close enough to the query.
     """
+    if self._engine is not None and isinstance(query, str):
+      return self._native_closest_matches(query, 0, True)
     lattice = self._create_levenshtein_automaton_lattice(query)
     lattice.project("output").rmepsilon()
     # Prunes all paths whose weights are worse than the best path.
     return list(pynini.determinize(lattice, weight=0).paths().ostrings())
 
+  def k_closest_matches(self, query: pynini.FstLike, k: int) -> List[str]:
+    """Returns the k closest strings to the query in the lexicon.
+
+    This method returns, for an input string or acceptor, up to k strings in
+    the lexicon, in order of increasing distance from the query according to
+    the underlying edit transducer. Ties are broken as in `closest_match`.
+
+    Args:
+      query: input string or acceptor.
+      k: the maximum number of strings to return.
+
+    Returns:
+      A list of the closest strings in the lexicon.
+
+    Raises:
+      Error: No string in the lexicon is close enough to the query.
+    """
+    if self._engine is not None and isinstance(query, str):
+      return self._native_closest_matches(query, k, False)
+    lattice = self._create_levenshtein_automaton_lattice(query)
+    lattice.project("output")
+    return [
+        match for (match, _) in itertools.islice(lattice.shortest_strings(), k)
+    ]
+
+  def _native_closest_matches(self, query: str, nshortest: int,
+                              optimal_only: bool) -> List[str]:
+    """Finds closest matches with the native engine."""
+    matches = self._engine.closest_matches(query, nshortest, optimal_only)
+    if not matches:
+      raise Error("Lattice is empty")
+    return [match for (match, _) in matches]
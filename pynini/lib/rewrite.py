@@ -35,6 +35,12 @@ There are five different end-user functions for rewriting:
 * `optimal_rewrites` returns a list of all rewrites whose weight is the same
   as the shortest-path rewrite.
 
+Each of `rewrites`, `top_rewrites`, `top_rewrite`, and `optimal_rewrites` also
+has a `batch_` variant which applies a rule to an iterable of input strings,
+distributing the work across multiple threads, and an awaitable variant, a
+method of `AsyncRewriter`, for use from asyncio coroutines; concurrent awaited
+rewrites are batched and handed to the `batch_` functions.
+
 The following helper functions are also exposed:
 
 * `rewrite_lattice` creates an epsilon-free lattice of output strings
@@ -42,16 +48,40 @@ The following helper functions are also exposed:
 * `lattice_to_dfa` converts that lattice to a DFA, pruning at semiring one
   if `optimal=True`.
 * `lattice_to_nshortest` creates a lattice of the n-shortest strings.
+* `lattice_to_shortest_strings` lazily generates the unique strings in a
+  lattice, best first.
 * `lattice_to_top_string` extracts a single string from a lattice; in case of
   ties, which string is returned is implementation-defined.
 * `lattice_to_one_top_string` extracts a single string from a pruned DFA,
   raising an error if there is more than one.
 * `lattice_to_strings` returns a list of all output strings in a lattice.
+
+Each of `rewrites`, `top_rewrites`, `top_rewrite`, `one_top_rewrite`, and
+`optimal_rewrites` also takes an optional `pynini.RewriteCache`. If one is
+given and the input is a string, the outputs are looked up in the cache, keyed
+on a fingerprint of the rule, and the rule is applied only if they are not
+found. Computing the fingerprint visits the whole rule, so it is not done on
+each call: the fingerprint (see `pynini.fingerprint`) must be computed once by
+the caller and passed along with the cache, unless the rule is frozen (see
+`pynini.Fst.freeze`), in which case it is computed on first use and kept while
+the rule lives.
+
+The same functions also take an optional `StatsSink`, which records the size
+of the composed lattice, the time spent in each phase, and the number of
+output strings enumerated for each call, and aggregates these per rule; this
+can be used to find pathological inputs and rules without a profiler.
 """
 
-from typing import List, Optional
+from typing import (Any, Callable, Dict, Hashable, Iterable, Iterator, List,
+                    NamedTuple, Optional, Tuple)
 
+import asyncio
+import heapq
+import itertools
 import logging
+import math
+import time
+import weakref
 
 import pynini
 
@@ -65,10 +95,61 @@ class Error(Exception):
 # Helper functions.
 
 
+# Fingerprints of frozen rules, which cannot change; entries are dropped along
+# with their rules.
+_frozen_fingerprints: "weakref.WeakKeyDictionary[pynini.FrozenFst, int]" = (
+    weakref.WeakKeyDictionary())
+
+
+def _fingerprint(rule: pynini.FstLike, fingerprint: Optional[int]) -> int:
+  """Returns the fingerprint of a rule, unless one is given.
+
+  That of a mutable rule is not computed, since doing so on each call would
+  visit the whole rule.
+
+  Raises:
+    Error: Mutable rule without a fingerprint.
+  """
+  if fingerprint is not None:
+    return fingerprint
+  if not isinstance(rule, pynini.FrozenFst):
+    raise Error("Caching requires a frozen rule or its fingerprint")
+  fingerprint = _frozen_fingerprints.get(rule)
+  if fingerprint is None:
+    fingerprint = pynini.fingerprint(rule)
+    _frozen_fingerprints[rule] = fingerprint
+  return fingerprint
+
+
+def _cached_rewrite(cache: pynini.RewriteCache, fingerprint: Optional[int],
+                    query: str, string: str, rule: pynini.Fst, nshortest: int,
+                    input_token_type: Optional[pynini.TokenType],
+                    output_token_type: Optional[pynini.TokenType],
+                    rewrite_fn: Callable[[], List[str]]) -> List[str]:
+  """Returns the outputs of a query, calling rewrite_fn only on a cache miss."""
+  fingerprint = _fingerprint(rule, fingerprint)
+  outputs = cache.lookup(fingerprint, query, string, nshortest,
+                         input_token_type, output_token_type)
+  if outputs is None:
+    outputs = rewrite_fn()
+    cache.insert(fingerprint, query, string, outputs, nshortest,
+                 input_token_type, output_token_type)
+  return outputs
+
+
+def _can_view(string: pynini.FstLike,
+               token_type: Optional[pynini.TokenType],
+               parse_brackets: bool) -> bool:
+  """Returns whether the input can be composed as an uncompiled string view."""
+  return (not parse_brackets and isinstance(string, str) and
+          not isinstance(token_type, pynini.SymbolTableView))
+
+
 def rewrite_lattice(
     string: pynini.FstLike,
     rule: pynini.Fst,
-    token_type: Optional[pynini.TokenType] = None) -> pynini.Fst:
+    token_type: Optional[pynini.TokenType] = None,
+    parse_brackets: bool = True) -> pynini.Fst:
   """Constructs a weighted lattice of output strings.
 
   Constructs a weighted, epsilon-free lattice of output strings given an
@@ -78,6 +159,10 @@ def rewrite_lattice(
     string: Input string or FST.
     rule: Input rule WFST.
     token_type: Optional input token type, or symbol table.
+    parse_brackets: If false, and the input is a string and the token type is
+      not a symbol table, bracketed spans are not treated as generated
+      symbols, and the rule is instead composed directly against a view of
+      the string, which avoids compiling it.
 
   Returns:
     An epsilon-free WFSA.
@@ -85,6 +170,11 @@ def rewrite_lattice(
   Raises:
     Error: Composition failure.
   """
+  if _can_view(string, token_type, parse_brackets):
+    try:
+      return pynini.string_view_rewrite_lattice(string, rule, token_type)
+    except pynini.FstOpError as error:
+      raise Error("Composition failure") from error
   # TODO(kbg): Consider adding support for PDT and MPDT composition.
   # TODO(kbg): Consider using `contextlib.nullcontext` here instead.
   if token_type is None:
@@ -99,12 +189,17 @@ def rewrite_lattice(
 
 def lattice_to_dfa(lattice: pynini.Fst,
                    optimal_only: bool,
-                   state_multiplier: int = 4) -> pynini.Fst:
+                   state_multiplier: int = 4,
+                   beam: Optional[pynini.WeightLike] = None) -> pynini.Fst:
   """Constructs a (possibly pruned) weighted DFA of output strings.
 
   Given an epsilon-free lattice of output strings (such as produced by
   rewrite_lattice), attempts to determinize it, pruning non-optimal paths if
-  optimal_only is true. This is valid only in a semiring with the path property.
+  optimal_only is true. If a beam is given, it is used instead, and paths are
+  pruned if their weight is worse than the best path's weight times the beam.
+  Pruning is performed during determinization, so the parts of the DFA which
+  lie outside the beam are never constructed. This is valid only in a semiring
+  with the path property.
 
   To prevent unexpected blowup during determinization, a state threshold is
   also used and a warning is logged if this exact threshold is reached. The
@@ -117,14 +212,19 @@ def lattice_to_dfa(lattice: pynini.Fst,
     optimal_only: Should we only preserve optimal paths?
     state_multiplier: Max ratio for the number of states in the DFA lattice to
       the NFA lattice; if exceeded, a warning is logged.
+    beam: Optional weight threshold, relative to the best path, overriding
+      optimal_only.
 
   Returns:
     Epsilon-free deterministic finite acceptor.
   """
   weight_type = lattice.weight_type()
-  weight_threshold = (
-      pynini.Weight.one(weight_type)
-      if optimal_only else pynini.Weight.zero(weight_type))
+  if beam is not None:
+    weight_threshold = beam
+  elif optimal_only:
+    weight_threshold = pynini.Weight.one(weight_type)
+  else:
+    weight_threshold = pynini.Weight.zero(weight_type)
   state_threshold = 256 + state_multiplier * lattice.num_states()
   lattice = pynini.determinize(
       lattice, nstate=state_threshold, weight=weight_threshold)
@@ -151,6 +251,27 @@ def lattice_to_nshortest(lattice: pynini.Fst, nshortest: int) -> pynini.Fst:
   return pynini.shortestpath(lattice, nshortest=nshortest, unique=True)
 
 
+def lattice_to_shortest_strings(
+    lattice: pynini.Fst,
+    token_type: Optional[pynini.TokenType] = None) -> Iterator[str]:
+  """Lazily generates the unique strings in the lattice, best first.
+
+  Given an epsilon-free lattice of output strings (such as produced by
+  rewrite_lattice), generates its unique strings in order of weight. Unlike
+  lattice_to_nshortest, no n-best lattice is constructed, and each string is
+  searched for only when requested. This is valid only in a path semiring.
+
+  Args:
+    lattice: Epsilon-free finite acceptor.
+    token_type: Optional output token type, or symbol table.
+
+  Yields:
+    Output strings, best first.
+  """
+  for ostring, _ in lattice.shortest_strings(token_type):
+    yield ostring
+
+
 def lattice_to_top_string(lattice: pynini.Fst,
                           token_type: Optional[pynini.TokenType] = None) -> str:
   """Returns the top string in the lattice.
@@ -212,6 +333,235 @@ def lattice_to_one_top_string(lattice: pynini.Fst,
   return output
 
 
+# Instrumentation.
+
+
+class RewriteRecord(NamedTuple):
+  """Statistics for a single call to a rewrite function.
+
+  Attributes:
+    string: The input, if it was a string.
+    lattice_states: The number of states in the composed lattice.
+    lattice_arcs: The number of arcs in the composed lattice.
+    paths: The number of output strings enumerated.
+    compose_seconds: Time spent composing, including lattice cleanup.
+    dfa_seconds: Time spent determinizing the lattice, if it was.
+    shortest_path_seconds: Time spent searching for the best strings.
+    print_seconds: Time spent enumerating and printing the output strings.
+  """
+
+  string: Optional[str]
+  lattice_states: int
+  lattice_arcs: int
+  paths: int
+  compose_seconds: float
+  dfa_seconds: float
+  shortest_path_seconds: float
+  print_seconds: float
+
+  @property
+  def seconds(self) -> float:
+    """The total time spent in all phases."""
+    return (self.compose_seconds + self.dfa_seconds +
+            self.shortest_path_seconds + self.print_seconds)
+
+
+def _bucket(value: float) -> int:
+  """Returns the least power of two no less than a positive value, else 0."""
+  if value <= 0:
+    return 0
+  return 1 << max(0, math.ceil(math.log2(value)))
+
+
+class RuleStats:
+  """Aggregate statistics for the rewrites made with a single rule.
+
+  The histograms map the upper bound of each bucket, a power of two, to the
+  number of calls which fell into it; latencies are bucketed in microseconds.
+
+  Attributes:
+    calls: The number of calls recorded.
+    failures: The number of calls which raised an error.
+    compose_seconds: Total time spent composing.
+    dfa_seconds: Total time spent determinizing.
+    shortest_path_seconds: Total time spent searching for the best strings.
+    print_seconds: Total time spent enumerating and printing output strings.
+    latency_histogram: Histogram of the total time per call.
+    lattice_states_histogram: Histogram of the composed lattice sizes.
+  """
+
+  def __init__(self, max_slowest: int):
+    self._max_slowest = max_slowest
+    # A min-heap of (seconds, call number, record) for the slowest calls.
+    self._slowest: List[Tuple[float, int, RewriteRecord]] = []
+    self.calls = 0
+    self.failures = 0
+    self.compose_seconds = 0.0
+    self.dfa_seconds = 0.0
+    self.shortest_path_seconds = 0.0
+    self.print_seconds = 0.0
+    self.latency_histogram: Dict[int, int] = {}
+    self.lattice_states_histogram: Dict[int, int] = {}
+
+  def _add(self, record: RewriteRecord, failed: bool) -> None:
+    self.calls += 1
+    if failed:
+      self.failures += 1
+    self.compose_seconds += record.compose_seconds
+    self.dfa_seconds += record.dfa_seconds
+    self.shortest_path_seconds += record.shortest_path_seconds
+    self.print_seconds += record.print_seconds
+    bucket = _bucket(record.seconds * 1e6)
+    self.latency_histogram[bucket] = self.latency_histogram.get(bucket, 0) + 1
+    bucket = _bucket(record.lattice_states)
+    self.lattice_states_histogram[bucket] = (
+        self.lattice_states_histogram.get(bucket, 0) + 1)
+    entry = (record.seconds, self.calls, record)
+    if len(self._slowest) < self._max_slowest:
+      heapq.heappush(self._slowest, entry)
+    elif self._slowest and entry[0] > self._slowest[0][0]:
+      heapq.heapreplace(self._slowest, entry)
+
+  @property
+  def slowest(self) -> List[RewriteRecord]:
+    """The records of the slowest calls, slowest first."""
+    return [record for (_, _, record) in sorted(self._slowest, reverse=True)]
+
+
+class StatsSink:
+  """Collects statistics for calls to the rewrite functions.
+
+  When passed as the `stats` argument of a rewrite function, the sink records
+  the size of the composed lattice, the time spent in each phase, and the
+  number of output strings enumerated. The record for the most recent call is
+  kept as `last`, and records are aggregated per rule. Rules are only weakly
+  referenced where they support it, as pynini FSTs do, and their statistics
+  are dropped along with them. Calls answered from a cache are not recorded.
+
+  Args:
+    max_slowest: The number of records of the slowest calls kept per rule.
+  """
+
+  def __init__(self, max_slowest: int = 10):
+    self._max_slowest = max_slowest
+    # Rule statistics, keyed by the identity of the rule, each with a
+    # reference to the rule. Entries with weak references are removed when the
+    # rule is freed, before its identity can be reused.
+    self._rules: Dict[int, Tuple[Callable[[], Optional[pynini.Fst]],
+                                 RuleStats]] = {}
+    self.last: Optional[RewriteRecord] = None
+
+  def __getitem__(self, rule: pynini.Fst) -> RuleStats:
+    """Returns the aggregate statistics for a rule.
+
+    Raises:
+      KeyError: No calls have been recorded for the rule.
+    """
+    return self._rules[id(rule)][1]
+
+  def __contains__(self, rule: pynini.Fst) -> bool:
+    return id(rule) in self._rules
+
+  def items(self) -> List[Tuple[pynini.Fst, RuleStats]]:
+    """Returns the live rules seen and their aggregate statistics."""
+    items = []
+    for (ref, rule_stats) in list(self._rules.values()):
+      rule = ref()
+      if rule is not None:
+        items.append((rule, rule_stats))
+    return items
+
+  def clear(self) -> None:
+    """Forgets all records."""
+    self._rules.clear()
+    self.last = None
+
+  def _add(self, rule: pynini.Fst, record: RewriteRecord, failed: bool) -> None:
+    key = id(rule)
+    entry = self._rules.get(key)
+    if entry is None:
+      rules = self._rules
+      try:
+        ref = weakref.ref(rule, lambda unused_ref: rules.pop(key, None))
+      except TypeError:
+        # E.g., delayed FSTs, which cannot be weakly referenced.
+        ref = lambda: rule
+      entry = (ref, RuleStats(self._max_slowest))
+      self._rules[key] = entry
+    entry[1]._add(record, failed)
+    self.last = record
+
+
+class _Phase:
+  """Adds the time spent in a with-block to one of the phases of a call."""
+
+  __slots__ = ("_seconds", "_name", "_start")
+
+  def __init__(self, seconds: Dict[str, float], name: str):
+    self._seconds = seconds
+    self._name = name
+
+  def __enter__(self) -> None:
+    self._start = time.perf_counter()
+
+  def __exit__(self, *unused_args) -> None:
+    self._seconds[self._name] += time.perf_counter() - self._start
+
+
+class _Recorder:
+  """Collects the statistics for a call and reports them to a sink.
+
+  It is used as a context manager around the call, so that calls which raise
+  errors are also reported. Calls made without a sink do not use one.
+  """
+
+  def __init__(self, sink: StatsSink, string: pynini.FstLike,
+               rule: pynini.Fst):
+    self._sink = sink
+    self._string = string if isinstance(string, str) else None
+    self._rule = rule
+    self._seconds = {
+        "compose": 0.0,
+        "dfa": 0.0,
+        "shortest_path": 0.0,
+        "print": 0.0
+    }
+    self._lattice_states = 0
+    self._lattice_arcs = 0
+    self.paths = 0
+
+  def __enter__(self) -> "_Recorder":
+    return self
+
+  def __exit__(self, exc_type, *unused_args) -> None:
+    record = RewriteRecord(self._string, self._lattice_states,
+                           self._lattice_arcs, self.paths,
+                           self._seconds["compose"], self._seconds["dfa"],
+                           self._seconds["shortest_path"],
+                           self._seconds["print"])
+    self._sink._add(self._rule, record, exc_type is not None)
+
+  def phase(self, name: str) -> _Phase:
+    """Returns a context manager which times a phase."""
+    return _Phase(self._seconds, name)
+
+  def lattice(self, lattice: pynini.Fst) -> None:
+    """Records the size of the composed lattice."""
+    self._lattice_states = lattice.num_states()
+    self._lattice_arcs = sum(
+        lattice.num_arcs(state) for state in lattice.states())
+
+  def add_native_stats(self, stats: pynini.RewriteStats) -> None:
+    """Records the statistics filled in by a native call."""
+    self._lattice_states = stats.lattice_states
+    self._lattice_arcs = stats.lattice_arcs
+    self.paths += stats.paths
+    self._seconds["compose"] += stats.compose_seconds
+    self._seconds["dfa"] += stats.dfa_seconds
+    self._seconds["shortest_path"] += stats.shortest_path_seconds
+    self._seconds["print"] += stats.print_seconds
+
+
 # Rewrite functions.
 
 
@@ -231,22 +581,27 @@ def matches(istring: pynini.FstLike,
 
   Returns:
     Whether the input-output pair is generated by the rule.
+
+  Raises:
+    Error: Composition failure.
   """
-  lattice = rewrite_lattice(istring, rule, input_token_type)
-  # TODO(kbg): Consider using `contextlib.nullcontext` here instead.
-  if output_token_type is None:
-    lattice = pynini.intersect(lattice, ostring, compose_filter="sequence")
-  else:
-    with pynini.default_token_type(output_token_type):
-      lattice = pynini.intersect(lattice, ostring, compose_filter="sequence")
-  return lattice.start() != pynini.NO_STATE_ID
+  # This searches the composition lazily, stopping at the first successful
+  # path, rather than constructing the lattice.
+  try:
+    return pynini.matches(istring, ostring, rule, input_token_type,
+                          output_token_type)
+  except pynini.FstOpError as error:
+    raise Error("Composition failure") from error
 
 
 def rewrites(string: pynini.FstLike,
              rule: pynini.Fst,
              input_token_type: Optional[pynini.TokenType] = None,
              output_token_type: Optional[pynini.TokenType] = None,
-             state_multiplier: int = 4) -> List[str]:
+             state_multiplier: int = 4,
+             cache: Optional[pynini.RewriteCache] = None,
+             fingerprint: Optional[int] = None,
+             stats: Optional[StatsSink] = None) -> List[str]:
   """Returns all rewrites.
 
   Args:
@@ -256,13 +611,34 @@ def rewrites(string: pynini.FstLike,
     output_token_type: Optional output token type, or symbol table.
     state_multiplier: Max ratio for the number of states in the DFA lattice to
       the NFA lattice; if exceeded, a warning is logged.
+    cache: Optional cache of rewrite outputs.
+    fingerprint: Optional fingerprint of the rule, keying it in the cache;
+      required with a cache unless the rule is frozen.
+    stats: Optional sink for statistics about the call.
 
   Returns:
     A list of output strings.
   """
-  lattice = rewrite_lattice(string, rule, input_token_type)
-  lattice = lattice_to_dfa(lattice, False, state_multiplier)
-  return lattice_to_strings(lattice, output_token_type)
+  if cache is not None and isinstance(string, str):
+    return _cached_rewrite(
+        cache, fingerprint, f"rewrites:{state_multiplier}", string, rule, 0,
+        input_token_type, output_token_type,
+        lambda: rewrites(string, rule, input_token_type, output_token_type,
+                         state_multiplier, stats=stats))
+  if stats is None:
+    lattice = rewrite_lattice(string, rule, input_token_type)
+    lattice = lattice_to_dfa(lattice, False, state_multiplier)
+    return lattice_to_strings(lattice, output_token_type)
+  with _Recorder(stats, string, rule) as recorder:
+    with recorder.phase("compose"):
+      lattice = rewrite_lattice(string, rule, input_token_type)
+    recorder.lattice(lattice)
+    with recorder.phase("dfa"):
+      lattice = lattice_to_dfa(lattice, False, state_multiplier)
+    with recorder.phase("print"):
+      outputs = lattice_to_strings(lattice, output_token_type)
+    recorder.paths = len(outputs)
+    return outputs
 
 
 def top_rewrites(
@@ -270,7 +646,11 @@ def top_rewrites(
     rule: pynini.Fst,
     nshortest: int,
     input_token_type: Optional[pynini.TokenType] = None,
-    output_token_type: Optional[pynini.TokenType] = None) -> List[str]:
+    output_token_type: Optional[pynini.TokenType] = None,
+    beam: Optional[pynini.WeightLike] = None,
+    cache: Optional[pynini.RewriteCache] = None,
+    fingerprint: Optional[int] = None,
+    stats: Optional[StatsSink] = None) -> List[str]:
   """Returns the top n rewrites.
 
   Args:
@@ -279,19 +659,59 @@ def top_rewrites(
     nshortest: The maximum number of rewrites to return.
     input_token_type: Optional input token type, or symbol table.
     output_token_type: Optional output token type, or symbol table.
+    beam: Optional weight threshold, relative to the top rewrite; if set,
+      rewrites whose weight is worse than the top rewrite's weight times the
+      beam are not returned.
+    cache: Optional cache of rewrite outputs.
+    fingerprint: Optional fingerprint of the rule, keying it in the cache;
+      required with a cache unless the rule is frozen.
+    stats: Optional sink for statistics about the call; since strings are
+      searched for lazily, the time spent printing them is included in the
+      shortest-path search.
 
   Returns:
-    A list of output strings.
+    A list of output strings, best first.
   """
-  lattice = rewrite_lattice(string, rule, input_token_type)
-  lattice = lattice_to_nshortest(lattice, nshortest)
-  return lattice_to_strings(lattice, output_token_type)
+  if cache is not None and isinstance(string, str):
+    return _cached_rewrite(
+        cache, fingerprint, f"top_rewrites:{beam}", string, rule, nshortest,
+        input_token_type, output_token_type,
+        lambda: top_rewrites(string, rule, nshortest, input_token_type,
+                             output_token_type, beam, stats=stats))
+  if stats is None:
+    lattice = rewrite_lattice(string, rule, input_token_type)
+    return _top_strings(lattice, nshortest, output_token_type, beam)
+  with _Recorder(stats, string, rule) as recorder:
+    with recorder.phase("compose"):
+      lattice = rewrite_lattice(string, rule, input_token_type)
+    recorder.lattice(lattice)
+    with recorder.phase("shortest_path"):
+      outputs = _top_strings(lattice, nshortest, output_token_type, beam)
+    recorder.paths = len(outputs)
+    return outputs
+
+
+def _top_strings(lattice: pynini.Fst, nshortest: int,
+                 output_token_type: Optional[pynini.TokenType],
+                 beam: Optional[pynini.WeightLike]) -> List[str]:
+  """Returns the top n strings of a lattice, within the beam if any."""
+  if beam is not None:
+    # A string is within the beam just in case its best path is, so it
+    # suffices to prune paths.
+    lattice.prune(weight=beam)
+  return list(
+      itertools.islice(
+          lattice_to_shortest_strings(lattice, output_token_type), nshortest))
 
 
 def top_rewrite(string: str,
                 rule: pynini.Fst,
                 input_token_type: Optional[pynini.TokenType] = None,
-                output_token_type: Optional[pynini.TokenType] = None) -> str:
+                output_token_type: Optional[pynini.TokenType] = None,
+                parse_brackets: bool = True,
+                cache: Optional[pynini.RewriteCache] = None,
+                fingerprint: Optional[int] = None,
+                stats: Optional[StatsSink] = None) -> str:
   """Returns one top rewrite.
 
   Args:
@@ -299,19 +719,64 @@ def top_rewrite(string: str,
     rule: Input rule WFST.
     input_token_type: Optional input token type, or symbol table.
     output_token_type: Optional output token type, or symbol table.
+    parse_brackets: If false, bracketed spans in the input string are not
+      treated as generated symbols; see `rewrite_lattice`.
+    cache: Optional cache of rewrite outputs.
+    fingerprint: Optional fingerprint of the rule, keying it in the cache;
+      required with a cache unless the rule is frozen.
+    stats: Optional sink for statistics about the call.
 
   Returns:
     The top string.
+
+  Raises:
+    Error: Composition failure.
   """
-  lattice = rewrite_lattice(string, rule, input_token_type)
-  return lattice_to_top_string(lattice, output_token_type)
+  if cache is not None and isinstance(string, str):
+    return _cached_rewrite(
+        cache, fingerprint, f"top_rewrite:{parse_brackets}", string, rule, 0,
+        input_token_type, output_token_type, lambda: [
+            top_rewrite(string, rule, input_token_type, output_token_type,
+                        parse_brackets, stats=stats)
+        ])[0]
+  if stats is None:
+    if _can_view(string, input_token_type, parse_brackets):
+      try:
+        return pynini.string_view_top_rewrite(string, rule, input_token_type,
+                                              output_token_type)
+      except pynini.FstOpError as error:
+        raise Error("Composition failure") from error
+    lattice = rewrite_lattice(string, rule, input_token_type)
+    return pynini.shortestpath(lattice).string(output_token_type)
+  with _Recorder(stats, string, rule) as recorder:
+    if _can_view(string, input_token_type, parse_brackets):
+      native_stats = pynini.RewriteStats()
+      try:
+        return pynini.string_view_top_rewrite(string, rule, input_token_type,
+                                              output_token_type, native_stats)
+      except pynini.FstOpError as error:
+        raise Error("Composition failure") from error
+      finally:
+        recorder.add_native_stats(native_stats)
+    with recorder.phase("compose"):
+      lattice = rewrite_lattice(string, rule, input_token_type)
+    recorder.lattice(lattice)
+    with recorder.phase("shortest_path"):
+      lattice = pynini.shortestpath(lattice)
+    with recorder.phase("print"):
+      output = lattice.string(output_token_type)
+    recorder.paths = 1
+    return output
 
 
 def one_top_rewrite(string: str,
                     rule: pynini.Fst,
                     input_token_type: Optional[pynini.TokenType] = None,
                     output_token_type: Optional[pynini.TokenType] = None,
-                    state_multiplier: int = 4) -> str:
+                    state_multiplier: int = 4,
+                    cache: Optional[pynini.RewriteCache] = None,
+                    fingerprint: Optional[int] = None,
+                    stats: Optional[StatsSink] = None) -> str:
   """Returns one top rewrite, unless there is a tie.
 
   Args:
@@ -321,20 +786,46 @@ def one_top_rewrite(string: str,
     output_token_type: Optional output token type, or symbol table.
     state_multiplier: Max ratio for the number of states in the DFA lattice to
       the NFA lattice; if exceeded, a warning is logged.
+    cache: Optional cache of rewrite outputs; ties are not cached.
+    fingerprint: Optional fingerprint of the rule, keying it in the cache;
+      required with a cache unless the rule is frozen.
+    stats: Optional sink for statistics about the call.
 
   Returns:
     The top string.
   """
-  lattice = rewrite_lattice(string, rule, input_token_type)
-  lattice = lattice_to_dfa(lattice, True, state_multiplier)
-  return lattice_to_one_top_string(lattice, output_token_type)
+  if cache is not None and isinstance(string, str):
+    return _cached_rewrite(
+        cache, fingerprint, f"one_top_rewrite:{state_multiplier}", string,
+        rule, 0, input_token_type, output_token_type, lambda: [
+            one_top_rewrite(string, rule, input_token_type, output_token_type,
+                            state_multiplier, stats=stats)
+        ])[0]
+  if stats is None:
+    lattice = rewrite_lattice(string, rule, input_token_type)
+    lattice = lattice_to_dfa(lattice, True, state_multiplier)
+    return lattice_to_one_top_string(lattice, output_token_type)
+  with _Recorder(stats, string, rule) as recorder:
+    with recorder.phase("compose"):
+      lattice = rewrite_lattice(string, rule, input_token_type)
+    recorder.lattice(lattice)
+    with recorder.phase("dfa"):
+      lattice = lattice_to_dfa(lattice, True, state_multiplier)
+    with recorder.phase("print"):
+      output = lattice_to_one_top_string(lattice, output_token_type)
+    recorder.paths = 1
+    return output
 
 
 def optimal_rewrites(string: pynini.FstLike,
                      rule: pynini.Fst,
                      input_token_type: Optional[pynini.TokenType] = None,
                      output_token_type: Optional[pynini.TokenType] = None,
-                     state_multiplier: int = 4) -> List[str]:
+                     state_multiplier: int = 4,
+                     beam: Optional[pynini.WeightLike] = None,
+                     cache: Optional[pynini.RewriteCache] = None,
+                     fingerprint: Optional[int] = None,
+                     stats: Optional[StatsSink] = None) -> List[str]:
   """Returns all optimal rewrites.
 
   Args:
@@ -344,11 +835,397 @@ def optimal_rewrites(string: pynini.FstLike,
     output_token_type: Optional output token type, or symbol table.
     state_multiplier: Max ratio for the number of states in the DFA lattice to
       the NFA lattice; if exceeded, a warning is logged.
+    beam: Optional weight threshold, relative to the optimal rewrites; if set,
+      all rewrites whose weight is no worse than the optimal weight times the
+      beam are returned.
+    cache: Optional cache of rewrite outputs.
+    fingerprint: Optional fingerprint of the rule, keying it in the cache;
+      required with a cache unless the rule is frozen.
+    stats: Optional sink for statistics about the call.
 
   Returns:
     A tuple of output strings.
   """
-  lattice = rewrite_lattice(string, rule, input_token_type)
-  lattice = lattice_to_dfa(lattice, True, state_multiplier)
-  return lattice_to_strings(lattice, output_token_type)
+  if cache is not None and isinstance(string, str):
+    return _cached_rewrite(
+        cache, fingerprint, f"optimal_rewrites:{state_multiplier}:{beam}",
+        string, rule, 0, input_token_type, output_token_type,
+        lambda: optimal_rewrites(string, rule, input_token_type,
+                                 output_token_type, state_multiplier, beam,
+                                 stats=stats))
+  if stats is None:
+    lattice = rewrite_lattice(string, rule, input_token_type)
+    lattice = lattice_to_dfa(lattice, True, state_multiplier, beam)
+    return lattice_to_strings(lattice, output_token_type)
+  with _Recorder(stats, string, rule) as recorder:
+    with recorder.phase("compose"):
+      lattice = rewrite_lattice(string, rule, input_token_type)
+    recorder.lattice(lattice)
+    with recorder.phase("dfa"):
+      lattice = lattice_to_dfa(lattice, True, state_multiplier, beam)
+    with recorder.phase("print"):
+      outputs = lattice_to_strings(lattice, output_token_type)
+    recorder.paths = len(outputs)
+    return outputs
+
+
+# Batch rewrite functions.
+
+
+def batch_rewrites(strings: Iterable[str],
+                   rule: pynini.Fst,
+                   input_token_type: Optional[pynini.TokenType] = None,
+                   output_token_type: Optional[pynini.TokenType] = None,
+                   state_multiplier: int = 4,
+                   num_threads: int = 0) -> List[List[str]]:
+  """Returns all rewrites for each of a batch of strings.
+
+  Args:
+    strings: Input strings.
+    rule: Input rule WFST.
+    input_token_type: Optional input token type, or symbol table.
+    output_token_type: Optional output token type, or symbol table.
+    state_multiplier: Max ratio for the number of states in the DFA lattice to
+      the NFA lattice; if exceeded, a warning is logged.
+    num_threads: Number of worker threads; if not positive, the number of
+      hardware threads is used.
+
+  Returns:
+    A list of lists of output strings, one per input string.
+
+  Raises:
+    Error: Composition failure.
+  """
+  try:
+    return pynini.batch_rewrites(strings, rule, input_token_type,
+                                 output_token_type, num_threads,
+                                 state_multiplier)
+  except pynini.FstOpError as error:
+    raise Error("Composition failure") from error
+
+
+def batch_top_rewrites(
+    strings: Iterable[str],
+    rule: pynini.Fst,
+    nshortest: int,
+    input_token_type: Optional[pynini.TokenType] = None,
+    output_token_type: Optional[pynini.TokenType] = None,
+    num_threads: int = 0) -> List[List[str]]:
+  """Returns the top n rewrites for each of a batch of strings.
+
+  Args:
+    strings: Input strings.
+    rule: Input rule WFST.
+    nshortest: The maximum number of rewrites to return per string.
+    input_token_type: Optional input token type, or symbol table.
+    output_token_type: Optional output token type, or symbol table.
+    num_threads: Number of worker threads; if not positive, the number of
+      hardware threads is used.
+
+  Returns:
+    A list of lists of output strings, one per input string.
+
+  Raises:
+    Error: Composition failure.
+  """
+  try:
+    return pynini.batch_top_rewrites(strings, rule, nshortest,
+                                     input_token_type, output_token_type,
+                                     num_threads)
+  except pynini.FstOpError as error:
+    raise Error("Composition failure") from error
+
+
+def batch_top_rewrite(strings: Iterable[str],
+                      rule: pynini.Fst,
+                      input_token_type: Optional[pynini.TokenType] = None,
+                      output_token_type: Optional[pynini.TokenType] = None,
+                      num_threads: int = 0) -> List[str]:
+  """Returns one top rewrite for each of a batch of strings.
+
+  Args:
+    strings: Input strings.
+    rule: Input rule WFST.
+    input_token_type: Optional input token type, or symbol table.
+    output_token_type: Optional output token type, or symbol table.
+    num_threads: Number of worker threads; if not positive, the number of
+      hardware threads is used.
+
+  Returns:
+    A list of top strings, one per input string.
+
+  Raises:
+    Error: Composition failure.
+  """
+  try:
+    return pynini.batch_top_rewrite(strings, rule, input_token_type,
+                                    output_token_type, num_threads)
+  except pynini.FstOpError as error:
+    raise Error("Composition failure") from error
+
+
+def batch_optimal_rewrites(
+    strings: Iterable[str],
+    rule: pynini.Fst,
+    input_token_type: Optional[pynini.TokenType] = None,
+    output_token_type: Optional[pynini.TokenType] = None,
+    state_multiplier: int = 4,
+    num_threads: int = 0) -> List[List[str]]:
+  """Returns all optimal rewrites for each of a batch of strings.
+
+  Args:
+    strings: Input strings.
+    rule: Input rule WFST.
+    input_token_type: Optional input token type, or symbol table.
+    output_token_type: Optional output token type, or symbol table.
+    state_multiplier: Max ratio for the number of states in the DFA lattice to
+      the NFA lattice; if exceeded, a warning is logged.
+    num_threads: Number of worker threads; if not positive, the number of
+      hardware threads is used.
+
+  Returns:
+    A list of lists of output strings, one per input string.
+
+  Raises:
+    Error: Composition failure.
+  """
+  try:
+    return pynini.batch_optimal_rewrites(strings, rule, input_token_type,
+                                         output_token_type, num_threads,
+                                         state_multiplier)
+  except pynini.FstOpError as error:
+    raise Error("Composition failure") from error
+
+
+# Asynchronous rewriting.
+
+
+def _resolve_token_type(
+    token_type: Optional[pynini.TokenType]) -> pynini.TokenType:
+  """Returns the token type, or if it is None, the calling thread's default.
+
+  Defaults are per-thread (see `pynini.default_token_type`), so token types are
+  resolved on the event loop's thread before rewrites are run in a worker.
+  """
+  return pynini.get_default_token_type() if token_type is None else token_type
+
+
+def _token_type_key(token_type: pynini.TokenType) -> Hashable:
+  """Returns a hashable key for a resolved token type.
+
+  Symbol tables are keyed by their contents, so that requests using equal
+  tables (such as copies of the default table) are batched together.
+  """
+  if isinstance(token_type, str):
+    return token_type
+  return token_type.labeled_checksum()
+
+
+class _Batcher:
+  """Groups concurrently awaited requests into batches.
+
+  Requests submitted while no batch is running are gathered until the event
+  loop next runs its callbacks, so all those made in the same iteration of the
+  loop form one batch; requests submitted while a batch is running form the
+  next. Each batch is processed by one call to `batch_fn` in the loop's default
+  executor, so the loop is never blocked and there is one thread hop per batch
+  rather than per request. All requests must be made from the same loop.
+  """
+
+  def __init__(self, batch_fn: Callable[[List[Any]], List[Any]]):
+    self._batch_fn = batch_fn
+    self._pending: List[Tuple[Any, asyncio.Future]] = []
+    self._running = False
+
+  async def submit(self, request: Any) -> Any:
+    """Returns the output for a request once its batch has been processed."""
+    loop = asyncio.get_running_loop()
+    future = loop.create_future()
+    self._pending.append((request, future))
+    if not self._running:
+      self._running = True
+      loop.call_soon(self._dispatch, loop)
+    return await future
+
+  def _dispatch(self, loop: asyncio.AbstractEventLoop) -> None:
+    # Requests whose callers have been cancelled are dropped.
+    batch = [(request, future) for (request, future) in self._pending
+             if not future.done()]
+    self._pending = []
+    if not batch:
+      self._running = False
+      return
+    task = loop.run_in_executor(None, self._run,
+                                [request for (request, _) in batch])
+    task.add_done_callback(lambda task: self._complete(loop, batch, task))
+
+  def _run(self, requests: List[Any]) -> List[Any]:
+    """Processes a batch, returning an output or an Error for each request."""
+    try:
+      return self._batch_fn(requests)
+    except Error:
+      pass
+    # Retries the requests one at a time, so that only those which fail raise.
+    outputs = []
+    for request in requests:
+      try:
+        outputs.append(self._batch_fn([request])[0])
+      except Error as error:
+        outputs.append(error)
+    return outputs
+
+  def _complete(self, loop: asyncio.AbstractEventLoop,
+                batch: List[Tuple[Any, asyncio.Future]],
+                task: asyncio.Future) -> None:
+    try:
+      outputs = task.result()
+    except Exception as error:  # pylint: disable=broad-except
+      outputs = [error] * len(batch)
+    for (_, future), output in zip(batch, outputs):
+      if future.done():
+        continue
+      if isinstance(output, Exception):
+        future.set_exception(output)
+      else:
+        future.set_result(output)
+    if self._pending:
+      self._dispatch(loop)
+    else:
+      self._running = False
+
+
+class AsyncRewriter:
+  """Awaitable rewriting of strings with a rule.
+
+  Calling the rewrite functions from a coroutine blocks the event loop. The
+  coroutine methods of this class instead run rewrites in a worker thread.
+  Rewrites of the same kind, with the same options, which are awaited
+  concurrently (e.g., by several tasks) are batched, and each batch is handed
+  to the corresponding `batch_` function, which releases the GIL and
+  distributes the strings across native worker threads. If a string in a batch
+  cannot be rewritten, only the request for that string raises an error.
+
+  The rule is frozen (see `pynini.Fst.freeze`) once, when the rewriter is
+  constructed, so later changes to the rule do not affect the rewriter. Token
+  types which are None are those in effect on the event loop's thread when a
+  rewrite is awaited. A rewriter must only be used from a single event loop.
+
+  Args:
+    rule: Input rule WFST.
+    input_token_type: Optional input token type, or symbol table.
+    output_token_type: Optional output token type, or symbol table.
+    num_threads: Number of worker threads per batch; if not positive, the
+      number of hardware threads is used.
+  """
 
+  def __init__(self,
+               rule: pynini.Fst,
+               input_token_type: Optional[pynini.TokenType] = None,
+               output_token_type: Optional[pynini.TokenType] = None,
+               num_threads: int = 0):
+    self._rule = rule.freeze() if isinstance(rule, pynini.Fst) else rule
+    self._input_token_type = input_token_type
+    self._output_token_type = output_token_type
+    self._num_threads = num_threads
+    self._batchers: Dict[Tuple[Any, ...], _Batcher] = {}
+
+  def _batcher(
+      self, query: str, option: int,
+      batch_fn: Callable[[List[str], pynini.TokenType, pynini.TokenType],
+                         List[Any]]
+  ) -> _Batcher:
+    """Returns the batcher for a query and its option, creating it if needed.
+
+    The token types are resolved on the calling thread, and passed to
+    `batch_fn` along with each batch.
+    """
+    input_token_type = _resolve_token_type(self._input_token_type)
+    output_token_type = _resolve_token_type(self._output_token_type)
+    key = (query, option, _token_type_key(input_token_type),
+           _token_type_key(output_token_type))
+    batcher = self._batchers.get(key)
+    if batcher is None:
+      batcher = _Batcher(lambda strings: batch_fn(strings, input_token_type,
+                                                  output_token_type))
+      self._batchers[key] = batcher
+    return batcher
+
+  async def rewrites(self, string: str, state_multiplier: int = 4) -> List[str]:
+    """Returns all rewrites.
+
+    Args:
+      string: Input string.
+      state_multiplier: Max ratio for the number of states in the DFA lattice
+        to the NFA lattice; if exceeded, a warning is logged.
+
+    Returns:
+      A tuple of output strings.
+
+    Raises:
+      Error: Composition failure.
+    """
+    batcher = self._batcher(
+        "rewrites", state_multiplier,
+        lambda strings, itype, otype: batch_rewrites(
+            strings, self._rule, itype, otype, state_multiplier,
+            self._num_threads))
+    return await batcher.submit(string)
+
+  async def top_rewrites(self, string: str, nshortest: int) -> List[str]:
+    """Returns the top n rewrites.
+
+    Args:
+      string: Input string.
+      nshortest: The maximum number of rewrites to return.
+
+    Returns:
+      A tuple of output strings.
+
+    Raises:
+      Error: Composition failure.
+    """
+    batcher = self._batcher(
+        "top_rewrites", nshortest,
+        lambda strings, itype, otype: batch_top_rewrites(
+            strings, self._rule, nshortest, itype, otype, self._num_threads))
+    return await batcher.submit(string)
+
+  async def top_rewrite(self, string: str) -> str:
+    """Returns one top rewrite.
+
+    Args:
+      string: Input string.
+
+    Returns:
+      The top string.
+
+    Raises:
+      Error: Composition failure.
+    """
+    batcher = self._batcher(
+        "top_rewrite", 0, lambda strings, itype, otype: batch_top_rewrite(
+            strings, self._rule, itype, otype, self._num_threads))
+    return await batcher.submit(string)
+
+  async def optimal_rewrites(self,
+                             string: str,
+                             state_multiplier: int = 4) -> List[str]:
+    """Returns all optimal rewrites.
+
+    Args:
+      string: Input string.
+      state_multiplier: Max ratio for the number of states in the DFA lattice
+        to the NFA lattice; if exceeded, a warning is logged.
+
+    Returns:
+      A tuple of output strings.
+
+    Raises:
+      Error: Composition failure.
+    """
+    batcher = self._batcher(
+        "optimal_rewrites", state_multiplier,
+        lambda strings, itype, otype: batch_optimal_rewrites(
+            strings, self._rule, itype, otype, state_multiplier,
+            self._num_threads))
+    return await batcher.submit(string)
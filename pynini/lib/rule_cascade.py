@@ -25,7 +25,7 @@ the path property.
 See `rewrite.py` for more information about interpreting the rewrite functions.
 """
 
-from typing import Iterable, List, Optional
+from typing import Any, Callable, Dict, Iterable, List, Optional, Tuple
 
 import pynini
 from pynini.lib import rewrite
@@ -42,11 +42,53 @@ class RuleCascade:
 
   The caller must provide the path to a FAR file, and a set of rules before
   calling any other methods.
+
+  The rules are applied by a native engine, which composes them with each other
+  once, when they are set, rather than materializing an intermediate lattice
+  after each rule. If `precompose` is true, the rules are composed into a
+  single rule; this is fastest for small cascades but may be expensive to
+  construct for large ones. Otherwise, they are composed lazily, and the state
+  cache is shared across subsequent rewrites; the cache of each lazy
+  composition holds at most `cache_gc_limit` bytes.
+
+  If `lookahead` is true, the rules are converted, once, for lookahead
+  composition, which avoids exploring dead-end paths through epsilon arcs; this
+  helps most with long cascades of context-dependent rewrite rules.
+
+  If `memory_map` is true, rules stored in the FAR as ConstFsts (e.g., by an
+  exporter with `memory_map` set) are memory-mapped rather than read into
+  memory, so that processes applying the same cascade share a single copy of
+  them; these are never copied unless they need to be arc-sorted.
+
+  If a `cache` is given, the outputs of rewrites of string inputs are looked up
+  in it, keyed on a fingerprint of the rules, and the rules are applied only if
+  they are not found; a cache may be shared by several cascades.
+
+  `memory_usage` reports the approximate memory held by the cascade, so that
+  callers holding many cascades can cap what each uses.
+
+  The `_async` variants of the rewrite functions are coroutines which apply the
+  rules in a worker thread rather than blocking the event loop; concurrent
+  requests for the same query are batched (see `rewrite.AsyncRewriter`), so
+  there is one thread hop per batch. They must be awaited from a single loop.
   """
 
-  def __init__(self, far_path: str):
-    self.far = pynini.Far(far_path, "r")
+  def __init__(self,
+               far_path: str,
+               precompose: bool = False,
+               memory_map: bool = False,
+               cache: Optional[pynini.RewriteCache] = None,
+               lookahead: bool = False,
+               cache_gc_limit: int = 1 << 20):
+    self.far = pynini.Far(far_path, "r", memory_map=memory_map)
+    self.precompose = precompose
+    self.lookahead = lookahead
+    self.cache_gc_limit = cache_gc_limit
+    self.cache = cache
     self.rules = []
+    self._engine = None
+    self._fingerprint = 0
+    self._batchers: Dict[Tuple[Any, ...], rewrite._Batcher] = {}
 
   def _validate_and_arcsort_rules(self,
                                   rules: List[str]) -> Iterable[pynini.Fst]:
@@ -56,14 +98,18 @@ class RuleCascade:
       rules: An iterable of strings naming rules in the input FAR.
 
     Yields:
-       The requested rules, arc-sorted.
+       The requested rules, arc-sorted; memory-mapped rules are yielded as is,
+       and are arc-sorted by the engine only if they were not so written.
 
     Raises:
        Error: Cannot find rule.
     """
     for rule in rules:
       if self.far.find(rule):
-        yield self.far.get_fst().arcsort(sort_type="ilabel")
+        fst = self.far.get_fst()
+        if isinstance(fst, pynini.Fst):
+          fst.arcsort(sort_type="ilabel")
+        yield fst
       else:
         raise Error(f"Cannot find rule: {rule}")
 
@@ -72,8 +118,50 @@ class RuleCascade:
 
     Args:
       rules: An iterable of strings naming rules in the input FAR.
+
+    Raises:
+      Error: Cannot find rule.
+      Error: Rule cascade construction failed.
     """
     self.rules = list(self._validate_and_arcsort_rules(rules))
+    self._engine = None
+    self._batchers = {}
+    if not self.rules:
+      return
+    if self.cache is not None:
+      # Combines the rules' fingerprints into an unsigned 64-bit integer.
+      self._fingerprint = hash(
+          tuple(pynini.fingerprint(rule) for rule in self.rules)) & (2**64 - 1)
+    try:
+      self._engine = pynini.RuleCascadeEngine(
+          self.rules,
+          lazy=not self.precompose,
+          lookahead=self.lookahead,
+          cache_gc_limit=self.cache_gc_limit)
+    except pynini.FstOpError as err:
+      raise Error("Rule cascade construction failed") from err
+
+  def memory_usage(self) -> pynini.MemoryStats:
+    """Returns the approximate memory used by the rule cascade.
+
+    This is that of the rules and of the lazy compositions' caches (see
+    `pynini.RuleCascadeEngine.memory_usage`); the rewrite cache, which may be
+    shared, is not included.
+
+    Raises:
+      Error: No rules requested.
+    """
+    return self._get_engine().memory_usage()
+
+  def _get_engine(self) -> pynini.RuleCascadeEngine:
+    """Returns the rule cascade engine.
+
+    Raises:
+      Error: No rules requested.
+    """
+    if self._engine is None:
+      raise Error("No rules requested")
+    return self._engine
 
   def _rewrite_lattice(
       self,
@@ -90,16 +178,40 @@ class RuleCascade:
 
     Raises:
       Error: No rules requested.
+      rewrite.Error: Composition failure.
     """
-    if not self.rules:
-      raise Error("No rules requested")
-    lattice = string
-    for rule in self.rules:
-      lattice = rewrite.rewrite_lattice(lattice, rule, token_type)
-    else:
-      if not isinstance(lattice, pynini.Fst):
-        lattice = pynini.accep(lattice, token_type=token_type)
-    return lattice
+    engine = self._get_engine()
+    try:
+      return engine.rewrite_lattice(string, token_type)
+    except pynini.FstOpError:
+      raise rewrite.Error("Composition failure")
+
+  def _cached(self, query: str, string: pynini.FstLike, nshortest: int,
+              input_token_type: Optional[pynini.TokenType],
+              output_token_type: Optional[pynini.TokenType],
+              rewrite_fn: Callable[[], List[str]]) -> List[str]:
+    """Returns the outputs of a query, from the cache if possible.
+
+    Args:
+      query: The name of the query, including any options.
+      string: Input string or FST; only strings are cached.
+      nshortest: The number of shortest paths requested, if applicable.
+      input_token_type: Optional input token type, or symbol table.
+      output_token_type: Optional output token type, or symbol table.
+      rewrite_fn: Computes the outputs on a cache miss.
+
+    Returns:
+      A list of output strings.
+    """
+    if self.cache is None or not isinstance(string, str):
+      return rewrite_fn()
+    outputs = self.cache.lookup(self._fingerprint, query, string, nshortest,
+                                input_token_type, output_token_type)
+    if outputs is None:
+      outputs = rewrite_fn()
+      self.cache.insert(self._fingerprint, query, string, outputs, nshortest,
+                        input_token_type, output_token_type)
+    return outputs
 
   # Rewrite functions.
 
@@ -118,15 +230,18 @@ class RuleCascade:
 
     Returns:
       Whether the input-output pair is generated by the rule.
+
+    Raises:
+      Error: No rules requested.
+      rewrite.Error: Composition failure.
     """
-    lattice = self._rewrite_lattice(istring, input_token_type)
-    # TODO(kbg): Consider using `contextlib.nullcontext` here instead.
-    if output_token_type is None:
-      lattice = pynini.intersect(lattice, ostring, compose_filter="sequence")
-    else:
-      with pynini.default_token_type(output_token_type):
-        lattice = pynini.intersect(lattice, ostring, compose_filter="sequence")
-    return lattice.start() != pynini.NO_STATE_ID
+    engine = self._get_engine()
+    # As in `rewrite.matches`, an input rejected by the rules is an error.
+    try:
+      return engine.matches(istring, ostring, input_token_type,
+                            output_token_type)
+    except pynini.FstOpError:
+      raise rewrite.Error("Composition failure")
 
   def rewrites(self,
                string: pynini.FstLike,
@@ -145,9 +260,17 @@ class RuleCascade:
     Returns:
       A tuple of output strings.
     """
-    lattice = self._rewrite_lattice(string, input_token_type)
-    lattice = rewrite.lattice_to_dfa(lattice, False, state_multiplier)
-    return rewrite.lattice_to_strings(lattice, output_token_type)
+    engine = self._get_engine()
+
+    def _rewrites() -> List[str]:
+      try:
+        return engine.rewrites(string, input_token_type, output_token_type,
+                               state_multiplier)
+      except pynini.FstOpError:
+        raise rewrite.Error("Composition failure")
+
+    return self._cached(f"rewrites:{state_multiplier}", string, 0,
+                        input_token_type, output_token_type, _rewrites)
 
   def top_rewrites(
       self,
@@ -166,9 +289,17 @@ class RuleCascade:
     Returns:
       A tuple of output strings.
     """
-    lattice = self._rewrite_lattice(string, input_token_type)
-    lattice = rewrite.lattice_to_nshortest(lattice, nshortest)
-    return rewrite.lattice_to_strings(lattice, output_token_type)
+    engine = self._get_engine()
+
+    def _top_rewrites() -> List[str]:
+      try:
+        return engine.top_rewrites(string, nshortest, input_token_type,
+                                   output_token_type)
+      except pynini.FstOpError:
+        raise rewrite.Error("Composition failure")
+
+    return self._cached("top_rewrites", string, nshortest, input_token_type,
+                        output_token_type, _top_rewrites)
 
   def top_rewrite(self,
                   string: pynini.FstLike,
@@ -184,8 +315,18 @@ class RuleCascade:
     Returns:
       The top string.
     """
-    lattice = self._rewrite_lattice(string, input_token_type)
-    return rewrite.lattice_to_top_string(lattice, output_token_type)
+    engine = self._get_engine()
+
+    def _top_rewrite() -> List[str]:
+      try:
+        return [
+            engine.top_rewrite(string, input_token_type, output_token_type)
+        ]
+      except pynini.FstOpError:
+        raise rewrite.Error("Composition failure")
+
+    return self._cached("top_rewrite", string, 0, input_token_type,
+                        output_token_type, _top_rewrite)[0]
 
   def one_top_rewrite(self,
                       string: pynini.FstLike,
@@ -204,9 +345,16 @@ class RuleCascade:
     Returns:
       The top string.
     """
-    lattice = self._rewrite_lattice(string, input_token_type)
-    lattice = rewrite.lattice_to_dfa(lattice, True, state_multiplier)
-    return rewrite.lattice_to_one_top_string(lattice, output_token_type)
+
+    def _one_top_rewrite() -> List[str]:
+      # This goes through the lattice so that ties are reported as such.
+      lattice = self._rewrite_lattice(string, input_token_type)
+      lattice = rewrite.lattice_to_dfa(lattice, True, state_multiplier)
+      return [rewrite.lattice_to_one_top_string(lattice, output_token_type)]
+
+    return self._cached(f"one_top_rewrite:{state_multiplier}", string, 0,
+                        input_token_type, output_token_type,
+                        _one_top_rewrite)[0]
 
   def optimal_rewrites(self,
                        string: pynini.FstLike,
@@ -225,7 +373,138 @@ class RuleCascade:
     Returns:
       A tuple of output strings.
     """
-    lattice = self._rewrite_lattice(string, input_token_type)
-    lattice = rewrite.lattice_to_dfa(lattice, True, state_multiplier)
-    return rewrite.lattice_to_strings(lattice, output_token_type)
+    engine = self._get_engine()
+
+    def _optimal_rewrites() -> List[str]:
+      try:
+        return engine.optimal_rewrites(string, input_token_type,
+                                       output_token_type, state_multiplier)
+      except pynini.FstOpError:
+        raise rewrite.Error("Composition failure")
+
+    return self._cached(f"optimal_rewrites:{state_multiplier}", string, 0,
+                        input_token_type, output_token_type,
+                        _optimal_rewrites)
+
+  # Asynchronous rewrite functions.
+
+  async def _submit(
+      self, query: str, string: str, nshortest: int,
+      input_token_type: Optional[pynini.TokenType],
+      output_token_type: Optional[pynini.TokenType],
+      rewrite_fn: Callable[[str, pynini.TokenType, pynini.TokenType],
+                           List[str]]
+  ) -> List[str]:
+    """Returns the outputs of a query, batched with concurrent requests.
+
+    Args:
+      query: The name of the query, including any options.
+      string: Input string.
+      nshortest: The number of shortest paths requested, if applicable.
+      input_token_type: Optional input token type, or symbol table.
+      output_token_type: Optional output token type, or symbol table.
+      rewrite_fn: Computes the outputs for one string, given the token types;
+        this is called in a worker thread, so token types which are None are
+        first resolved to the defaults of the calling thread.
+
+    Returns:
+      A list of output strings.
+    """
+    input_token_type = rewrite._resolve_token_type(input_token_type)
+    output_token_type = rewrite._resolve_token_type(output_token_type)
+    if self.cache is not None:
+      outputs = self.cache.lookup(self._fingerprint, query, string, nshortest,
+                                  input_token_type, output_token_type)
+      if outputs is not None:
+        return outputs
+    key = (query, nshortest, rewrite._token_type_key(input_token_type),
+           rewrite._token_type_key(output_token_type))
+    batcher = self._batchers.get(key)
+    if batcher is None:
+      batcher = rewrite._Batcher(lambda strings: [
+          rewrite_fn(string, input_token_type, output_token_type)
+          for string in strings
+      ])
+      self._batchers[key] = batcher
+    outputs = await batcher.submit(string)
+    if self.cache is not None:
+      self.cache.insert(self._fingerprint, query, string, outputs, nshortest,
+                        input_token_type, output_token_type)
+    return outputs
+
+  async def rewrites_async(
+      self,
+      string: str,
+      input_token_type: Optional[pynini.TokenType] = None,
+      output_token_type: Optional[pynini.TokenType] = None,
+      state_multiplier: int = 4) -> List[str]:
+    """Awaitable variant of `rewrites`."""
+    engine = self._get_engine()
+
+    def _rewrites(string: str, itype: pynini.TokenType,
+                  otype: pynini.TokenType) -> List[str]:
+      try:
+        return engine.rewrites(string, itype, otype, state_multiplier)
+      except pynini.FstOpError:
+        raise rewrite.Error("Composition failure")
+
+    return await self._submit(f"rewrites:{state_multiplier}", string, 0,
+                              input_token_type, output_token_type, _rewrites)
+
+  async def top_rewrites_async(
+      self,
+      string: str,
+      nshortest: int,
+      input_token_type: Optional[pynini.TokenType] = None,
+      output_token_type: Optional[pynini.TokenType] = None) -> List[str]:
+    """Awaitable variant of `top_rewrites`."""
+    engine = self._get_engine()
+
+    def _top_rewrites(string: str, itype: pynini.TokenType,
+                      otype: pynini.TokenType) -> List[str]:
+      try:
+        return engine.top_rewrites(string, nshortest, itype, otype)
+      except pynini.FstOpError:
+        raise rewrite.Error("Composition failure")
+
+    return await self._submit("top_rewrites", string, nshortest,
+                              input_token_type, output_token_type,
+                              _top_rewrites)
 
+  async def top_rewrite_async(
+      self,
+      string: str,
+      input_token_type: Optional[pynini.TokenType] = None,
+      output_token_type: Optional[pynini.TokenType] = None) -> str:
+    """Awaitable variant of `top_rewrite`."""
+    engine = self._get_engine()
+
+    def _top_rewrite(string: str, itype: pynini.TokenType,
+                     otype: pynini.TokenType) -> List[str]:
+      try:
+        return [engine.top_rewrite(string, itype, otype)]
+      except pynini.FstOpError:
+        raise rewrite.Error("Composition failure")
+
+    return (await self._submit("top_rewrite", string, 0, input_token_type,
+                               output_token_type, _top_rewrite))[0]
+
+  async def optimal_rewrites_async(
+      self,
+      string: str,
+      input_token_type: Optional[pynini.TokenType] = None,
+      output_token_type: Optional[pynini.TokenType] = None,
+      state_multiplier: int = 4) -> List[str]:
+    """Awaitable variant of `optimal_rewrites`."""
+    engine = self._get_engine()
+
+    def _optimal_rewrites(string: str, itype: pynini.TokenType,
+                          otype: pynini.TokenType) -> List[str]:
+      try:
+        return engine.optimal_rewrites(string, itype, otype, state_multiplier)
+      except pynini.FstOpError:
+        raise rewrite.Error("Composition failure")
+
+    return await self._submit(f"optimal_rewrites:{state_multiplier}", string,
+                              0, input_token_type, output_token_type,
+                              _optimal_rewrites)
@@ -22,13 +22,21 @@ a set of strings in a text. The user provides a tag label,
 a (possibly weighted) acceptor matching the strings to be tagged,
 and unweighted cyclic acceptor \Sigma^*.
 
-At inference time, we compose the string with the rewrite rule transducer,
-compute the shortest-path, and take the output string. The shortest-path
-step is necessary as there is no guarantee that the rewrite rule transducer
-is functional (for example, one string in the "vocabulary" could contain
+String inputs are tagged natively: the text is scanned from left to right with
+a deterministic copy of the matcher, and at each position the best (and among
+those, the longest) match is tagged. Texts may also be streamed through the
+tagger chunk by chunk, in which case tagged output is produced as soon as it is
+known.
+
+FST inputs are instead composed with the equivalent rewrite rule transducer,
+and the output string of the shortest path is taken. The shortest-path step is
+necessary as there is no guarantee that the rewrite rule transducer is
+functional (for example, one string in the "vocabulary" could contain
 another).
 """
 
+from typing import Iterable, Iterator
+
 import pynini
 from pynini.lib import pynutil
 from pynini.lib import rewrite
@@ -58,9 +66,14 @@ class Tagger:
     Raises:
         Error: Tag is not in the alphabet.
     """
+    ltag_string = self.LTAG_TEMPLATE.format(tag_label)
+    rtag_string = self.RTAG_TEMPLATE.format(tag_label)
+    # Builds native tagger for string inputs.
+    self._engine = pynini.TaggerEngine(matcher, sigma_star, ltag_string,
+                                       rtag_string)
     # Builds tag transducer.
-    ltag = pynutil.insert(self.LTAG_TEMPLATE.format(tag_label))
-    rtag = pynutil.insert(self.RTAG_TEMPLATE.format(tag_label))
+    ltag = pynutil.insert(ltag_string)
+    rtag = pynutil.insert(rtag_string)
     self._tagger = pynini.cdrewrite(ltag + matcher + rtag, "", "",
                                     sigma_star).optimize()
 
@@ -75,6 +88,35 @@ class Tagger:
 
     Returns:
       The tagged string.
+
+    Raises:
+      rewrite.Error: Tagging failed.
     """
+    if isinstance(string, str):
+      try:
+        return self._engine.tag(string)
+      except pynini.FstOpError as error:
+        raise rewrite.Error("Tagging failed") from error
     return rewrite.one_top_rewrite(string, self._tagger)
 
+  def tag_stream(self, chunks: Iterable[str]) -> Iterator[str]:
+    """Tags a text given as an iterable of chunks.
+
+    Tagged output is yielded as soon as it is known; only the part of the text
+    in which a match might still be found is buffered, so large texts can be
+    tagged in bounded memory. Concatenating the output gives the same result as
+    tagging the concatenated chunks.
+
+    Args:
+      chunks: An iterable of strings which together make up the input.
+
+    Yields:
+      Successive non-empty parts of the tagged string.
+
+    Raises:
+      rewrite.Error: Tagging failed.
+    """
+    try:
+      yield from self._engine.tag_stream(chunks)
+    except pynini.FstOpError as error:
+      raise rewrite.Error("Tagging failed") from error
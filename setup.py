@@ -38,7 +38,9 @@ if sys.platform.startswith("darwin"):
   COMPILE_ARGS.append("-mmacosx-version-min=10.7")
 
 
-LIBRARIES = ["fstfarscript", "fstfar", "fstscript", "fst", "m", "dl"]
+LIBRARIES = [
+    "fstfarscript", "fstfar", "fstscript", "fst", "m", "dl", "pthread"
+]
 
 
 pywrapfst = Extension(
@@ -57,18 +59,27 @@ pynini = Extension(
         "extensions/_pynini.pyx",
         "extensions/cdrewritescript.cc",
         "extensions/concatrangescript.cc",
+        "extensions/constfstviewscript.cc",
         "extensions/crossscript.cc",
         "extensions/defaults.cc",
         "extensions/getters.cc",
         "extensions/lenientlycomposescript.cc",
+        "extensions/levenshteinautomatonscript.cc",
+        "extensions/memorymap.cc",
+        "extensions/memoryusagescript.cc",
         "extensions/optimizescript.cc",
         "extensions/pathsscript.cc",
+        "extensions/rewritecache.cc",
+        "extensions/rewritecachescript.cc",
+        "extensions/rewritescript.cc",
+        "extensions/rulecascadescript.cc",
         "extensions/stringcompile.cc",
         "extensions/stringcompilescript.cc",
         "extensions/stringfile.cc",
         "extensions/stringmapscript.cc",
         "extensions/stringprintscript.cc",
         "extensions/stringutil.cc",
+        "extensions/taggerscript.cc",
     ],
 )
 
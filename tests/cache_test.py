@@ -0,0 +1,108 @@
+# Copyright 2016-2020 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+"""Tests for the build cache."""
+
+import os
+
+import pynini
+from pynini.export import cache
+from absl.testing import absltest
+
+
+class BuildCacheTest(absltest.TestCase):
+
+  def setUp(self):
+    super().setUp()
+    self._directory = self.create_tempdir().full_path
+    self._build_cache = cache.BuildCache(self._directory)
+    self._calls = 0
+
+  def _closure(self, fst: pynini.Fst) -> pynini.Fst:
+    self._calls += 1
+    return fst.copy().closure()
+
+  def testCallReusesResult(self):
+    fst = pynini.accep('ab')
+    first = self._build_cache.call(self._closure, fst)
+    second = self._build_cache.call(self._closure, fst)
+    self.assertEqual(self._calls, 1)
+    self.assertEqual(self._build_cache.hits, 1)
+    self.assertTrue(pynini.equal(first, second))
+
+  def testDifferentArgumentsMiss(self):
+    self._build_cache.call(self._closure, pynini.accep('ab'))
+    self._build_cache.call(self._closure, pynini.accep('ba'))
+    self.assertEqual(self._calls, 2)
+
+  def testEditedFunctionMisses(self):
+
+    def closure(fst: pynini.Fst) -> pynini.Fst:
+      return fst.copy().closure()
+
+    def plus(fst: pynini.Fst) -> pynini.Fst:
+      return fst.copy().closure(1)
+
+    def invert(fst: pynini.Fst) -> pynini.Fst:
+      return fst.copy().invert()
+
+    fst = pynini.accep('ab')
+    keys = set()
+    for function in (closure, plus, invert):
+      # Gives all three the same name, as if one were edited between builds.
+      function.__qualname__ = 'builder'
+      keys.add(self._build_cache.key(function, fst))
+    self.assertLen(keys, 3)
+
+  def testResultsPersistAcrossCaches(self):
+    fst = pynini.accep('ab')
+    self._build_cache.call(self._closure, fst)
+    cache.BuildCache(self._directory).call(self._closure, fst)
+    self.assertEqual(self._calls, 1)
+
+  def testDisabledCacheAlwaysComputes(self):
+    build_cache = cache.BuildCache()
+    fst = pynini.accep('ab')
+    build_cache.call(self._closure, fst)
+    build_cache.call(self._closure, fst)
+    self.assertEqual(self._calls, 2)
+    self.assertFalse(build_cache.enabled)
+
+  def testStringFileKeyedByContents(self):
+    path = os.path.join(self._directory, 'lexicon.tsv')
+    with open(path, 'w') as sink:
+      sink.write('a\tb\n')
+    self.assertEqual(('a' @ self._build_cache.string_file(path)).string(), 'b')
+    with open(path, 'w') as sink:
+      sink.write('a\tc\n')
+    self.assertEqual(('a' @ self._build_cache.string_file(path)).string(), 'c')
+    self.assertEqual(self._build_cache.misses, 2)
+
+  def testCDRewriteMatchesUncached(self):
+    sigma_star = pynini.union(*'abc').closure()
+    tau = pynini.cross('a', 'b')
+    for _ in range(2):
+      rule = self._build_cache.cdrewrite(tau, '', '', sigma_star)
+      self.assertTrue(
+          pynini.equal(rule, pynini.cdrewrite(tau, '', '', sigma_star)))
+    self.assertEqual(self._build_cache.hits, 1)
+
+  def testUnsupportedArgumentRaisesTypeError(self):
+    with self.assertRaises(TypeError):
+      self._build_cache.call(self._closure, object())
+
+
+if __name__ == '__main__':
+  absltest.main()
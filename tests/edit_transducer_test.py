@@ -21,6 +21,7 @@ import string
 
 from absl.testing import absltest
 
+import pynini
 from pynini.lib import edit_transducer
 
 
@@ -81,6 +82,20 @@ class EditTest(absltest.TestCase):
     with self.assertRaises(edit_transducer.Error):
       unused_closest = self.automaton.closest_match("Gruyère")
 
+  def testKClosestMatchesAreInDistanceOrder(self):
+    res = self.automaton.k_closest_matches("cheese", 4)
+    self.assertSameElements(("cheddar", "cheshire"), res[:2])
+    self.assertLen(res, 4)
+    distances = [self.distance.distance("cheese", match) for match in res]
+    self.assertEqual(sorted(distances), distances)
+
+  def testNativeMatchesAgreeWithLattice(self):
+    for query in ("mozarela", "emmenthal", "rockford", "cheese"):
+      # Passing an FST forces the lattice-based implementation.
+      self.assertSameElements(
+          self.automaton.closest_matches(pynini.accep(query)),
+          self.automaton.closest_matches(query))
+
 
 class BoundEditTest(absltest.TestCase):
   """Same as above but with a bound of 2."""
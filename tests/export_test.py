@@ -74,6 +74,51 @@ class PyniniExporterTest(absltest.TestCase):
       self.assertTrue(stored_fsts['FSTA'])
       self.assertTrue(stored_fsts['FSTB'])
 
+  def testExportCDRewrites(self):
+    """Export rules compiled concurrently."""
+    sigma_star = pynini.union(*'abc').closure()
+    rules = {
+        'A_TO_B': (pynini.cross('a', 'b'), '', ''),
+        'B_TO_C': (pynini.cross('b', 'c'), 'a', ''),
+    }
+    exporter = export.Exporter(self._filename)
+    compiled = exporter.export_cdrewrites(rules, sigma_star)
+    exporter.close()
+    self.assertEqual(('aab' @ compiled['A_TO_B']).string(), 'bbb')
+    self.assertEqual(('abb' @ compiled['B_TO_C']).string(), 'acb')
+    for name, (tau, l, r) in rules.items():
+      expected = pynini.cdrewrite(tau, l, r, sigma_star)
+      for istring in ('aab', 'abb', 'cab', 'bac'):
+        self.assertEqual((istring @ compiled[name]).string(),
+                         (istring @ expected).string())
+    stored_fsts = _read_fst_map(self._filename)
+    self.assertLen(stored_fsts, 2)
+
+  def testExportBuilders(self):
+    """Export FSTs built concurrently."""
+    builders = {
+        f'FST{i}': (lambda i=i: pynini.accep(str(i)).closure().optimize())
+        for i in range(8)
+    }
+    exporter = export.Exporter(self._filename)
+    built = exporter.export_builders(builders, num_threads=4)
+    exporter.close()
+    self.assertCountEqual(built, builders)
+    stored_fsts = _read_fst_map(self._filename)
+    self.assertLen(stored_fsts, 8)
+    for name, fst in built.items():
+      self.assertTrue(pynini.equal(stored_fsts[name], fst))
+
+  def testExportBuildersUseDefaultTokenType(self):
+    """Export FSTs built concurrently with the caller's default token type."""
+    exporter = export.Exporter(self._filename)
+    with pynini.default_token_type('utf8'):
+      built = exporter.export_builders({'FST': lambda: pynini.accep('é')},
+                                       num_threads=2)
+    exporter.close()
+    self.assertEqual(built['FST'].num_states(), 2)
+
+
 if __name__ == '__main__':
   absltest.main()
 
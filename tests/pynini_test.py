@@ -17,6 +17,7 @@
 """Tests for the Pynini grammar compilation module."""
 
 import collections
+import concurrent.futures
 import functools
 import math
 import os
@@ -126,6 +127,54 @@ class CDRewriteTest(unittest.TestCase):
       unused_f = cdrewrite(
           cross("A", "B"), "C", accep("D", weight=2), self.sigstar)
 
+  def testLazyRuleMatchesEagerRule(self):
+    tau = cross(self.coronal, "")
+    lazy = lazy_cdrewrite(tau, "", "S[EOS]", self.sigstar)
+    self.assertNotIsInstance(lazy, Fst)
+    cascade = RuleCascadeEngine([lazy], lazy=True)
+    for istring in ("CONCORDS", "PVLTS", "HONORS", "SANGVINS", "LASES"):
+      rule = cdrewrite(tau, "", "S[EOS]", self.sigstar)
+      self.assertEqual(cascade.top_rewrite(istring),
+                       (istring @ rule).string())
+
+  def testLazyRuleWithTransducerContextRaisesFstOpError(self):
+    with self.assertRaises(FstOpError):
+      unused_f = lazy_cdrewrite(
+          cross("A", "B"), cross("C", "D"), "E", self.sigstar)
+
+  def testLabelClassRuleMatchesEagerRule(self):
+    for (tau, l, r) in ((cross("A", "B"), "C", "D"),
+                        (cross(self.coronal, ""), "", "S[EOS]"),
+                        (cross("A", "BB"), "[BOS]", "")):
+      eager = cdrewrite(tau, l, r, self.sigstar)
+      rule = label_class_cdrewrite(tau, l, r, self.sigstar)
+      self.assertNotIsInstance(rule, Fst)
+      for istring in ("CADCAD", "CONCORDS", "PVLTS", "AbbA", "xyz"):
+        self.assertEqual(
+            compose(istring, rule).string(), (istring @ eager).string())
+
+  def testOptionalLabelClassRuleMatchesEagerRule(self):
+    tau = cross("a", "b")
+    eager = cdrewrite(tau, "", "", self.sigstar, mode="opt")
+    rule = label_class_cdrewrite(tau, "", "", self.sigstar, mode="opt")
+    for istring in ("aza", "Zaza"):
+      self.assertSetEqual(
+          set(compose(istring, rule).paths().ostrings()),
+          set((istring @ eager).paths().ostrings()))
+
+  def testLabelClassRuleWithWeightedSigmaStarRaisesFstOpError(self):
+    sigstar = union(*"ABCDE", accep("F", weight=2)).closure()
+    with self.assertRaises(FstOpError):
+      unused_f = label_class_cdrewrite(cross("A", "B"), "C", "D", sigstar)
+
+  def testLabelClassRuleIsSmallerThanEagerRule(self):
+    tau = cross("A", "B")
+    eager = cdrewrite(tau, "C", "D", self.sigstar)
+    rule = label_class_cdrewrite(tau, "C", "D", self.sigstar)
+    self.assertLess(
+        sum(rule.num_arcs(state) for state in rule.states()),
+        sum(eager.num_arcs(state) for state in eager.states()))
+
 
 class ClosureTest(unittest.TestCase):
 
@@ -144,6 +193,76 @@ class ClosureTest(unittest.TestCase):
     # Doesn't accept more than 7 copies.
     self.assertEqual(compose(ac, cheese * (n + 1)).num_states(), 0)
 
+  def testLazyRangeClosureMatchesEagerRangeClosure(self):
+    cheese = accep("Red Windsor")
+    lazy = closure(cheese, 3, 7, lazy=True)
+    self.assertNotIsInstance(lazy, Fst)
+    self.assertTrue(
+        equivalent(
+            Fst.from_pywrapfst(lazy).optimize(),
+            closure(cheese, 3, 7).optimize()))
+
+  def testLazyOpenRangeClosureMatchesEagerOpenRangeClosure(self):
+    cheese = accep("Red Windsor")
+    lazy = Fst.from_pywrapfst(closure(cheese, 2, lazy=True))
+    for i in range(2):
+      self.assertEqual(compose(lazy, "Red Windsor" * i).num_states(), 0)
+    for i in range(2, 6):
+      self.assertNotEqual(compose(lazy, "Red Windsor" * i).num_states(), 0)
+
+
+class CrossTest(unittest.TestCase):
+
+  def testStringCrossOfUnequalLengthsIsTransduced(self):
+    f = cross(accep("ab", weight=1), accep("xyz", weight=2))
+    self.assertEqual(f.num_states(), 4)
+    self.assertEqual(("ab" @ f).string(), "xyz")
+    self.assertEqual(
+        float(shortestdistance(f, reverse=True)[f.start()]), 3)
+
+  def testStringCrossWithEmptyStringIsTransduced(self):
+    self.assertEqual(("" @ cross("", "abc")).string(), "abc")
+    self.assertEqual(("abc" @ cross("abc", "")).string(), "")
+
+  def testLazyCrossMatchesEagerCross(self):
+    upper = union("Red Leicester", "Tilsit", "Caerphilly")
+    lower = union("England", "Russia")
+    lazy = lazy_cross(upper, lower)
+    self.assertNotIsInstance(lazy, Fst)
+    eager = cross(upper, lower)
+    for istring in ("Tilsit", "Caerphilly", "Stilton"):
+      self.assertTrue(
+          equivalent(
+              (istring @ Fst.from_pywrapfst(lazy)).project("output").optimize(),
+              (istring @ eager).project("output").optimize()))
+
+
+class DefaultTokenTypeTest(unittest.TestCase):
+
+  def testDefaultTokenTypeOverridesCompilation(self):
+    with default_token_type("utf8"):
+      f = accep("é")
+    self.assertEqual(f.num_states(), 2)
+    self.assertEqual(accep("é").num_states(), 3)
+
+  def testDefaultTokenTypeIsThreadLocal(self):
+    with default_token_type("utf8"):
+      with concurrent.futures.ThreadPoolExecutor(1) as executor:
+        f = executor.submit(accep, "é").result()
+      self.assertEqual(accep("é").num_states(), 2)
+    # The worker thread uses its own defaults, namely "byte".
+    self.assertEqual(f.num_states(), 3)
+
+  def testGetDefaultTokenTypePassesDefaultToWorkers(self):
+    self.assertEqual(get_default_token_type(), "byte")
+    with default_token_type("utf8"):
+      token_type = get_default_token_type()
+      with concurrent.futures.ThreadPoolExecutor(1) as executor:
+        utf8_accep = default_token_type(token_type)(accep)
+        f = executor.submit(utf8_accep, "é").result()
+    self.assertEqual(token_type, "utf8")
+    self.assertEqual(f.num_states(), 2)
+
 
 class DifferenceTest(unittest.TestCase):
 
@@ -291,6 +410,11 @@ class ExceptionsTest(unittest.TestCase):
     with self.assertRaises(FstArgError):
       unused_sp = self.f.paths(output_token_type="nonexistent")
 
+  def testNonStringFstStringRaisesFstOpError(self):
+    # The final state has an outgoing arc, so this is not a string FST.
+    with self.assertRaises(FstOpError):
+      unused_s = accep("ab").closure().string()
+
   def testTransducerDifferenceRaisesFstArgError(self):
     with self.assertRaises(FstOpError):
       unused_f = difference(self.exchange, self.exchange)
@@ -331,6 +455,80 @@ class ExceptionsTest(unittest.TestCase):
       unused_w = Weight("nonexistent", 1)
 
 
+class FreezeTest(unittest.TestCase):
+
+  @classmethod
+  def setUpClass(cls):
+    super().setUpClass()
+    # Unsorted, so that freezing must sort it.
+    cls.rule = union(cross("b", "c"), cross("a", "b")).optimize()
+    cls.frozen = cls.rule.freeze()
+    cls.sorted_rule = cls.rule.copy().arcsort("ilabel")
+
+  def testFrozenFstIsImmutableConstFst(self):
+    self.assertNotIsInstance(self.frozen, pywrapfst.MutableFst)
+    self.assertEqual(self.frozen.fst_type(), "const")
+    self.assertEqual(self.frozen.properties(I_LABEL_SORTED, True),
+                     I_LABEL_SORTED)
+    self.assertTrue(equal(self.frozen, self.sorted_rule))
+
+  def testFrozenFstPrints(self):
+    self.assertCountEqual(self.frozen.paths().ostrings(), ["b", "c"])
+    self.assertEqual(accep("abc").freeze().string(), "abc")
+
+  def testFrozenFstComposes(self):
+    self.assertEqual(project(compose("a", self.frozen), "output").string(), "b")
+    self.assertEqual(project(compose(self.frozen, "b"), "input").string(), "a")
+    self.assertEqual(string_view_top_rewrite("b", self.frozen), "c")
+    self.assertEqual(batch_top_rewrite(["a", "b"], self.frozen), ["b", "c"])
+
+  def testFrozenFstIsAcceptedByOtherOperations(self):
+    self.assertCountEqual(
+        union(self.frozen, "d").paths().ostrings(), ["b", "c", "d"])
+    self.assertEqual(Fst.from_pywrapfst(self.frozen).fst_type(), "vector")
+
+  def testFrozenFstPickles(self):
+    for protocol in (4, 5):
+      unpickled = pickle.loads(pickle.dumps(self.frozen, protocol=protocol))
+      self.assertIsInstance(unpickled, FrozenFst)
+      self.assertTrue(equal(unpickled, self.sorted_rule))
+
+  def testFrozenFstPicklesOutOfBand(self):
+    buffers = []
+    data = pickle.dumps(self.frozen, protocol=5, buffer_callback=buffers.append)
+    self.assertEqual(len(buffers), 1)
+    unpickled = pickle.loads(data, buffers=buffers)
+    self.assertEqual(string_view_top_rewrite("a", unpickled), "b")
+
+  def testFrozenFstFromBuffer(self):
+    image = bytearray(self.frozen.to_buffer())
+    frozen = FrozenFst.from_buffer(image)
+    self.assertEqual(frozen.fst_type(), "const")
+    self.assertEqual(project(compose("b", frozen), "output").string(), "c")
+    # The buffer stays exported while the FST is alive.
+    with self.assertRaises(BufferError):
+      image.clear()
+
+  def testCascadeKeepsBorrowedRuleAlive(self):
+    # A lazy cascade shares the storage of the rule, rather than copying it.
+    cascade = RuleCascadeEngine(
+        [FrozenFst.from_buffer(bytearray(self.frozen.to_buffer()))], lazy=True)
+    self.assertEqual(cascade.top_rewrite("b"), "c")
+
+  def testLazyLenientCompositionOutlivesBorrowedFst(self):
+    composer = LenientComposer(self.rule, union("a", "b", "c").closure())
+    image = bytearray(accep("a").freeze().to_buffer())
+    delayed = composer(FrozenFst.from_buffer(image), lazy=True)
+    # The frozen FST is gone, so the buffer may be overwritten.
+    image[:] = bytes(len(image))
+    self.assertEqual(
+        Fst.from_pywrapfst(delayed).project("output").optimize().string(), "b")
+
+  def testGarbageBufferRaisesFstIOError(self):
+    with self.assertRaises(FstIOError):
+      FrozenFst.from_buffer(b"garbage")
+
+
 class GeneratedSymbolsTest(unittest.TestCase):
 
   def testBosIndex(self):
@@ -360,6 +558,26 @@ class GeneratedSymbolsTest(unittest.TestCase):
     syms = generated_symbols()
     self.assertTrue(syms.member(cheese))
 
+  def testConcurrentlyGeneratedSymbolsAreConsistent(self):
+    tags = [f"Cheese{i}" for i in range(100)] * 4
+    with concurrent.futures.ThreadPoolExecutor(4) as executor:
+      fsts = list(executor.map(lambda tag: accep(f"[{tag}]"), tags))
+    syms = generated_symbols()
+    for tag, f in zip(tags, fsts):
+      self.assertEqual(syms.find(tag), f.arcs(f.start()).value().ilabel)
+
+  def testGeneratedSymbolsCanBeReadDuringGeneration(self):
+    tags = [f"Cheddar{i}" for i in range(100)]
+    with concurrent.futures.ThreadPoolExecutor(4) as executor:
+      futures = [executor.submit(accep, f"[{tag}]") for tag in tags]
+      # Each copy is consistent, though it may lack some of the symbols.
+      while not all(future.done() for future in futures):
+        syms = generated_symbols()
+        self.assertEqual(len(list(syms)), syms.num_symbols())
+    syms = generated_symbols()
+    for tag in tags:
+      self.assertTrue(syms.member(tag))
+
 
 class IOTest(unittest.TestCase):
 
@@ -423,6 +641,134 @@ class LenientlyComposeTest(unittest.TestCase):
         leniently_compose(cheese, self.cheese_geography,
                           self.sigstar).project("output").optimize(), "England")
 
+  def testLenientComposerMatchesLenientlyCompose(self):
+    composer = LenientComposer(self.cheese_geography, self.sigstar)
+    self.assertEqual(composer("Wisconsin Cheddar"), "Wisconsin Cheddar")
+    self.assertEqual(
+        composer("Lancashire").project("output").optimize(), "England")
+
+  def testLazyLenientComposerOutputCanBeLenientlyComposed(self):
+    composer = LenientComposer(self.cheese_geography, self.sigstar)
+    delayed = composer("Lancashire", lazy=True)
+    self.assertNotIsInstance(delayed, Fst)
+    self.assertEqual(
+        composer(delayed).project("output").optimize(), "England")
+
+
+class MemoryUsageTest(unittest.TestCase):
+
+  def testMemoryUsageGrowsWithArcs(self):
+    short = accep("Cheddar")
+    long = accep("Cheddar" * 10)
+    self.assertGreater(long.memory_usage().arcs, short.memory_usage().arcs)
+    self.assertGreater(long.memory_usage().states, short.memory_usage().states)
+    self.assertEqual(short.memory_usage().caches, 0)
+
+  def testMemoryUsageCountsSymbolTables(self):
+    f = accep("Cheddar")
+    self.assertEqual(f.memory_usage().symbols, 0)
+    syms = SymbolTable()
+    syms.add_symbol("<epsilon>")
+    syms.add_symbol("Cheddar")
+    f.set_input_symbols(syms)
+    one = f.memory_usage().symbols
+    self.assertGreater(one, 0)
+    f.set_output_symbols(syms)
+    self.assertEqual(f.memory_usage().symbols, one)
+
+  def testMemoryUsageOfFrozenFst(self):
+    frozen = accep("Cheddar").freeze()
+    usage = frozen.memory_usage()
+    self.assertGreater(usage.arcs, 0)
+    self.assertEqual(usage.total, usage.states + usage.arcs + usage.symbols)
+
+  def testMemoryUsageOfDelayedFstDoesNotCountStates(self):
+    sigstar = union(*"abc").closure()
+    rule = lazy_cdrewrite(cross("a", "b"), "", "", sigstar)
+    self.assertEqual(memory_usage(rule).states, 0)
+
+  def testMemoryUsageOfDelayedRuleCountsCacheLimits(self):
+    sigstar = union(*"abc").closure()
+    small = lazy_cdrewrite(cross("a", "b"), "", "", sigstar,
+                           cache_gc_limit=1 << 10)
+    large = lazy_cdrewrite(cross("a", "b"), "", "", sigstar,
+                           cache_gc_limit=1 << 20)
+    self.assertGreater(memory_usage(small).caches, 0)
+    self.assertEqual(memory_usage(large).caches,
+                     (1 << 10) * memory_usage(small).caches)
+
+  def testRewriteCacheMemoryUsage(self):
+    cache = RewriteCache()
+    cache.insert(1, "top_rewrite", "Cheddar", ["Cheddar"])
+    self.assertEqual(cache.memory_usage().caches, cache.num_bytes())
+    self.assertGreater(cache.memory_usage().total, 0)
+
+
+class OptimizeTest(unittest.TestCase):
+
+  def testOptimizeStatsForTransducer(self):
+    f = union(cross("ab", "x"), cross("ac", "y"))
+    stats = OptimizeStats()
+    f.optimize(stats=stats)
+    self.assertFalse(stats.acceptor)
+    self.assertTrue(stats.determinized)
+    self.assertTrue(stats.encode_flags & ENCODE_LABELS)
+    names = [phase[0] for phase in stats.phases]
+    self.assertEqual(names[:5],
+                     ["rmepsilon", "encode", "determinize", "minimize",
+                      "decode"])
+    self.assertEqual(stats.phases[-1][4], f.num_states())
+    for _, seconds, *_ in stats.phases:
+      self.assertGreaterEqual(seconds, 0)
+
+  def testOptimizeStatsForDeterministicAcceptor(self):
+    f = accep("Gouda")
+    stats = OptimizeStats()
+    optimize(f, stats=stats)
+    self.assertTrue(stats.acceptor)
+    self.assertFalse(stats.determinized)
+    self.assertEqual(stats.encode_flags, 0)
+    self.assertEqual([phase[0] for phase in stats.phases], ["minimize"])
+
+  def testOptimizeWithStateLimitLeavesFstUndeterminized(self):
+    sigma = union("a", "b")
+    # Determinizing this requires 2^11 states.
+    f = sigma.closure() + "a" + sigma.closure(10, 10)
+    stats = OptimizeStats()
+    g = optimize(f, stats=stats, max_determinized_states=100)
+    self.assertTrue(g.optimize_limit_exceeded)
+    self.assertTrue(stats.limit_exceeded)
+    self.assertFalse(stats.determinized)
+    self.assertEqual(g.properties(NO_EPSILONS, True), NO_EPSILONS)
+    self.assertNotEqual(compose("ba" + "b" * 10, g).num_states(), 0)
+    self.assertEqual(compose("b" * 11, g).num_states(), 0)
+
+  def testOptimizeWithinStateLimitDeterminizes(self):
+    stats = OptimizeStats()
+    f = union(cross("ab", "x"), cross("ac", "y"))
+    f.optimize(stats=stats,
+               max_determinized_states=100,
+               max_determinized_bytes=1 << 20)
+    self.assertFalse(f.optimize_limit_exceeded)
+    self.assertFalse(stats.limit_exceeded)
+    self.assertTrue(stats.determinized)
+
+  def testOptimizeWithinStateLimitKeepsSymbolTables(self):
+    syms = SymbolTable()
+    syms.add_symbol("<epsilon>")
+    f = union("ab", "ac")
+    f.set_input_symbols(syms)
+    f.set_output_symbols(syms)
+    f.optimize(max_determinized_states=100)
+    self.assertIsNotNone(f.input_symbols())
+    self.assertIsNotNone(f.output_symbols())
+
+  def testOptimizeStatsAreOverwritten(self):
+    stats = OptimizeStats()
+    union(cross("ab", "x"), cross("ac", "y")).optimize(stats=stats)
+    accep("Gouda").optimize(stats=stats)
+    self.assertEqual(len(stats.phases), 1)
+
 
 class StringTest(unittest.TestCase):
   """Tests string compilation and stringification."""
@@ -554,6 +900,15 @@ class StringTest(unittest.TestCase):
     with self.assertRaises(FstOpError):
       unused_ac = union(self.cheese, self.imported_cheese).string()
 
+  def testUtf8StringifyOfNonCodePointRaisesFstOpError(self):
+    f = Fst()
+    f.add_states(2)
+    f.set_start(0)
+    f.set_final(1)
+    f.add_arc(0, Arc(0x200000, 0x200000, 0, 1))
+    with self.assertRaises(FstOpError):
+      unused_string = f.string("utf8")
+
   def testCompositionOfStringAndLogArcWorks(self):
     cheese = "Greek Feta"
     self.assertEqual(cheese @ accep(cheese, arc_type="log"), cheese)
@@ -627,6 +982,22 @@ class StringFileTest(unittest.TestCase):
     self.ContainsMapping("[Bel Paese]", mapper, symc("Sorry"))
     self.ContainsMapping("Pont-l'Évêque", mapper, symc("Camembert"))
 
+  def testMultithreadedStringFileMatchesSerial(self):
+    serial = string_file(self.map_file)
+    self.assertTrue(equal(serial, string_file(self.map_file, num_threads=4)))
+    self.assertTrue(equal(serial, string_file(self.map_file, num_threads=0)))
+
+  def testMultithreadedStringFileWithEscapedCommentsMatchesSerial(self):
+    # Lines with escapes are unescaped into a buffer, so must be copied.
+    with tempfile.TemporaryDirectory() as tmpdir:
+      path = os.path.join(tmpdir, "escaped.map")
+      with open(path, "w") as sink:
+        for i in range(100):
+          print(f"{i}\\#\t{i % 7}\t{i / 10}", file=sink)
+      serial = string_file(path)
+      self.assertTrue(equal(serial, string_file(path, num_threads=4)))
+    self.ContainsMapping("42#", serial, "0")
+
 
 class StringMapTest(unittest.TestCase):
 
@@ -677,6 +1048,49 @@ class StringMapTest(unittest.TestCase):
     self.ContainsMapping("[Bel Paese]", mapper, symc("Sorry"))
     self.ContainsMapping("Pont-l'Évêque", mapper, symc("Camembert"))
 
+  def testStringMapWeightsParseAsFloats(self):
+    mapper = string_map([("a", "b", "1.5"), ("c", "d", "+2"),
+                         ("e", "f", "1e1"), ("g", "h", ".25")])
+    weights = {
+        istring: float(weight)
+        for istring, _, weight in mapper.paths().items()
+    }
+    self.assertEqual(weights, {"a": 1.5, "c": 2, "e": 10, "g": 0.25})
+
+  def testStringMapBadWeightRaisesFstArgError(self):
+    with self.assertRaises(FstArgError):
+      unused_f = string_map([("a", "b", "1.5x2")])
+
+  def testMultithreadedStringMapMatchesSerial(self):
+    lines = [(f"{i:05d}", f"[{i % 7}]{i}") for i in range(1000)]
+    serial = string_map(lines, input_token_type="utf8")
+    parallel = string_map(lines, input_token_type="utf8", num_threads=4)
+    self.assertTrue(equal(serial, parallel))
+
+  def testMinimizedStringMapOfSortedAcceptorIsMinimal(self):
+    words = sorted(["Brie", "Brie de Meaux", "Cheddar", "Cheshire", "Stilton"])
+    mapper = string_map(words, minimize=True)
+    self.assertEqual(mapper.num_states(),
+                     string_map(words).optimize().num_states())
+    self.assertCountEqual(mapper.paths().istrings(), words)
+
+  def testMinimizedStringMapOfSortedTransducer(self):
+    lines = sorted([("Brie", "soft"), ("Camembert", "soft"),
+                    ("Cheddar", "hard"), ("Cheddar", "sharp")])
+    mapper = string_map(lines, minimize=True)
+    self.assertLess(mapper.num_states(), string_map(lines).num_states())
+    self.assertCountEqual(
+        ((istring, ostring) for istring, ostring, _ in mapper.paths().items()),
+        lines)
+
+  def testMinimizedStringMapOfUnsortedLinesFallsBackToPrefixTree(self):
+    self.assertTrue(
+        equal(string_map(self.lines, minimize=True), string_map(self.lines)))
+
+  def testMultithreadedStringMapIllFormedLineRaisesFstArgError(self):
+    with self.assertRaises(FstArgError):
+      unused_f = string_map(self.lines + [("a", "b", "c", "d")], num_threads=4)
+
 
 class StringPathIteratorTest(unittest.TestCase):
 
@@ -724,6 +1138,36 @@ class StringPathIteratorTest(unittest.TestCase):
     f = union(*cheeses)
     self.assertCountEqual(cheeses, f.paths().ostrings())
 
+  def testStringPathsExtractAllMatchesItems(self):
+    expected = [(i, o, str(w)) for i, o, w in self.f.paths().items()]
+    actual = [(i, o, str(w)) for i, o, w in self.f.paths().extract_all()]
+    self.assertEqual(expected, actual)
+
+  def testStringPathsExtractAllWithLimit(self):
+    sp = self.f.paths()
+    first = sp.extract_all(limit=1)
+    self.assertEqual(len(first), 1)
+    rest = sp.extract_all()
+    self.assertTrue(sp.done())
+    self.assertCountEqual(
+        (t[1] for t in first + rest), (t[1] for t in self.triples))
+
+
+class ShortestStringsTest(unittest.TestCase):
+
+  def testShortestStringsAreUniqueAndInWeightOrder(self):
+    f = union(
+        accep("Caerphilly", weight=3),
+        accep("Cheddar", weight=1),
+        accep("Caerphilly", weight=2))
+    self.assertEqual([(s, str(w)) for s, w in f.shortest_strings()],
+                     [("Cheddar", "1"), ("Caerphilly", "2")])
+
+  def testShortestStringsOfCyclicFstIsLazy(self):
+    f = accep("a", weight=1).closure()
+    strings = f.shortest_strings()
+    self.assertEqual([next(strings)[0] for _ in range(3)], ["", "a", "aa"])
+
 
 class SymbolTableTest(unittest.TestCase):
 
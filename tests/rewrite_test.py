@@ -17,6 +17,7 @@
 # pynini.opengrm.org.
 """Tests rewrite functions."""
 
+import asyncio
 import string
 
 import pynini
@@ -101,6 +102,19 @@ class TDTest(absltest.TestCase):
     self.assertTrue(rewrite.matches("fist", "fis", rule))
     self.assertFalse(rewrite.matches("fis", "fist", rule))
 
+  def testStringViewRewrite(self):
+    rule = pynini.cdrewrite(
+        pynutil.delete(self.td), self.consonant, "[EOS]",
+        self.sigstar).optimize()
+    self.assertEqual("fis",
+                     rewrite.top_rewrite("fist", rule, parse_brackets=False))
+    lattice = rewrite.rewrite_lattice("fist", rule, parse_brackets=False)
+    self.assertEqual("fis", rewrite.lattice_to_top_string(lattice))
+    # Brackets are not special characters here, so they are ordinary bytes
+    # outside the rule's alphabet.
+    with self.assertRaisesRegex(rewrite.Error, r"Composition failure"):
+      unused_var = rewrite.top_rewrite("[fist]", rule, parse_brackets=False)
+
   def testOptionalRewrite(self):
     rule = pynini.cdrewrite(
         pynutil.delete(self.td),
@@ -115,6 +129,24 @@ class TDTest(absltest.TestCase):
     self.assertTrue(rewrite.matches("fist", "fist", rule))
     self.assertFalse(rewrite.matches("fis", "fist", rule))
 
+  def testMatchesWithFstsAndFrozenRule(self):
+    rule = pynini.cdrewrite(
+        pynutil.delete(self.td),
+        self.consonant,
+        "[EOS]",
+        self.sigstar,
+        mode="opt").optimize()
+    frozen = rule.freeze()
+    self.assertTrue(
+        rewrite.matches(pynini.accep("fist"), pynini.accep("fis"), frozen))
+    self.assertTrue(rewrite.matches("fist", "fist", frozen))
+    self.assertFalse(rewrite.matches("fist", "fi", frozen))
+    # The output need not be a single string.
+    self.assertTrue(
+        rewrite.matches("fist", pynini.union("fis", "xyz").optimize(), rule))
+    with self.assertRaisesRegex(rewrite.Error, r"Composition failure"):
+      rewrite.matches("FIST", "FIS", rule)
+
 
 class RankedTest(absltest.TestCase):
   """Made-up rule cascade in which consonant cluster simplification:
@@ -130,6 +162,7 @@ class RankedTest(absltest.TestCase):
 
   sigstar: pynini.Fst
   consonant: pynini.Fst
+  rule: pynini.Fst
 
   @classmethod
   def setUpClass(cls):
@@ -137,17 +170,294 @@ class RankedTest(absltest.TestCase):
     cls.sigstar = pynini.union(*string.ascii_lowercase).closure().optimize()
     cls.consonant = pynini.union("p", "b", "f", "v", "t", "d", "s", "z", "k",
                                  "g", "m", "n", "l", "r").optimize()
-
-  def testRankedRewrite(self):
     deletion_rule = pynini.cdrewrite(
-        pynutil.delete(self.consonant, weight=1), "", self.consonant,
-        self.sigstar)
+        pynutil.delete(cls.consonant, weight=1), "", cls.consonant,
+        cls.sigstar)
     epenthesis_rule = pynini.cdrewrite(
-        pynutil.insert("i", weight=2), self.consonant, self.consonant,
-        self.sigstar)
-    rule = pynini.union(deletion_rule, epenthesis_rule).optimize()
-    self.assertEqual("oto", rewrite.one_top_rewrite("okto", rule))
-    self.assertTrue(rewrite.matches("okto", "oto", rule))
+        pynutil.insert("i", weight=2), cls.consonant, cls.consonant,
+        cls.sigstar)
+    cls.rule = pynini.union(deletion_rule, epenthesis_rule).optimize()
+
+  def testRankedRewrite(self):
+    self.assertEqual("oto", rewrite.one_top_rewrite("okto", self.rule))
+    self.assertTrue(rewrite.matches("okto", "oto", self.rule))
+
+  def testTopRewritesAreInWeightOrder(self):
+    self.assertEqual(["oto", "okito"],
+                     rewrite.top_rewrites("okto", self.rule, 5))
+    self.assertEqual(["oto"], rewrite.top_rewrites("okto", self.rule, 1))
+
+  def testBeamWidensOptimalRewritesAndNarrowsTopRewrites(self):
+    self.assertEqual(["oto"], rewrite.optimal_rewrites("okto", self.rule))
+    self.assertCountEqual(
+        ["oto", "okito"], rewrite.optimal_rewrites("okto", self.rule, beam=1.5))
+    self.assertEqual(["oto"],
+                     rewrite.top_rewrites("okto", self.rule, 5, beam=0.5))
+
+
+class BatchTest(absltest.TestCase):
+  """Tests that batch rewriting agrees with one-at-a-time rewriting."""
+
+  rule: pynini.Fst
+  strings = ["fist", "fish", "mist", "pit", "lift"]
+
+  @classmethod
+  def setUpClass(cls):
+    super().setUpClass()
+    sigstar = pynini.union(*string.ascii_lowercase).closure().optimize()
+    td = pynini.union("t", "d").optimize()
+    consonant = pynini.union(td, "p", "b", "f", "v", "s", "z", "k", "g", "m",
+                             "n", "l", "r").optimize()
+    cls.rule = pynini.cdrewrite(
+        pynutil.delete(td, weight=1), consonant, "[EOS]", sigstar,
+        mode="opt").optimize()
+
+  def testBatchTopRewrite(self):
+    self.assertEqual(
+        rewrite.batch_top_rewrite(self.strings, self.rule, num_threads=2),
+        [rewrite.top_rewrite(istring, self.rule) for istring in self.strings])
+
+  def testBatchRewrites(self):
+    outputs = rewrite.batch_rewrites(self.strings, self.rule, num_threads=2)
+    self.assertLen(outputs, len(self.strings))
+    for istring, ostrings in zip(self.strings, outputs):
+      self.assertCountEqual(ostrings, rewrite.rewrites(istring, self.rule))
+
+  def testBatchTopRewrites(self):
+    outputs = rewrite.batch_top_rewrites(
+        self.strings, self.rule, 2, num_threads=2)
+    for istring, ostrings in zip(self.strings, outputs):
+      self.assertCountEqual(ostrings,
+                            rewrite.top_rewrites(istring, self.rule, 2))
+
+  def testBatchOptimalRewrites(self):
+    outputs = rewrite.batch_optimal_rewrites(self.strings, self.rule)
+    for istring, ostrings in zip(self.strings, outputs):
+      self.assertCountEqual(ostrings,
+                            rewrite.optimal_rewrites(istring, self.rule))
+
+  def testBatchCompositionFailureRaisesError(self):
+    with self.assertRaisesRegex(rewrite.Error, r"Composition failure"):
+      unused_var = rewrite.batch_top_rewrite(["fist", "FIST"], self.rule)
+
+
+class AsyncTest(absltest.TestCase):
+  """Tests that awaited rewriting agrees with one-at-a-time rewriting."""
+
+  rule: pynini.Fst
+  strings = ["fist", "fish", "mist", "pit", "lift"]
+
+  @classmethod
+  def setUpClass(cls):
+    super().setUpClass()
+    sigstar = pynini.union(*string.ascii_lowercase).closure().optimize()
+    td = pynini.union("t", "d").optimize()
+    cls.rule = pynini.cdrewrite(
+        pynutil.delete(td, weight=1), "", "[EOS]", sigstar,
+        mode="opt").optimize()
+
+  def testConcurrentRewritesAgree(self):
+    rewriter = rewrite.AsyncRewriter(self.rule, num_threads=2)
+
+    async def _rewrite():
+      return await asyncio.gather(
+          asyncio.gather(*(rewriter.top_rewrite(s) for s in self.strings)),
+          asyncio.gather(*(rewriter.rewrites(s) for s in self.strings)),
+          asyncio.gather(*(rewriter.top_rewrites(s, 2) for s in self.strings)),
+          asyncio.gather(
+              *(rewriter.optimal_rewrites(s) for s in self.strings)))
+
+    top, all_, top_two, optimal = asyncio.run(_rewrite())
+    for i, istring in enumerate(self.strings):
+      self.assertEqual(top[i], rewrite.top_rewrite(istring, self.rule))
+      self.assertCountEqual(all_[i], rewrite.rewrites(istring, self.rule))
+      self.assertCountEqual(top_two[i],
+                            rewrite.top_rewrites(istring, self.rule, 2))
+      self.assertCountEqual(optimal[i],
+                            rewrite.optimal_rewrites(istring, self.rule))
+
+  def testRewriterIsUnaffectedByChangesToRule(self):
+    rule = self.rule.copy()
+    rewriter = rewrite.AsyncRewriter(rule)
+    rule.invert()
+    self.assertEqual(
+        asyncio.run(rewriter.top_rewrite("fist")),
+        rewrite.top_rewrite("fist", self.rule))
+
+  def testCompositionFailureRaisesErrorForFailingStringOnly(self):
+    rewriter = rewrite.AsyncRewriter(self.rule)
+
+    async def _rewrite():
+      return await asyncio.gather(
+          rewriter.top_rewrite("fist"),
+          rewriter.top_rewrite("FIST"),
+          return_exceptions=True)
+
+    ostring, error = asyncio.run(_rewrite())
+    self.assertEqual(ostring, rewrite.top_rewrite("fist", self.rule))
+    self.assertIsInstance(error, rewrite.Error)
+
+  def testDefaultTokenTypeOfEventLoopIsUsed(self):
+    with pynini.default_token_type("utf8"):
+      rewriter = rewrite.AsyncRewriter(pynini.cross("a", "é"))
+      self.assertEqual(asyncio.run(rewriter.top_rewrite("a")), "é")
+
+
+class StatsTest(absltest.TestCase):
+  """Tests the collection of statistics about rewrite calls."""
+
+  rule: pynini.Fst
+
+  @classmethod
+  def setUpClass(cls):
+    super().setUpClass()
+    sigstar = pynini.union(*string.ascii_lowercase).closure().optimize()
+    cls.rule = pynini.cdrewrite(
+        pynutil.delete("t", weight=1), "", "[EOS]", sigstar,
+        mode="opt").optimize()
+
+  def testRecordsAreAggregatedPerRule(self):
+    sink = rewrite.StatsSink()
+    self.assertCountEqual(
+        rewrite.rewrites("fist", self.rule, stats=sink), ["fist", "fis"])
+    record = sink.last
+    self.assertEqual(record.string, "fist")
+    self.assertGreater(record.lattice_states, 0)
+    self.assertGreater(record.lattice_arcs, 0)
+    self.assertEqual(record.paths, 2)
+    self.assertGreater(record.compose_seconds, 0)
+    self.assertGreater(record.dfa_seconds, 0)
+    self.assertGreaterEqual(record.seconds, record.compose_seconds)
+    rewrite.top_rewrite("mist", self.rule, stats=sink)
+    rewrite.optimal_rewrites("pit", self.rule, stats=sink)
+    stats = sink[self.rule]
+    self.assertEqual(stats.calls, 3)
+    self.assertEqual(stats.failures, 0)
+    self.assertEqual(sum(stats.latency_histogram.values()), 3)
+    self.assertEqual(sum(stats.lattice_states_histogram.values()), 3)
+    self.assertLen(stats.slowest, 3)
+    self.assertGreaterEqual(stats.slowest[0].seconds, stats.slowest[-1].seconds)
+
+  def testStringViewTopRewriteIsRecorded(self):
+    sink = rewrite.StatsSink()
+    self.assertEqual(
+        rewrite.top_rewrite("fist", self.rule, parse_brackets=False,
+                            stats=sink), "fist")
+    record = sink.last
+    self.assertGreater(record.lattice_states, 0)
+    self.assertEqual(record.paths, 1)
+    self.assertGreater(record.shortest_path_seconds, 0)
+
+  def testFailuresAreRecorded(self):
+    sink = rewrite.StatsSink()
+    with self.assertRaises(rewrite.Error):
+      rewrite.top_rewrite("FIST", self.rule, stats=sink)
+    self.assertEqual(sink[self.rule].failures, 1)
+
+  def testSinkDoesNotKeepRulesAlive(self):
+    sink = rewrite.StatsSink()
+    rule = self.rule.copy()
+    rewrite.top_rewrite("fist", rule, stats=sink)
+    self.assertLen(sink.items(), 1)
+    del rule
+    self.assertEmpty(sink.items())
+
+  def testCacheHitsAreNotRecorded(self):
+    cache = pynini.RewriteCache()
+    fingerprint = pynini.fingerprint(self.rule)
+    sink = rewrite.StatsSink()
+    for _ in range(2):
+      rewrite.top_rewrites("fist", self.rule, 2, cache=cache,
+                           fingerprint=fingerprint, stats=sink)
+    self.assertEqual(sink[self.rule].calls, 1)
+
+
+class CacheTest(absltest.TestCase):
+  """Tests that cached rewriting agrees with uncached rewriting."""
+
+  rule: pynini.Fst
+  fingerprint: int
+  strings = ["fist", "fish", "mist", "pit", "lift"]
+
+  @classmethod
+  def setUpClass(cls):
+    super().setUpClass()
+    sigstar = pynini.union(*string.ascii_lowercase).closure().optimize()
+    td = pynini.union("t", "d").optimize()
+    consonant = pynini.union(td, "p", "b", "f", "v", "s", "z", "k", "g", "m",
+                             "n", "l", "r").optimize()
+    cls.rule = pynini.cdrewrite(
+        pynutil.delete(td, weight=1), consonant, "[EOS]", sigstar,
+        mode="opt").optimize()
+    cls.fingerprint = pynini.fingerprint(cls.rule)
+
+  def testCachedRewritesAgree(self):
+    cache = pynini.RewriteCache()
+    for _ in range(2):
+      for istring in self.strings:
+        self.assertEqual(
+            rewrite.top_rewrite(
+                istring, self.rule, cache=cache, fingerprint=self.fingerprint),
+            rewrite.top_rewrite(istring, self.rule))
+        self.assertCountEqual(
+            rewrite.rewrites(
+                istring, self.rule, cache=cache, fingerprint=self.fingerprint),
+            rewrite.rewrites(istring, self.rule))
+        self.assertEqual(
+            rewrite.top_rewrites(
+                istring, self.rule, 2, cache=cache,
+                fingerprint=self.fingerprint),
+            rewrite.top_rewrites(istring, self.rule, 2))
+    self.assertEqual(cache.misses(), 3 * len(self.strings))
+    self.assertEqual(cache.hits(), 3 * len(self.strings))
+    self.assertLen(cache, 3 * len(self.strings))
+
+  def testCacheKeyIncludesNShortestAndTokenType(self):
+    cache = pynini.RewriteCache()
+    self.assertLen(
+        rewrite.top_rewrites(
+            "fist", self.rule, 1, cache=cache, fingerprint=self.fingerprint),
+        1)
+    self.assertLen(
+        rewrite.top_rewrites(
+            "fist", self.rule, 2, cache=cache, fingerprint=self.fingerprint),
+        2)
+    rewrite.top_rewrite(
+        "fist", self.rule, cache=cache, fingerprint=self.fingerprint)
+    rewrite.top_rewrite("fist", self.rule, output_token_type="utf8",
+                        cache=cache, fingerprint=self.fingerprint)
+    self.assertEqual(cache.hits(), 0)
+
+  def testCacheIsBoundedInBytes(self):
+    cache = pynini.RewriteCache(max_bytes=1024, num_shards=1)
+    for istring in self.strings * 20:
+      rewrite.top_rewrite(istring * 10, self.rule, cache=cache,
+                          fingerprint=self.fingerprint)
+    self.assertLessEqual(cache.num_bytes(), 1024)
+    self.assertGreater(cache.evictions(), 0)
+
+  def testMutableRuleRequiresFingerprint(self):
+    cache = pynini.RewriteCache()
+    with self.assertRaisesRegex(rewrite.Error, r"frozen rule"):
+      unused_var = rewrite.top_rewrite("fist", self.rule, cache=cache)
+    self.assertEmpty(cache)
+
+  def testFrozenRuleHitsCache(self):
+    cache = pynini.RewriteCache()
+    rule = self.rule.freeze()
+    for _ in range(2):
+      self.assertEqual(
+          rewrite.top_rewrite("fist", rule, cache=cache),
+          rewrite.top_rewrite("fist", self.rule))
+    self.assertEqual(cache.hits(), 1)
+
+  def testCompositionFailureIsNotCached(self):
+    cache = pynini.RewriteCache()
+    for _ in range(2):
+      with self.assertRaisesRegex(rewrite.Error, r"Composition failure"):
+        unused_var = rewrite.top_rewrite(
+            "FIST", self.rule, cache=cache, fingerprint=self.fingerprint)
+    self.assertEmpty(cache)
 
 
 if __name__ == "__main__":
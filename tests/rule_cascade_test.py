@@ -17,10 +17,13 @@
 # pynini.opengrm.org.
 """Tests rule cascade."""
 
+import asyncio
+from concurrent import futures
 import os
 import tempfile
 
 import pynini
+from pynini.lib import rewrite
 from pynini.lib import rule_cascade
 
 from absl.testing import absltest
@@ -71,6 +74,146 @@ class RuleCascadeTest(absltest.TestCase):
     self.assertCountEqual(self.cascade.optimal_rewrites("B"), ["B"])
     self.assertTrue(self.cascade.matches("B", "B"))
 
+  def testNoRulesRaisesException(self):
+    self.cascade.set_rules([])
+    with self.assertRaises(rule_cascade.Error):
+      self.cascade.top_rewrite("A")
+
+  def testCompositionFailureRaisesException(self):
+    self.cascade.set_rules(["DOWNCASE"])
+    with self.assertRaises(rewrite.Error):
+      self.cascade.top_rewrite("c")
+    with self.assertRaises(rewrite.Error):
+      self.cascade.matches("c", "c")
+
+  def testPrecomposedRoundtrip(self):
+    cascade = rule_cascade.RuleCascade(self.far_path, precompose=True)
+    cascade.set_rules(["DOWNCASE", "UPCASE"])
+    self.assertEqual(cascade.top_rewrite("B"), "B")
+    self.assertCountEqual(cascade.rewrites("A"), ["A"])
+    self.assertTrue(cascade.matches("A", "A"))
+    self.assertFalse(cascade.matches("A", "a"))
+
+  def testMemoryMappedRoundtrip(self):
+    far_path = tempfile.mkstemp(suffix=".far")[1]
+    self.addCleanup(os.remove, far_path)
+    fold = pynini.string_map((("A", "a"), ("B", "b"))).optimize()
+    with pynini.Far(far_path, "w", memory_map=True) as far:
+      far["DOWNCASE"] = fold
+      far["UPCASE"] = fold.invert()
+    cascade = rule_cascade.RuleCascade(far_path, memory_map=True)
+    self.assertEqual(cascade.far.get_fst().fst_type(), "const")
+    cascade.set_rules(["DOWNCASE", "UPCASE"])
+    self.assertEqual(cascade.top_rewrite("B"), "B")
+    self.assertTrue(cascade.matches("A", "A"))
+
+  def testCachedRoundtrip(self):
+    cache = pynini.RewriteCache()
+    cascade = rule_cascade.RuleCascade(self.far_path, cache=cache)
+    cascade.set_rules(["DOWNCASE", "UPCASE"])
+    for _ in range(2):
+      self.assertEqual(cascade.top_rewrite("B"), "B")
+      self.assertCountEqual(cascade.rewrites("A"), ["A"])
+    self.assertEqual(cache.misses(), 2)
+    self.assertEqual(cache.hits(), 2)
+    # A different cascade sharing the cache does not see these results.
+    downcase = rule_cascade.RuleCascade(self.far_path, cache=cache)
+    downcase.set_rules(["DOWNCASE"])
+    self.assertEqual(downcase.top_rewrite("B"), "b")
+
+  def testAsyncRoundtrip(self):
+    self.cascade.set_rules(["DOWNCASE", "UPCASE"])
+
+    async def _rewrite():
+      return await asyncio.gather(
+          self.cascade.top_rewrite_async("A"),
+          self.cascade.top_rewrite_async("B"),
+          self.cascade.rewrites_async("A"),
+          self.cascade.top_rewrites_async("B", 100),
+          self.cascade.optimal_rewrites_async("A"),
+          self.cascade.top_rewrite_async("c"),
+          return_exceptions=True)
+
+    outputs = asyncio.run(_rewrite())
+    self.assertEqual(outputs[:5], ["A", "B", ["A"], ["B"], ["A"]])
+    self.assertIsInstance(outputs[5], rewrite.Error)
+
+
+class RuleCascadeEngineTest(absltest.TestCase):
+
+  def testLazyAndPrecomposedAgree(self):
+    fold = pynini.string_map((("A", "a"), ("B", "b"))).optimize()
+    sigma = pynini.union("a", "b", "c").closure()
+    rules = [fold, pynini.cdrewrite(pynini.cross("a", "c"), "", "", sigma)]
+    lazy = pynini.RuleCascadeEngine(rules, lazy=True)
+    eager = pynini.RuleCascadeEngine(rules)
+    self.assertTrue(lazy.lazy())
+    self.assertFalse(eager.lazy())
+    for cascade in (lazy, eager):
+      self.assertEqual(cascade.top_rewrite("A"), "c")
+      self.assertEqual(cascade.top_rewrite("B"), "b")
+
+  def testLazyCascadeRewritesConcurrently(self):
+    fold = pynini.string_map((("A", "a"), ("B", "b"))).optimize()
+    sigma = pynini.union("a", "b", "c").closure()
+    rules = [fold, pynini.cdrewrite(pynini.cross("a", "c"), "", "", sigma)]
+    cascade = pynini.RuleCascadeEngine(rules, lazy=True)
+    inputs = ["AB", "BA", "AAB", "BBA"] * 25
+    with futures.ThreadPoolExecutor(max_workers=4) as executor:
+      outputs = list(executor.map(cascade.top_rewrite, inputs))
+    self.assertEqual(outputs, ["cb", "bc", "ccb", "bbc"] * 25)
+
+  def testLookAheadAgrees(self):
+    fold = pynini.string_map((("A", "a"), ("B", "b"))).optimize()
+    sigma = pynini.union("a", "b", "c").closure()
+    rules = [
+        fold,
+        pynini.cdrewrite(pynini.cross("a", "c"), "", "b", sigma),
+        pynini.cdrewrite(pynini.cross("b", "a"), "c", "", sigma)
+    ]
+    for lazy in (True, False):
+      cascade = pynini.RuleCascadeEngine(rules, lazy=lazy, lookahead=True)
+      self.assertTrue(cascade.lookahead())
+      self.assertEqual(cascade.top_rewrite("AB"), "ca")
+      self.assertEqual(cascade.top_rewrite("BA"), "ba")
+      self.assertCountEqual(cascade.rewrites("AAB"), ["aca"])
+      self.assertTrue(cascade.matches("AB", "ca"))
+      self.assertFalse(cascade.matches("AB", "ab"))
+
+  def testMemoryUsageCountsRulesAndCacheLimits(self):
+    fold = pynini.string_map((("A", "a"), ("B", "b"))).optimize()
+    sigma = pynini.union("a", "b", "c").closure()
+    rules = [fold, pynini.cdrewrite(pynini.cross("a", "c"), "", "", sigma)]
+    lazy = pynini.RuleCascadeEngine(rules, lazy=True, cache_gc_limit=4096)
+    self.assertEqual(lazy.memory_usage().caches, 4096)
+    self.assertGreater(lazy.memory_usage().arcs, 0)
+    eager = pynini.RuleCascadeEngine(rules)
+    self.assertEqual(eager.memory_usage().caches, 0)
+    self.assertGreater(eager.memory_usage().arcs, 0)
+
+  def testLabelClassRulesAgreeWithOrdinaryRules(self):
+    sigma = pynini.union(*"abcdefghijklmnopqrstuvwxyz").closure().optimize()
+    args = [(pynini.cross("a", "c"), "", "b"),
+            (pynini.cross("b", "a"), "c", "")]
+    ordinary = [pynini.cdrewrite(*arg, sigma) for arg in args]
+    classes = [pynini.label_class_cdrewrite(*arg, sigma) for arg in args]
+    # The label class rule is first, second, both, and alone.
+    for rules in ([classes[0], ordinary[1]], [ordinary[0], classes[1]],
+                  classes, classes[:1]):
+      expected = pynini.RuleCascadeEngine(ordinary[:len(rules)])
+      for (lazy, lookahead) in ((True, False), (False, False), (True, True),
+                                (False, True)):
+        cascade = pynini.RuleCascadeEngine(rules, lazy=lazy,
+                                           lookahead=lookahead)
+        for istring in ("ab", "xaby", "zcbq", "abab"):
+          self.assertEqual(cascade.top_rewrite(istring),
+                           expected.top_rewrite(istring))
+        self.assertTrue(cascade.matches("xaby", expected.top_rewrite("xaby")))
+
+  def testEmptyCascadeRaisesFstOpError(self):
+    with self.assertRaises(pynini.FstOpError):
+      pynini.RuleCascadeEngine([])
+
 
 if __name__ == "__main__":
   absltest.main()
@@ -56,11 +56,27 @@ class TaggerTest(absltest.TestCase):
         "<cheese>emmental</cheese> or "
         "<cheese>edam</cheese>")
 
+  def testFstMatchesString(self):
+    request = "do you have tilsit caerphilly gruyere emmental or edam"
+    self.assertEqual(
+        self.tagger.tag(pynini.accep(request)), self.tagger.tag(request))
+
+  def testStream(self):
+    request = "do you have tilsit caerphilly gruyere emmental or edam"
+    # Splits the request mid-word, so that matches span chunks.
+    chunks = [request[i:i + 4] for i in range(0, len(request), 4)]
+    self.assertEqual("".join(self.tagger.tag_stream(chunks)),
+                     self.tagger.tag(request))
+
   def testOutofAlphabetQueryRaisesException(self):
     request = "Gruyère"
     with self.assertRaises(rewrite.Error):
       self.tagger.tag(request)
 
+  def testOutofAlphabetStreamRaisesException(self):
+    with self.assertRaises(rewrite.Error):
+      list(self.tagger.tag_stream(["do you have ", "Gruyère"]))
+
 
 if __name__ == "__main__":
   absltest.main()